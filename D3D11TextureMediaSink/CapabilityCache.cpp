@@ -0,0 +1,163 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	CapabilityCache::CapabilityCache()
+	{
+	}
+	CapabilityCache::~CapabilityCache()
+	{
+	}
+
+	HRESULT CapabilityCache::MakeKey(IMFMediaType* pMediaType, _Out_ CapabilityKey* pKey, _Out_opt_ UINT32* pWidth, _Out_opt_ UINT32* pHeight)
+	{
+		if (NULL == pMediaType || NULL == pKey)
+			return E_POINTER;
+
+		HRESULT hr;
+
+		ZeroMemory(pKey, sizeof(CapabilityKey));
+
+		if (FAILED(hr = pMediaType->GetGUID(MF_MT_SUBTYPE, &pKey->Subtype)))
+			return hr;
+
+		UINT32 width = 0, height = 0;
+		if (FAILED(hr = ::MFGetAttributeSize(pMediaType, MF_MT_FRAME_SIZE, &width, &height)))
+			return hr;
+		pKey->WidthBucket = (width + CAPABILITY_SIZE_BUCKET - 1) / CAPABILITY_SIZE_BUCKET * CAPABILITY_SIZE_BUCKET;
+		pKey->HeightBucket = (height + CAPABILITY_SIZE_BUCKET - 1) / CAPABILITY_SIZE_BUCKET * CAPABILITY_SIZE_BUCKET;
+		if (NULL != pWidth)
+			*pWidth = width;
+		if (NULL != pHeight)
+			*pHeight = height;
+
+		pKey->FrameRateNumerator = 30000;
+		pKey->FrameRateDenominator = 1001;
+		::MFGetAttributeRatio(pMediaType, MF_MT_FRAME_RATE, &pKey->FrameRateNumerator, &pKey->FrameRateDenominator);
+
+		pKey->Interlaced = (MFVideoInterlace_Progressive != ::MFGetAttributeUINT32(pMediaType, MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+
+		return S_OK;
+	}
+	BOOL CapabilityCache::IsCacheable(HRESULT hr)
+	{
+		return (S_OK == hr || MF_E_INVALIDMEDIATYPE == hr || MF_E_UNSUPPORTED_D3D_TYPE == hr || E_INVALIDARG == hr);
+	}
+
+	HRESULT CapabilityCache::Negotiate(IMFMediaType* pMediaType, CapabilityProvider* pProvider, _Out_ DXGI_FORMAT* pDXGIFormat)
+	{
+		if (NULL == pProvider || NULL == pDXGIFormat)
+			return E_POINTER;
+
+		HRESULT hr;
+
+		// Get what decides the support.
+		CapabilityKey key;
+		UINT32 width = 0, height = 0;
+		if (FAILED(hr = MakeKey(pMediaType, &key, &width, &height)))
+			return hr;
+
+		// Topology resolution probes the same types again and again; the answer for this device is usually known.
+		CapabilityResult result;
+		if (!this->Find(key, &result))
+		{
+			result.Format = DXGI_FORMAT_UNKNOWN;
+			result.Result = pProvider->CheckMediaType(key, width, height, &result.Format);
+			if (IsCacheable(result.Result))
+				this->Insert(key, result);
+		}
+
+		*pDXGIFormat = result.Format;
+		return result.Result;
+	}
+	BOOL CapabilityCache::Find(const CapabilityKey& key, _Out_ CapabilityResult* pResult)
+	{
+		AutoLock lock(&this->_csCache);
+
+		UINT index = Hash(key);
+		for (UINT i = 0; i < CAPABILITY_CACHE_SLOTS; i++)
+		{
+			Slot* pSlot = &this->_Slots[(index + i) & (CAPABILITY_CACHE_SLOTS - 1)];
+			if (!pSlot->Used)
+				break;	// Nothing is removed one by one, so the chain ends here.
+
+			if (IsEqual(pSlot->Key, key))
+			{
+				*pResult = pSlot->Value;
+				this->_Hits++;
+				return TRUE;
+			}
+		}
+
+		this->_Misses++;
+		return FALSE;
+	}
+	void CapabilityCache::Insert(const CapabilityKey& key, const CapabilityResult& result)
+	{
+		AutoLock lock(&this->_csCache);
+
+		// Keep the table at most 3/4 full, so that the chains stay short.
+		if (this->_Count >= CAPABILITY_CACHE_SLOTS * 3 / 4)
+		{
+			ZeroMemory(this->_Slots, sizeof(this->_Slots));
+			this->_Count = 0;
+		}
+
+		UINT index = Hash(key);
+		for (UINT i = 0; i < CAPABILITY_CACHE_SLOTS; i++)
+		{
+			Slot* pSlot = &this->_Slots[(index + i) & (CAPABILITY_CACHE_SLOTS - 1)];
+			if (pSlot->Used && !IsEqual(pSlot->Key, key))
+				continue;
+
+			if (!pSlot->Used)
+				this->_Count++;
+
+			pSlot->Used = TRUE;
+			pSlot->Key = key;
+			pSlot->Value = result;
+			return;
+		}
+	}
+	void CapabilityCache::Invalidate()
+	{
+		AutoLock lock(&this->_csCache);
+
+		ZeroMemory(this->_Slots, sizeof(this->_Slots));
+		this->_Count = 0;
+	}
+	UINT64 CapabilityCache::GetHitCount()
+	{
+		AutoLock lock(&this->_csCache);
+
+		return this->_Hits;
+	}
+	UINT64 CapabilityCache::GetMissCount()
+	{
+		AutoLock lock(&this->_csCache);
+
+		return this->_Misses;
+	}
+
+	// private
+
+	UINT CapabilityCache::Hash(const CapabilityKey& key)
+	{
+		// FNV-1a over the fields.
+		UINT32 values[5] = { key.WidthBucket, key.HeightBucket, key.FrameRateNumerator, key.FrameRateDenominator, (UINT32)key.Interlaced };
+		UINT hash = Fnv1a(&key.Subtype, sizeof(GUID));
+		hash = Fnv1a(values, sizeof(values), hash);
+
+		return hash & (CAPABILITY_CACHE_SLOTS - 1);
+	}
+	BOOL CapabilityCache::IsEqual(const CapabilityKey& key1, const CapabilityKey& key2)
+	{
+		return
+			key1.Subtype == key2.Subtype &&
+			key1.WidthBucket == key2.WidthBucket &&
+			key1.HeightBucket == key2.HeightBucket &&
+			key1.FrameRateNumerator == key2.FrameRateNumerator &&
+			key1.FrameRateDenominator == key2.FrameRateDenominator &&
+			key1.Interlaced == key2.Interlaced;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#define CAPABILITY_CACHE_SLOTS		256		// Power of 2. Topology resolution probes a few dozen types.
+#define CAPABILITY_SIZE_BUCKET		16		// Frame sizes are rounded up to this; the support does not change within it.
+
+namespace D3D11TextureMediaSink
+{
+	// What decides whether a media type is supported.
+	struct CapabilityKey
+	{
+		GUID Subtype;
+		UINT32 WidthBucket;		// Rounded up to CAPABILITY_SIZE_BUCKET.
+		UINT32 HeightBucket;	//
+		UINT32 FrameRateNumerator;
+		UINT32 FrameRateDenominator;
+		BOOL Interlaced;
+	};
+
+	struct CapabilityResult
+	{
+		HRESULT Result;			// S_OK if supported.
+		DXGI_FORMAT Format;		// DXGI format of the subtype.
+	};
+
+	// What answers a media type probe the cache does not know.
+	class CapabilityProvider
+	{
+	public:
+		virtual ~CapabilityProvider() {}
+
+		// width, height: the frame size itself, not the bucket of the key.
+		virtual HRESULT CheckMediaType(const CapabilityKey& key, UINT32 width, UINT32 height, _Out_ DXGI_FORMAT* pDXGIFormat) = 0;
+	};
+
+	// Results of the media type negotiation for one device, so that probing a type again costs a hash lookup rather than
+	// creating a video processor enumerator. An open-addressed table with linear probing; when it is full, it starts over.
+	// Invalidate when the device changes.
+	//
+	class CapabilityCache
+	{
+	public:
+		CapabilityCache();
+		~CapabilityCache();
+
+		static HRESULT MakeKey(IMFMediaType* pMediaType, _Out_ CapabilityKey* pKey, _Out_opt_ UINT32* pWidth = NULL, _Out_opt_ UINT32* pHeight = NULL);	// pWidth, pHeight: the frame size itself, to probe with.
+		static BOOL IsCacheable(HRESULT hr);	// Only definite answers are kept; not transient errors.
+
+		HRESULT Negotiate(IMFMediaType* pMediaType, CapabilityProvider* pProvider, _Out_ DXGI_FORMAT* pDXGIFormat);	// From the cache, or the provider.
+		BOOL Find(const CapabilityKey& key, _Out_ CapabilityResult* pResult);
+		void Insert(const CapabilityKey& key, const CapabilityResult& result);
+		void Invalidate();
+
+		UINT64 GetHitCount();
+		UINT64 GetMissCount();
+
+	private:
+		struct Slot
+		{
+			BOOL Used;
+			CapabilityKey Key;
+			CapabilityResult Value;
+		};
+
+		Slot _Slots[CAPABILITY_CACHE_SLOTS] = {};
+		UINT _Count = 0;
+		UINT64 _Hits = 0;
+		UINT64 _Misses = 0;
+		CriticalSection _csCache;
+
+		static UINT Hash(const CapabilityKey& key);
+		static BOOL IsEqual(const CapabilityKey& key1, const CapabilityKey& key2);
+	};
+}
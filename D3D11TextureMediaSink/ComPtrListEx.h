@@ -3,6 +3,7 @@
 namespace D3D11TextureMediaSink
 {
 	// Doubly-linked list containing COM objects.
+	// Removed nodes are kept in a free-list and reused by later insertions, so a list with a steady length does not hit the allocator.
 	//
 	template <class T, bool NULLABLE = FALSE>
 	class ComPtrListEx
@@ -72,8 +73,56 @@ namespace D3D11TextureMediaSink
 		};
 
 	protected:
-		Node    m_anchor;  // Anchor node for the linked list.
-		DWORD   m_count;   // Number of items in the list.
+		static const DWORD FREE_LIST_MAX = 32;	// Maximum number of nodes kept for reuse.
+
+		Node    m_anchor;     // Anchor node for the linked list.
+		DWORD   m_count;      // Number of items in the list.
+		Node*   m_freeList;   // Singly-linked (through next) list of nodes available for reuse.
+		DWORD   m_freeCount;  // Number of nodes in the free-list.
+
+		// AllocNode: Takes a node from the free-list, or creates a new one when the free-list is empty.
+		Node* AllocNode(Ptr item)
+		{
+			if (m_freeList == NULL)
+			{
+				return new Node(item);
+			}
+
+			Node *pNode = m_freeList;
+			m_freeList = pNode->next;
+			m_freeCount--;
+
+			pNode->prev = NULL;
+			pNode->next = NULL;
+			pNode->item = item;
+			if (item)
+			{
+				item->AddRef();
+			}
+
+			return pNode;
+		}
+
+		// FreeNode: Releases the item of the node and returns the node to the free-list.
+		void FreeNode(Node *pNode)
+		{
+			if (pNode->item)
+			{
+				pNode->item->Release();
+				pNode->item = NULL;
+			}
+
+			if (m_freeCount >= FREE_LIST_MAX)
+			{
+				delete pNode;
+				return;
+			}
+
+			pNode->prev = NULL;
+			pNode->next = m_freeList;
+			m_freeList = pNode;
+			m_freeCount++;
+		}
 
 		Node* Front() const
 		{
@@ -98,7 +147,7 @@ namespace D3D11TextureMediaSink
 				return E_POINTER;
 			}
 
-			Node *pNode = new Node(item);
+			Node *pNode = AllocNode(item);
 			if (pNode == NULL)
 			{
 				return E_OUTOFMEMORY;
@@ -171,7 +220,7 @@ namespace D3D11TextureMediaSink
 				}
 			}
 
-			delete pNode;
+			FreeNode(pNode);
 			m_count--;
 
 			return S_OK;
@@ -185,28 +234,34 @@ namespace D3D11TextureMediaSink
 			m_anchor.prev = &m_anchor;
 
 			m_count = 0;
+
+			m_freeList = NULL;
+			m_freeCount = 0;
 		}
 
 		virtual ~ComPtrListEx()
 		{
 			Clear();
+
+			// Delete the nodes kept for reuse.
+			while (m_freeList != NULL)
+			{
+				Node *tmp = m_freeList->next;
+				delete m_freeList;
+				m_freeList = tmp;
+			}
+			m_freeCount = 0;
 		}
 
 		void Clear()
 		{
 			Node *n = m_anchor.next;
 
-			// Delete the nodes
+			// Return the nodes to the free-list
 			while (n != &m_anchor)
 			{
-				if (n->item)
-				{
-					n->item->Release();
-					n->item = NULL;
-				}
-
 				Node *tmp = n->next;
-				delete n;
+				FreeNode(n);
 				n = tmp;
 			}
 
@@ -0,0 +1,305 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// Array-backed ring buffer containing COM objects.
+	// Has the same insertion/removal surface as ComPtrListEx, but does not allocate per element.
+	// The array only grows (doubles) when it becomes full, so a queue with a steady depth never hits the allocator.
+	//
+	template <class T, bool NULLABLE = FALSE>
+	class ComPtrRing
+	{
+	protected:
+		typedef T* Ptr;
+
+		Ptr*    m_items;     // Array of elements. Each element holds one reference.
+		DWORD   m_capacity;  // Number of slots in the array.
+		DWORD   m_head;      // Index of the front element.
+		DWORD   m_count;     // Number of items in the ring.
+
+		DWORD IndexOf(DWORD offset) const
+		{
+			return (m_head + offset) % m_capacity;
+		}
+
+		HRESULT Grow()
+		{
+			DWORD newCapacity = (m_capacity == 0) ? INITIAL_CAPACITY : m_capacity * 2;
+
+			Ptr* pNewItems = new Ptr[newCapacity];
+			if (pNewItems == NULL)
+				return E_OUTOFMEMORY;
+
+			// Copy the elements so that the front comes to index 0. References move with the elements.
+			for (DWORD i = 0; i < m_count; i++)
+				pNewItems[i] = m_items[IndexOf(i)];
+
+			delete[] m_items;
+			m_items = pNewItems;
+			m_capacity = newCapacity;
+			m_head = 0;
+
+			return S_OK;
+		}
+
+		// TakeItem:
+		// Clears the slot and hands its reference to ppItem, or releases it if ppItem is NULL.
+		void TakeItem(DWORD index, Ptr *ppItem)
+		{
+			Ptr item = m_items[index];
+			m_items[index] = NULL;
+
+			if (ppItem)
+			{
+				*ppItem = item;	// The reference held by the slot is transferred to the caller.
+			}
+			else if (item)
+			{
+				item->Release();
+			}
+		}
+
+	public:
+		static const DWORD INITIAL_CAPACITY = 8;
+
+		ComPtrRing()
+		{
+			m_items = NULL;
+			m_capacity = 0;
+			m_head = 0;
+			m_count = 0;
+		}
+
+		virtual ~ComPtrRing()
+		{
+			Clear();
+			delete[] m_items;
+		}
+
+		void Clear()
+		{
+			for (DWORD i = 0; i < m_count; i++)
+				TakeItem(IndexOf(i), NULL);
+
+			m_head = 0;
+			m_count = 0;
+		}
+
+		// Insertion functions
+		HRESULT InsertBack(Ptr item)
+		{
+			// Do not allow NULL item pointers unless NULLABLE is true.
+			if (!item && !NULLABLE)
+			{
+				return E_POINTER;
+			}
+
+			HRESULT hr;
+			if (m_count == m_capacity)
+			{
+				if (FAILED(hr = Grow()))
+					return hr;
+			}
+
+			m_items[IndexOf(m_count)] = item;
+			if (item)
+			{
+				item->AddRef();
+			}
+			m_count++;
+
+			return S_OK;
+		}
+
+		HRESULT InsertFront(Ptr item)
+		{
+			// Do not allow NULL item pointers unless NULLABLE is true.
+			if (!item && !NULLABLE)
+			{
+				return E_POINTER;
+			}
+
+			HRESULT hr;
+			if (m_count == m_capacity)
+			{
+				if (FAILED(hr = Grow()))
+					return hr;
+			}
+
+			m_head = (m_head + m_capacity - 1) % m_capacity;
+			m_items[m_head] = item;
+			if (item)
+			{
+				item->AddRef();
+			}
+			m_count++;
+
+			return S_OK;
+		}
+
+		// InsertAt: Inserts the item so that it comes at the offset from the front.
+		HRESULT InsertAt(DWORD offset, Ptr item)
+		{
+			if (offset > m_count)
+			{
+				return E_INVALIDARG;
+			}
+			if (offset == 0)
+			{
+				return InsertFront(item);
+			}
+			if (offset == m_count)
+			{
+				return InsertBack(item);
+			}
+
+			// Do not allow NULL item pointers unless NULLABLE is true.
+			if (!item && !NULLABLE)
+			{
+				return E_POINTER;
+			}
+
+			HRESULT hr;
+			if (m_count == m_capacity)
+			{
+				if (FAILED(hr = Grow()))
+					return hr;
+			}
+
+			// Move the items from the offset on back by one.
+			for (DWORD i = m_count; i > offset; i--)
+				m_items[IndexOf(i)] = m_items[IndexOf(i - 1)];
+
+			m_items[IndexOf(offset)] = item;
+			if (item)
+			{
+				item->AddRef();
+			}
+			m_count++;
+
+			return S_OK;
+		}
+
+		// RemoveAt: Removes the item at the offset from the front and returns the value.
+		// ppItem can be NULL if you don't want the item back.
+		HRESULT RemoveAt(DWORD offset, Ptr *ppItem)
+		{
+			if (offset >= m_count)
+			{
+				return E_INVALIDARG;
+			}
+
+			TakeItem(IndexOf(offset), ppItem);
+
+			// Move the items after the offset forward by one.
+			for (DWORD i = offset; i < m_count - 1; i++)
+				m_items[IndexOf(i)] = m_items[IndexOf(i + 1)];
+			m_items[IndexOf(m_count - 1)] = NULL;
+			m_count--;
+
+			return S_OK;
+		}
+
+		// RemoveBack: Removes the tail of the ring and returns the value.
+		// ppItem can be NULL if you don't want the item back.
+		HRESULT RemoveBack(Ptr *ppItem)
+		{
+			if (IsEmpty())
+			{
+				return E_FAIL;
+			}
+
+			TakeItem(IndexOf(m_count - 1), ppItem);
+			m_count--;
+
+			return S_OK;
+		}
+
+		// RemoveFront: Removes the head of the ring and returns the value.
+		// ppItem can be NULL if you don't want the item back.
+		HRESULT RemoveFront(Ptr *ppItem)
+		{
+			if (IsEmpty())
+			{
+				return E_FAIL;
+			}
+
+			TakeItem(m_head, ppItem);
+			m_head = (m_head + 1) % m_capacity;
+			m_count--;
+
+			return S_OK;
+		}
+
+		// GetBack: Gets the tail item.
+		HRESULT GetBack(Ptr *ppItem)
+		{
+			if (IsEmpty())
+			{
+				return E_FAIL;
+			}
+			if (ppItem == NULL)
+			{
+				return E_POINTER;
+			}
+
+			*ppItem = m_items[IndexOf(m_count - 1)];
+			if (*ppItem)
+			{
+				(*ppItem)->AddRef();
+			}
+
+			return S_OK;
+		}
+
+		// GetFront: Gets the front item.
+		HRESULT GetFront(Ptr *ppItem)
+		{
+			if (IsEmpty())
+			{
+				return E_FAIL;
+			}
+			if (ppItem == NULL)
+			{
+				return E_POINTER;
+			}
+
+			*ppItem = m_items[m_head];
+			if (*ppItem)
+			{
+				(*ppItem)->AddRef();
+			}
+
+			return S_OK;
+		}
+
+		// GetAt: Gets the item at the offset from the front.
+		HRESULT GetAt(DWORD offset, Ptr *ppItem)
+		{
+			if (offset >= m_count)
+			{
+				return E_INVALIDARG;
+			}
+			if (ppItem == NULL)
+			{
+				return E_POINTER;
+			}
+
+			*ppItem = m_items[IndexOf(offset)];
+			if (*ppItem)
+			{
+				(*ppItem)->AddRef();
+			}
+
+			return S_OK;
+		}
+
+		// GetCount: Returns the number of items in the ring.
+		DWORD GetCount() const { return m_count; }
+
+		bool IsEmpty() const
+		{
+			return (GetCount() == 0);
+		}
+	};
+}
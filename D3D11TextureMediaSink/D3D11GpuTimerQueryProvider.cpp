@@ -0,0 +1,115 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	D3D11GpuTimerQueryProvider::D3D11GpuTimerQueryProvider()
+	{
+	}
+	D3D11GpuTimerQueryProvider::~D3D11GpuTimerQueryProvider()
+	{
+		this->Release();
+	}
+
+	HRESULT D3D11GpuTimerQueryProvider::Initialize(ID3D11Device* pDevice)
+	{
+		if (NULL == pDevice)
+			return E_POINTER;
+
+		HRESULT hr = S_OK;
+
+		this->Release();
+
+		do
+		{
+			D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+			D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+
+			for (UINT i = 0; i < GPU_TIMER_QUERY_SLOTS; i++)
+			{
+				if (FAILED(hr = pDevice->CreateQuery(&disjointDesc, &this->_Queries[i].Disjoint)))
+					break;
+				if (FAILED(hr = pDevice->CreateQuery(&timestampDesc, &this->_Queries[i].Begin)))
+					break;
+				if (FAILED(hr = pDevice->CreateQuery(&timestampDesc, &this->_Queries[i].End)))
+					break;
+			}
+			if (FAILED(hr))
+				break;
+
+			pDevice->GetImmediateContext(&this->_DeviceContext);
+
+		} while (FALSE);
+
+		if (FAILED(hr))
+			this->Release();
+
+		return hr;
+	}
+
+	HRESULT D3D11GpuTimerQueryProvider::Begin(UINT slot)
+	{
+		if (NULL == this->_DeviceContext || slot >= GPU_TIMER_QUERY_SLOTS)
+			return E_UNEXPECTED;
+
+		this->_DeviceContext->Begin(this->_Queries[slot].Disjoint);
+		this->_DeviceContext->End(this->_Queries[slot].Begin);
+
+		return S_OK;
+	}
+	HRESULT D3D11GpuTimerQueryProvider::End(UINT slot)
+	{
+		if (NULL == this->_DeviceContext || slot >= GPU_TIMER_QUERY_SLOTS)
+			return E_UNEXPECTED;
+
+		this->_DeviceContext->End(this->_Queries[slot].End);
+		this->_DeviceContext->End(this->_Queries[slot].Disjoint);
+
+		return S_OK;
+	}
+	HRESULT D3D11GpuTimerQueryProvider::GetResult(UINT slot, _Out_ BOOL* pbValid, _Out_ LONGLONG* phnsTime)
+	{
+		if (NULL == pbValid || NULL == phnsTime)
+			return E_POINTER;
+
+		*pbValid = FALSE;
+		*phnsTime = 0;
+
+		if (NULL == this->_DeviceContext || slot >= GPU_TIMER_QUERY_SLOTS)
+			return E_UNEXPECTED;
+
+		HRESULT hr;
+
+		// Do not flush: the results are polled, and they will be there after the next present anyway.
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		if (S_OK != (hr = this->_DeviceContext->GetData(this->_Queries[slot].Disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH)))
+			return hr;	// S_FALSE or an error.
+
+		UINT64 beginTicks = 0, endTicks = 0;
+		if (S_OK != (hr = this->_DeviceContext->GetData(this->_Queries[slot].Begin, &beginTicks, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH)))
+			return hr;
+		if (S_OK != (hr = this->_DeviceContext->GetData(this->_Queries[slot].End, &endTicks, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH)))
+			return hr;
+
+		// The timestamps are meaningless if the GPU clock changed in between (power management, etc.).
+		if (disjoint.Disjoint || 0 == disjoint.Frequency || endTicks < beginTicks)
+			return S_OK;
+
+		*phnsTime = (LONGLONG)((endTicks - beginTicks) * 10000000ULL / disjoint.Frequency);
+		*pbValid = TRUE;
+
+		return S_OK;
+	}
+
+	// private
+
+	void D3D11GpuTimerQueryProvider::Release()
+	{
+		for (UINT i = 0; i < GPU_TIMER_QUERY_SLOTS; i++)
+		{
+			SafeRelease(this->_Queries[i].Disjoint);
+			SafeRelease(this->_Queries[i].Begin);
+			SafeRelease(this->_Queries[i].End);
+		}
+		SafeRelease(this->_DeviceContext);
+	}
+}
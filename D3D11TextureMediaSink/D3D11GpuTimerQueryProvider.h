@@ -0,0 +1,34 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// GpuTimerQueryProvider with D3D11 queries: a TIMESTAMP_DISJOINT query around two TIMESTAMP queries per slot.
+	// The caller must serialize the use of the immediate context, as for any other work on it.
+	//
+	class D3D11GpuTimerQueryProvider : public GpuTimerQueryProvider
+	{
+	public:
+		D3D11GpuTimerQueryProvider();
+		~D3D11GpuTimerQueryProvider();
+
+		HRESULT Initialize(ID3D11Device* pDevice);
+
+		// GpuTimerQueryProvider
+		HRESULT Begin(UINT slot);
+		HRESULT End(UINT slot);
+		HRESULT GetResult(UINT slot, _Out_ BOOL* pbValid, _Out_ LONGLONG* phnsTime);
+
+	private:
+		struct Queries
+		{
+			ID3D11Query* Disjoint;
+			ID3D11Query* Begin;
+			ID3D11Query* End;
+		};
+
+		ID3D11DeviceContext* _DeviceContext = NULL;
+		Queries _Queries[GPU_TIMER_QUERY_SLOTS] = {};
+
+		void Release();
+	};
+}
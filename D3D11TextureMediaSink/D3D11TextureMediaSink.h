@@ -9,9 +9,279 @@ DEFINE_GUID(CLSID_D3D11TextureMediaSink, 0x6a0d25f9, 0x1a0b, 0x4512, 0xae, 0xac,
 DEFINE_GUID(CLSID_D3D11TextureMediaSinkActivate, 0x9ea010e9, 0x21e3, 0x4e07, 0xa9, 0xee, 0xa, 0xb5, 0x5d, 0x62, 0x4e, 0xab);
 
 // Attribute GUID used to receive IMFSample from D3D11TextureMediaSink.
+// GetUnknown locks the presented sample and SetUnknown unlocks it. Unlock as soon as the work on the texture is submitted to the
+// immediate context of the same device; the sink does not reuse the texture before the GPU is done with it when it can avoid it.
 // {87468A84-1CD6-41E3-9522-A8625EB3A5F8}
 DEFINE_GUID(TMS_SAMPLE, 0x87468a84, 0x1cd6, 0x41e3, 0x95, 0x22, 0xa8, 0x62, 0x5e, 0xb3, 0xa5, 0xf8);
 
+// Attribute GUIDs of D3D11TextureMediaSink for the texture memory budget shared by all sinks in the process.
+// {7C2025AE-9420-4591-B7FB-5FDBF2CD5330}
+// (UINT64, get/set) Budget in bytes.
+DEFINE_GUID(TMS_MEMORY_BUDGET, 0x7c2025ae, 0x9420, 0x4591, 0xb7, 0xfb, 0x5f, 0xdb, 0xf2, 0xcd, 0x53, 0x30);
+// {1ED57D09-C365-4380-A01C-A9C0E783AE6A}
+// (UINT32, get/set) What to do when the budget is exceeded. One of TMS_MEMORY_POLICY_*.
+DEFINE_GUID(TMS_MEMORY_POLICY, 0x1ed57d09, 0xc365, 0x4380, 0xa0, 0x1c, 0xa9, 0xc0, 0xe7, 0x83, 0xae, 0x6a);
+#define TMS_MEMORY_POLICY_SHRINK_POOLS			0	// Destroy the cached pools of the other frame sizes. (default)
+#define TMS_MEMORY_POLICY_LOWER_OUTPUT_SIZE		1	// Also scale the output down (1/2, 1/4, 1/8) to fit in the budget.
+#define TMS_MEMORY_POLICY_REFUSE_NEW_STREAMS	2	// Fail the creation of new sinks while the budget is exceeded.
+// {79D34FED-7C11-44ED-BA40-5D64CED55785}
+// (UINT64, get) Bytes currently held by the textures of this sink.
+DEFINE_GUID(TMS_MEMORY_CURRENT_BYTES, 0x79d34fed, 0x7c11, 0x44ed, 0xba, 0x40, 0x5d, 0x64, 0xce, 0xd5, 0x57, 0x85);
+// {9600D050-8404-4787-B8E0-27577A29C864}
+// (UINT64, get) Peak bytes held by the textures of this sink.
+DEFINE_GUID(TMS_MEMORY_PEAK_BYTES, 0x9600d050, 0x8404, 0x4787, 0xb8, 0xe0, 0x27, 0x57, 0x7a, 0x29, 0xc8, 0x64);
+// {CF70BE86-C1C7-43E9-9D98-5D322F6601ED}
+// (UINT64, get) Bytes currently held by the textures of all sinks in the process.
+DEFINE_GUID(TMS_MEMORY_TOTAL_BYTES, 0xcf70be86, 0xc1c7, 0x43e9, 0x9d, 0x98, 0x5d, 0x32, 0x2f, 0x66, 0x01, 0xed);
+
+// Attribute GUID of D3D11TextureMediaSink to enable the passthrough mode.
+// (UINT32, get/set) If TRUE, when a frame needs no conversion (same format and size, progressive), the decoder's texture is
+// presented as is instead of being copied. The decoder's sample is then held until the presented sample is released.
+// {067A8127-E97C-4FDE-8789-3F8400053B77}
+DEFINE_GUID(TMS_PASSTHROUGH, 0x067a8127, 0xe97c, 0x4fde, 0x87, 0x89, 0x3f, 0x84, 0x00, 0x05, 0x3b, 0x77);
+
+// Attribute GUID of D3D11TextureMediaSink to select the format of the output textures.
+// (UINT32, get/set) A DXGI_FORMAT: DXGI_FORMAT_B8G8R8A8_UNORM (default), DXGI_FORMAT_R10G10B10A2_UNORM, DXGI_FORMAT_NV12 or DXGI_FORMAT_P010.
+// {85F0BEA7-C05C-4546-9DF0-5A05FF3B1E87}
+DEFINE_GUID(TMS_OUTPUT_FORMAT, 0x85f0bea7, 0xc05c, 0x4546, 0x9d, 0xf0, 0x5a, 0x05, 0xff, 0x3b, 0x1e, 0x87);
+
+// Attribute GUID of D3D11TextureMediaSink to share the immediate context safely with the application's render thread.
+// (UINT32, get/set) TRUE to turn on the multithread protection of the device (ID3D10Multithread), and submit the work of each
+// frame inside Enter/Leave so that it is not interleaved with the calls of other threads. Default: FALSE.
+// {5242B1E6-C2C2-406A-ACBF-8FB661A3C1DA}
+DEFINE_GUID(TMS_MULTITHREAD_PROTECTION, 0x5242b1e6, 0xc2c2, 0x406a, 0xac, 0xbf, 0x8f, 0xb6, 0x61, 0xa3, 0xc1, 0xda);
+
+// Attribute GUIDs of D3D11TextureMediaSink for the frame rate conversion (FRC).
+// When enabled, the frames are presented on a steady grid of output ticks at the target rate instead of at their own times.
+// {1E700F40-5FDB-4B61-9DD0-46CDC0B7CFD8}
+// (UINT32, get/set) One of TMS_FRC_MODE_*. Setting it resets the statistics below.
+DEFINE_GUID(TMS_FRC_MODE, 0x1e700f40, 0x5fdb, 0x4b61, 0x9d, 0xd0, 0x46, 0xcd, 0xc0, 0xb7, 0xcf, 0xd8);
+#define TMS_FRC_MODE_OFF			0	// Present the frames at their own times. (default)
+#define TMS_FRC_MODE_REPEAT_SKIP	1	// At each tick, present the nearest frame; frames are repeated or skipped.
+#define TMS_FRC_MODE_BLEND			2	// At each tick, present a linear blend of the two frames around it.
+// {7779773D-42AF-4C82-9AD0-8A12096E0CD1}
+// (UINT64, get/set) Target rate, packed as MF_MT_FRAME_RATE (use MFSetAttributeRatio/MFGetAttributeRatio). Default: 60/1.
+DEFINE_GUID(TMS_FRC_TARGET_RATE, 0x7779773d, 0x42af, 0x4c82, 0x9a, 0xd0, 0x8a, 0x12, 0x09, 0x6e, 0x0c, 0xd1);
+// {FD932AEA-3D2F-4A0F-9B1F-BE079801E0D8}
+// (UINT64, get) Number of output ticks.
+DEFINE_GUID(TMS_FRC_TICK_COUNT, 0xfd932aea, 0x3d2f, 0x4a0f, 0x9b, 0x1f, 0xbe, 0x07, 0x98, 0x01, 0xe0, 0xd8);
+// {3A9CABED-E4B6-4298-94E7-85CBDB66AB80}
+// (UINT64, get) Number of ticks that repeated the previous output.
+DEFINE_GUID(TMS_FRC_REPEAT_COUNT, 0x3a9cabed, 0xe4b6, 0x4298, 0x94, 0xe7, 0x85, 0xcb, 0xdb, 0x66, 0xab, 0x80);
+// {BB1E26E0-A546-41BB-8049-A3910CB142A9}
+// (UINT64, get) Number of source frames that were never shown.
+DEFINE_GUID(TMS_FRC_SKIP_COUNT, 0xbb1e26e0, 0xa546, 0x41bb, 0x80, 0x49, 0xa3, 0x91, 0x0c, 0xb1, 0x42, 0xa9);
+// {049F61CD-F66B-421A-A270-0D077201CA90}
+// (UINT64, get) Number of ticks that presented a blend of two frames.
+DEFINE_GUID(TMS_FRC_BLEND_COUNT, 0x049f61cd, 0xf66b, 0x421a, 0xa2, 0x70, 0x0d, 0x07, 0x72, 0x01, 0xca, 0x90);
+// {0CEB52B5-65CA-4243-8A98-4439699D70E5}
+// (UINT64, get) Largest judder in 100ns units. The judder of a tick is how far the source time shown advanced unlike the tick interval.
+DEFINE_GUID(TMS_FRC_JUDDER_MAX, 0x0ceb52b5, 0x65ca, 0x4243, 0x8a, 0x98, 0x44, 0x39, 0x69, 0x9d, 0x70, 0xe5);
+// {890FCA64-4840-4FD1-83B3-5224E7BCCD21}
+// (UINT64, get) Mean judder per tick in 100ns units.
+DEFINE_GUID(TMS_FRC_JUDDER_MEAN, 0x890fca64, 0x4840, 0x4fd1, 0x83, 0xb3, 0x52, 0x24, 0xe7, 0xbc, 0xcd, 0x21);
+
+// Attribute GUIDs of D3D11TextureMediaSink for fast and reverse playback.
+// Above 2x (either direction), only the frames that can actually be shown are video-processed; the others are dropped on arrival.
+// {63A0806A-02E2-43B2-92BA-D765C0CE2735}
+// (UINT32, get) TRUE while the frames are being thinned.
+DEFINE_GUID(TMS_TRICKPLAY_THINNING, 0x63a0806a, 0x02e2, 0x43b2, 0x92, 0xba, 0xd7, 0x65, 0xc0, 0xce, 0x27, 0x35);
+// {265A8032-DF29-4F7A-81FE-AEF83C9E1B5D}
+// (UINT64, get) Number of frames dropped by the thinning.
+DEFINE_GUID(TMS_TRICKPLAY_THINNED_COUNT, 0x265a8032, 0xdf29, 0x4f7a, 0x81, 0xfe, 0xae, 0xf8, 0x3c, 0x9e, 0x1b, 0x5d);
+
+// Attribute GUIDs of D3D11TextureMediaSink for the GPU time of the video processing.
+// When enabled, each blit is bracketed by GPU timestamp queries, which are read a few frames later without stalling the GPU.
+// {E86E810E-1B5F-44CC-A6D1-F92362882104}
+// (UINT32, get/set) TRUE to measure. Default: FALSE. Setting it resets the statistics below.
+DEFINE_GUID(TMS_GPU_TIMING, 0xe86e810e, 0x1b5f, 0x44cc, 0xa6, 0xd1, 0xf9, 0x23, 0x62, 0x88, 0x21, 0x04);
+// {9305E27A-F2DF-4E57-8EE6-25970DD8C346}
+// (UINT64, get) Number of blits measured.
+DEFINE_GUID(TMS_GPU_TIME_COUNT, 0x9305e27a, 0xf2df, 0x4e57, 0x8e, 0xe6, 0x25, 0x97, 0x0d, 0xd8, 0xc3, 0x46);
+// {17942FB6-003E-4CC3-B1D0-BC97FBB23D13}
+// (UINT64, get) Mean GPU time of a blit in 100ns units.
+DEFINE_GUID(TMS_GPU_TIME_MEAN, 0x17942fb6, 0x003e, 0x4cc3, 0xb1, 0xd0, 0xbc, 0x97, 0xfb, 0xb2, 0x3d, 0x13);
+// {4CD91AA3-8B64-4FBC-AB48-F53B1F93A1A7}
+// (UINT64, get) Largest GPU time of a blit in 100ns units.
+DEFINE_GUID(TMS_GPU_TIME_MAX, 0x4cd91aa3, 0x8b64, 0x4fbc, 0xab, 0x48, 0xf5, 0x3b, 0x1f, 0x93, 0xa1, 0xa7);
+// {04187B19-1EA1-4A6B-AC8B-B75BDAFF259C}
+// (UINT64, get) Number of blits that could not be measured. (All queries were in flight, or the GPU clock was disjoint.)
+DEFINE_GUID(TMS_GPU_TIME_LOST_COUNT, 0x04187b19, 0x1ea1, 0x4a6b, 0xac, 0x8b, 0xb7, 0x5b, 0xda, 0xff, 0x25, 0x9c);
+// {DC98C2EA-DD54-4641-95BD-221656E9296E}
+// (BLOB, get) Histogram of the GPU times: UINT64[TMS_GPU_TIME_HISTOGRAM_BUCKETS], the number of blits per bucket.
+// Bucket i counts the times in [i, i+1) * TMS_GPU_TIME_BUCKET_WIDTH; the last one also counts all longer times.
+DEFINE_GUID(TMS_GPU_TIME_HISTOGRAM, 0xdc98c2ea, 0xdd54, 0x4641, 0x95, 0xbd, 0x22, 0x16, 0x56, 0xe9, 0x29, 0x6e);
+#define TMS_GPU_TIME_HISTOGRAM_BUCKETS	32
+#define TMS_GPU_TIME_BUCKET_WIDTH		2500	// 100ns units (0.25ms)
+
+// Attribute GUIDs of D3D11TextureMediaSink to share the output textures with another process or device.
+// When enabled, the output textures are created with D3D11_RESOURCE_MISC_SHARED_NTHANDLE and D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX,
+// and each presented sample carries TMS_SAMPLE_SHARED_HANDLE and TMS_SAMPLE_SHARED_SEQUENCE. To read a frame, the consumer
+// acquires the keyed mutex with key 1 and releases it with key 0. Do not wait long in AcquireSync: if it times out, the sink
+// has taken the texture back for a newer frame. The sink never waits for the consumer; it writes to another texture instead.
+// {941D0AF8-783A-4716-9620-8E4595CDCDB9}
+// (UINT32, get/set) TRUE to share. Default: FALSE. Takes effect with the next output textures; the passthrough mode is not used meanwhile.
+DEFINE_GUID(TMS_SHARED_TEXTURES, 0x941d0af8, 0x783a, 0x4716, 0x96, 0x20, 0x8e, 0x45, 0x95, 0xcd, 0xcd, 0xb9);
+// {8084410C-C0D9-4161-92C8-15D10B595921}
+// (UINT64, get) Number of times a texture was skipped because the consumer was reading it.
+DEFINE_GUID(TMS_SHARED_BUSY_COUNT, 0x8084410c, 0xc0d9, 0x4161, 0x92, 0xc8, 0x15, 0xd1, 0x0b, 0x59, 0x59, 0x21);
+
+// Attribute GUIDs of D3D11TextureMediaSink for a fast start.
+// The output textures and the video processor are created in the background as soon as the media type is set, so that the
+// first frame does not wait for them. With a hint, they are created even before that.
+// {CC853765-7025-4109-B309-21AFC1F7B066}
+// (UINT64, get/set) Expected frame size, packed as MFSetAttributeSize does (width in the upper 32 bits). Default: 0 (none).
+// Used only until the media type is set; a media type of another size simply gets its own objects.
+DEFINE_GUID(TMS_WARMUP_HINT, 0xcc853765, 0x7025, 0x4109, 0xb3, 0x09, 0x21, 0xaf, 0xc1, 0xf7, 0xb0, 0x66);
+// {680EA98D-E9A1-4386-B1A3-AA0EED43DD49}
+// (UINT64, get) Time from the last start at a new position to the first frame presented, in 100ns units. 0 until then.
+DEFINE_GUID(TMS_FIRST_FRAME_LATENCY, 0x680ea98d, 0xe9a1, 0x4386, 0xb1, 0xa3, 0xaa, 0x0e, 0xed, 0x43, 0xdd, 0x49);
+// {1DF48402-3051-4AB6-8AB7-3E589D586C90}
+// (UINT64, get) Time the first frame processed after the last media type change waited for the output textures and the video
+// processor, in 100ns units. 0 when the warm-up was done in time.
+DEFINE_GUID(TMS_FIRST_FRAME_SETUP_TIME, 0x1df48402, 0x3051, 0x4ab6, 0x8a, 0xb7, 0x3e, 0x58, 0x9d, 0x58, 0x6c, 0x90);
+// {24DF01EB-B7EB-4D38-A136-EC9DD5A5CC76}
+// (UINT32, get/set) TRUE to keep the sink alive across sources. Default: FALSE.
+// While TRUE, IMFMediaSink::Shutdown only detaches the sink from the session: the clock, the queued samples and the events are
+// dropped, but the device objects, the video processors and the texture pools are kept, and TMS_SAMPLE still returns the last
+// frame until the next source presents its first one. Add the sink to the next topology as is. (Set MF_TOPONODE_NOSHUTDOWN_ON_REMOVE
+// on its output node, or the session shuts it down.) To really shut it down, set FALSE and call Shutdown again; the last Release
+// of a sink left detached does it too.
+DEFINE_GUID(TMS_KEEP_ALIVE, 0x24df01eb, 0xb7eb, 0x4d38, 0xa1, 0x36, 0xec, 0x9d, 0xd5, 0xa5, 0xcc, 0x76);
+// {8321F9C6-7905-4DDD-87FE-FD19B933E827}
+// (UINT64, get) Time from the last detach to the first frame presented after it, in 100ns units. 0 until then.
+DEFINE_GUID(TMS_SWITCH_LATENCY, 0x8321f9c6, 0x7905, 0x4ddd, 0x87, 0xfe, 0xfd, 0x19, 0xb9, 0x33, 0xe8, 0x27);
+// {446BE54B-1355-4BD9-B0E0-E5C54CF42BC0}
+// (UINT64, get/set) Longest wait for the frames before an MFSTREAMSINK_MARKER_ENDOFSEGMENT marker, in 100ns units. Default: 1 second.
+// The marker event is sent once all of them have been presented; the ones still scheduled at the deadline are dropped, and the
+// event is sent anyway. The wait starts over when the stream is resumed after a pause. 0 sends the event as soon as the marker is reached.
+DEFINE_GUID(TMS_DRAIN_TIMEOUT, 0x446be54b, 0x1355, 0x4bd9, 0xb0, 0xe0, 0xe5, 0xc5, 0x4c, 0xf4, 0x2b, 0xc0);
+// {8F2F119A-BCE5-4F1A-B481-1A23992F0557}
+// (UINT64, get) Number of end-of-segment drains that reached TMS_DRAIN_TIMEOUT and dropped frames.
+DEFINE_GUID(TMS_DRAIN_TIMEOUT_COUNT, 0x8f2f119a, 0xbce5, 0x4f1a, 0xb4, 0x81, 0x1a, 0x23, 0x99, 0x2f, 0x05, 0x57);
+// {4324C37F-6F25-480E-9763-40374B0BCBAB}
+// (UINT32, get/set) TRUE to play the segments of a playlist back to back. Default: FALSE.
+// The samples after an MFSTREAMSINK_MARKER_ENDOFSEGMENT marker are processed while the frames before it are still scheduled,
+// and their times are rebased, so that the first one follows the last frame of the previous segment whatever its own timestamp.
+// The rebased times are the ones of the presented samples. For forward playback; a start at a new position ends the rebasing.
+DEFINE_GUID(TMS_GAPLESS, 0x4324c37f, 0x6f25, 0x480e, 0x97, 0x63, 0x40, 0x37, 0x4b, 0x0b, 0xcb, 0xab);
+// {6A99EF61-39B5-41EA-8CBE-01335A9A9983}
+// (UINT64, get) How long the display stayed on the last frame of a segment beyond its duration, before the first frame of the
+// next segment was presented, in 100ns units. Of the last segment change; 0 when it was seamless.
+DEFINE_GUID(TMS_SEGMENT_GAP, 0x6a99ef61, 0x39b5, 0x41ea, 0x8c, 0xbe, 0x01, 0x33, 0x5a, 0x9a, 0x99, 0x83);
+// {C0E961ED-8FD3-4304-B332-1D957BD4B73C}
+// (UINT64, get/set) Memory budget of the scrubbing cache, in bytes. Default: 0 (off).
+// While the stream is not started (scrubbing), a copy of every frame processed is kept, and a sample at the time of a kept frame
+// presents the copy instead of being processed again. The least recently used frames go first. (Not with TMS_SHARED_TEXTURES.)
+// The copies count in the texture memory budget. A new source or a device change empties the cache.
+DEFINE_GUID(TMS_SCRUB_CACHE_BUDGET, 0xc0e961ed, 0x8fd3, 0x4304, 0xb3, 0x32, 0x1d, 0x95, 0x7b, 0xd4, 0xb7, 0x3c);
+// {EEC5B9AD-2014-49D3-AE37-C9733BC371BF}
+// (UINT64, set) Presents the frame kept in the scrubbing cache for this time (100ns units, as a LONGLONG) at once, without a seek
+// or a decode. MF_E_NOT_FOUND if no frame is kept for it; seek as usual then. MF_E_INVALIDREQUEST while the stream is started.
+DEFINE_GUID(TMS_SCRUB_TIME, 0xeec5b9ad, 0x2014, 0x49d3, 0xae, 0x37, 0xc9, 0x73, 0x3b, 0xc3, 0x71, 0xbf);
+// {C5ED56DE-AFFE-4ED9-8194-52C592A972BA}
+// (UINT64, get) Number of lookups in the scrubbing cache that found a frame.
+DEFINE_GUID(TMS_SCRUB_CACHE_HIT_COUNT, 0xc5ed56de, 0xaffe, 0x4ed9, 0x81, 0x94, 0x52, 0xc5, 0x92, 0xa9, 0x72, 0xba);
+// {5037D74A-5FC4-4367-BBDD-7D19730C6991}
+// (UINT64, get) Number of lookups in the scrubbing cache that did not.
+DEFINE_GUID(TMS_SCRUB_CACHE_MISS_COUNT, 0x5037d74a, 0x5fc4, 0x4367, 0xbb, 0xdd, 0x7d, 0x19, 0x73, 0x0c, 0x69, 0x91);
+
+// Attribute GUIDs set on the IMFSample received through TMS_SAMPLE.
+// The sample also carries MF_MT_FRAME_SIZE (texture size), MF_MT_VIDEO_NOMINAL_RANGE, MF_MT_VIDEO_PRIMARIES and MF_MT_TRANSFER_FUNCTION,
+// and for YUV formats MF_MT_YUV_MATRIX and MF_MT_VIDEO_CHROMA_SITING.
+// {262CDDC8-C775-4C11-ADBE-A4E29C982663}
+// (UINT32) DXGI_FORMAT of the texture.
+DEFINE_GUID(TMS_SAMPLE_FORMAT, 0x262cddc8, 0xc775, 0x4c11, 0xad, 0xbe, 0xa4, 0xe2, 0x9c, 0x98, 0x26, 0x63);
+// {D6099AAA-9AC3-4429-A411-E2098FCF1CC0}
+// (UINT32) Number of planes of the texture. 2 for NV12/P010: Y (R8/R16 view) and interleaved UV at half size (R8G8/R16G16 view).
+DEFINE_GUID(TMS_SAMPLE_PLANE_COUNT, 0xd6099aaa, 0x9ac3, 0x4429, 0xa4, 0x11, 0xe2, 0x09, 0x8f, 0xcf, 0x1c, 0xc0);
+// {D19A48A5-5B91-4D4D-BB65-F2DDB3FBDEC3}
+// (UINT64) With TMS_SHARED_TEXTURES: NT handle of the texture, valid in this process (DuplicateHandle it to another process).
+// Owned by the sink; the same texture keeps the same handle. Open it with ID3D11Device1::OpenSharedResource1.
+DEFINE_GUID(TMS_SAMPLE_SHARED_HANDLE, 0xd19a48a5, 0x5b91, 0x4d4d, 0xbb, 0x65, 0xf2, 0xdd, 0xb3, 0xfb, 0xde, 0xc3);
+// {C494534D-FD7E-4F55-9D22-6694070AB880}
+// (UINT64) With TMS_SHARED_TEXTURES: sequence number of the frame in the texture. Increases with every frame written.
+DEFINE_GUID(TMS_SAMPLE_SHARED_SEQUENCE, 0xc494534d, 0xfd7e, 0x4f55, 0x9d, 0x22, 0x66, 0x94, 0x07, 0x0a, 0xb8, 0x80);
+
+// Description of a presented frame, kept by the sink next to each output sample.
+// The attributes above are set on the sample only when their values change; this is what the sink itself reads.
+typedef struct _TMS_FRAME_DESCRIPTOR
+{
+	LONGLONG SampleTime;		// Presentation time and duration of the frame, in 100ns units. (As IMFSample::GetSampleTime/Duration.)
+	LONGLONG SampleDuration;	//
+	UINT32 SampleFlags;			// As IMFSample::GetSampleFlags.
+	UINT32 Epoch;				// Incremented by every flush of the sink.
+	UINT32 Width;				// Size and DXGI_FORMAT of the texture. (As MF_MT_FRAME_SIZE and TMS_SAMPLE_FORMAT.)
+	UINT32 Height;				//
+	UINT32 Format;				//
+	UINT32 YuvMatrix;			// MFVideoTransferMatrix; 0 for RGB formats. (As MF_MT_YUV_MATRIX.)
+	UINT32 NominalRange;		// MFNominalRange. (As MF_MT_VIDEO_NOMINAL_RANGE.)
+	UINT32 ChromaSiting;		// MFVideoChromaSubsampling; 0 if not known or RGB. (As MF_MT_VIDEO_CHROMA_SITING.)
+	UINT32 Primaries;			// MFVideoPrimaries. (As MF_MT_VIDEO_PRIMARIES.)
+	UINT32 TransferFunction;	// MFVideoTransferFunction. (As MF_MT_TRANSFER_FUNCTION.)
+	UINT64 SourceIndex;			// Number of input samples processed before the one this frame was made from, since the media type was set.
+	UINT64 SharedSequence;		// With TMS_SHARED_TEXTURES: as TMS_SAMPLE_SHARED_SEQUENCE. Otherwise 0.
+	LONGLONG ProcessTime;		// Time the sink took to process the input sample into this frame, in 100ns units.
+	LONGLONG PresentTime;		// System time (MFGetSystemTime) when the frame was presented.
+} TMS_FRAME_DESCRIPTOR;
+
+// Attribute GUID of D3D11TextureMediaSink to describe the presented frame without reading the attributes of the sample.
+// {C0EB5611-C81E-4526-81AF-4DCFF3BCB690}
+// (BLOB, get) A TMS_FRAME_DESCRIPTOR of the sample TMS_SAMPLE returns. MF_E_ATTRIBUTENOTFOUND until a frame is presented.
+// Call it while the sample is locked to be sure the two are of the same frame.
+DEFINE_GUID(TMS_SAMPLE_DESCRIPTOR, 0xc0eb5611, 0xc81e, 0x4526, 0x81, 0xaf, 0x4d, 0xcf, 0xf3, 0xbc, 0xb6, 0x90);
+
+// Attribute GUIDs of D3D11TextureMediaSink for the thumbnail (filmstrip) mode.
+// In this mode nothing is presented. Only the frames at the requested times are processed: each one is scaled down into a cell
+// of a texture atlas, and the atlas is read back in one copy when its cells are full, when all the requests are served, or at an
+// MFSTREAMSINK_MARKER_ENDOFSEGMENT marker. The thumbnails are then handed to the callback. The other frames are dropped on
+// arrival, without any processing, so the source may run as fast as it can (seek to each time, or play at a high rate).
+// {11C6D67F-35F6-4910-89CB-5EE0625555CD}
+// (UINT64, get/set) Size of a thumbnail, packed as MFSetAttributeSize does (width in the upper 32 bits). Default: 0 (off).
+// The frame keeps its aspect ratio within it, on black. The thumbnails are DXGI_FORMAT_B8G8R8A8_UNORM. Setting it drops the
+// thumbnails not yet delivered.
+DEFINE_GUID(TMS_THUMBNAIL_SIZE, 0x11c6d67f, 0x35f6, 0x4910, 0x89, 0xcb, 0x5e, 0xe0, 0x62, 0x55, 0x55, 0xcd);
+// {EAFA5201-6559-4FC0-9064-48DC7FBD2874}
+// (BLOB, set) Requested times, as LONGLONG[] in 100ns units, at most TMS_THUMBNAIL_REQUEST_MAX. Replaces the pending requests and
+// drops the thumbnails not yet delivered. A request is served by the frame on display at its time; the requests are served in
+// ascending order, so feed the frames forward. A request the frames have already passed is missed (TMS_THUMBNAIL_MISSED_COUNT).
+DEFINE_GUID(TMS_THUMBNAIL_TIMES, 0xeafa5201, 0x6559, 0x4fc0, 0x90, 0x64, 0x48, 0xdc, 0x7f, 0xbd, 0x28, 0x74);
+#define TMS_THUMBNAIL_REQUEST_MAX	4096
+// {D38D273F-B186-4295-A250-90BD29EC3979}
+// (IUnknown, set) The ITMSThumbnailCallback that receives the thumbnails. NULL to clear; the thumbnails are then dropped.
+DEFINE_GUID(TMS_THUMBNAIL_CALLBACK, 0xd38d273f, 0xb186, 0x4295, 0xa2, 0x50, 0x90, 0xbd, 0x29, 0xec, 0x39, 0x79);
+// {DE0D3FED-658D-417E-911B-B52D7CF6E94C}
+// (UINT64, get) Number of requests not served yet.
+DEFINE_GUID(TMS_THUMBNAIL_PENDING_COUNT, 0xde0d3fed, 0x658d, 0x417e, 0x91, 0x1b, 0xb5, 0x2d, 0x7c, 0xf6, 0xe9, 0x4c);
+// {7D333923-9979-44BF-882E-513E3FD04957}
+// (UINT64, get) Number of requests missed since TMS_THUMBNAIL_TIMES was set: the first frame after them started later, as after a
+// seek past them. They get no thumbnail.
+DEFINE_GUID(TMS_THUMBNAIL_MISSED_COUNT, 0x7d333923, 0x9979, 0x44bf, 0x88, 0x2e, 0x51, 0x3e, 0x3f, 0xd0, 0x49, 0x57);
+
+// Description of a thumbnail in the atlas handed to ITMSThumbnailCallback.
+typedef struct _TMS_THUMBNAIL
+{
+	LONGLONG RequestTime;		// The requested time, in 100ns units.
+	LONGLONG SampleTime;		// Presentation time of the frame that served it.
+	UINT32 X;					// Cell of the thumbnail in the atlas, in pixels.
+	UINT32 Y;					//
+	UINT32 Width;				// As TMS_THUMBNAIL_SIZE.
+	UINT32 Height;				//
+} TMS_THUMBNAIL;
+
+// Callback interface of the thumbnail mode. (TMS_THUMBNAIL_CALLBACK)
+// {792DDD59-95D4-44E7-8679-4F451C135D1E}
+DEFINE_GUID(IID_ITMSThumbnailCallback, 0x792ddd59, 0x95d4, 0x44e7, 0x86, 0x79, 0x4f, 0x45, 0x1c, 0x13, 0x5d, 0x1e);
+MIDL_INTERFACE("792DDD59-95D4-44E7-8679-4F451C135D1E")
+ITMSThumbnailCallback : public IUnknown
+{
+public:
+	// Called on a worker thread of the sink with a batch of thumbnails, in the order of their requested times. The atlas
+	// (B8G8R8A8, rows of cbPitch bytes) is valid only during the call; copy what is needed. Do not wait in it for another
+	// thread that calls the sink.
+	virtual HRESULT STDMETHODCALLTYPE OnThumbnails(const TMS_THUMBNAIL* pThumbnails, UINT32 count, const BYTE* pAtlas, UINT32 cbPitch) = 0;
+};
+
 // Creation methods exposed by the library.
 STDAPI CreateD3D11TextureMediaSink(REFIID ridd, void** ppvObject, void* pDXGIDeviceManager, void* pD3D11Device);
 
@@ -0,0 +1,35 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// Automatic scope of the work on the immediate context.
+	// Locks the critical section, and if given, also enters the device's multithread protection, so that the work is
+	// submitted as one batch that the application's threads using the same context cannot interleave with.
+	class DeviceContextLock
+	{
+	public:
+		_Acquires_lock_(this->m_pLock->m_cs)
+		DeviceContextLock(CriticalSection* pLock, ID3D10Multithread* pMultithread)
+		{
+			this->m_pLock = pLock;
+			this->m_pLock->Lock();
+
+			this->m_pMultithread = pMultithread;
+			if (NULL != this->m_pMultithread)
+				this->m_pMultithread->Enter();
+		}
+
+		_Releases_lock_(this->m_pLock->m_cs)
+		~DeviceContextLock()
+		{
+			if (NULL != this->m_pMultithread)
+				this->m_pMultithread->Leave();
+
+			this->m_pLock->Unlock();
+		}
+
+	private:
+		CriticalSection* m_pLock;
+		ID3D10Multithread* m_pMultithread;
+	};
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// The time from an event (a start at a new position, a detach) to the first frame presented after it.
+	// The stream sink calls it under _csPresentedSample, so it is not thread safe. It takes the system times from the caller.
+	//
+	class FirstFrameTimer
+	{
+	public:
+		// The event. A first frame still awaited from the previous one is not measured any more.
+		void Start(MFTIME hnsNow)
+		{
+			this->_Start = hnsNow;
+			this->_IsWaiting = TRUE;
+		}
+
+		// A frame was presented. Returns TRUE with the latency if it is the first one since Start, FALSE otherwise.
+		BOOL FramePresented(MFTIME hnsNow, _Out_ UINT64* pLatency)
+		{
+			*pLatency = 0;
+			if (!this->_IsWaiting)
+				return FALSE;
+
+			this->_IsWaiting = FALSE;
+			*pLatency = (UINT64)(hnsNow - this->_Start);
+			return TRUE;
+		}
+
+		BOOL IsWaiting() const
+		{
+			return this->_IsWaiting;
+		}
+
+	private:
+		MFTIME _Start = 0;
+		BOOL _IsWaiting = FALSE;
+	};
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#define FNV1A_OFFSET_BASIS		2166136261U
+#define FNV1A_PRIME				16777619U
+
+namespace D3D11TextureMediaSink
+{
+	// 32-bit FNV-1a over the bytes, continuing from hash.
+	inline UINT Fnv1a(const void* pData, UINT size, UINT hash = FNV1A_OFFSET_BASIS)
+	{
+		const BYTE* pBytes = (const BYTE*)pData;
+		for (UINT i = 0; i < size; i++)
+			hash = (hash ^ pBytes[i]) * FNV1A_PRIME;
+
+		return hash;
+	}
+}
@@ -0,0 +1,194 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	FrameCache::FrameCache()
+	{
+	}
+	FrameCache::~FrameCache()
+	{
+		this->Clear();
+	}
+
+	void FrameCache::SetBudget(UINT64 budgetBytes)
+	{
+		AutoLock lock(&this->_csCache);
+
+		this->_Budget = budgetBytes;
+		while (this->_Bytes > this->_Budget)
+			this->Evict(this->FindLeastRecent(), NULL);
+	}
+	UINT64 FrameCache::GetBudget()
+	{
+		AutoLock lock(&this->_csCache);
+
+		return this->_Budget;
+	}
+
+	BOOL FrameCache::Find(LONGLONG hnsTime, _Out_ TMS_FRAME_DESCRIPTOR* pFrame, _Out_ IUnknown** ppResource)
+	{
+		AutoLock lock(&this->_csCache);
+
+		*ppResource = NULL;
+
+		// The latest frame that starts at or before the time, if it lasts until then. A frame without a duration only at its own time.
+		int found = -1;
+		for (int i = 0; i < FRAME_CACHE_SLOTS; i++)
+		{
+			Slot* pSlot = &this->_Slots[i];
+			if (NULL == pSlot->Resource || pSlot->Frame.SampleTime > hnsTime)
+				continue;
+			if (hnsTime >= pSlot->Frame.SampleTime + max(1LL, pSlot->Frame.SampleDuration))
+				continue;
+			if (found < 0 || pSlot->Frame.SampleTime > this->_Slots[found].Frame.SampleTime)
+				found = i;
+		}
+
+		if (found < 0)
+		{
+			this->_Misses++;
+			return FALSE;
+		}
+
+		Slot* pSlot = &this->_Slots[found];
+		pSlot->LastUsed = ++this->_UseCounter;
+		*pFrame = pSlot->Frame;
+		*ppResource = pSlot->Resource;
+		(*ppResource)->AddRef();
+		this->_Hits++;
+
+		return TRUE;
+	}
+	HRESULT FrameCache::Reserve(UINT64 bytes, _Out_ IUnknown** ppReusable)
+	{
+		AutoLock lock(&this->_csCache);
+
+		*ppReusable = NULL;
+
+		if (bytes > this->_Budget)
+			return S_FALSE;
+
+		this->MakeRoom(bytes, ppReusable);
+
+		return S_OK;
+	}
+	HRESULT FrameCache::Insert(const TMS_FRAME_DESCRIPTOR& frame, UINT64 bytes, IUnknown* pResource)
+	{
+		if (NULL == pResource)
+			return E_POINTER;
+
+		AutoLock lock(&this->_csCache);
+
+		if (bytes > this->_Budget)
+			return S_FALSE;
+
+		// A frame of the same time is replaced.
+		for (int i = 0; i < FRAME_CACHE_SLOTS; i++)
+		{
+			if (NULL != this->_Slots[i].Resource && this->_Slots[i].Frame.SampleTime == frame.SampleTime)
+			{
+				this->Evict(i, NULL);
+				break;
+			}
+		}
+
+		this->MakeRoom(bytes, NULL);
+
+		for (int i = 0; i < FRAME_CACHE_SLOTS; i++)
+		{
+			Slot* pSlot = &this->_Slots[i];
+			if (NULL != pSlot->Resource)
+				continue;
+
+			pSlot->Resource = pResource;
+			pSlot->Resource->AddRef();
+			pSlot->Frame = frame;
+			pSlot->Bytes = bytes;
+			pSlot->LastUsed = ++this->_UseCounter;
+			this->_Count++;
+			this->_Bytes += bytes;
+			break;
+		}
+
+		return S_OK;
+	}
+	void FrameCache::Clear()
+	{
+		AutoLock lock(&this->_csCache);
+
+		for (int i = 0; i < FRAME_CACHE_SLOTS; i++)
+		{
+			if (NULL != this->_Slots[i].Resource)
+				this->Evict(i, NULL);
+		}
+	}
+
+	UINT64 FrameCache::GetHitCount()
+	{
+		AutoLock lock(&this->_csCache);
+
+		return this->_Hits;
+	}
+	UINT64 FrameCache::GetMissCount()
+	{
+		AutoLock lock(&this->_csCache);
+
+		return this->_Misses;
+	}
+	UINT FrameCache::GetCount()
+	{
+		AutoLock lock(&this->_csCache);
+
+		return this->_Count;
+	}
+	UINT64 FrameCache::GetBytes()
+	{
+		AutoLock lock(&this->_csCache);
+
+		return this->_Bytes;
+	}
+
+	// private
+
+	int FrameCache::FindLeastRecent()
+	{
+		int found = -1;
+		for (int i = 0; i < FRAME_CACHE_SLOTS; i++)
+		{
+			if (NULL == this->_Slots[i].Resource)
+				continue;
+			if (found < 0 || this->_Slots[i].LastUsed < this->_Slots[found].LastUsed)
+				found = i;
+		}
+		return found;
+	}
+	void FrameCache::Evict(int index, IUnknown** ppResource)
+	{
+		if (index < 0)
+			return;
+
+		Slot* pSlot = &this->_Slots[index];
+
+		// Hand the resource over, or release it.
+		if (NULL != ppResource)
+			*ppResource = pSlot->Resource;
+		else
+			pSlot->Resource->Release();
+
+		this->_Count--;
+		this->_Bytes -= pSlot->Bytes;
+		ZeroMemory(pSlot, sizeof(Slot));
+	}
+	void FrameCache::MakeRoom(UINT64 bytes, IUnknown** ppReusable)
+	{
+		// Evict the least recently used frames until a frame of the size fits in a free slot.
+		while (0 < this->_Count && (this->_Bytes + bytes > this->_Budget || FRAME_CACHE_SLOTS == this->_Count))
+		{
+			int index = this->FindLeastRecent();
+
+			// The first one of the same size is handed back, so that its resource is reused instead of created.
+			BOOL bReuse = (NULL != ppReusable && NULL == *ppReusable && this->_Slots[index].Bytes == bytes);
+			this->Evict(index, bReuse ? ppReusable : NULL);
+		}
+	}
+}
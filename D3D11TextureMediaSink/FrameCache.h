@@ -0,0 +1,52 @@
+#pragma once
+
+#define FRAME_CACHE_SLOTS		64		// Most frames kept, whatever the budget.
+
+namespace D3D11TextureMediaSink
+{
+	// Output frames recently processed while scrubbing, keyed by their time, so that a seek back to one of them presents it
+	// again without processing. The least recently used frames are evicted to stay within a memory budget (0: none are kept).
+	// Each frame is held as an opaque resource (its texture) with its descriptor.
+	//
+	class FrameCache
+	{
+	public:
+		FrameCache();
+		~FrameCache();
+
+		void SetBudget(UINT64 budgetBytes);	// Evicts at once down to the new budget.
+		UINT64 GetBudget();
+
+		BOOL Find(LONGLONG hnsTime, _Out_ TMS_FRAME_DESCRIPTOR* pFrame, _Out_ IUnknown** ppResource);	// The frame on display at the time.
+		HRESULT Reserve(UINT64 bytes, _Out_ IUnknown** ppReusable);	// S_FALSE if a frame of the size is never kept. Hands back an evicted resource of the same size.
+		HRESULT Insert(const TMS_FRAME_DESCRIPTOR& frame, UINT64 bytes, IUnknown* pResource);	// Replaces the frame of the same time.
+		void Clear();
+
+		UINT64 GetHitCount();
+		UINT64 GetMissCount();
+		UINT GetCount();
+		UINT64 GetBytes();
+
+	private:
+		struct Slot
+		{
+			IUnknown* Resource;			// NULL if the slot is free.
+			TMS_FRAME_DESCRIPTOR Frame;
+			UINT64 Bytes;
+			UINT64 LastUsed;			// Value of the use counter when the frame was last inserted or found.
+		};
+
+		Slot _Slots[FRAME_CACHE_SLOTS] = {};
+		UINT _Count = 0;
+		UINT64 _Budget = 0;
+		UINT64 _Bytes = 0;
+		UINT64 _UseCounter = 0;
+		UINT64 _Hits = 0;
+		UINT64 _Misses = 0;
+		CriticalSection _csCache;
+
+		int FindLeastRecent();
+		void Evict(int index, IUnknown** ppResource);
+		void MakeRoom(UINT64 bytes, IUnknown** ppReusable);
+	};
+}
@@ -0,0 +1,48 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	void FrameDescription::SetColor(IMFSample* pSample, FrameDescriptor* pDescriptor, const TMS_FRAME_DESCRIPTOR& color)
+	{
+		// A sample of the pool mostly carries the same colour frame after frame, so the attributes are written only when it changes.
+		struct ColorAttribute
+		{
+			const GUID* Key;
+			UINT32* Current;
+			UINT32 Value;
+		};
+		TMS_FRAME_DESCRIPTOR* pFrame = &pDescriptor->Frame;
+		ColorAttribute attributes[] = {
+			{ &MF_MT_YUV_MATRIX, &pFrame->YuvMatrix, color.YuvMatrix },
+			{ &MF_MT_VIDEO_NOMINAL_RANGE, &pFrame->NominalRange, color.NominalRange },
+			{ &MF_MT_VIDEO_CHROMA_SITING, &pFrame->ChromaSiting, color.ChromaSiting },
+			{ &MF_MT_VIDEO_PRIMARIES, &pFrame->Primaries, color.Primaries },
+			{ &MF_MT_TRANSFER_FUNCTION, &pFrame->TransferFunction, color.TransferFunction },
+		};
+
+		for (UINT i = 0; i < _countof(attributes); i++)
+		{
+			if (*attributes[i].Current == attributes[i].Value)
+				continue;
+
+			if (0 == attributes[i].Value)
+				pSample->DeleteItem(*attributes[i].Key);	// Not known, or not for this format.
+			else
+				pSample->SetUINT32(*attributes[i].Key, attributes[i].Value);
+			*attributes[i].Current = attributes[i].Value;
+		}
+	}
+	void FrameDescription::SetTimes(IMFSample* pSample, FrameDescriptor* pDescriptor, UINT64 sourceIndex, LONGLONG hnsProcessTime)
+	{
+		// The times and the flags are not in the attribute store.
+		TMS_FRAME_DESCRIPTOR* pFrame = &pDescriptor->Frame;
+		if (FAILED(pSample->GetSampleTime(&pFrame->SampleTime)))
+			pFrame->SampleTime = 0;
+		if (FAILED(pSample->GetSampleDuration(&pFrame->SampleDuration)))
+			pFrame->SampleDuration = 0;
+		DWORD flags;
+		pFrame->SampleFlags = SUCCEEDED(pSample->GetSampleFlags(&flags)) ? flags : 0;
+		pFrame->SourceIndex = sourceIndex;
+		pFrame->ProcessTime = hnsProcessTime;
+	}
+}
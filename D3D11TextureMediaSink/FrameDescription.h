@@ -0,0 +1,18 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// Writes the description of an output frame to the FrameDescriptor of its pooled sample.
+	// The colour attributes are still set on the sample for the consumers that read them, but only when they differ from what
+	// the sample already carries, so a steady stream of frames makes no call on the attribute store.
+	//
+	class FrameDescription
+	{
+	public:
+		// The colour of the frame, from the YuvMatrix to the TransferFunction of color. 0 is not known, or not for this format.
+		static void SetColor(IMFSample* pSample, FrameDescriptor* pDescriptor, const TMS_FRAME_DESCRIPTOR& color);
+
+		// The times and the flags the processing copied to the sample, and where the frame came from.
+		static void SetTimes(IMFSample* pSample, FrameDescriptor* pDescriptor, UINT64 sourceIndex, LONGLONG hnsProcessTime);
+	};
+}
@@ -0,0 +1,210 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	FrameRateConverter::FrameRateConverter()
+	{
+	}
+	FrameRateConverter::~FrameRateConverter()
+	{
+	}
+
+	HRESULT FrameRateConverter::SetMode(UINT32 mode)
+	{
+		if (mode > TMS_FRC_MODE_BLEND)
+			return E_INVALIDARG;
+
+		AutoLock lock(&this->_csFrc);
+
+		this->_Mode = mode;
+
+		return S_OK;
+	}
+	UINT32 FrameRateConverter::GetMode()
+	{
+		return this->_Mode;
+	}
+	HRESULT FrameRateConverter::SetTargetRate(const MFRatio& fps)
+	{
+		if (fps.Numerator == 0 || fps.Denominator == 0)
+			return E_INVALIDARG;
+
+		HRESULT hr;
+
+		UINT64 avgTimePerFrame = 0;
+		if (FAILED(hr = ::MFFrameRateToAverageTimePerFrame(fps.Numerator, fps.Denominator, &avgTimePerFrame)))
+			return hr;
+		if (avgTimePerFrame == 0)
+			return E_INVALIDARG;
+
+		AutoLock lock(&this->_csFrc);
+
+		this->_TargetRate = fps;
+		this->_TickInterval = (LONGLONG)avgTimePerFrame;
+
+		return S_OK;
+	}
+	MFRatio FrameRateConverter::GetTargetRate()
+	{
+		AutoLock lock(&this->_csFrc);
+
+		return this->_TargetRate;
+	}
+	LONGLONG FrameRateConverter::GetTickInterval()
+	{
+		AutoLock lock(&this->_csFrc);
+
+		return this->_TickInterval;
+	}
+	LONGLONG FrameRateConverter::GetTickTime(LONGLONG time)
+	{
+		AutoLock lock(&this->_csFrc);
+
+		// The ticks are on a grid from time 0, so they do not depend on when the playback started.
+		LONGLONG n = time / this->_TickInterval;
+		if (time < 0 && (time % this->_TickInterval) != 0)
+			n--;	// Round towards minus infinity.
+
+		return n * this->_TickInterval;
+	}
+
+	void FrameRateConverter::Reset()
+	{
+		AutoLock lock(&this->_csFrc);
+
+		this->_HasDisplay = FALSE;
+		this->_DisplayTime = 0;
+		this->_ShownUpTo = 0;
+		this->_LastWasBlend = FALSE;
+	}
+	void FrameRateConverter::Decide(LONGLONG tickTime, const LONGLONG* pSourceTimes, UINT count, FrcDecision* pDecision)
+	{
+		AutoLock lock(&this->_csFrc);
+
+		ZeroMemory(pDecision, sizeof(FrcDecision));
+		pDecision->Action = Frc_Wait;
+
+		if (NULL == pSourceTimes)
+			count = 0;
+
+		if (this->_Mode == TMS_FRC_MODE_BLEND)
+		{
+			// The last frame that starts at or before the tick; it is blended with the next one.
+			int current = -1;
+			for (UINT i = 0; i < count; i++)
+			{
+				if (pSourceTimes[i] > tickTime)
+					break;
+				current = i;
+			}
+
+			if (current >= 0)
+			{
+				pDecision->Index = current;
+				pDecision->Drop = current;
+				for (int i = 0; i < current; i++)
+				{
+					if (!this->_HasDisplay || pSourceTimes[i] > this->_ShownUpTo)
+						pDecision->Skip++;
+				}
+
+				// Position of the tick between the frame and the next one.
+				float weight = 0.0f;
+				if ((UINT)current + 1 < count && pSourceTimes[current + 1] > pSourceTimes[current])
+					weight = (float)(tickTime - pSourceTimes[current]) / (float)(pSourceTimes[current + 1] - pSourceTimes[current]);
+
+				if (weight >= FRC_BLEND_EPSILON)
+				{
+					pDecision->Action = Frc_Blend;
+					pDecision->Weight = weight;
+					pDecision->DisplayTime = pSourceTimes[current] + (LONGLONG)(weight * (pSourceTimes[current + 1] - pSourceTimes[current]));
+					this->_ShownUpTo = max(this->_ShownUpTo, pSourceTimes[current + 1]);
+				}
+				else if (this->_HasDisplay && !this->_LastWasBlend && this->_DisplayTime == pSourceTimes[current])
+				{
+					pDecision->Action = Frc_Repeat;	// The frame alone is already on display.
+					pDecision->DisplayTime = this->_DisplayTime;
+				}
+				else
+				{
+					pDecision->Action = Frc_Present;
+					pDecision->DisplayTime = pSourceTimes[current];
+					this->_ShownUpTo = max(this->_ShownUpTo, pSourceTimes[current]);
+				}
+			}
+			else if (this->_HasDisplay)
+			{
+				pDecision->Action = Frc_Repeat;	// All frames are in the future.
+				pDecision->DisplayTime = this->_DisplayTime;
+			}
+		}
+		else
+		{
+			// The frame nearest to the tick: the last one that starts no later than half a tick after it.
+			// The queued frames have not been shown in this mode, so the ones in front of it are skipped.
+			int current = -1;
+			for (UINT i = 0; i < count; i++)
+			{
+				if (pSourceTimes[i] > tickTime + this->_TickInterval / 2)
+					break;
+				current = i;
+			}
+
+			if (current >= 0)
+			{
+				pDecision->Action = Frc_Present;
+				pDecision->Index = current;
+				pDecision->Drop = current;
+				pDecision->Skip = current;
+				pDecision->DisplayTime = pSourceTimes[current];
+				this->_ShownUpTo = max(this->_ShownUpTo, pSourceTimes[current]);
+			}
+			else if (this->_HasDisplay)
+			{
+				pDecision->Action = Frc_Repeat;
+				pDecision->DisplayTime = this->_DisplayTime;
+			}
+		}
+
+		this->Account(pDecision);
+	}
+	void FrameRateConverter::GetStatistics(FrcStatistics* pStatistics)
+	{
+		AutoLock lock(&this->_csFrc);
+
+		*pStatistics = this->_Statistics;
+	}
+	void FrameRateConverter::ResetStatistics()
+	{
+		AutoLock lock(&this->_csFrc);
+
+		ZeroMemory(&this->_Statistics, sizeof(FrcStatistics));
+	}
+
+	// private
+
+	void FrameRateConverter::Account(FrcDecision* pDecision)
+	{
+		if (pDecision->Action == Frc_Wait)
+			return;
+
+		this->_Statistics.Ticks++;
+		this->_Statistics.Skips += pDecision->Skip;
+		if (pDecision->Action == Frc_Repeat)
+			this->_Statistics.Repeats++;
+		if (pDecision->Action == Frc_Blend)
+			this->_Statistics.Blends++;
+
+		// Judder: how far the source time shown advanced unlike the tick interval. 0 for perfectly smooth motion.
+		if (this->_HasDisplay)
+		{
+			LONGLONG judder = ::_abs64((pDecision->DisplayTime - this->_DisplayTime) - this->_TickInterval);
+			this->_Statistics.JudderMax = max(this->_Statistics.JudderMax, judder);
+			this->_Statistics.JudderTotal += judder;
+		}
+
+		this->_HasDisplay = TRUE;
+		this->_DisplayTime = pDecision->DisplayTime;
+		this->_LastWasBlend = (pDecision->Action == Frc_Blend);
+	}
+}
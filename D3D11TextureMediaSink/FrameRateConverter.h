@@ -0,0 +1,75 @@
+#pragma once
+
+// Maximum number of queued source frames looked at for one output tick.
+#define FRC_LOOKAHEAD_MAX	4
+
+// Blend weights below this are presented as the first frame alone.
+#define FRC_BLEND_EPSILON	(1.0f / 64.0f)
+
+namespace D3D11TextureMediaSink
+{
+	// What to do at an output tick.
+	enum FrcAction
+	{
+		Frc_Wait = 0,	// Nothing to show yet.
+		Frc_Present,	// Present source frame Index.
+		Frc_Repeat,		// Keep the previous output.
+		Frc_Blend,		// Present a blend of source frames Index and Index + 1.
+	};
+
+	struct FrcDecision
+	{
+		FrcAction Action;
+		UINT Index;				// Source frame to present, or the first frame of the blend.
+		UINT Drop;				// Number of source frames in front of Index that are no longer needed.
+		UINT Skip;				// Of those, the number that were never shown.
+		float Weight;			// Weight of frame Index + 1 in a blend (0 - 1).
+		LONGLONG DisplayTime;	// Source time shown at this tick.
+	};
+
+	struct FrcStatistics
+	{
+		UINT64 Ticks;
+		UINT64 Repeats;
+		UINT64 Skips;
+		UINT64 Blends;
+		LONGLONG JudderMax;		// 100ns units
+		LONGLONG JudderTotal;	//
+	};
+
+	// Timing decisions of the frame rate conversion.
+	// Given the time of an output tick and the times of the queued source frames, decides which frame to present, repeat,
+	// skip or blend, and keeps the judder statistics.
+	//
+	class FrameRateConverter
+	{
+	public:
+		FrameRateConverter();
+		~FrameRateConverter();
+
+		HRESULT SetMode(UINT32 mode);
+		UINT32 GetMode();
+		HRESULT SetTargetRate(const MFRatio& fps);
+		MFRatio GetTargetRate();
+		LONGLONG GetTickInterval();
+		LONGLONG GetTickTime(LONGLONG time);	// The tick at or before the time.
+
+		void Reset();	// Forgets the frame on display. (flush, seek)
+		void Decide(LONGLONG tickTime, const LONGLONG* pSourceTimes, UINT count, FrcDecision* pDecision);
+		void GetStatistics(FrcStatistics* pStatistics);
+		void ResetStatistics();
+
+	private:
+		UINT32 _Mode = TMS_FRC_MODE_OFF;
+		MFRatio _TargetRate = { 60, 1 };
+		LONGLONG _TickInterval = 166667;	// 100ns units
+		BOOL _HasDisplay = FALSE;			// Something has been presented since the reset.
+		LONGLONG _DisplayTime = 0;			// Source time shown at the last tick.
+		LONGLONG _ShownUpTo = 0;			// Latest source time that was shown, alone or in a blend.
+		BOOL _LastWasBlend = FALSE;
+		FrcStatistics _Statistics = {};
+		CriticalSection _csFrc;
+
+		void Account(FrcDecision* pDecision);
+	};
+}
@@ -0,0 +1,59 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	D3D11EventFence::D3D11EventFence()
+	{
+	}
+	D3D11EventFence::~D3D11EventFence()
+	{
+		SafeRelease(this->_Query);
+		SafeRelease(this->_DeviceContext);
+	}
+
+	HRESULT D3D11EventFence::Initialize(ID3D11Device* pDevice)
+	{
+		if (NULL == pDevice)
+			return E_POINTER;
+
+		HRESULT hr;
+
+		SafeRelease(this->_Query);
+		SafeRelease(this->_DeviceContext);
+		this->_Signaled = FALSE;
+
+		D3D11_QUERY_DESC desc = { D3D11_QUERY_EVENT, 0 };
+		if (FAILED(hr = pDevice->CreateQuery(&desc, &this->_Query)))
+			return hr;
+
+		pDevice->GetImmediateContext(&this->_DeviceContext);
+
+		return S_OK;
+	}
+
+	HRESULT D3D11EventFence::Signal()
+	{
+		if (NULL == this->_Query)
+			return E_UNEXPECTED;
+
+		this->_DeviceContext->End(this->_Query);
+		this->_Signaled = TRUE;
+
+		return S_OK;
+	}
+	BOOL D3D11EventFence::IsCompleted()
+	{
+		if (NULL == this->_Query || !this->_Signaled)
+			return TRUE;
+
+		// Do not flush: the commands before the point are flushed by the consumer's present anyway.
+		BOOL done = FALSE;
+		if (S_OK != this->_DeviceContext->GetData(this->_Query, &done, sizeof(BOOL), D3D11_ASYNC_GETDATA_DONOTFLUSH))
+			return FALSE;
+
+		if (done)
+			this->_Signaled = FALSE;	// No need to ask the GPU again.
+
+		return done;
+	}
+}
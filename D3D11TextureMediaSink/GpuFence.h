@@ -0,0 +1,36 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// A point in the GPU's command stream, to learn when the GPU has passed it without waiting for it.
+	//
+	class GpuFence
+	{
+	public:
+		virtual ~GpuFence() {}
+
+		virtual HRESULT Signal() = 0;		// Sets the point after the work submitted so far.
+		virtual BOOL IsCompleted() = 0;		// Has the GPU passed the last point? TRUE if never signaled.
+	};
+
+	// GpuFence with a D3D11 event query on the immediate context.
+	// The caller must serialize the use of the immediate context, as for any other work on it.
+	//
+	class D3D11EventFence : public GpuFence
+	{
+	public:
+		D3D11EventFence();
+		~D3D11EventFence();
+
+		HRESULT Initialize(ID3D11Device* pDevice);
+
+		// GpuFence
+		HRESULT Signal();
+		BOOL IsCompleted();
+
+	private:
+		ID3D11DeviceContext* _DeviceContext = NULL;
+		ID3D11Query* _Query = NULL;
+		BOOL _Signaled = FALSE;
+	};
+}
@@ -0,0 +1,147 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	GpuTimerQueryRing::GpuTimerQueryRing()
+	{
+	}
+	GpuTimerQueryRing::~GpuTimerQueryRing()
+	{
+		this->SetProvider(NULL);
+	}
+
+	void GpuTimerQueryRing::SetProvider(GpuTimerQueryProvider* pProvider)
+	{
+		AutoLock lock(&this->_csTimer);
+
+		if (NULL != this->_Provider)
+			delete this->_Provider;
+
+		this->_Provider = pProvider;
+
+		// The slots of the previous provider mean nothing to the new one.
+		ZeroMemory(this->_States, sizeof(this->_States));
+		this->_Head = 0;
+		this->_Count = 0;
+	}
+	BOOL GpuTimerQueryRing::HasProvider()
+	{
+		AutoLock lock(&this->_csTimer);
+
+		return (NULL != this->_Provider);
+	}
+
+	HRESULT GpuTimerQueryRing::Begin(_Out_ UINT* pSlot)
+	{
+		if (NULL == pSlot)
+			return E_POINTER;
+
+		AutoLock lock(&this->_csTimer);
+
+		if (NULL == this->_Provider)
+			return S_FALSE;
+
+		// Make room with the results that are already there.
+		if (this->_Count == GPU_TIMER_QUERY_SLOTS)
+			this->ResolveCore();
+
+		if (this->_Count == GPU_TIMER_QUERY_SLOTS)
+		{
+			this->_Statistics.Lost++;	// The GPU is far behind; do not add to it.
+			return S_FALSE;
+		}
+
+		UINT slot = (this->_Head + this->_Count) % GPU_TIMER_QUERY_SLOTS;
+
+		HRESULT hr;
+		if (FAILED(hr = this->_Provider->Begin(slot)))
+			return hr;
+
+		this->_States[slot] = Slot_Begun;
+		this->_Count++;
+
+		*pSlot = slot;
+		return S_OK;
+	}
+	HRESULT GpuTimerQueryRing::End(UINT slot)
+	{
+		AutoLock lock(&this->_csTimer);
+
+		if (NULL == this->_Provider || slot >= GPU_TIMER_QUERY_SLOTS || Slot_Begun != this->_States[slot])
+			return E_UNEXPECTED;
+
+		HRESULT hr = this->_Provider->End(slot);
+
+		// A slot that failed to end is given up when it comes to the head.
+		this->_States[slot] = Slot_Ended;
+
+		return hr;
+	}
+	void GpuTimerQueryRing::Resolve()
+	{
+		AutoLock lock(&this->_csTimer);
+
+		this->ResolveCore();
+	}
+	void GpuTimerQueryRing::Reset()
+	{
+		AutoLock lock(&this->_csTimer);
+
+		this->_Statistics.Lost += this->_Count;
+
+		ZeroMemory(this->_States, sizeof(this->_States));
+		this->_Head = 0;
+		this->_Count = 0;
+	}
+
+	void GpuTimerQueryRing::GetStatistics(GpuTimeStatistics* pStatistics)
+	{
+		AutoLock lock(&this->_csTimer);
+
+		*pStatistics = this->_Statistics;
+	}
+	void GpuTimerQueryRing::ResetStatistics()
+	{
+		AutoLock lock(&this->_csTimer);
+
+		ZeroMemory(&this->_Statistics, sizeof(GpuTimeStatistics));
+	}
+
+	// private
+
+	void GpuTimerQueryRing::ResolveCore()
+	{
+		if (NULL == this->_Provider)
+			return;
+
+		// In order: the GPU finishes them in the order they were issued.
+		while (this->_Count > 0 && Slot_Ended == this->_States[this->_Head])
+		{
+			BOOL bValid = FALSE;
+			LONGLONG hnsTime = 0;
+			HRESULT hr = this->_Provider->GetResult(this->_Head, &bValid, &hnsTime);
+			if (S_FALSE == hr)
+				break;	// Not yet.
+
+			if (SUCCEEDED(hr) && bValid)
+				this->Account(hnsTime);
+			else
+				this->_Statistics.Lost++;
+
+			this->_States[this->_Head] = Slot_Free;
+			this->_Head = (this->_Head + 1) % GPU_TIMER_QUERY_SLOTS;
+			this->_Count--;
+		}
+	}
+	void GpuTimerQueryRing::Account(LONGLONG hnsTime)
+	{
+		hnsTime = max(0LL, hnsTime);
+
+		this->_Statistics.Count++;
+		this->_Statistics.Total += hnsTime;
+		this->_Statistics.Max = max(this->_Statistics.Max, hnsTime);
+
+		LONGLONG bucket = hnsTime / TMS_GPU_TIME_BUCKET_WIDTH;
+		this->_Statistics.Buckets[min(bucket, (LONGLONG)(TMS_GPU_TIME_HISTOGRAM_BUCKETS - 1))]++;
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+// Number of measurements that can be in flight. The results are read this many blits later at the latest.
+#define GPU_TIMER_QUERY_SLOTS	16
+
+namespace D3D11TextureMediaSink
+{
+	// The GPU queries behind GpuTimerQueryRing. The slots are numbered 0 to GPU_TIMER_QUERY_SLOTS - 1.
+	//
+	class GpuTimerQueryProvider
+	{
+	public:
+		virtual ~GpuTimerQueryProvider() {}
+
+		virtual HRESULT Begin(UINT slot) = 0;	// Marks the start of the measurement on the GPU.
+		virtual HRESULT End(UINT slot) = 0;		// Marks the end of the measurement on the GPU.
+
+		// S_FALSE if the GPU has not got there yet. *pbValid is FALSE if the time cannot be trusted.
+		virtual HRESULT GetResult(UINT slot, _Out_ BOOL* pbValid, _Out_ LONGLONG* phnsTime) = 0;
+	};
+
+	struct GpuTimeStatistics
+	{
+		UINT64 Count;		// Measurements in the histogram.
+		UINT64 Lost;		// Measurements given up.
+		LONGLONG Total;		// 100ns units
+		LONGLONG Max;		//
+		UINT64 Buckets[TMS_GPU_TIME_HISTOGRAM_BUCKETS];
+	};
+
+	// GPU time measurements, read back asynchronously.
+	// Begin/End issue the queries of a slot, and Resolve reads the finished ones in order into the histogram without
+	// waiting for the GPU. When all the slots are in flight, the measurement is skipped rather than stalling the caller.
+	// The queries themselves are issued by the provider.
+	//
+	class GpuTimerQueryRing
+	{
+	public:
+		GpuTimerQueryRing();
+		~GpuTimerQueryRing();
+
+		void SetProvider(GpuTimerQueryProvider* pProvider);	// Takes ownership. NULL deletes the current one.
+		BOOL HasProvider();
+
+		HRESULT Begin(_Out_ UINT* pSlot);	// S_FALSE if this one is not measured; do not call End then.
+		HRESULT End(UINT slot);
+		void Resolve();						// Reads the results that are ready.
+		void Reset();						// Forgets the measurements in flight.
+
+		void GetStatistics(GpuTimeStatistics* pStatistics);
+		void ResetStatistics();
+
+	private:
+		enum SlotState
+		{
+			Slot_Free = 0,
+			Slot_Begun,
+			Slot_Ended,
+		};
+
+		GpuTimerQueryProvider* _Provider = NULL;
+		SlotState _States[GPU_TIMER_QUERY_SLOTS] = {};
+		UINT _Head = 0;		// Oldest slot in flight.
+		UINT _Count = 0;	// Slots in flight.
+		GpuTimeStatistics _Statistics = {};
+		CriticalSection _csTimer;
+
+		void ResolveCore();
+		void Account(LONGLONG hnsTime);
+	};
+}
@@ -0,0 +1,189 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	HotAttributeTable::HotAttributeTable()
+	{
+	}
+	HotAttributeTable::~HotAttributeTable()
+	{
+	}
+
+	HRESULT HotAttributeTable::Register(REFGUID key, MF_ATTRIBUTE_TYPE type, UINT64 value)
+	{
+		if (type != MF_ATTRIBUTE_UINT32 && type != MF_ATTRIBUTE_UINT64)
+			return E_INVALIDARG;
+
+		AutoLock lock(&this->_csWriter);
+
+		// Keep the table at most half full, so that the chains stay short.
+		if (this->_Count >= HOT_ATTRIBUTE_SLOTS / 2)
+			return E_OUTOFMEMORY;
+
+		UINT index = Hash(key);
+		for (UINT i = 0; i < HOT_ATTRIBUTE_SLOTS; i++)
+		{
+			Slot* pSlot = &this->_Slots[(index + i) & (HOT_ATTRIBUTE_SLOTS - 1)];
+			if (pSlot->Used)
+			{
+				if (pSlot->Key == key)
+					return E_INVALIDARG;	// Already registered.
+				continue;
+			}
+
+			pSlot->Key = key;
+			pSlot->Type = type;
+			pSlot->Sequence = 0;
+			pSlot->Value = value;
+			pSlot->Used = TRUE;
+			this->_Order[this->_Count++] = pSlot;
+			return S_OK;
+		}
+
+		return E_OUTOFMEMORY;
+	}
+	BOOL HotAttributeTable::Get(REFGUID key, MF_ATTRIBUTE_TYPE type, _Out_ UINT64* pValue)
+	{
+		Slot* pSlot = this->FindSlot(key);
+		if (NULL == pSlot || pSlot->Type != type)
+			return FALSE;
+
+		*pValue = Read(pSlot);
+		return TRUE;
+	}
+	BOOL HotAttributeTable::Set(REFGUID key, UINT64 value)
+	{
+		Slot* pSlot = this->FindSlot(key);
+		if (NULL == pSlot)
+			return FALSE;
+
+		AutoLock lock(&this->_csWriter);
+
+		if (pSlot->Value == value)
+			return TRUE;	// The readers need not retry for nothing.
+
+		pSlot->Sequence++;
+		::MemoryBarrier();
+		pSlot->Value = value;
+		::MemoryBarrier();
+		pSlot->Sequence++;
+
+		return TRUE;
+	}
+	BOOL HotAttributeTable::GetItem(REFGUID key, _Out_opt_ PROPVARIANT* pValue)
+	{
+		Slot* pSlot = this->FindSlot(key);
+		if (NULL == pSlot)
+			return FALSE;
+
+		if (NULL != pValue)
+			ToPropVariant(pSlot, pValue);
+		return TRUE;
+	}
+	BOOL HotAttributeTable::GetItemType(REFGUID key, _Out_ MF_ATTRIBUTE_TYPE* pType)
+	{
+		Slot* pSlot = this->FindSlot(key);
+		if (NULL == pSlot)
+			return FALSE;
+
+		*pType = pSlot->Type;
+		return TRUE;
+	}
+	BOOL HotAttributeTable::GetItemByIndex(UINT index, _Out_ GUID* pKey, _Out_opt_ PROPVARIANT* pValue)
+	{
+		if (index >= this->_Count)
+			return FALSE;
+
+		Slot* pSlot = this->_Order[index];
+		*pKey = pSlot->Key;
+		if (NULL != pValue)
+			ToPropVariant(pSlot, pValue);
+		return TRUE;
+	}
+	BOOL HotAttributeTable::CompareItem(REFGUID key, REFPROPVARIANT value, _Out_ BOOL* pbResult)
+	{
+		Slot* pSlot = this->FindSlot(key);
+		if (NULL == pSlot)
+			return FALSE;
+
+		// As the generic store does: a value of another type is not equal.
+		if (MF_ATTRIBUTE_UINT32 == pSlot->Type)
+			*pbResult = (VT_UI4 == value.vt && value.ulVal == (ULONG)Read(pSlot));
+		else
+			*pbResult = (VT_UI8 == value.vt && value.uhVal.QuadPart == Read(pSlot));
+		return TRUE;
+	}
+	HRESULT HotAttributeTable::CopyAllItems(IMFAttributes* pDest)
+	{
+		if (NULL == pDest)
+			return E_POINTER;
+
+		HRESULT hr;
+		for (UINT i = 0; i < this->_Count; i++)
+		{
+			Slot* pSlot = this->_Order[i];
+			UINT64 value = Read(pSlot);
+			hr = (MF_ATTRIBUTE_UINT32 == pSlot->Type) ? pDest->SetUINT32(pSlot->Key, (UINT32)value) : pDest->SetUINT64(pSlot->Key, value);
+			if (FAILED(hr))
+				return hr;
+		}
+
+		return S_OK;
+	}
+
+	// private
+
+	HotAttributeTable::Slot* HotAttributeTable::FindSlot(REFGUID key)
+	{
+		// The keys do not change once registered, so the lookup needs no lock.
+		UINT index = Hash(key);
+		for (UINT i = 0; i < HOT_ATTRIBUTE_SLOTS; i++)
+		{
+			Slot* pSlot = &this->_Slots[(index + i) & (HOT_ATTRIBUTE_SLOTS - 1)];
+			if (!pSlot->Used)
+				return NULL;	// Nothing is removed, so the chain ends here.
+
+			if (pSlot->Key == key)
+				return pSlot;
+		}
+
+		return NULL;
+	}
+	UINT64 HotAttributeTable::Read(Slot* pSlot)
+	{
+		for (;;)
+		{
+			LONG sequence = pSlot->Sequence;
+			if (sequence & 1)
+			{
+				::YieldProcessor();	// Being written; it takes a few instructions.
+				continue;
+			}
+			::MemoryBarrier();
+
+			UINT64 value = pSlot->Value;
+
+			::MemoryBarrier();
+			if (pSlot->Sequence == sequence)
+				return value;
+		}
+	}
+	void HotAttributeTable::ToPropVariant(Slot* pSlot, _Out_ PROPVARIANT* pValue)
+	{
+		::PropVariantInit(pValue);
+		if (MF_ATTRIBUTE_UINT32 == pSlot->Type)
+		{
+			pValue->vt = VT_UI4;
+			pValue->ulVal = (ULONG)Read(pSlot);
+		}
+		else
+		{
+			pValue->vt = VT_UI8;
+			pValue->uhVal.QuadPart = Read(pSlot);
+		}
+	}
+	UINT HotAttributeTable::Hash(REFGUID key)
+	{
+		return Fnv1a(&key, sizeof(GUID)) & (HOT_ATTRIBUTE_SLOTS - 1);
+	}
+}
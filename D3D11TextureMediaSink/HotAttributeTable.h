@@ -0,0 +1,56 @@
+#pragma once
+
+#define HOT_ATTRIBUTE_SLOTS		128		// Power of 2. At least twice the number of keys registered.
+
+namespace D3D11TextureMediaSink
+{
+	// Values of the attributes the consumer polls every frame (statistics and configuration), readable without any lock.
+	// An open-addressed table with linear probing, whose keys are registered once before it is shared. Each slot is a seqlock:
+	// the writer makes the sequence odd while it writes, and a reader retries until it reads the same even sequence before and
+	// after the value, so a reader never blocks the producer and never sees half of a 64-bit value. The writers are serialized.
+	// The keys that are not registered are left to the generic attribute store. The IMFAttributes methods of the sink go
+	// through both, so that the registered keys read the same whichever method is used.
+	//
+	class HotAttributeTable
+	{
+	public:
+		HotAttributeTable();
+		~HotAttributeTable();
+
+		HRESULT Register(REFGUID key, MF_ATTRIBUTE_TYPE type, UINT64 value);	// Before the table is shared.
+
+		BOOL Get(REFGUID key, MF_ATTRIBUTE_TYPE type, _Out_ UINT64* pValue);	// FALSE if not registered with the type.
+		BOOL Set(REFGUID key, UINT64 value);									// FALSE if not registered.
+
+		// As IMFAttributes has them. Each returns FALSE if the key is not registered; the items are VT_UI4 or VT_UI8.
+		UINT GetCount() const
+		{
+			return this->_Count;
+		}
+		BOOL GetItem(REFGUID key, _Out_opt_ PROPVARIANT* pValue);
+		BOOL GetItemType(REFGUID key, _Out_ MF_ATTRIBUTE_TYPE* pType);
+		BOOL GetItemByIndex(UINT index, _Out_ GUID* pKey, _Out_opt_ PROPVARIANT* pValue);	// In the order registered.
+		BOOL CompareItem(REFGUID key, REFPROPVARIANT value, _Out_ BOOL* pbResult);
+		HRESULT CopyAllItems(IMFAttributes* pDest);
+
+	private:
+		struct Slot
+		{
+			BOOL Used;
+			GUID Key;
+			MF_ATTRIBUTE_TYPE Type;		// MF_ATTRIBUTE_UINT32 or MF_ATTRIBUTE_UINT64.
+			volatile LONG Sequence;		// Odd while the value is being written.
+			volatile UINT64 Value;
+		};
+
+		Slot _Slots[HOT_ATTRIBUTE_SLOTS] = {};
+		Slot* _Order[HOT_ATTRIBUTE_SLOTS / 2] = {};	// The slots in the order registered.
+		UINT _Count = 0;
+		CriticalSection _csWriter;
+
+		Slot* FindSlot(REFGUID key);
+		static UINT64 Read(Slot* pSlot);
+		static void ToPropVariant(Slot* pSlot, _Out_ PROPVARIANT* pValue);
+		static UINT Hash(REFGUID key);
+	};
+}
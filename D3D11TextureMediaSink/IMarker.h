@@ -11,10 +11,10 @@ namespace D3D11TextureMediaSink
 // - CONTEXT (PROVARIANT)
 //
 //  This interface allows marker data to be stored inside an IUnknown object.
-//  The object can be kept in the same queue as the queue holding the media type.
-//  This is useful because samples and markers must be serialized.
-//  In other words, you cannot be responsible for the marker until you have processed
-//  all the samples that came before it.
+//  Samples and markers must be serialized: you cannot be responsible for the marker until
+//  you have processed all the samples that came before it. The marker remembers how many
+//  samples came before it (its position), so that it can be kept in its own queue and
+//  completed as soon as that many samples are done.
 
 //  Note that IMarker is not a standard Media Foundation interface.
 	MIDL_INTERFACE("3AC82233-933C-43a9-AF3D-ADC94EABF406")
@@ -23,5 +23,6 @@ namespace D3D11TextureMediaSink
 		virtual STDMETHODIMP GetType(MFSTREAMSINK_MARKER_TYPE* pType) = 0;
 		virtual STDMETHODIMP GetValue(PROPVARIANT* pvar) = 0;
 		virtual STDMETHODIMP GetContext(PROPVARIANT* pvar) = 0;
+		virtual STDMETHODIMP GetPosition(UINT64* pPosition) = 0;
 	};
 }
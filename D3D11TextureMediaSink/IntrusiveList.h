@@ -0,0 +1,164 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// Links of an element of an IntrusiveList. Derive the element type from it.
+	struct IntrusiveListEntry
+	{
+		IntrusiveListEntry* prev = NULL;
+		IntrusiveListEntry* next = NULL;
+	};
+
+	// Doubly-linked list whose links are in the elements themselves (T derives from IntrusiveListEntry).
+	// Insertion and removal never allocate, and an element can be removed from the middle in O(1) without a search.
+	// The list does not own the elements: Clear and the destructor only unlink them. An element is in one list at a time.
+	//
+	template <class T>
+	class IntrusiveList
+	{
+	public:
+		IntrusiveList()
+		{
+			m_anchor.next = &m_anchor;
+			m_anchor.prev = &m_anchor;
+			m_count = 0;
+		}
+		~IntrusiveList()
+		{
+			this->Clear();
+		}
+
+		void Clear()
+		{
+			IntrusiveListEntry *n = m_anchor.next;
+
+			while (n != &m_anchor)
+			{
+				IntrusiveListEntry *tmp = n->next;
+				n->prev = NULL;
+				n->next = NULL;
+				n = tmp;
+			}
+
+			m_anchor.next = &m_anchor;
+			m_anchor.prev = &m_anchor;
+			m_count = 0;
+		}
+
+		// Insertion functions
+		HRESULT InsertBack(T* item)
+		{
+			return this->InsertAfter(item, m_anchor.prev);
+		}
+		HRESULT InsertFront(T* item)
+		{
+			return this->InsertAfter(item, &m_anchor);
+		}
+
+		// Remove: Unlinks an element of this list.
+		HRESULT Remove(T* item)
+		{
+			if (item == NULL)
+				return E_POINTER;
+
+			IntrusiveListEntry *pEntry = item;
+			if (pEntry->next == NULL)
+				return E_INVALIDARG;	// Not in a list.
+
+			pEntry->next->prev = pEntry->prev;
+			pEntry->prev->next = pEntry->next;
+			pEntry->prev = NULL;
+			pEntry->next = NULL;
+			m_count--;
+
+			return S_OK;
+		}
+
+		// RemoveBack / RemoveFront: Unlinks the tail / head and returns it. ppItem can be NULL.
+		HRESULT RemoveBack(T** ppItem)
+		{
+			if (this->IsEmpty())
+				return E_FAIL;
+
+			T* item = static_cast<T*>(m_anchor.prev);
+			if (ppItem)
+				*ppItem = item;
+			return this->Remove(item);
+		}
+		HRESULT RemoveFront(T** ppItem)
+		{
+			if (this->IsEmpty())
+				return E_FAIL;
+
+			T* item = static_cast<T*>(m_anchor.next);
+			if (ppItem)
+				*ppItem = item;
+			return this->Remove(item);
+		}
+
+		// GetBack / GetFront: Gets the tail / head item.
+		HRESULT GetBack(T** ppItem)
+		{
+			if (ppItem == NULL)
+				return E_POINTER;
+			if (this->IsEmpty())
+				return E_FAIL;
+
+			*ppItem = static_cast<T*>(m_anchor.prev);
+			return S_OK;
+		}
+		HRESULT GetFront(T** ppItem)
+		{
+			if (ppItem == NULL)
+				return E_POINTER;
+			if (this->IsEmpty())
+				return E_FAIL;
+
+			*ppItem = static_cast<T*>(m_anchor.next);
+			return S_OK;
+		}
+
+		// GetCount: Returns the number of items in the list.
+		DWORD GetCount() const { return m_count; }
+
+		bool IsEmpty() const { return (this->GetCount() == 0); }
+
+		// Enumerator functions: for (T* p = list.Front(); p != NULL; p = list.Next(p))
+
+		T* Front() const
+		{
+			return this->IsEmpty() ? NULL : static_cast<T*>(m_anchor.next);
+		}
+		T* Next(const T* item) const
+		{
+			const IntrusiveListEntry *pEntry = item;
+			return (pEntry->next != &m_anchor) ? static_cast<T*>(pEntry->next) : NULL;
+		}
+
+	private:
+		IntrusiveListEntry m_anchor;	// Anchor entry for the linked list.
+		DWORD m_count;					// Number of items in the list.
+
+		HRESULT InsertAfter(T* item, IntrusiveListEntry *pBefore)
+		{
+			if (item == NULL)
+				return E_POINTER;
+
+			IntrusiveListEntry *pEntry = item;
+			if (pEntry->next != NULL)
+				return E_INVALIDARG;	// Already in a list.
+
+			IntrusiveListEntry *pAfter = pBefore->next;
+
+			pBefore->next = pEntry;
+			pAfter->prev = pEntry;
+
+			pEntry->prev = pBefore;
+			pEntry->next = pAfter;
+
+			m_count++;
+
+			return S_OK;
+		}
+	};
+}
@@ -6,6 +6,7 @@ namespace D3D11TextureMediaSink
 	{
 		this->mReferenceCounter = 1;
 		this->mType = type;
+		this->mPosition = 0;
 		::PropVariantInit(&this->mValue);
 		::PropVariantInit(&this->mContext);
 	}
@@ -21,6 +22,7 @@ namespace D3D11TextureMediaSink
 		MFSTREAMSINK_MARKER_TYPE eMarkerType,
 		const PROPVARIANT* pvarMarkerValue, // Can be NULL.
 		const PROPVARIANT* pvarContextValue, // Can be NULL.
+		UINT64 position, // Number of samples placed before the marker.
 		IMarker** ppMarker // [out] A pointer to receive the IMarker you created.
 	)
 	{
@@ -49,6 +51,8 @@ namespace D3D11TextureMediaSink
 				if (FAILED(hr = ::PropVariantCopy(&pMarker->mContext, pvarContextValue)))
 					break;
 
+			pMarker->mPosition = position;
+
 			// Update the reference counter for the return value and complete.
 			*ppMarker = pMarker;
 			(*ppMarker)->AddRef();
@@ -124,4 +128,13 @@ namespace D3D11TextureMediaSink
 
 		return ::PropVariantCopy(pvar, &(this->mContext));
 	}
+	HRESULT Marker::GetPosition(UINT64* pPosition)
+	{
+		if (pPosition == NULL)
+			return E_POINTER;
+
+		*pPosition = this->mPosition;
+
+		return S_OK;
+	}
 }
@@ -11,6 +11,7 @@ namespace D3D11TextureMediaSink
 			MFSTREAMSINK_MARKER_TYPE eMarkerType,
 			const PROPVARIANT* pvarMarkerValue,
 			const PROPVARIANT* pvarContextValue,
+			UINT64 position,
 			IMarker** ppMarker);
 
 		// IUnknown Implementation
@@ -22,11 +23,13 @@ namespace D3D11TextureMediaSink
 		STDMETHODIMP GetType(MFSTREAMSINK_MARKER_TYPE* pType);
 		STDMETHODIMP GetValue(PROPVARIANT* pvar);
 		STDMETHODIMP GetContext(PROPVARIANT* pvar);
+		STDMETHODIMP GetPosition(UINT64* pPosition);
 
 	protected:
 		MFSTREAMSINK_MARKER_TYPE	mType;
 		PROPVARIANT					mValue;
 		PROPVARIANT					mContext;
+		UINT64						mPosition;
 
 	private:
 		Marker(MFSTREAMSINK_MARKER_TYPE type);
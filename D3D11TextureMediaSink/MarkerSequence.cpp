@@ -0,0 +1,68 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	MarkerSequence::MarkerSequence()
+	{
+	}
+	MarkerSequence::~MarkerSequence()
+	{
+		this->_Markers.Clear();
+	}
+
+	void MarkerSequence::SamplePlaced()
+	{
+		this->_SamplesPlaced++;
+	}
+	void MarkerSequence::SampleDone()
+	{
+		this->_SamplesDone++;
+	}
+	HRESULT MarkerSequence::PlaceMarker(MFSTREAMSINK_MARKER_TYPE eMarkerType, const PROPVARIANT* pvarMarkerValue, const PROPVARIANT* pvarContextValue)
+	{
+		HRESULT hr;
+		IMarker* pMarker = NULL;
+
+		// After the samples placed so far.
+		if (SUCCEEDED(hr = Marker::Create(eMarkerType, pvarMarkerValue, pvarContextValue, this->_SamplesPlaced, &pMarker)))
+			hr = this->_Markers.Queue(pMarker);
+
+		SafeRelease(pMarker);
+
+		return hr;
+	}
+	HRESULT MarkerSequence::Complete(MarkerTarget* pTarget)
+	{
+		if (NULL == pTarget)
+			return E_POINTER;
+
+		HRESULT hr = S_OK;
+
+		IMarker* pMarker = NULL;
+		while (S_OK == this->_Markers.GetAt(0, &pMarker))
+		{
+			UINT64 position = 0;
+			pMarker->GetPosition(&position);
+			if (position > this->_SamplesDone)
+			{
+				SafeRelease(pMarker);
+				break;	// Some of the samples before it are not done yet.
+			}
+
+			hr = pTarget->CompleteMarker(pMarker);
+			SafeRelease(pMarker);
+			if (S_OK != hr)
+				break;	// The markers after it wait too.
+
+			if (S_OK == this->_Markers.Dequeue(&pMarker))
+				SafeRelease(pMarker);
+		}
+
+		return SUCCEEDED(hr) ? S_OK : hr;
+	}
+	void MarkerSequence::Clear()
+	{
+		this->_Markers.Clear();
+		this->_SamplesDone = this->_SamplesPlaced;
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// What the stream sink does with a marker once all the samples placed before it are done.
+	class MarkerTarget
+	{
+	public:
+		virtual ~MarkerTarget() {}
+
+		// S_OK: the marker is done and leaves the sequence. Anything else keeps it at the head, with the markers after it,
+		// until the next Complete (S_FALSE: an end of segment still waiting for its frames).
+		virtual HRESULT CompleteMarker(IMarker* pMarker) = 0;
+	};
+
+	// The markers placed on a stream, each keyed to the number of samples placed before it (its position).
+	// The samples go their own way; a marker is due as soon as that many samples are done (scheduled or dropped), without
+	// waiting for the samples after it. The markers are completed in the order they were placed.
+	// The counts are not thread safe: the stream sink places under _csStreamSink, and is done with samples and completes
+	// markers under _csProcessing. The queue of the markers is.
+	//
+	class MarkerSequence
+	{
+	public:
+		MarkerSequence();
+		~MarkerSequence();
+
+		void SamplePlaced();
+		void SampleDone();
+		HRESULT PlaceMarker(MFSTREAMSINK_MARKER_TYPE eMarkerType, const PROPVARIANT* pvarMarkerValue, const PROPVARIANT* pvarContextValue);
+		HRESULT Complete(MarkerTarget* pTarget);	// Completes the markers that are due, in order.
+		void Clear();								// Drops the markers, and the samples not done yet.
+
+		UINT64 GetSamplesPlaced() const
+		{
+			return this->_SamplesPlaced;
+		}
+		UINT64 GetSamplesDone() const
+		{
+			return this->_SamplesDone;
+		}
+		DWORD GetMarkerCount()
+		{
+			return this->_Markers.GetCount();
+		}
+
+	private:
+		ThreadSafeComPtrQueue<IMarker> _Markers;	// In the order they were placed, so their positions never decrease.
+		UINT64 _SamplesPlaced = 0;
+		UINT64 _SamplesDone = 0;
+	};
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#define OUTPUT_PLANE_MAX	2
+
+namespace D3D11TextureMediaSink
+{
+	// Layout of one plane of an output texture.
+	struct OutputPlane
+	{
+		UINT32 Width;			// Size of the plane in elements.
+		UINT32 Height;			//
+		UINT32 BytesPerElement;
+		DXGI_FORMAT ViewFormat;	// Format of a shader resource view that reads this plane.
+	};
+
+	// Is the format one of the output formats the sink can produce?
+	inline BOOL IsSupportedOutputFormat(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+		case DXGI_FORMAT_NV12:
+		case DXGI_FORMAT_P010:
+			return TRUE;
+		default:
+			return FALSE;
+		}
+	}
+
+	inline BOOL IsPlanarFormat(DXGI_FORMAT format)
+	{
+		return (format == DXGI_FORMAT_NV12 || format == DXGI_FORMAT_P010);
+	}
+
+	// Planar (4:2:0) textures must have an even width and height.
+	inline UINT32 AlignOutputSize(DXGI_FORMAT format, UINT32 size)
+	{
+		return IsPlanarFormat(format) ? ((size + 1) & ~1) : size;
+	}
+
+	// Gets the planes of a texture of the format and size. Returns the number of planes (0 if the format is not supported).
+	inline UINT32 GetOutputPlanes(DXGI_FORMAT format, UINT32 width, UINT32 height, OutputPlane planes[OUTPUT_PLANE_MAX])
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+			planes[0] = { width, height, 4, format };
+			return 1;
+
+		case DXGI_FORMAT_NV12:
+			planes[0] = { width, height, 1, DXGI_FORMAT_R8_UNORM };					// Y
+			planes[1] = { width / 2, height / 2, 2, DXGI_FORMAT_R8G8_UNORM };		// interleaved UV
+			return 2;
+
+		case DXGI_FORMAT_P010:
+			planes[0] = { width, height, 2, DXGI_FORMAT_R16_UNORM };				// Y
+			planes[1] = { width / 2, height / 2, 4, DXGI_FORMAT_R16G16_UNORM };		// interleaved UV
+			return 2;
+
+		default:
+			return 0;
+		}
+	}
+
+	// Gets the number of bytes of a texture of the format and size.
+	inline UINT64 GetOutputFrameBytes(DXGI_FORMAT format, UINT32 width, UINT32 height)
+	{
+		OutputPlane planes[OUTPUT_PLANE_MAX];
+		UINT32 count = GetOutputPlanes(format, width, height, planes);
+		if (count == 0)
+			return (UINT64)width * height * 4;	// Unknown format; assume 32 bits per pixel.
+
+		UINT64 bytes = 0;
+		for (UINT32 i = 0; i < count; i++)
+			bytes += (UINT64)planes[i].Width * planes[i].Height * planes[i].BytesPerElement;
+
+		return bytes;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// Description of an input frame and of the output it should be turned into.
+	struct PassthroughQuery
+	{
+		BOOL Enabled;				// TMS_PASSTHROUGH attribute.
+		DXGI_FORMAT InputFormat;	// The decoder's texture.
+		UINT32 InputWidth;			//
+		UINT32 InputHeight;			//
+		UINT InputArraySize;		//
+		UINT InputViewIndex;		//
+		UINT InputBindFlags;		//
+		UINT32 InterlaceMode;		// Interlace mode of this frame.
+		DXGI_FORMAT OutputFormat;	// The output pool.
+		UINT32 OutputWidth;			//
+		UINT32 OutputHeight;		//
+	};
+
+	// Result of DecidePassthrough. Anything other than Passthrough_Yes is the reason the video processor is needed.
+	enum PassthroughDecision
+	{
+		Passthrough_Yes = 0,
+		Passthrough_Disabled,
+		Passthrough_FormatMismatch,
+		Passthrough_SizeMismatch,
+		Passthrough_Interlaced,
+		Passthrough_NotShareable,	// The consumer could not use the texture as is (a slice of an array, or not bindable as a shader resource).
+	};
+
+	// Decides whether the decoder's texture can be presented as is, instead of being blitted into a pool texture.
+	// Pure function of the query, so it does not need a device.
+	inline PassthroughDecision DecidePassthrough(const PassthroughQuery& query)
+	{
+		if (!query.Enabled)
+			return Passthrough_Disabled;
+
+		// The same format. (X8 is read as opaque alpha, so BGRX is as good as BGRA.)
+		BOOL formatMatches =
+			(query.InputFormat == query.OutputFormat) ||
+			(query.InputFormat == DXGI_FORMAT_B8G8R8X8_UNORM && query.OutputFormat == DXGI_FORMAT_B8G8R8A8_UNORM);
+		if (!formatMatches)
+			return Passthrough_FormatMismatch;
+
+		if (query.InputWidth != query.OutputWidth || query.InputHeight != query.OutputHeight)
+			return Passthrough_SizeMismatch;
+
+		if (query.InterlaceMode != MFVideoInterlace_Progressive)
+			return Passthrough_Interlaced;
+
+		if (query.InputArraySize != 1 || query.InputViewIndex != 0 || 0 == (query.InputBindFlags & D3D11_BIND_SHADER_RESOURCE))
+			return Passthrough_NotShareable;
+
+		return Passthrough_Yes;
+	}
+}
@@ -6,7 +6,6 @@ namespace D3D11TextureMediaSink
 	{
 		this->_ShutdownComplete = FALSE;
 		this->_csPresenter = new CriticalSection();
-		this->_SampleAllocator = new SampleAllocator();
 	}
 	Presenter::~Presenter()
 	{
@@ -15,6 +14,9 @@ namespace D3D11TextureMediaSink
 
 	void Presenter::SetD3D11(void* pDXGIDeviceManager, void* pD3D11Device)
 	{
+		// The warm-up in progress uses the video device.
+		this->WaitForWarmUp();
+
 		this->_DXGIDeviceManager = (IMFDXGIDeviceManager*)pDXGIDeviceManager;
 		this->_DXGIDeviceManager->AddRef();
 
@@ -24,6 +26,22 @@ namespace D3D11TextureMediaSink
 		this->_D3D11VideoDevice = NULL;
 		this->_D3D11Device->QueryInterface(__uuidof(ID3D11VideoDevice), (void**)&this->_D3D11VideoDevice);
 
+		// What the previous device supported means nothing for this one. Neither do its textures.
+		this->_Capabilities.Invalidate();
+		this->ClearScrubCache();
+		this->ReleaseThumbnailAtlas();
+		this->ReleaseThumbnailProcessor();
+
+		// Get the contexts once, rather than for every frame.
+		this->_D3D11DeviceContext = NULL;
+		this->_D3D11Device->GetImmediateContext(&this->_D3D11DeviceContext);
+		this->_D3D11VideoContext = NULL;
+		this->_D3D11DeviceContext->QueryInterface(__uuidof(ID3D11VideoContext), (void**)&this->_D3D11VideoContext);
+		this->_Multithread = NULL;
+		this->_D3D11DeviceContext->QueryInterface(__uuidof(ID3D10Multithread), (void**)&this->_Multithread);
+		if (this->_MultithreadProtection && NULL != this->_Multithread)
+			this->_Multithread->SetMultithreadProtected(TRUE);
+
 		// Attempt to initialize the sample allocator.
 		this->InitializeSampleAllocator();
 	}
@@ -37,39 +55,29 @@ namespace D3D11TextureMediaSink
 		this->_D3D11Device->AddRef();
 		return this->_D3D11Device;
 	}
-	HRESULT Presenter::IsSupported(IMFMediaType* pMediaType, DXGI_FORMAT dxgiFormat)
+	HRESULT Presenter::IsSupported(const CapabilityKey& key, UINT32 width, UINT32 height, DXGI_FORMAT dxgiFormat)
 	{
 		HRESULT hr = S_OK;
 
-		if (NULL == pMediaType)
-			return E_POINTER;
-
 		// Shut down?
 		if (FAILED(hr = this->CheckShutdown()))
 			return hr;
 
-		UINT32 FrameRateNumerator = 30000, FrameRateDenominator = 1001;
-		UINT32 ImageWidthPx, ImageHeightPx = 0;
-
-		// Get the frame size (image width, height) from the media type to be scanned.
-		if (FAILED(hr = ::MFGetAttributeSize(pMediaType, MF_MT_FRAME_SIZE, &ImageWidthPx, &ImageHeightPx)))
-			return hr;
-
-		// Get the frame rate (numerator, denominator) from the media type to be inspected.
-		::MFGetAttributeRatio(pMediaType, MF_MT_FRAME_RATE, &FrameRateNumerator, &FrameRateDenominator);
+		if (NULL == this->_D3D11VideoDevice)
+			return MF_E_UNSUPPORTED_D3D_TYPE;
 
-		// Check if the format is supportable.
+		// Check if the format is supportable. (The real frame size; the bucket of the key is only where the answer is cached.)
 		D3D11_VIDEO_PROCESSOR_CONTENT_DESC ContentDesc;
 		ZeroMemory(&ContentDesc, sizeof(ContentDesc));
-		ContentDesc.InputFrameFormat = D3D11_VIDEO_FRAME_FORMAT_INTERLACED_TOP_FIELD_FIRST;
-		ContentDesc.InputWidth = (DWORD)ImageWidthPx;
-		ContentDesc.InputHeight = (DWORD)ImageHeightPx;
-		ContentDesc.OutputWidth = (DWORD)ImageWidthPx;
-		ContentDesc.OutputHeight = (DWORD)ImageHeightPx;
-		ContentDesc.InputFrameRate.Numerator = FrameRateNumerator;
-		ContentDesc.InputFrameRate.Denominator = FrameRateDenominator;
-		ContentDesc.OutputFrameRate.Numerator = FrameRateNumerator;
-		ContentDesc.OutputFrameRate.Denominator = FrameRateDenominator;
+		ContentDesc.InputFrameFormat = key.Interlaced ? D3D11_VIDEO_FRAME_FORMAT_INTERLACED_TOP_FIELD_FIRST : D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE;
+		ContentDesc.InputWidth = (DWORD)width;
+		ContentDesc.InputHeight = (DWORD)height;
+		ContentDesc.OutputWidth = (DWORD)width;
+		ContentDesc.OutputHeight = (DWORD)height;
+		ContentDesc.InputFrameRate.Numerator = key.FrameRateNumerator;
+		ContentDesc.InputFrameRate.Denominator = key.FrameRateDenominator;
+		ContentDesc.OutputFrameRate.Numerator = key.FrameRateNumerator;
+		ContentDesc.OutputFrameRate.Denominator = key.FrameRateDenominator;
 		ContentDesc.Usage = D3D11_VIDEO_USAGE_PLAYBACK_NORMAL;
 
 		// Get the ID3D11VideoProcessorEnumerator.
@@ -81,10 +89,16 @@ namespace D3D11TextureMediaSink
 		UINT uiFlags;
 		hr = pVideoProcessorEnum->CheckVideoProcessorFormat(dxgiFormat, &uiFlags);
 		if (FAILED(hr) || 0 == (uiFlags & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_INPUT))
-			return MF_E_UNSUPPORTED_D3D_TYPE;
+			hr = MF_E_UNSUPPORTED_D3D_TYPE;
+
+		SafeRelease(pVideoProcessorEnum);
 
 		return hr;
 	}
+	CapabilityCache* Presenter::GetCapabilityCache()
+	{
+		return &this->_Capabilities;
+	}
 	HRESULT Presenter::SetCurrentMediaType(IMFMediaType* pMediaType)
 	{
 		HRESULT hr = S_OK;
@@ -109,11 +123,132 @@ namespace D3D11TextureMediaSink
 		if (FAILED(hr = pMediaType->GetGUID(MF_MT_SUBTYPE, &subType)))
 			return hr;
 
-		// Attempt to initialize the sample allocator.
+		// Interlaced content is deinterlaced with reference frames. The frames of the previous media type are not references of the new ones.
+		this->_InterlacedContent = (MFVideoInterlace_Progressive != ::MFGetAttributeUINT32(pMediaType, MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+		this->_History.Clear();
+
+		// Measure how long the first frame of this type waits for the objects the warm-up creates.
+		this->_FirstFramePending = TRUE;
+
+		// Get the YUV matrix. (Default as in the EVR: BT.709 for HD, BT.601 for SD.)
+		this->_YuvMatrix = ::MFGetAttributeUINT32(pMediaType, MF_MT_YUV_MATRIX, (this->_Height >= 720) ? MFVideoTransferMatrix_BT709 : MFVideoTransferMatrix_BT601);
+
+		// The rest of the colour, for the description of the output. The primaries and the transfer function are not changed by the video processor.
+		this->_ChromaSiting = ::MFGetAttributeUINT32(pMediaType, MF_MT_VIDEO_CHROMA_SITING, 0);
+		this->_Primaries = ::MFGetAttributeUINT32(pMediaType, MF_MT_VIDEO_PRIMARIES, MFVideoPrimaries_BT709);
+		this->_TransferFunction = ::MFGetAttributeUINT32(pMediaType, MF_MT_TRANSFER_FUNCTION, MFVideoTransFunc_709);
+		this->_InputCount = 0;
+
+		// Switch the sample allocator to the new size. A recently used size is reused as is; otherwise the textures and the
+		// video processor are built in the background, and the caller does not wait for them. Frames of the previous size are
+		// still processed with the pool of that size during the transition.
+		this->InitializeSampleAllocator();
+
+		return S_OK;
+	}
+	void Presenter::SetMemoryBudget(TextureMemoryBudget* pBudget, DWORD streamId)
+	{
+		this->_SamplePool.SetMemoryBudget(pBudget, streamId);
+		this->_MemoryBudget = pBudget;
+		this->_MemoryStreamId = streamId;
+	}
+	void Presenter::SetHotAttributes(HotAttributeTable* pTable)
+	{
+		this->_HotAttributes = pTable;
+	}
+	HRESULT Presenter::SetOutputFormat(DXGI_FORMAT format)
+	{
+		if (!IsSupportedOutputFormat(format))
+			return MF_E_INVALIDMEDIATYPE;
+
+		HRESULT hr;
+
+		// Shut down?
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		if (this->_OutputFormat == format)
+			return S_OK;
+
+		this->_OutputFormat = format;
+
+		// Switch to the pool of the new format. (The samples of the previous format still come back to their pool.)
 		this->InitializeSampleAllocator();
 
 		return S_OK;
 	}
+	DXGI_FORMAT Presenter::GetOutputFormat()
+	{
+		return this->_OutputFormat;
+	}
+	void Presenter::SetPassthrough(BOOL bEnable)
+	{
+		this->_Passthrough = bEnable;
+	}
+	BOOL Presenter::GetPassthrough()
+	{
+		return this->_Passthrough;
+	}
+	void Presenter::SetMultithreadProtection(BOOL bEnable)
+	{
+		this->_MultithreadProtection = bEnable;
+
+		// The protection is left on when disabled, as the application may have turned it on for itself.
+		if (bEnable && NULL != this->_Multithread)
+			this->_Multithread->SetMultithreadProtected(TRUE);
+	}
+	BOOL Presenter::GetMultithreadProtection()
+	{
+		return this->_MultithreadProtection;
+	}
+	void Presenter::SetSharedTextures(BOOL bEnable)
+	{
+		if (this->_SharedTextures == bEnable)
+			return;
+
+		this->_SharedTextures = bEnable;
+		this->_SamplePool.SetShared(bEnable);
+
+		// Switch to a pool of the new mode. (The samples of the previous mode still come back to their pool.)
+		if (SUCCEEDED(this->CheckShutdown()))
+			this->InitializeSampleAllocator();
+	}
+	BOOL Presenter::GetSharedTextures()
+	{
+		return this->_SharedTextures;
+	}
+	void Presenter::SetGpuTiming(BOOL bEnable)
+	{
+		this->_GpuTiming = bEnable;
+
+		// The measurements in flight are not read any more when disabled.
+		if (!bEnable)
+			this->_GpuTimer.Reset();
+		this->_GpuTimer.ResetStatistics();
+		this->PublishGpuTimeStatistics();
+	}
+	BOOL Presenter::GetGpuTiming()
+	{
+		return this->_GpuTiming;
+	}
+	void Presenter::GetGpuTimeStatistics(GpuTimeStatistics* pStatistics)
+	{
+		this->_GpuTimer.GetStatistics(pStatistics);
+	}
+	void Presenter::SetWarmUpHint(UINT32 width, UINT32 height)
+	{
+		this->_HintWidth = width;
+		this->_HintHeight = height;
+
+		// Until the media type is known, warm up the hinted size speculatively.
+		if (SUCCEEDED(this->CheckShutdown()) && this->_Width == 0)
+			this->InitializeSampleAllocator();
+	}
+	void Presenter::GetWarmUpHint(UINT32* pWidth, UINT32* pHeight)
+	{
+		*pWidth = this->_HintWidth;
+		*pHeight = this->_HintHeight;
+	}
 	BOOL Presenter::IsReadyNextSample()
 	{
 		return this->_IsNextSampleReady;
@@ -121,13 +256,32 @@ namespace D3D11TextureMediaSink
 
 	void Presenter::Shutdown()
 	{
-		AutoLock(this->_csPresenter);
+		AutoLock lock(this->_csPresenter);
 
 		if (!this->_ShutdownComplete)
 		{
+			// Let the warm-up in progress finish first.
+			this->_WarmUp.Close();
+
+			// Wait for the blending on the scheduler thread, if any.
+			AutoLock lockContext(&this->_csDeviceContext);
+
 			//this._XVPControl = null;
 			//this._XVP = null;
 
+			// Shut down the sample allocators and the video processors, and give the reference frames back to the decoder.
+			this->_History.Clear();
+			this->_SamplePool.Shutdown();
+			this->ClearScrubCache();
+			this->ReleaseBlendProcessor();
+			this->ReleaseThumbnailAtlas();
+			this->ReleaseThumbnailProcessor();
+			SafeRelease(this->_ThumbnailCallback);
+			this->_GpuTimer.SetProvider(NULL);
+
+			SafeRelease(this->_Multithread);
+			SafeRelease(this->_D3D11VideoContext);
+			SafeRelease(this->_D3D11DeviceContext);
 			SafeRelease(this->_DXGIDeviceManager);
 			SafeRelease(this->_D3D11VideoDevice);
 			SafeRelease(this->_D3D11Device);
@@ -147,9 +301,12 @@ namespace D3D11TextureMediaSink
 
 		this->_IsNextSampleReady = TRUE;
 
+		// The frames before the flush are not references of the ones after it.
+		this->_History.Clear();
+
 		return S_OK;
 	}
-	HRESULT Presenter::ProcessFrame(_In_ IMFMediaType* pCurrentType, _In_ IMFSample* pSample, _Out_ UINT32* punInterlaceMode, _Out_ BOOL* pbDeviceChanged, _Out_ BOOL* pbProcessAgain, _Out_ IMFSample** ppOutputSample)
+	HRESULT Presenter::ProcessFrame(_In_ IMFMediaType* pCurrentType, _In_ IMFSample* pSample, _Out_ UINT32* punInterlaceMode, _Out_ BOOL* pbDeviceChanged, _Out_ BOOL* pbProcessAgain, _Out_ IMFSample** ppOutputSample, _Out_opt_ IMFSample** ppSecondFieldSample)
 	{
 		HRESULT hr;
 		*pbDeviceChanged = FALSE;
@@ -162,11 +319,19 @@ namespace D3D11TextureMediaSink
 		if (NULL == pCurrentType || NULL == pSample || NULL == punInterlaceMode || NULL == pbDeviceChanged || NULL == pbProcessAgain || NULL == ppOutputSample)
 			return E_POINTER;
 
+		*ppOutputSample = NULL;
+		if (NULL != ppSecondFieldSample)
+			*ppSecondFieldSample = NULL;
+
 
 		IMFMediaBuffer* pBuffer = NULL;
 		IMFDXGIBuffer* pMFDXGIBuffer = NULL;
 		ID3D11Texture2D* pTexture2D = NULL;
 		IMFSample* pRTSample = NULL;
+		MFTIME hnsStart = ::MFGetSystemTime();
+
+		// The output is of this input unless the deinterlacer lags behind.
+		this->_OutputSourceIndex = this->_InputCount++;
 
 		do
 		{
@@ -219,26 +384,29 @@ namespace D3D11TextureMediaSink
 			if (FAILED(hr = pMFDXGIBuffer->GetSubresourceIndex(&dwViewIndex)))
 				break;
 
-			// ID3D11Texture2D is video-processed to obtain an output sample (IMFSample).
-			if (FAILED(hr = this->ProcessFrameUsingD3D11(pTexture2D, dwViewIndex, *punInterlaceMode, ppOutputSample)))
+			// If nothing needs to be done to the frame, present the decoder's texture as is.
+			if (FAILED(hr = this->ProcessFramePassthrough(pSample, pBuffer, pTexture2D, dwViewIndex, *punInterlaceMode, ppOutputSample)))
 				break;
 
-			// Copy the time information from the input sample to the output sample.
-			LONGLONG llv;
-			if (SUCCEEDED(pSample->GetSampleTime(&llv)))
+			if (S_OK == hr)
 			{
-				(*ppOutputSample)->SetSampleTime(llv);
-				//TCHAR buf[1024];
-				//wsprintf(buf, L"Presenter::ProcessFrame; Display time %d ms (%x)\n", (llv / 10000), *ppOutputSample);
-				//OutputDebugString(buf);
+				// Copy the time information from the input sample to the output sample.
+				this->CopySampleTimes(pSample, *ppOutputSample, 0, 1);
 			}
-			if (SUCCEEDED(pSample->GetSampleDuration(&llv)))
+			else
 			{
-				(*ppOutputSample)->SetSampleDuration(llv);
+				// Otherwise, ID3D11Texture2D is video-processed to obtain the output samples (IMFSample). This copies the time information.
+				// (With a deinterlacer that uses future frames, there may be no output yet, and the output is of an earlier input.)
+				if (FAILED(hr = this->ProcessFrameUsingD3D11(pSample, pTexture2D, dwViewIndex, *punInterlaceMode, ppOutputSample, ppSecondFieldSample)))
+					break;
 			}
-			DWORD flags;
-			if (SUCCEEDED(pSample->GetSampleFlags(&flags)))
-				(*ppOutputSample)->SetSampleFlags(flags);
+
+			// Describe the output.
+			LONGLONG hnsProcessTime = ::MFGetSystemTime() - hnsStart;
+			if (NULL != *ppOutputSample)
+				this->DescribeOutput(*ppOutputSample, hnsProcessTime);
+			if (NULL != ppSecondFieldSample && NULL != *ppSecondFieldSample)
+				this->DescribeOutput(*ppSecondFieldSample, hnsProcessTime);
 
 		} while (FALSE);
 
@@ -246,260 +414,1681 @@ namespace D3D11TextureMediaSink
 		SafeRelease(pMFDXGIBuffer);
 		SafeRelease(pBuffer);
 
+		// A lost device takes what it supported with it.
+		if (DXGI_ERROR_DEVICE_REMOVED == hr || DXGI_ERROR_DEVICE_RESET == hr)
+			this->_Capabilities.Invalidate();
+
 		return S_OK;
 	}
-	HRESULT Presenter::ReleaseSample(IMFSample* pSample)
+	HRESULT Presenter::DrainHistory(_Out_ IMFSample** ppOutputSample, _Out_opt_ IMFSample** ppSecondFieldSample)
 	{
-		return this->_SampleAllocator->ReleaseSample(pSample);
-	}
+		HRESULT hr;
 
-	// private
+		// Shut down?
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
 
-	HRESULT Presenter::CheckShutdown() const
+		if (NULL == ppOutputSample)
+			return E_POINTER;
+
+		*ppOutputSample = NULL;
+		if (NULL != ppSecondFieldSample)
+			*ppSecondFieldSample = NULL;
+
+		// The deinterlacer holds the newest frames back as future references. Nothing comes after them at the end of the segment,
+		// so they are output one by one with the future references there are.
+		if (0 == this->_History.GetPendingCount())
+		{
+			// The frames of the next segment are not references of the ones of this segment.
+			this->_History.Clear();
+			return S_FALSE;
+		}
+
+		MFTIME hnsStart = ::MFGetSystemTime();
+
+		// The output is of the newest input, less the lag.
+		this->_OutputSourceIndex = this->_InputCount - 1;
+
+		// The textures of the pool are of the size of the newest frame.
+		const ReferenceFrameHistory::Frame* pNewest = this->_History.GetFrame(0);
+		if (FAILED(hr = this->ProcessFrameUsingD3D11(NULL, pNewest->Texture, pNewest->ViewIndex, pNewest->InterlaceMode, ppOutputSample, ppSecondFieldSample)))
+			return hr;
+
+		// Describe the output.
+		LONGLONG hnsProcessTime = ::MFGetSystemTime() - hnsStart;
+		if (NULL != *ppOutputSample)
+			this->DescribeOutput(*ppOutputSample, hnsProcessTime);
+		if (NULL != ppSecondFieldSample && NULL != *ppSecondFieldSample)
+			this->DescribeOutput(*ppSecondFieldSample, hnsProcessTime);
+
+		return S_OK;
+	}
+	HRESULT Presenter::ReleaseSample(IMFSample* pSample)
 	{
-		return this->_ShutdownComplete ? MF_E_SHUTDOWN : S_OK;
+		// Return the sample to the allocator that owns it. (Drained allocators of other sizes are destroyed later by Trim.)
+		return this->_SamplePool.ReleaseSample(pSample);
 	}
-	HRESULT Presenter::InitializeSampleAllocator()
+	FrameDescriptor* Presenter::GetFrameDescriptor(IMFSample* pSample)
 	{
-		// Do you have the device, size, and format?
-		if (NULL == this->_D3D11Device || this->_Width == 0 || this->_Height == 0)
-			return MF_E_NOT_INITIALIZED;	// Not yet available
-
-		this->_SampleAllocator->Shutdown();	// Shut it down just in case,
-		return this->_SampleAllocator->Initialize(this->_D3D11Device, this->_Width, this->_Height);	// Initialization.
+		return this->_SamplePool.GetDescriptor(pSample);
 	}
+	HRESULT Presenter::SignalSampleFence(IMFSample* pSample)
+	{
+		// Called by the consumer's thread when it is done with the presented sample; the point is marked after its work on the context.
+		DeviceContextLock lockContext(&this->_csDeviceContext, this->GetMultithread());
 
-	HRESULT Presenter::ProcessFrameUsingD3D11(ID3D11Texture2D* pTexture2D, UINT dwViewIndex, UINT32 unInterlaceMode, IMFSample** ppVideoOutFrame)
+		return this->_SamplePool.SignalFence(pSample);
+	}
+	HRESULT Presenter::BlendFrames(IMFSample* pFirst, IMFSample* pSecond, float weight, IMFSample** ppOutputSample)
 	{
+		// Creates a new output sample of the two frames: pFirst * (1 - weight) + pSecond * weight.
+		// Called by the scheduler thread for the frame rate conversion. Never waits for a free sample.
+
 		HRESULT hr = S_OK;
-		ID3D11DeviceContext* pDeviceContext = NULL;
+
+		if (NULL == pFirst || NULL == ppOutputSample)
+			return E_POINTER;
+
+		*ppOutputSample = NULL;
+
+		// Shut down?
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
 		ID3D11VideoContext* pVideoContext = NULL;
 		IMFSample* pOutputSample = NULL;
 		ID3D11Texture2D* pOutputTexture2D = NULL;
 		ID3D11VideoProcessorOutputView* pOutputView = NULL;
-		ID3D11VideoProcessorInputView* pInputView = NULL;
+		ReferenceFrameHistory::Frame frames[2] = {};
+		ID3D11VideoProcessorInputView* pInputViews[2] = { NULL, NULL };
+		UINT streamCount = (NULL != pSecond && weight > 0.0f) ? 2 : 1;
 
 		do
 		{
-			// ID3D11DeviceContext get
-			this->_D3D11Device->GetImmediateContext(&pDeviceContext);
-
-			// ID3D11VideoContext get
-			if (FAILED(hr = pDeviceContext->QueryInterface(__uuidof(ID3D11VideoContext), (void**)&pVideoContext)))
+			// Get the textures of the frames.
+			IMFSample* pSamples[2] = { pFirst, pSecond };
+			for (UINT i = 0; i < streamCount; i++)
+			{
+				frames[i].Sample = pSamples[i];
+				if (FAILED(hr = this->GetSampleTexture(pSamples[i], &frames[i].Texture, &frames[i].ViewIndex)))
+					break;
+			}
+			if (FAILED(hr))
 				break;
 
-			// Get input texture information.
-			D3D11_TEXTURE2D_DESC surfaceDesc;
-			pTexture2D->GetDesc(&surfaceDesc);
+			D3D11_TEXTURE2D_DESC desc;
+			frames[0].Texture->GetDesc(&desc);
+			if (2 == streamCount)
+			{
+				D3D11_TEXTURE2D_DESC secondDesc;
+				frames[1].Texture->GetDesc(&secondDesc);
+				if (secondDesc.Format != desc.Format)
+					streamCount = 1;	// Not blendable with a single video processor (e.g. one of them is passed through); show the first.
+			}
 
-			if (surfaceDesc.Width != this->_Width ||
-				surfaceDesc.Height != this->_Height)
+			// The size of the frames. (The texture of a passed-through frame may be larger.)
+			FrameDescriptor* pFirstDescriptor = this->_SamplePool.GetDescriptor(pFirst);
+			if (NULL == pFirstDescriptor)
 			{
-				hr = MF_E_INVALID_STREAM_DATA;	// Ignore if it is different from the size specified by the media type.
+				hr = MF_E_NOT_FOUND;
 				break;
 			}
+			UINT32 width = pFirstDescriptor->Frame.Width;
+			UINT32 height = pFirstDescriptor->Frame.Height;
 
-			// Create a video processor if you haven't already.
-			if (NULL == this->_D3D11VideoProcessorEnum || NULL == this->_D3D11VideoProcessor)
+			// The output is of the current size. Frames of a previous size are not blended.
+			SampleAllocatorPool::Entry* pEntry = this->_SamplePool.GetCurrent();
+			if (NULL == pEntry || pEntry->OutputWidth != width || pEntry->OutputHeight != height)
 			{
-				SafeRelease(this->_D3D11VideoProcessor);		// Just in case
-				SafeRelease(this->_D3D11VideoProcessorEnum);	//
-
-				// Create a VideoProcessorEnumerator.
-				D3D11_VIDEO_PROCESSOR_CONTENT_DESC ContentDesc;
-				ZeroMemory(&ContentDesc, sizeof(ContentDesc));
-				ContentDesc.InputFrameFormat = D3D11_VIDEO_FRAME_FORMAT_INTERLACED_TOP_FIELD_FIRST;
-				ContentDesc.InputWidth = surfaceDesc.Width;				// Input size and
-				ContentDesc.InputHeight = surfaceDesc.Height;			//
-				ContentDesc.OutputWidth = surfaceDesc.Width;			// output size are the same.
-				ContentDesc.OutputHeight = surfaceDesc.Height;			//
-				ContentDesc.Usage = D3D11_VIDEO_USAGE_PLAYBACK_NORMAL;	// Purpose: Playback
-				if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessorEnumerator(&ContentDesc, &this->_D3D11VideoProcessorEnum)))
-					break;
-
-				// If the VideoProcessor doesn't support DXGI_FORMAT_B8G8R8A8_UNORM output, we can't use it.
-				UINT uiFlags;
-				DXGI_FORMAT VP_Output_Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-				if (FAILED(hr = this->_D3D11VideoProcessorEnum->CheckVideoProcessorFormat(VP_Output_Format, &uiFlags)))
-					return hr;
-				if (0 == (uiFlags & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_OUTPUT))
-				{
-					hr = MF_E_UNSUPPORTED_D3D_TYPE;	// Output cannot be supported.
-					break;
-				}
+				hr = MF_E_INVALIDREQUEST;
+				break;
+			}
 
-				// Find the index of the BOB Video Processor.
+			// Get the output sample without waiting.
+			if (FAILED(hr = pEntry->Allocator->GetSample(&pOutputSample, 0)))
+				break;
 
-				DWORD indexOfBOB;
-				if (FAILED(hr = this->FindBOBVideoProcessor(&indexOfBOB)))
-					break;	// BOB not found...
+			DeviceContextLock lockContext(&this->_csDeviceContext, this->GetMultithread());
 
-				// Create the BOB Video Processor.
-				if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessor(this->_D3D11VideoProcessorEnum, indexOfBOB, &this->_D3D11VideoProcessor)))
-					break;
-			}
+			// Shut down meanwhile?
+			if (FAILED(hr = this->CheckShutdown()))
+				break;
 
-			// Get the output sample.
-			pOutputSample = NULL;
-			if (FAILED(hr = this->_SampleAllocator->GetSample(&pOutputSample)))
+			// A shared texture the consumer is reading is not written.
+			if (FAILED(hr = this->BeginWriteSamples(pEntry, &pOutputSample, 1)))
 				break;
-			if (FAILED(hr = pOutputSample->SetUINT32(SAMPLE_STATE, SAMPLE_STATE_UPDATING)))
+
+			// Create the blending video processor if you haven't already.
+			if (FAILED(hr = this->CreateBlendProcessor(desc.Format, width, height, pEntry->Format)))
 				break;
 
-			// Get the output texture.
-			IMFMediaBuffer* pBuffer = NULL;
-			IMFDXGIBuffer* pMFDXGIBuffer = NULL;
-			do
+			// The context got at SetD3D11.
+			pVideoContext = this->_D3D11VideoContext;
+			if (NULL == pVideoContext)
 			{
-				// Get the media buffer from the output sample.
-				if (FAILED(hr = pOutputSample->GetBufferByIndex(0, &pBuffer)))
-					break;
-
-				// Get the IMFDXGIBuffer from the IMFMediaBuffer.
-				if (FAILED(hr = pBuffer->QueryInterface(__uuidof(IMFDXGIBuffer), (LPVOID*)&pMFDXGIBuffer)))
-					break;
+				hr = E_NOINTERFACE;
+				break;
+			}
 
-				// Get the ID3D11Texture2D from the IMFDXGIBuffer.
-				if (FAILED(hr = pMFDXGIBuffer->GetResource(__uuidof(ID3D11Texture2D), (LPVOID*)&pOutputTexture2D)))
+			// Create the input views and the output view.
+			for (UINT i = 0; i < streamCount; i++)
+			{
+				if (FAILED(hr = this->CreateInputView(this->_BlendProcessorEnum, &frames[i], &pInputViews[i])))
 					break;
-
-			} while (FALSE);
-
-			SafeRelease(pMFDXGIBuffer);
-			SafeRelease(pBuffer);
-
+			}
 			if (FAILED(hr))
 				break;
-
-			// Create an input view from the input texture.
-			D3D11_VIDEO_PROCESSOR_INPUT_VIEW_DESC InputLeftViewDesc;
-			ZeroMemory(&InputLeftViewDesc, sizeof(InputLeftViewDesc));
-			InputLeftViewDesc.FourCC = 0;
-			InputLeftViewDesc.ViewDimension = D3D11_VPIV_DIMENSION_TEXTURE2D;
-			InputLeftViewDesc.Texture2D.MipSlice = 0;
-			InputLeftViewDesc.Texture2D.ArraySlice = dwViewIndex;
-			if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessorInputView(pTexture2D, this->_D3D11VideoProcessorEnum, &InputLeftViewDesc, &pInputView)))
+			if (FAILED(hr = this->GetSampleTexture(pOutputSample, &pOutputTexture2D)))
 				break;
-
-			// Create an output view from the output texture.
 			D3D11_VIDEO_PROCESSOR_OUTPUT_VIEW_DESC OutputViewDesc;
 			ZeroMemory(&OutputViewDesc, sizeof(OutputViewDesc));
 			OutputViewDesc.ViewDimension = D3D11_VPOV_DIMENSION_TEXTURE2D;
 			OutputViewDesc.Texture2D.MipSlice = 0;
-			OutputViewDesc.Texture2DArray.MipSlice = 0;
-			OutputViewDesc.Texture2DArray.FirstArraySlice = 0;
-			if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessorOutputView(pOutputTexture2D, this->_D3D11VideoProcessorEnum, &OutputViewDesc, &pOutputView)))
+			if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessorOutputView(pOutputTexture2D, this->_BlendProcessorEnum, &OutputViewDesc, &pOutputView)))
 				break;
 
-			// Set the parameters for the video context.
+			// Set the parameters for the video context. Both streams cover the whole output.
+			RECT rect = { 0L, 0L, (LONG)width, (LONG)height };
+			D3D11_VIDEO_PROCESSOR_COLOR_SPACE colorSpace;
+			for (UINT i = 0; i < 2; i++)
 			{
-				// Set the format for input stream 0.
-				D3D11_VIDEO_FRAME_FORMAT FrameFormat = D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE;
-				if ((MFVideoInterlace_FieldInterleavedUpperFirst == unInterlaceMode) ||
-					(MFVideoInterlace_FieldSingleUpper == unInterlaceMode) ||
-					(MFVideoInterlace_MixedInterlaceOrProgressive == unInterlaceMode))
-				{
-					FrameFormat = D3D11_VIDEO_FRAME_FORMAT_INTERLACED_TOP_FIELD_FIRST;
-				}
-				else if ((MFVideoInterlace_FieldInterleavedLowerFirst == unInterlaceMode) ||
-					(MFVideoInterlace_FieldSingleLower == unInterlaceMode))
-				{
-					FrameFormat = D3D11_VIDEO_FRAME_FORMAT_INTERLACED_BOTTOM_FIELD_FIRST;
-				}
-				pVideoContext->VideoProcessorSetStreamFrameFormat(this->_D3D11VideoProcessor, 0, FrameFormat);
+				pVideoContext->VideoProcessorSetStreamFrameFormat(this->_BlendProcessor, i, D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE);
+				pVideoContext->VideoProcessorSetStreamOutputRate(this->_BlendProcessor, i, D3D11_VIDEO_PROCESSOR_OUTPUT_RATE_NORMAL, TRUE, NULL);
+				pVideoContext->VideoProcessorSetStreamSourceRect(this->_BlendProcessor, i, TRUE, &rect);
+				pVideoContext->VideoProcessorSetStreamDestRect(this->_BlendProcessor, i, TRUE, &rect);
+				this->SetVideoColorSpace(&colorSpace, desc.Format);
+				pVideoContext->VideoProcessorSetStreamColorSpace(this->_BlendProcessor, i, &colorSpace);
+			}
+
+			// The second frame is drawn over the first, with the weight as its alpha.
+			pVideoContext->VideoProcessorSetStreamAlpha(this->_BlendProcessor, 1, TRUE, weight);
+
+			pVideoContext->VideoProcessorSetOutputTargetRect(this->_BlendProcessor, TRUE, &rect);
+			this->SetVideoColorSpace(&colorSpace, pEntry->Format);
+			pVideoContext->VideoProcessorSetOutputColorSpace(this->_BlendProcessor, &colorSpace);
+
+			// Blend.
+			D3D11_VIDEO_PROCESSOR_STREAM StreamData[2];
+			ZeroMemory(StreamData, sizeof(StreamData));
+			for (UINT i = 0; i < streamCount; i++)
+			{
+				StreamData[i].Enable = TRUE;
+				StreamData[i].pInputSurface = pInputViews[i];
+			}
+			UINT timerSlot = 0;
+			BOOL bTimed = this->BeginGpuTimer(&timerSlot);
+			hr = pVideoContext->VideoProcessorBlt(this->_BlendProcessor, pOutputView, 0, streamCount, StreamData);
+			if (bTimed)
+				this->EndGpuTimer(timerSlot);
+			if (FAILED(hr))
+				break;
+			if (FAILED(hr = pEntry->Allocator->EndWrite(pOutputSample)))
+				break;
+
+			// Describe the output as the frames.
+			FrameDescriptor* pDescriptor = pEntry->Allocator->GetDescriptor(pOutputSample);
+			if (NULL != pDescriptor)
+			{
+				FrameDescription::SetColor(pOutputSample, pDescriptor, pFirstDescriptor->Frame);
+				pDescriptor->Frame.SampleFlags = pFirstDescriptor->Frame.SampleFlags;
+				pDescriptor->Frame.SourceIndex = pFirstDescriptor->Frame.SourceIndex;
+				pDescriptor->Frame.ProcessTime = 0;
+			}
+
+			*ppOutputSample = pOutputSample;
+			pOutputSample = NULL;
 
-				// Set the output rate for input stream 0.
-				pVideoContext->VideoProcessorSetStreamOutputRate(this->_D3D11VideoProcessor, 0, D3D11_VIDEO_PROCESSOR_OUTPUT_RATE_NORMAL, TRUE, NULL);
+		} while (FALSE);
 
-				// Set the source rectangle for input stream 0. This is a rectangle within the input surface specified in pixel coordinates relative to the input surface. (There is one for each input stream.)
-				RECT sourceRect = { 0L, 0L, (LONG)surfaceDesc.Width, (LONG)surfaceDesc.Height };
-				pVideoContext->VideoProcessorSetStreamSourceRect(this->_D3D11VideoProcessor, 0, TRUE, &sourceRect);
+		// The output sample not handed out goes back to the pool.
+		if (NULL != pOutputSample)
+		{
+			this->_SamplePool.ReleaseSample(pOutputSample);
+			SafeRelease(pOutputSample);
+		}
 
-				// Set the destination rectangle for input stream 0. This is a rectangle within the output surface specified in pixel coordinates relative to the output surface. (There is one for each input stream.)
-				RECT destRect = { 0L, 0L, (LONG)surfaceDesc.Width, (LONG)surfaceDesc.Height };
-				pVideoContext->VideoProcessorSetStreamDestRect(this->_D3D11VideoProcessor, 0, TRUE, &destRect);
+		// Release resources
+		for (UINT i = 0; i < 2; i++)
+		{
+			SafeRelease(pInputViews[i]);
+			SafeRelease(frames[i].Texture);
+		}
+		SafeRelease(pOutputView);
+		SafeRelease(pOutputTexture2D);
 
-				// Set the output target rectangle. This is a rectangle within the output surface specified in pixel coordinates relative to the output surface. (There is only one.)
-				RECT targetRect = { 0L, 0L, (LONG)surfaceDesc.Width, (LONG)surfaceDesc.Height };
-				pVideoContext->VideoProcessorSetOutputTargetRect(this->_D3D11VideoProcessor, TRUE, &destRect);
+		return hr;
+	}
 
-				// Set the input color space for input stream 0.
-				D3D11_VIDEO_PROCESSOR_COLOR_SPACE colorSpace = {};
-				colorSpace.YCbCr_xvYCC = 1;
-				pVideoContext->VideoProcessorSetStreamColorSpace(this->_D3D11VideoProcessor, 0, &colorSpace);
+	void Presenter::SetScrubCacheBudget(UINT64 budgetBytes)
+	{
+		this->_ScrubCache.SetBudget(budgetBytes);
+		this->AccountScrubCache();
+	}
+	UINT64 Presenter::GetScrubCacheBudget()
+	{
+		return this->_ScrubCache.GetBudget();
+	}
+	void Presenter::ClearScrubCache()
+	{
+		this->_ScrubCache.Clear();
+		this->AccountScrubCache();
+	}
+	HRESULT Presenter::CacheFrame(IMFSample* pSample)
+	{
+		// Keeps a copy of an output frame processed while scrubbing. Called by the processing before the frame is presented.
 
-				// Set the output color space.
-				pVideoContext->VideoProcessorSetOutputColorSpace(this->_D3D11VideoProcessor, &colorSpace);
+		HRESULT hr = S_OK;
 
-				// Set the output background color to black.
-				D3D11_VIDEO_COLOR backgroundColor = {};
-				backgroundColor.RGBA.A = 1.0F;
-				backgroundColor.RGBA.R = 1.0F * static_cast<float>(GetRValue(0)) / 255.0F;
-				backgroundColor.RGBA.G = 1.0F * static_cast<float>(GetGValue(0)) / 255.0F;
-				backgroundColor.RGBA.B = 1.0F * static_cast<float>(GetBValue(0)) / 255.0F;
-				pVideoContext->VideoProcessorSetOutputBackgroundColor(this->_D3D11VideoProcessor, FALSE, &backgroundColor);
-			}
+		if (NULL == pSample)
+			return E_POINTER;
 
-			// Convert and process the input to the output.
-			D3D11_VIDEO_PROCESSOR_STREAM StreamData;
-			ZeroMemory(&StreamData, sizeof(StreamData));
-			StreamData.Enable = TRUE;
-			StreamData.OutputIndex = 0;
-			StreamData.InputFrameOrField = 0;
-			StreamData.PastFrames = 0;
-			StreamData.FutureFrames = 0;
-			StreamData.ppPastSurfaces = NULL;
-			StreamData.ppFutureSurfaces = NULL;
-			StreamData.pInputSurface = pInputView;
-			StreamData.ppPastSurfacesRight = NULL;
-			StreamData.ppFutureSurfacesRight = NULL;
-			if (FAILED(hr = pVideoContext->VideoProcessorBlt(this->_D3D11VideoProcessor, pOutputView, 0, 1, &StreamData)))
+		// Off? The textures shared with the consumer are not read behind its back.
+		if (0 == this->_ScrubCache.GetBudget() || this->_SharedTextures)
+			return S_FALSE;
+
+		// Shut down?
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		FrameDescriptor* pDescriptor = this->_SamplePool.GetDescriptor(pSample);
+		if (NULL == pDescriptor)
+			return MF_E_NOT_FOUND;
+
+		ID3D11Texture2D* pTexture2D = NULL;
+		IUnknown* pReusable = NULL;
+		ID3D11Texture2D* pCopy = NULL;
+
+		do
+		{
+			UINT viewIndex = 0;
+			if (FAILED(hr = this->GetSampleTexture(pSample, &pTexture2D, &viewIndex)))
 				break;
+			D3D11_TEXTURE2D_DESC desc;
+			pTexture2D->GetDesc(&desc);
+
+			// Make room for it. The texture of a frame of the same size that had to go is reused.
+			UINT64 bytes = GetOutputFrameBytes(desc.Format, desc.Width, desc.Height);
+			if (S_OK != (hr = this->_ScrubCache.Reserve(bytes, &pReusable)))
+				break;	// Larger than the whole budget.
+			if (NULL != pReusable && SUCCEEDED(pReusable->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&pCopy)))
+			{
+				D3D11_TEXTURE2D_DESC copyDesc;
+				pCopy->GetDesc(&copyDesc);
+				if (copyDesc.Width != desc.Width || copyDesc.Height != desc.Height || copyDesc.Format != desc.Format)
+					SafeRelease(pCopy);
+			}
 
-			// If the output sample was created successfully, return it.
-			if (NULL != ppVideoOutFrame)
+			// A texture of its own; only the slice of the frame, if the output is in a texture array (passthrough).
+			if (NULL == pCopy)
 			{
-				*ppVideoOutFrame = pOutputSample;
-				//(*ppVideoOutFrame)->AddRef();--> Do not AddRef/Release the sample owned by SampleAllocator
+				D3D11_TEXTURE2D_DESC copyDesc = desc;
+				copyDesc.MipLevels = 1;
+				copyDesc.ArraySize = 1;
+				copyDesc.Usage = D3D11_USAGE_DEFAULT;
+				copyDesc.BindFlags = 0;
+				copyDesc.CPUAccessFlags = 0;
+				copyDesc.MiscFlags = 0;
+				if (FAILED(hr = this->_D3D11Device->CreateTexture2D(&copyDesc, NULL, &pCopy)))
+					break;
+			}
+
+			{
+				DeviceContextLock lockContext(&this->_csDeviceContext, this->GetMultithread());
+
+				// Shut down meanwhile?
+				if (FAILED(hr = this->CheckShutdown()))
+					break;
+
+				this->_D3D11DeviceContext->CopySubresourceRegion(pCopy, 0, 0, 0, 0, pTexture2D, viewIndex, NULL);
 			}
 
+			hr = this->_ScrubCache.Insert(pDescriptor->Frame, bytes, pCopy);
+
 		} while (FALSE);
-		// Release resources
-		SafeRelease(pInputView);
-		SafeRelease(pOutputView);
-		SafeRelease(pOutputTexture2D);
-		//SafeRelease(pOutputSample); --> Do not AddRef/Release the sample owned by SampleAllocator
-		SafeRelease(pVideoContext);
-		SafeRelease(pDeviceContext);
+
+		SafeRelease(pCopy);
+		SafeRelease(pReusable);
+		SafeRelease(pTexture2D);
+
+		this->AccountScrubCache();
 
 		return hr;
 	}
-	HRESULT Presenter::FindBOBVideoProcessor(_Out_ DWORD* pIndex)
+	HRESULT Presenter::GetCachedFrame(LONGLONG hnsTime, IMFSample** ppOutputSample)
 	{
-		// ※ BOB does not require any reference frames, so it can be used for both progressive/interlaced video.
+		// Creates a new output sample from the frame cached at the time, by a copy instead of a video processing pass.
 
 		HRESULT hr = S_OK;
-		D3D11_VIDEO_PROCESSOR_CAPS caps = {};
 
-		*pIndex = 0;
+		if (NULL == ppOutputSample)
+			return E_POINTER;
 
-		if (FAILED(hr = this->_D3D11VideoProcessorEnum->GetVideoProcessorCaps(&caps)))
+		*ppOutputSample = NULL;
+
+		if (0 == this->_ScrubCache.GetBudget())
+			return MF_E_NOT_FOUND;
+
+		// Shut down?
+		if (FAILED(hr = this->CheckShutdown()))
 			return hr;
 
-		for (DWORD i = 0; i < caps.RateConversionCapsCount; i++)
+		TMS_FRAME_DESCRIPTOR frame;
+		IUnknown* pResource = NULL;
+		BOOL bFound = this->_ScrubCache.Find(hnsTime, &frame, &pResource);
+		if (NULL != this->_HotAttributes)
 		{
-			D3D11_VIDEO_PROCESSOR_RATE_CONVERSION_CAPS convCaps = {};
-			if (FAILED(hr = this->_D3D11VideoProcessorEnum->GetVideoProcessorRateConversionCaps(i, &convCaps)))
-				return hr;
+			this->_HotAttributes->Set(TMS_SCRUB_CACHE_HIT_COUNT, this->_ScrubCache.GetHitCount());
+			this->_HotAttributes->Set(TMS_SCRUB_CACHE_MISS_COUNT, this->_ScrubCache.GetMissCount());
+		}
+		if (!bFound)
+			return MF_E_NOT_FOUND;
+
+		ID3D11Texture2D* pCopy = NULL;
+		IMFSample* pOutputSample = NULL;
+		ID3D11Texture2D* pOutputTexture2D = NULL;
+
+		do
+		{
+			if (FAILED(hr = pResource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&pCopy)))
+				break;
+			D3D11_TEXTURE2D_DESC desc;
+			pCopy->GetDesc(&desc);
+
+			// The output is of the current size and format. A frame cached in another one is processed again instead.
+			SampleAllocatorPool::Entry* pEntry = this->_SamplePool.GetCurrent();
+			if (NULL == pEntry || pEntry->OutputWidth != desc.Width || pEntry->OutputHeight != desc.Height || pEntry->Format != desc.Format)
+			{
+				hr = MF_E_NOT_FOUND;
+				break;
+			}
+
+			// Get the output sample without waiting.
+			if (FAILED(hr = pEntry->Allocator->GetSample(&pOutputSample, 0)))
+				break;
+
+			DeviceContextLock lockContext(&this->_csDeviceContext, this->GetMultithread());
+
+			// Shut down meanwhile?
+			if (FAILED(hr = this->CheckShutdown()))
+				break;
 
-			// If deinterlacing is supported, return the corresponding index.
-			if (0 != (convCaps.ProcessorCaps & D3D11_VIDEO_PROCESSOR_PROCESSOR_CAPS_DEINTERLACE_BOB))
+			// A shared texture the consumer is reading is not written.
+			if (FAILED(hr = this->BeginWriteSamples(pEntry, &pOutputSample, 1)))
+				break;
+
+			UINT viewIndex = 0;
+			if (FAILED(hr = this->GetSampleTexture(pOutputSample, &pOutputTexture2D, &viewIndex)))
+				break;
+			this->_D3D11DeviceContext->CopySubresourceRegion(pOutputTexture2D, viewIndex, 0, 0, 0, pCopy, 0, NULL);
+			if (FAILED(hr = pEntry->Allocator->EndWrite(pOutputSample)))
+				break;
+
+			// Describe the output as the frame was.
+			pOutputSample->SetSampleTime(frame.SampleTime);
+			pOutputSample->SetSampleDuration(frame.SampleDuration);
+			FrameDescriptor* pDescriptor = pEntry->Allocator->GetDescriptor(pOutputSample);
+			if (NULL != pDescriptor)
 			{
-				*pIndex = i;
-				return S_OK;	// return
+				FrameDescription::SetColor(pOutputSample, pDescriptor, frame);
+				pDescriptor->Frame.SampleTime = frame.SampleTime;
+				pDescriptor->Frame.SampleDuration = frame.SampleDuration;
+				pDescriptor->Frame.SampleFlags = frame.SampleFlags;
+				pDescriptor->Frame.SourceIndex = frame.SourceIndex;
+				pDescriptor->Frame.ProcessTime = 0;
+			}
+
+			*ppOutputSample = pOutputSample;
+			pOutputSample = NULL;
+
+		} while (FALSE);
+
+		// The output sample not handed out goes back to the pool.
+		if (NULL != pOutputSample)
+		{
+			this->_SamplePool.ReleaseSample(pOutputSample);
+			SafeRelease(pOutputSample);
+		}
+
+		SafeRelease(pOutputTexture2D);
+		SafeRelease(pCopy);
+		SafeRelease(pResource);
+
+		return hr;
+	}
+
+	HRESULT Presenter::SetThumbnailSize(UINT32 width, UINT32 height)
+	{
+		AutoLock lock(this->_csPresenter);
+
+		HRESULT hr;
+
+		if (FAILED(hr = this->_Thumbnails.SetLayout(width, height, D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION)))
+			return hr;
+
+		// The atlas and the video processor are made again for the new size, on the next thumbnail.
+		this->ReleaseThumbnailAtlas();
+		this->ReleaseThumbnailProcessor();
+
+		return S_OK;
+	}
+	void Presenter::GetThumbnailSize(UINT32* pWidth, UINT32* pHeight)
+	{
+		this->_Thumbnails.GetThumbnailSize(pWidth, pHeight);
+	}
+	BOOL Presenter::IsThumbnailMode()
+	{
+		return this->_Thumbnails.IsEnabled();
+	}
+	HRESULT Presenter::SetThumbnailRequests(const LONGLONG* pTimes, UINT count)
+	{
+		AutoLock lock(this->_csPresenter);	// Not while a batch is being drawn or read back.
+
+		HRESULT hr;
+
+		if (FAILED(hr = this->_Thumbnails.SetRequests(pTimes, count)))
+			return hr;
+
+		this->PublishThumbnailStatistics();
+
+		return S_OK;
+	}
+	void Presenter::SetThumbnailCallback(ITMSThumbnailCallback* pCallback)
+	{
+		AutoLock lock(this->_csPresenter);	// Not while it is being called.
+
+		if (NULL != pCallback)
+			pCallback->AddRef();
+		SafeRelease(this->_ThumbnailCallback);
+		this->_ThumbnailCallback = pCallback;
+	}
+	HRESULT Presenter::ProcessThumbnail(IMFSample* pSample)
+	{
+		// Scales the frame down into the cell of every request it serves, and reads the atlas back whenever a batch is ready.
+		// Called by the processing in the thumbnail mode, instead of ProcessFrame.
+
+		HRESULT hr = S_OK;
+
+		if (NULL == pSample)
+			return E_POINTER;
+
+		AutoLock lock(this->_csPresenter);
+
+		// Shut down?
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		LONGLONG time = 0, duration = 0;
+		if (FAILED(hr = pSample->GetSampleTime(&time)))
+			return hr;
+		if (FAILED(pSample->GetSampleDuration(&duration)))
+			duration = 0;
+
+		// Not requested? Then it is dropped without any processing.
+		TMS_THUMBNAIL thumbnail;
+		if (!this->_Thumbnails.Match(time, duration, &thumbnail))
+		{
+			// The requests it passed may have been the last ones of the batch.
+			if (this->_Thumbnails.IsBatchReady())
+				hr = this->ReadBackThumbnails();
+
+			this->PublishThumbnailStatistics();
+			return FAILED(hr) ? hr : S_FALSE;
+		}
+
+		ReferenceFrameHistory::Frame frame = {};
+		frame.Sample = pSample;
+
+		do
+		{
+			if (FAILED(hr = this->GetSampleTexture(pSample, &frame.Texture, &frame.ViewIndex)))
+				break;
+
+			if (FAILED(hr = this->CreateThumbnailAtlas()))
+				break;
+
+			// A frame may serve several requests. Each one is read back with its batch.
+			BOOL bServe = TRUE;
+			while (bServe)
+			{
+				if (FAILED(hr = this->DrawThumbnail(&frame, thumbnail)))
+					break;
+
+				if (this->_Thumbnails.IsBatchReady())
+				{
+					if (FAILED(hr = this->ReadBackThumbnails()))
+						break;
+				}
+
+				bServe = this->_Thumbnails.Match(time, duration, &thumbnail);
+			}
+
+		} while (FALSE);
+
+		SafeRelease(frame.Texture);
+
+		this->PublishThumbnailStatistics();
+
+		return hr;
+	}
+	HRESULT Presenter::FlushThumbnails()
+	{
+		AutoLock lock(this->_csPresenter);
+
+		HRESULT hr;
+
+		// Shut down?
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		return this->ReadBackThumbnails();
+	}
+
+	// private
+
+	HRESULT Presenter::CheckShutdown() const
+	{
+		return this->_ShutdownComplete ? MF_E_SHUTDOWN : S_OK;
+	}
+	BOOL Presenter::BeginGpuTimer(UINT* pSlot)
+	{
+		// Called with _csDeviceContext held; the queries go on the immediate context.
+
+		if (!this->_GpuTiming)
+			return FALSE;
+
+		// The queries are created on first use.
+		if (!this->_GpuTimer.HasProvider())
+		{
+			D3D11GpuTimerQueryProvider* pProvider = new D3D11GpuTimerQueryProvider();
+			if (FAILED(pProvider->Initialize(this->_D3D11Device)))
+			{
+				delete pProvider;
+				return FALSE;
+			}
+			this->_GpuTimer.SetProvider(pProvider);
+		}
+
+		return (S_OK == this->_GpuTimer.Begin(pSlot));
+	}
+	void Presenter::EndGpuTimer(UINT slot)
+	{
+		this->_GpuTimer.End(slot);
+	}
+	void Presenter::PublishGpuTimeStatistics()
+	{
+		if (NULL == this->_HotAttributes)
+			return;
+
+		GpuTimeStatistics stats;
+		this->_GpuTimer.GetStatistics(&stats);
+
+		this->_HotAttributes->Set(TMS_GPU_TIME_COUNT, stats.Count);
+		this->_HotAttributes->Set(TMS_GPU_TIME_MEAN, (stats.Count > 0) ? (UINT64)(stats.Total / (LONGLONG)stats.Count) : 0);
+		this->_HotAttributes->Set(TMS_GPU_TIME_MAX, (UINT64)stats.Max);
+		this->_HotAttributes->Set(TMS_GPU_TIME_LOST_COUNT, stats.Lost);
+	}
+	void Presenter::AccountScrubCache()
+	{
+		// The cached textures count in the texture memory budget of the stream, like the pools.
+		AutoLock lock(this->_csPresenter);
+
+		UINT64 bytes = this->_ScrubCache.GetBytes();
+		if (NULL == this->_MemoryBudget || bytes == this->_ScrubCacheReserved)
+			return;
+
+		if (bytes > this->_ScrubCacheReserved)
+			this->_MemoryBudget->Reserve(this->_MemoryStreamId, bytes - this->_ScrubCacheReserved);
+		else
+			this->_MemoryBudget->Release(this->_MemoryStreamId, this->_ScrubCacheReserved - bytes);
+		this->_ScrubCacheReserved = bytes;
+	}
+	HRESULT Presenter::CreateThumbnailAtlas()
+	{
+		// Called with _csPresenter held. The atlas is drawn by the video processor and copied at once to its staging texture.
+
+		if (NULL != this->_ThumbnailAtlas)
+			return S_OK;
+
+		UINT32 width, height;
+		this->_Thumbnails.GetAtlasSize(&width, &height);
+		if (0 == width || 0 == height)
+			return MF_E_NOT_INITIALIZED;
+
+		HRESULT hr = S_OK;
+
+		do
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			ZeroMemory(&desc, sizeof(desc));
+			desc.Width = width;
+			desc.Height = height;
+			desc.MipLevels = 1;
+			desc.ArraySize = 1;
+			desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+			desc.SampleDesc.Count = 1;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_RENDER_TARGET;	// For the video processor output view.
+			if (FAILED(hr = this->_D3D11Device->CreateTexture2D(&desc, NULL, &this->_ThumbnailAtlas)))
+				break;
+
+			desc.Usage = D3D11_USAGE_STAGING;
+			desc.BindFlags = 0;
+			desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+			if (FAILED(hr = this->_D3D11Device->CreateTexture2D(&desc, NULL, &this->_ThumbnailStaging)))
+				break;
+
+			// Both count in the texture memory budget of the stream, like the pools.
+			this->_ThumbnailReserved = 2 * GetOutputFrameBytes(desc.Format, width, height);
+			if (NULL != this->_MemoryBudget)
+				this->_MemoryBudget->Reserve(this->_MemoryStreamId, this->_ThumbnailReserved);
+
+		} while (FALSE);
+
+		if (FAILED(hr))
+			this->ReleaseThumbnailAtlas();
+
+		return hr;
+	}
+	void Presenter::ReleaseThumbnailAtlas()
+	{
+		SafeRelease(this->_ThumbnailStaging);
+		SafeRelease(this->_ThumbnailAtlas);
+
+		if (NULL != this->_MemoryBudget && 0 < this->_ThumbnailReserved)
+			this->_MemoryBudget->Release(this->_MemoryStreamId, this->_ThumbnailReserved);
+		this->_ThumbnailReserved = 0;
+	}
+	HRESULT Presenter::DrawThumbnail(const ReferenceFrameHistory::Frame* pFrame, const TMS_THUMBNAIL& thumbnail)
+	{
+		// Called with _csPresenter held. Scales the frame down into the cell of the thumbnail, letterboxed on black.
+
+		HRESULT hr = S_OK;
+		ID3D11VideoProcessorInputView* pInputView = NULL;
+		ID3D11VideoProcessorOutputView* pOutputView = NULL;
+
+		do
+		{
+			// The frame size of the media type. (The decoder's texture may be larger.)
+			D3D11_TEXTURE2D_DESC desc;
+			pFrame->Texture->GetDesc(&desc);
+			UINT32 width = (0 < this->_Width) ? min(this->_Width, desc.Width) : desc.Width;
+			UINT32 height = (0 < this->_Height) ? min(this->_Height, desc.Height) : desc.Height;
+
+			DeviceContextLock lockContext(&this->_csDeviceContext, this->GetMultithread());
+
+			// Shut down meanwhile?
+			if (FAILED(hr = this->CheckShutdown()))
+				break;
+
+			// Create the scaling video processor if you haven't already.
+			if (FAILED(hr = this->CreateThumbnailProcessor(desc.Format, width, height)))
+				break;
+
+			// The context got at SetD3D11.
+			ID3D11VideoContext* pVideoContext = this->_D3D11VideoContext;
+			if (NULL == pVideoContext)
+			{
+				hr = E_NOINTERFACE;
+				break;
+			}
+
+			// Create the input view and the output view.
+			if (FAILED(hr = this->CreateInputView(this->_ThumbnailProcessorEnum, pFrame, &pInputView)))
+				break;
+			D3D11_VIDEO_PROCESSOR_OUTPUT_VIEW_DESC OutputViewDesc;
+			ZeroMemory(&OutputViewDesc, sizeof(OutputViewDesc));
+			OutputViewDesc.ViewDimension = D3D11_VPOV_DIMENSION_TEXTURE2D;
+			OutputViewDesc.Texture2D.MipSlice = 0;
+			if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessorOutputView(this->_ThumbnailAtlas, this->_ThumbnailProcessorEnum, &OutputViewDesc, &pOutputView)))
+				break;
+
+			// Set the parameters for the video context. Only the cell is written; the rest of the atlas is left as is.
+			RECT sourceRect = { 0L, 0L, (LONG)width, (LONG)height };
+			RECT destRect;
+			ThumbnailAtlas::FitFrame(width, height, thumbnail, &destRect);
+			RECT targetRect = { (LONG)thumbnail.X, (LONG)thumbnail.Y, (LONG)(thumbnail.X + thumbnail.Width), (LONG)(thumbnail.Y + thumbnail.Height) };
+			pVideoContext->VideoProcessorSetStreamFrameFormat(this->_ThumbnailProcessor, 0, D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE);	// No deinterlacing at this size.
+			pVideoContext->VideoProcessorSetStreamOutputRate(this->_ThumbnailProcessor, 0, D3D11_VIDEO_PROCESSOR_OUTPUT_RATE_NORMAL, TRUE, NULL);
+			pVideoContext->VideoProcessorSetStreamSourceRect(this->_ThumbnailProcessor, 0, TRUE, &sourceRect);
+			pVideoContext->VideoProcessorSetStreamDestRect(this->_ThumbnailProcessor, 0, TRUE, &destRect);
+			pVideoContext->VideoProcessorSetOutputTargetRect(this->_ThumbnailProcessor, TRUE, &targetRect);
+			D3D11_VIDEO_COLOR backgroundColor = {};
+			backgroundColor.RGBA.A = 1.0F;
+			pVideoContext->VideoProcessorSetOutputBackgroundColor(this->_ThumbnailProcessor, FALSE, &backgroundColor);
+			D3D11_VIDEO_PROCESSOR_COLOR_SPACE colorSpace;
+			this->SetVideoColorSpace(&colorSpace, desc.Format);
+			pVideoContext->VideoProcessorSetStreamColorSpace(this->_ThumbnailProcessor, 0, &colorSpace);
+			this->SetVideoColorSpace(&colorSpace, DXGI_FORMAT_B8G8R8A8_UNORM);
+			pVideoContext->VideoProcessorSetOutputColorSpace(this->_ThumbnailProcessor, &colorSpace);
+
+			// Scale.
+			D3D11_VIDEO_PROCESSOR_STREAM StreamData;
+			ZeroMemory(&StreamData, sizeof(StreamData));
+			StreamData.Enable = TRUE;
+			StreamData.pInputSurface = pInputView;
+			if (FAILED(hr = pVideoContext->VideoProcessorBlt(this->_ThumbnailProcessor, pOutputView, 0, 1, &StreamData)))
+				break;
+
+		} while (FALSE);
+
+		SafeRelease(pOutputView);
+		SafeRelease(pInputView);
+
+		return hr;
+	}
+	HRESULT Presenter::ReadBackThumbnails()
+	{
+		// Called with _csPresenter held. Hands the thumbnails of the batch to the callback, the whole atlas in one copy.
+
+		TMS_THUMBNAIL thumbnails[THUMBNAIL_ATLAS_CELLS];
+		UINT count = this->_Thumbnails.TakeBatch(thumbnails);
+		if (0 == count || NULL == this->_ThumbnailCallback)
+			return S_FALSE;	// Nothing to deliver, or no one to deliver it to.
+
+		if (NULL == this->_ThumbnailAtlas || NULL == this->_ThumbnailStaging)
+			return MF_E_NOT_INITIALIZED;
+
+		HRESULT hr;
+		D3D11_MAPPED_SUBRESOURCE mapped;
+
+		{
+			DeviceContextLock lockContext(&this->_csDeviceContext, this->GetMultithread());
+
+			// Shut down meanwhile?
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			// Map waits for the blits of the batch, once.
+			this->_D3D11DeviceContext->CopyResource(this->_ThumbnailStaging, this->_ThumbnailAtlas);
+			if (FAILED(hr = this->_D3D11DeviceContext->Map(this->_ThumbnailStaging, 0, D3D11_MAP_READ, 0, &mapped)))
+				return hr;
+		}
+
+		// The callback is called with the context unlocked, so that it may use the device. (Neither the staging texture nor
+		// the callback can go meanwhile; both need _csPresenter.)
+		this->_ThumbnailCallback->OnThumbnails(thumbnails, count, (const BYTE*)mapped.pData, mapped.RowPitch);
+
+		{
+			DeviceContextLock lockContext(&this->_csDeviceContext, this->GetMultithread());
+
+			this->_D3D11DeviceContext->Unmap(this->_ThumbnailStaging, 0);
+		}
+
+		return S_OK;
+	}
+	void Presenter::PublishThumbnailStatistics()
+	{
+		if (NULL != this->_HotAttributes)
+		{
+			this->_HotAttributes->Set(TMS_THUMBNAIL_PENDING_COUNT, this->_Thumbnails.GetPendingCount());
+			this->_HotAttributes->Set(TMS_THUMBNAIL_MISSED_COUNT, this->_Thumbnails.GetMissedCount());
+		}
+	}
+	HRESULT Presenter::BeginWriteSamples(SampleAllocatorPool::Entry* pEntry, IMFSample** ppSamples, UINT count)
+	{
+		// Called with _csDeviceContext held. With shared textures, the consumer may be reading a sample;
+		// take another one instead of waiting for it. Not shared: nothing to do.
+
+		HRESULT hr = S_OK;
+		IMFSample* pBusySamples[SAMPLE_MAX] = {};
+		UINT busyCount = 0;
+
+		for (UINT i = 0; i < count && SUCCEEDED(hr); i++)
+		{
+			while (S_FALSE == (hr = pEntry->Allocator->BeginWrite(ppSamples[i])))
+			{
+				this->_SharedBusyCount++;
+				if (NULL != this->_HotAttributes)
+					this->_HotAttributes->Set(TMS_SHARED_BUSY_COUNT, this->_SharedBusyCount);
+
+				// Keep it lent out, so that it is not given again, until another one is found.
+				pBusySamples[busyCount++] = ppSamples[i];
+				ppSamples[i] = NULL;
+
+				if (FAILED(hr = pEntry->Allocator->GetSample(&ppSamples[i], 0)))
+					break;	// All of them are busy.
+			}
+		}
+
+		// The busy ones go back to the pool.
+		for (UINT i = 0; i < busyCount; i++)
+		{
+			this->_SamplePool.ReleaseSample(pBusySamples[i]);
+			SafeRelease(pBusySamples[i]);
+		}
+
+		return hr;
+	}
+	ID3D10Multithread* Presenter::GetMultithread()
+	{
+		return this->_MultithreadProtection ? this->_Multithread : NULL;
+	}
+	HRESULT Presenter::GetOutputView(SampleAllocatorPool::Entry* pEntry, ID3D11Texture2D* pTexture, ID3D11VideoProcessorOutputView** ppOutputView)
+	{
+		HRESULT hr;
+
+		// The output textures of an entry never change, so their views are created once.
+		int freeIndex = -1;
+		for (int i = 0; i < SAMPLE_MAX; i++)
+		{
+			if (NULL == pEntry->OutputViews[i])
+			{
+				if (freeIndex < 0)
+					freeIndex = i;
+				continue;
+			}
+			if (pEntry->ViewTextures[i] == pTexture)
+			{
+				*ppOutputView = pEntry->OutputViews[i];
+				(*ppOutputView)->AddRef();
+				return S_OK;
+			}
+		}
+
+		D3D11_VIDEO_PROCESSOR_OUTPUT_VIEW_DESC OutputViewDesc;
+		ZeroMemory(&OutputViewDesc, sizeof(OutputViewDesc));
+		OutputViewDesc.ViewDimension = D3D11_VPOV_DIMENSION_TEXTURE2D;
+		OutputViewDesc.Texture2D.MipSlice = 0;
+		OutputViewDesc.Texture2DArray.MipSlice = 0;
+		OutputViewDesc.Texture2DArray.FirstArraySlice = 0;
+		if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessorOutputView(pTexture, pEntry->ProcessorEnum, &OutputViewDesc, ppOutputView)))
+			return hr;
+
+		// Keep it if there is room. (The view holds the texture, so the pointer stays valid while it is cached.)
+		if (freeIndex >= 0)
+		{
+			pEntry->ViewTextures[freeIndex] = pTexture;
+			pEntry->OutputViews[freeIndex] = *ppOutputView;
+			pEntry->OutputViews[freeIndex]->AddRef();
+		}
+
+		return S_OK;
+	}
+	HRESULT Presenter::InitializeSampleAllocator()
+	{
+		HRESULT hr;
+
+		// Without a media type, the size of the hint (if any) is used instead.
+		UINT32 width = this->_Width;
+		UINT32 height = this->_Height;
+		if (width == 0 || height == 0)
+		{
+			width = this->_HintWidth;
+			height = this->_HintHeight;
+		}
+
+		// Do you have the device, size, and format?
+		if (NULL == this->_D3D11Device || width == 0 || height == 0)
+			return MF_E_NOT_INITIALIZED;	// Not yet available
+
+		// The warm-up in progress works on the current entry, which may be left to Trim once another one is current.
+		this->WaitForWarmUp();
+
+		// Make the pool of the current size current. The pools of the previous sizes are kept within the cache budget.
+		if (FAILED(hr = this->_SamplePool.Activate(this->_D3D11Device, width, height, this->_OutputFormat)))
+			return hr;
+
+		// The textures are being built in the background; build the video processor in the background too.
+		return this->StartWarmUp();
+	}
+	HRESULT Presenter::StartWarmUp()
+	{
+		SampleAllocatorPool::Entry* pEntry = this->_SamplePool.GetCurrent();
+		if (NULL == pEntry || NULL == this->_D3D11VideoDevice)
+			return S_FALSE;
+
+		// A recently used size is already warm; the work finds it has nothing to do.
+		return this->_WarmUp.Start(this, pEntry);
+	}
+	void Presenter::WaitForWarmUp()
+	{
+		this->_WarmUp.Wait();
+	}
+	HRESULT Presenter::WarmUp(void* pItem)
+	{
+		SampleAllocatorPool::Entry* pEntry = (SampleAllocatorPool::Entry*)pItem;
+
+		if (NULL != pEntry->Processor)
+			return S_OK;
+
+		return this->CreateVideoProcessor(pEntry);
+	}
+
+	void Presenter::DescribeOutput(IMFSample* pOutputSample, LONGLONG hnsProcessTime)
+	{
+		// The plane layout (TMS_SAMPLE_FORMAT, TMS_SAMPLE_PLANE_COUNT, MF_MT_FRAME_SIZE) is set by the allocator when the sample is created.
+		FrameDescriptor* pDescriptor = this->_SamplePool.GetDescriptor(pOutputSample);
+		if (NULL == pDescriptor)
+			return;
+
+		TMS_FRAME_DESCRIPTOR color;
+		this->GetOutputColor(&color);
+		FrameDescription::SetColor(pOutputSample, pDescriptor, color);
+		FrameDescription::SetTimes(pOutputSample, pDescriptor, this->_OutputSourceIndex, hnsProcessTime);
+	}
+	void Presenter::GetOutputColor(TMS_FRAME_DESCRIPTOR* pColor)
+	{
+		ZeroMemory(pColor, sizeof(TMS_FRAME_DESCRIPTOR));
+
+		if (IsPlanarFormat(this->_OutputFormat))
+		{
+			// The YUV values are those of the input.
+			pColor->YuvMatrix = this->_YuvMatrix;
+			pColor->NominalRange = MFNominalRange_16_235;
+			pColor->ChromaSiting = this->_ChromaSiting;
+		}
+		else
+		{
+			pColor->NominalRange = MFNominalRange_0_255;
+		}
+
+		// The primaries and the transfer function are not changed by the video processor.
+		pColor->Primaries = this->_Primaries;
+		pColor->TransferFunction = this->_TransferFunction;
+	}
+	HRESULT Presenter::ProcessFramePassthrough(IMFSample* pSample, IMFMediaBuffer* pBuffer, ID3D11Texture2D* pTexture2D, UINT dwViewIndex, UINT32 unInterlaceMode, IMFSample** ppVideoOutFrame)
+	{
+		// Returns S_FALSE if the frame has to be processed.
+
+		if (!this->_Passthrough || this->_InterlacedContent || this->_SharedTextures)
+			return S_FALSE;	// Interlaced content goes through the reference frame history, even for its progressive frames.
+
+		HRESULT hr = S_OK;
+
+		// Get input texture information.
+		D3D11_TEXTURE2D_DESC surfaceDesc;
+		pTexture2D->GetDesc(&surfaceDesc);
+
+		// Destroy the pools of previous sizes that are over the budget and have been drained.
+		this->_SamplePool.Trim();
+
+		// The output sample still comes from the pool of this size, so that the number of frames in flight stays bounded.
+		SampleAllocatorPool::Entry* pEntry = NULL;
+		if (FAILED(hr = this->_SamplePool.Acquire(this->_D3D11Device, surfaceDesc.Width, surfaceDesc.Height, this->_OutputFormat, &pEntry)))
+			return hr;
+
+		PassthroughQuery query;
+		query.Enabled = this->_Passthrough;
+		query.InputFormat = surfaceDesc.Format;
+		query.InputWidth = surfaceDesc.Width;
+		query.InputHeight = surfaceDesc.Height;
+		query.InputArraySize = surfaceDesc.ArraySize;
+		query.InputViewIndex = dwViewIndex;
+		query.InputBindFlags = surfaceDesc.BindFlags;
+		query.InterlaceMode = unInterlaceMode;
+		query.OutputFormat = pEntry->Format;
+		query.OutputWidth = pEntry->OutputWidth;
+		query.OutputHeight = pEntry->OutputHeight;
+		if (Passthrough_Yes != DecidePassthrough(query))
+			return S_FALSE;
+
+		// Get the output sample. (If the allocator is still being built, this waits for it.)
+		IMFSample* pOutputSample = NULL;
+		if (FAILED(hr = pEntry->Allocator->GetSample(&pOutputSample)))
+			return hr;
+
+		// Swap in the decoder's buffer. It is swapped back when the sample is released.
+		if (FAILED(hr = pEntry->Allocator->AttachPassthrough(pOutputSample, pSample, pBuffer)))
+		{
+			pEntry->Allocator->ReleaseSample(pOutputSample);
+			return hr;
+		}
+
+		*ppVideoOutFrame = pOutputSample;
+		//(*ppVideoOutFrame)->AddRef();--> Do not AddRef/Release the sample owned by SampleAllocator
+
+		return S_OK;
+	}
+	HRESULT Presenter::ProcessFrameUsingD3D11(IMFSample* pSample, ID3D11Texture2D* pTexture2D, UINT dwViewIndex, UINT32 unInterlaceMode, IMFSample** ppVideoOutFrame, IMFSample** ppSecondFieldFrame)
+	{
+		HRESULT hr = S_OK;
+		ID3D11DeviceContext* pDeviceContext = NULL;
+		ID3D11VideoContext* pVideoContext = NULL;
+		IMFSample* pOutputSamples[2] = { NULL, NULL };
+		ID3D11Texture2D* pOutputTexture2D = NULL;
+		ID3D11VideoProcessorOutputView* pOutputView = NULL;
+		ID3D11VideoProcessorInputView* pInputView = NULL;
+		ID3D11VideoProcessorInputView* pPastViews[MAX_PAST_FRAMES] = {};
+		ID3D11VideoProcessorInputView* pFutureViews[MAX_FUTURE_FRAMES] = {};
+		UINT pastCount = 0;
+		UINT futureCount = 0;
+		UINT outputCount = 0;
+		LONGLONG hnsSetup = 0;
+
+		do
+		{
+			// The contexts are got once at SetD3D11.
+			pDeviceContext = this->_D3D11DeviceContext;
+			pVideoContext = this->_D3D11VideoContext;
+			if (NULL == pVideoContext)
+			{
+				hr = E_NOINTERFACE;
+				break;
+			}
+
+			// Get input texture information.
+			D3D11_TEXTURE2D_DESC surfaceDesc;
+			pTexture2D->GetDesc(&surfaceDesc);
+
+			// Destroy the pools of previous sizes that are over the budget and have been drained.
+			this->_SamplePool.Trim();
+
+			// Get the pool for the size of the input surface. (It differs from the media type while the resolution is switching.)
+			SampleAllocatorPool::Entry* pEntry = NULL;
+			if (FAILED(hr = this->_SamplePool.Acquire(this->_D3D11Device, surfaceDesc.Width, surfaceDesc.Height, this->_OutputFormat, &pEntry)))
+				break;
+
+			// The first frame of the media type waits for the textures here, if they are not built yet.
+			if (this->_FirstFramePending)
+			{
+				MFTIME hnsWait = ::MFGetSystemTime();
+				pEntry->Allocator->WaitForInitialized();
+				hnsSetup += ::MFGetSystemTime() - hnsWait;
+			}
+
+			// Decide which frame to process.
+			// (Without an input sample, the frames left in the history are drained.)
+			ReferenceFrameHistory::Frame current = { pSample, pTexture2D, dwViewIndex, unInterlaceMode };
+			const ReferenceFrameHistory::Frame* pTarget = &current;
+			UINT lag = 0;
+			BOOL bHistory = (this->_InterlacedContent || NULL == pSample);
+			if (bHistory)
+			{
+				// The deinterlacer decides how many reference frames are needed.
+				if (FAILED(hr = this->_WarmUp.Ensure(this, pEntry, &hnsSetup)))
+					break;
+
+				if (NULL != pSample)
+				{
+					// Interlaced content goes through the history, so that the deinterlacer can see the neighbouring frames.
+					if (FAILED(hr = this->_History.Push(pSample, pTexture2D, dwViewIndex, unInterlaceMode)))
+						break;
+
+					// With future reference frames, the output lags behind the input by that many frames.
+					lag = pEntry->FutureFrames;
+				}
+				else
+				{
+					// Draining: the oldest frame not output yet, with the frames after it as its only future references.
+					lag = min(this->_History.GetPendingCount() - 1, pEntry->FutureFrames);
+				}
+				pTarget = this->_History.TakeTarget(lag);
+				if (NULL == pTarget)
+					break;	// Not enough frames yet; no output this time.
+				this->_OutputSourceIndex -= lag;
+			}
+
+			// If the frame is already in the output format and size and needs no deinterlacing, a copy is enough.
+			BOOL bCopy =
+				(surfaceDesc.Format == pEntry->Format) &&
+				(surfaceDesc.Width == pEntry->OutputWidth) &&
+				(surfaceDesc.Height == pEntry->OutputHeight) &&
+				(MFVideoInterlace_Progressive == pTarget->InterlaceMode);
+
+			// Create a video processor for this size if neither the warm-up nor a previous frame has.
+			if (!bCopy)
+			{
+				if (FAILED(hr = this->_WarmUp.Ensure(this, pEntry, &hnsSetup)))
+					break;
+			}
+			ID3D11VideoProcessorEnumerator* pVideoProcessorEnum = pEntry->ProcessorEnum;
+			ID3D11VideoProcessor* pVideoProcessor = pEntry->Processor;
+
+			// An interlaced frame is output at field rate (one frame per field), if the caller can take the second one.
+			outputCount = (!bCopy && MFVideoInterlace_Progressive != pTarget->InterlaceMode && NULL != ppSecondFieldFrame) ? 2 : 1;
+
+			// Get the output samples. (If the allocator is still being built, this waits for it.)
+			for (UINT i = 0; i < outputCount; i++)
+			{
+				if (FAILED(hr = pEntry->Allocator->GetSample(&pOutputSamples[i])))
+					break;
+			}
+			if (FAILED(hr))
+				break;
+
+			// The scheduler thread may be blending on the immediate context. (Not held while waiting for the samples above.)
+			// All the work of this frame, including both fields, goes to the context as one batch.
+			DeviceContextLock lockContext(&this->_csDeviceContext, this->GetMultithread());
+
+			// A shared texture the consumer is reading is not written.
+			if (FAILED(hr = this->BeginWriteSamples(pEntry, pOutputSamples, outputCount)))
+				break;
+
+			// Copy without the video processor.
+			if (bCopy)
+			{
+				if (FAILED(hr = this->GetSampleTexture(pOutputSamples[0], &pOutputTexture2D)))
+					break;
+
+				UINT timerSlot = 0;
+				BOOL bTimed = this->BeginGpuTimer(&timerSlot);
+				pDeviceContext->CopySubresourceRegion(pOutputTexture2D, 0, 0, 0, 0, pTarget->Texture, pTarget->ViewIndex, NULL);
+				if (bTimed)
+					this->EndGpuTimer(timerSlot);
+				SafeRelease(pOutputTexture2D);
+			}
+			else
+			{
+				// Create the input views of the frame and of its reference frames.
+				if (FAILED(hr = this->CreateInputView(pVideoProcessorEnum, pTarget, &pInputView)))
+					break;
+				if (bHistory)
+				{
+					for (UINT i = 0; i < pEntry->PastFrames; i++)
+					{
+						const ReferenceFrameHistory::Frame* pPast = this->_History.GetFrame(lag + 1 + i);
+						if (NULL == pPast)
+							break;	// Use as many as we have.
+						if (FAILED(hr = this->CreateInputView(pVideoProcessorEnum, pPast, &pPastViews[pastCount])))
+							break;
+						pastCount++;
+					}
+					for (UINT i = 0; i < lag && SUCCEEDED(hr); i++)
+					{
+						// pFutureViews[0] is the frame right after the target.
+						if (FAILED(hr = this->CreateInputView(pVideoProcessorEnum, this->_History.GetFrame(lag - 1 - i), &pFutureViews[futureCount])))
+							break;
+						futureCount++;
+					}
+					if (FAILED(hr))
+						break;
+				}
+
+				// Set the parameters for the video context. The state belongs to the video processor, so it is set only when it changes.
+				{
+					// Set the format for input stream 0.
+					D3D11_VIDEO_FRAME_FORMAT FrameFormat = D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE;
+					if ((MFVideoInterlace_FieldInterleavedUpperFirst == pTarget->InterlaceMode) ||
+						(MFVideoInterlace_FieldSingleUpper == pTarget->InterlaceMode) ||
+						(MFVideoInterlace_MixedInterlaceOrProgressive == pTarget->InterlaceMode))
+					{
+						FrameFormat = D3D11_VIDEO_FRAME_FORMAT_INTERLACED_TOP_FIELD_FIRST;
+					}
+					else if ((MFVideoInterlace_FieldInterleavedLowerFirst == pTarget->InterlaceMode) ||
+						(MFVideoInterlace_FieldSingleLower == pTarget->InterlaceMode))
+					{
+						FrameFormat = D3D11_VIDEO_FRAME_FORMAT_INTERLACED_BOTTOM_FIELD_FIRST;
+					}
+					DWORD groups = pEntry->StreamState.Update(FrameFormat, this->_YuvMatrix);
+					if (groups & VP_STATE_FRAME_FORMAT)
+						pVideoContext->VideoProcessorSetStreamFrameFormat(pVideoProcessor, 0, FrameFormat);
+
+					// The rectangles and the background depend on the entry only.
+					if (groups & VP_STATE_GEOMETRY)
+					{
+						// Set the output rate for input stream 0. (Normal: one output frame per field of interlaced input.)
+						pVideoContext->VideoProcessorSetStreamOutputRate(pVideoProcessor, 0, D3D11_VIDEO_PROCESSOR_OUTPUT_RATE_NORMAL, TRUE, NULL);
+
+						// Set the source rectangle for input stream 0. This is a rectangle within the input surface specified in pixel coordinates relative to the input surface. (There is one for each input stream.)
+						RECT sourceRect = { 0L, 0L, (LONG)surfaceDesc.Width, (LONG)surfaceDesc.Height };
+						pVideoContext->VideoProcessorSetStreamSourceRect(pVideoProcessor, 0, TRUE, &sourceRect);
+
+						// Set the destination rectangle for input stream 0. This is a rectangle within the output surface specified in pixel coordinates relative to the output surface. (There is one for each input stream.)
+						RECT destRect = { 0L, 0L, (LONG)pEntry->OutputWidth, (LONG)pEntry->OutputHeight };
+						pVideoContext->VideoProcessorSetStreamDestRect(pVideoProcessor, 0, TRUE, &destRect);
+
+						// Set the output target rectangle. This is a rectangle within the output surface specified in pixel coordinates relative to the output surface. (There is only one.)
+						RECT targetRect = { 0L, 0L, (LONG)pEntry->OutputWidth, (LONG)pEntry->OutputHeight };
+						pVideoContext->VideoProcessorSetOutputTargetRect(pVideoProcessor, TRUE, &destRect);
+
+						// Set the output background color to black.
+						D3D11_VIDEO_COLOR backgroundColor = {};
+						backgroundColor.RGBA.A = 1.0F;
+						backgroundColor.RGBA.R = 1.0F * static_cast<float>(GetRValue(0)) / 255.0F;
+						backgroundColor.RGBA.G = 1.0F * static_cast<float>(GetGValue(0)) / 255.0F;
+						backgroundColor.RGBA.B = 1.0F * static_cast<float>(GetBValue(0)) / 255.0F;
+						pVideoContext->VideoProcessorSetOutputBackgroundColor(pVideoProcessor, FALSE, &backgroundColor);
+					}
+
+					// The color spaces follow the YUV matrix of the media type.
+					if (groups & VP_STATE_COLOR_SPACE)
+					{
+						// Set the input color space for input stream 0.
+						D3D11_VIDEO_PROCESSOR_COLOR_SPACE colorSpace = {};
+						colorSpace.YCbCr_xvYCC = 1;
+						colorSpace.YCbCr_Matrix = (MFVideoTransferMatrix_BT709 == this->_YuvMatrix) ? 1 : 0;	// 0:BT.601, 1:BT.709
+						pVideoContext->VideoProcessorSetStreamColorSpace(pVideoProcessor, 0, &colorSpace);
+
+						// Set the output color space. YUV output keeps the matrix of the input, in studio range.
+						if (IsPlanarFormat(pEntry->Format))
+							colorSpace.Nominal_Range = D3D11_VIDEO_PROCESSOR_NOMINAL_RANGE_16_235;
+						pVideoContext->VideoProcessorSetOutputColorSpace(pVideoProcessor, &colorSpace);
+					}
+				}
+
+				// Convert and process the input to the output; once per output frame (field).
+				for (UINT field = 0; field < outputCount; field++)
+				{
+					// Get the output texture.
+					if (FAILED(hr = this->GetSampleTexture(pOutputSamples[field], &pOutputTexture2D)))
+						break;
+
+					// Get the output view of the output texture.
+					if (FAILED(hr = this->GetOutputView(pEntry, pOutputTexture2D, &pOutputView)))
+						break;
+
+					D3D11_VIDEO_PROCESSOR_STREAM StreamData;
+					ZeroMemory(&StreamData, sizeof(StreamData));
+					StreamData.Enable = TRUE;
+					StreamData.OutputIndex = field;
+					StreamData.InputFrameOrField = this->_FrameNumber;
+					StreamData.PastFrames = pastCount;
+					StreamData.FutureFrames = futureCount;
+					StreamData.ppPastSurfaces = (pastCount > 0) ? pPastViews : NULL;
+					StreamData.ppFutureSurfaces = (futureCount > 0) ? pFutureViews : NULL;
+					StreamData.pInputSurface = pInputView;
+					StreamData.ppPastSurfacesRight = NULL;
+					StreamData.ppFutureSurfacesRight = NULL;
+					UINT timerSlot = 0;
+					BOOL bTimed = this->BeginGpuTimer(&timerSlot);
+					hr = pVideoContext->VideoProcessorBlt(pVideoProcessor, pOutputView, field, 1, &StreamData);
+					if (bTimed)
+						this->EndGpuTimer(timerSlot);
+
+					SafeRelease(pOutputView);
+					SafeRelease(pOutputTexture2D);
+
+					if (FAILED(hr))
+						break;
+				}
+				if (FAILED(hr))
+					break;
+
+				this->_FrameNumber++;
+			}
+
+			// Hand the shared textures to the consumer.
+			for (UINT i = 0; i < outputCount && SUCCEEDED(hr); i++)
+				hr = pEntry->Allocator->EndWrite(pOutputSamples[i]);
+			if (FAILED(hr))
+				break;
+
+			// Read the GPU times of the earlier blits that have finished by now.
+			if (this->_GpuTiming)
+			{
+				this->_GpuTimer.Resolve();
+				this->PublishGpuTimeStatistics();
+			}
+
+			// Learn which of the samples the consumer released the GPU is done with, for the next GetSample.
+			this->_SamplePool.PollFences();
+
+			// The first frame of the media type is out: how long did it wait for the objects of the warm-up?
+			if (this->_FirstFramePending && outputCount > 0)
+			{
+				this->_FirstFramePending = FALSE;
+				if (NULL != this->_HotAttributes)
+					this->_HotAttributes->Set(TMS_FIRST_FRAME_SETUP_TIME, (UINT64)hnsSetup);
+			}
+
+			// Copy the time information of the processed frame. Each field gets its share of the frame's duration.
+			for (UINT i = 0; i < outputCount; i++)
+				this->CopySampleTimes(pTarget->Sample, pOutputSamples[i], i, outputCount);
+
+			// If the output samples were created successfully, return them.
+			if (NULL != ppVideoOutFrame)
+			{
+				*ppVideoOutFrame = pOutputSamples[0];
+				pOutputSamples[0] = NULL;
+				//(*ppVideoOutFrame)->AddRef();--> Do not AddRef/Release the sample owned by SampleAllocator
+			}
+			if (NULL != ppSecondFieldFrame && outputCount == 2)
+			{
+				*ppSecondFieldFrame = pOutputSamples[1];
+				pOutputSamples[1] = NULL;
+			}
+
+		} while (FALSE);
+
+		// Output samples not handed out go back to the pool.
+		for (UINT i = 0; i < 2; i++)
+		{
+			if (NULL != pOutputSamples[i])
+			{
+				this->_SamplePool.ReleaseSample(pOutputSamples[i]);
+				SafeRelease(pOutputSamples[i]);
+			}
+		}
+
+		// Release resources
+		for (UINT i = 0; i < MAX_PAST_FRAMES; i++)
+			SafeRelease(pPastViews[i]);
+		for (UINT i = 0; i < MAX_FUTURE_FRAMES; i++)
+			SafeRelease(pFutureViews[i]);
+		SafeRelease(pInputView);
+		SafeRelease(pOutputView);
+		SafeRelease(pOutputTexture2D);
+
+		return hr;
+	}
+	HRESULT Presenter::GetSampleTexture(IMFSample* pSample, ID3D11Texture2D** ppTexture, UINT* pViewIndex)
+	{
+		HRESULT hr = S_OK;
+		IMFMediaBuffer* pBuffer = NULL;
+		IMFDXGIBuffer* pMFDXGIBuffer = NULL;
+
+		do
+		{
+			// Get the media buffer from the output sample.
+			if (FAILED(hr = pSample->GetBufferByIndex(0, &pBuffer)))
+				break;
+
+			// Get the IMFDXGIBuffer from the IMFMediaBuffer.
+			if (FAILED(hr = pBuffer->QueryInterface(__uuidof(IMFDXGIBuffer), (LPVOID*)&pMFDXGIBuffer)))
+				break;
+
+			// Get the ID3D11Texture2D from the IMFDXGIBuffer.
+			if (FAILED(hr = pMFDXGIBuffer->GetResource(__uuidof(ID3D11Texture2D), (LPVOID*)ppTexture)))
+				break;
+
+			// Get the index of the texture in the array, if needed.
+			if (NULL != pViewIndex)
+			{
+				if (FAILED(hr = pMFDXGIBuffer->GetSubresourceIndex(pViewIndex)))
+				{
+					SafeRelease(*ppTexture);
+					break;
+				}
+			}
+
+		} while (FALSE);
+
+		SafeRelease(pMFDXGIBuffer);
+		SafeRelease(pBuffer);
+
+		return hr;
+	}
+	HRESULT Presenter::CreateInputView(ID3D11VideoProcessorEnumerator* pVideoProcessorEnum, const ReferenceFrameHistory::Frame* pFrame, ID3D11VideoProcessorInputView** ppInputView)
+	{
+		// Create an input view from the input texture.
+		D3D11_VIDEO_PROCESSOR_INPUT_VIEW_DESC InputLeftViewDesc;
+		ZeroMemory(&InputLeftViewDesc, sizeof(InputLeftViewDesc));
+		InputLeftViewDesc.FourCC = 0;
+		InputLeftViewDesc.ViewDimension = D3D11_VPIV_DIMENSION_TEXTURE2D;
+		InputLeftViewDesc.Texture2D.MipSlice = 0;
+		InputLeftViewDesc.Texture2D.ArraySlice = pFrame->ViewIndex;
+
+		return this->_D3D11VideoDevice->CreateVideoProcessorInputView(pFrame->Texture, pVideoProcessorEnum, &InputLeftViewDesc, ppInputView);
+	}
+	void Presenter::CopySampleTimes(IMFSample* pFrom, IMFSample* pTo, UINT index, UINT count)
+	{
+		// The output covers the index-th of count equal parts of the input's duration.
+		LONGLONG time = 0, duration = 0;
+		BOOL hasDuration = SUCCEEDED(pFrom->GetSampleDuration(&duration));
+
+		if (SUCCEEDED(pFrom->GetSampleTime(&time)))
+		{
+			pTo->SetSampleTime(time + (hasDuration ? (duration * index / count) : 0));
+			//TCHAR buf[1024];
+			//wsprintf(buf, L"Presenter::ProcessFrame; Display time %d ms (%x)\n", (llv / 10000), *ppOutputSample);
+			//OutputDebugString(buf);
+		}
+		if (hasDuration)
+		{
+			pTo->SetSampleDuration(duration / count);
+		}
+		DWORD flags;
+		if (SUCCEEDED(pFrom->GetSampleFlags(&flags)))
+			pTo->SetSampleFlags(flags);
+	}
+	void Presenter::SetVideoColorSpace(D3D11_VIDEO_PROCESSOR_COLOR_SPACE* pColorSpace, DXGI_FORMAT format)
+	{
+		// The color space of a texture in one of the output formats. (YUV: the matrix of the input, in studio range. RGB: full range.)
+		ZeroMemory(pColorSpace, sizeof(D3D11_VIDEO_PROCESSOR_COLOR_SPACE));
+		pColorSpace->YCbCr_Matrix = (MFVideoTransferMatrix_BT709 == this->_YuvMatrix) ? 1 : 0;	// 0:BT.601, 1:BT.709
+		if (IsPlanarFormat(format))
+			pColorSpace->Nominal_Range = D3D11_VIDEO_PROCESSOR_NOMINAL_RANGE_16_235;
+		else
+			pColorSpace->RGB_Range = 0;	// 0-255
+	}
+	HRESULT Presenter::CreateBlendProcessor(DXGI_FORMAT inputFormat, UINT32 width, UINT32 height, DXGI_FORMAT outputFormat)
+	{
+		// Already have one for these?
+		if (NULL != this->_BlendProcessor &&
+			this->_BlendInputFormat == inputFormat && this->_BlendOutputFormat == outputFormat &&
+			this->_BlendWidth == width && this->_BlendHeight == height)
+			return S_OK;
+
+		this->ReleaseBlendProcessor();
+
+		HRESULT hr = S_OK;
+		ID3D11VideoProcessorEnumerator* pVideoProcessorEnum = NULL;
+		ID3D11VideoProcessor* pVideoProcessor = NULL;
+
+		do
+		{
+			// Create a VideoProcessorEnumerator. Progressive frames, no scaling.
+			D3D11_VIDEO_PROCESSOR_CONTENT_DESC ContentDesc;
+			ZeroMemory(&ContentDesc, sizeof(ContentDesc));
+			ContentDesc.InputFrameFormat = D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE;
+			ContentDesc.InputWidth = width;
+			ContentDesc.InputHeight = height;
+			ContentDesc.OutputWidth = width;
+			ContentDesc.OutputHeight = height;
+			ContentDesc.Usage = D3D11_VIDEO_USAGE_PLAYBACK_NORMAL;
+			if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessorEnumerator(&ContentDesc, &pVideoProcessorEnum)))
+				break;
+
+			// The formats must be supported, and the processor must take two streams with alpha.
+			UINT uiFlags;
+			if (FAILED(hr = pVideoProcessorEnum->CheckVideoProcessorFormat(inputFormat, &uiFlags)) || 0 == (uiFlags & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_INPUT))
+			{
+				hr = MF_E_UNSUPPORTED_D3D_TYPE;
+				break;
+			}
+			if (FAILED(hr = pVideoProcessorEnum->CheckVideoProcessorFormat(outputFormat, &uiFlags)) || 0 == (uiFlags & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_OUTPUT))
+			{
+				hr = MF_E_UNSUPPORTED_D3D_TYPE;
+				break;
+			}
+			D3D11_VIDEO_PROCESSOR_CAPS caps = {};
+			if (FAILED(hr = pVideoProcessorEnum->GetVideoProcessorCaps(&caps)))
+				break;
+			if (caps.MaxInputStreams < 2 || 0 == (caps.FeatureCaps & D3D11_VIDEO_PROCESSOR_FEATURE_CAPS_ALPHA_STREAM))
+			{
+				hr = MF_E_UNSUPPORTED_D3D_TYPE;	// Cannot blend.
+				break;
+			}
+
+			// Create the Video Processor. ※ No deinterlacing or rate conversion is needed, so any of them will do.
+			if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessor(pVideoProcessorEnum, 0, &pVideoProcessor)))
+				break;
+
+			this->_BlendProcessorEnum = pVideoProcessorEnum;
+			this->_BlendProcessorEnum->AddRef();
+			this->_BlendProcessor = pVideoProcessor;
+			this->_BlendProcessor->AddRef();
+			this->_BlendInputFormat = inputFormat;
+			this->_BlendOutputFormat = outputFormat;
+			this->_BlendWidth = width;
+			this->_BlendHeight = height;
+
+		} while (FALSE);
+
+		SafeRelease(pVideoProcessor);
+		SafeRelease(pVideoProcessorEnum);
+
+		return hr;
+	}
+	void Presenter::ReleaseBlendProcessor()
+	{
+		SafeRelease(this->_BlendProcessor);
+		SafeRelease(this->_BlendProcessorEnum);
+		this->_BlendWidth = 0;
+		this->_BlendHeight = 0;
+	}
+	HRESULT Presenter::CreateThumbnailProcessor(DXGI_FORMAT inputFormat, UINT32 width, UINT32 height)
+	{
+		// Already have one for these?
+		if (NULL != this->_ThumbnailProcessor &&
+			this->_ThumbnailInputFormat == inputFormat && this->_ThumbnailInputWidth == width && this->_ThumbnailInputHeight == height)
+			return S_OK;
+
+		this->ReleaseThumbnailProcessor();
+
+		UINT32 thumbnailWidth, thumbnailHeight;
+		this->_Thumbnails.GetThumbnailSize(&thumbnailWidth, &thumbnailHeight);
+
+		HRESULT hr = S_OK;
+		ID3D11VideoProcessorEnumerator* pVideoProcessorEnum = NULL;
+		ID3D11VideoProcessor* pVideoProcessor = NULL;
+
+		do
+		{
+			// Create a VideoProcessorEnumerator. Progressive frames, scaled down to the thumbnail size.
+			D3D11_VIDEO_PROCESSOR_CONTENT_DESC ContentDesc;
+			ZeroMemory(&ContentDesc, sizeof(ContentDesc));
+			ContentDesc.InputFrameFormat = D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE;
+			ContentDesc.InputWidth = width;
+			ContentDesc.InputHeight = height;
+			ContentDesc.OutputWidth = thumbnailWidth;
+			ContentDesc.OutputHeight = thumbnailHeight;
+			ContentDesc.Usage = D3D11_VIDEO_USAGE_OPTIMAL_SPEED;
+			if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessorEnumerator(&ContentDesc, &pVideoProcessorEnum)))
+				break;
+
+			// The formats must be supported.
+			UINT uiFlags;
+			if (FAILED(hr = pVideoProcessorEnum->CheckVideoProcessorFormat(inputFormat, &uiFlags)) || 0 == (uiFlags & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_INPUT))
+			{
+				hr = MF_E_UNSUPPORTED_D3D_TYPE;
+				break;
+			}
+			if (FAILED(hr = pVideoProcessorEnum->CheckVideoProcessorFormat(DXGI_FORMAT_B8G8R8A8_UNORM, &uiFlags)) || 0 == (uiFlags & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_OUTPUT))
+			{
+				hr = MF_E_UNSUPPORTED_D3D_TYPE;
+				break;
+			}
+
+			// Create the Video Processor. ※ No deinterlacing or rate conversion is needed, so any of them will do.
+			if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessor(pVideoProcessorEnum, 0, &pVideoProcessor)))
+				break;
+
+			this->_ThumbnailProcessorEnum = pVideoProcessorEnum;
+			this->_ThumbnailProcessorEnum->AddRef();
+			this->_ThumbnailProcessor = pVideoProcessor;
+			this->_ThumbnailProcessor->AddRef();
+			this->_ThumbnailInputFormat = inputFormat;
+			this->_ThumbnailInputWidth = width;
+			this->_ThumbnailInputHeight = height;
+
+		} while (FALSE);
+
+		SafeRelease(pVideoProcessor);
+		SafeRelease(pVideoProcessorEnum);
+
+		return hr;
+	}
+	void Presenter::ReleaseThumbnailProcessor()
+	{
+		SafeRelease(this->_ThumbnailProcessor);
+		SafeRelease(this->_ThumbnailProcessorEnum);
+		this->_ThumbnailInputWidth = 0;
+		this->_ThumbnailInputHeight = 0;
+	}
+	HRESULT Presenter::CreateVideoProcessor(SampleAllocatorPool::Entry* pEntry)
+	{
+		HRESULT hr = S_OK;
+		ID3D11VideoProcessorEnumerator* pVideoProcessorEnum = NULL;
+		ID3D11VideoProcessor* pVideoProcessor = NULL;
+
+		do
+		{
+			// Create a VideoProcessorEnumerator.
+			D3D11_VIDEO_PROCESSOR_CONTENT_DESC ContentDesc;
+			ZeroMemory(&ContentDesc, sizeof(ContentDesc));
+			ContentDesc.InputFrameFormat = D3D11_VIDEO_FRAME_FORMAT_INTERLACED_TOP_FIELD_FIRST;
+			ContentDesc.InputWidth = pEntry->Width;					// Input size and
+			ContentDesc.InputHeight = pEntry->Height;				//
+			ContentDesc.OutputWidth = pEntry->OutputWidth;			// output size. (They differ only when the memory budget lowered the output size.)
+			ContentDesc.OutputHeight = pEntry->OutputHeight;		//
+			ContentDesc.Usage = D3D11_VIDEO_USAGE_PLAYBACK_NORMAL;	// Purpose: Playback
+			if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessorEnumerator(&ContentDesc, &pVideoProcessorEnum)))
+				break;
+
+			// If the VideoProcessor doesn't support the output format, we can't use it.
+			UINT uiFlags;
+			if (FAILED(hr = pVideoProcessorEnum->CheckVideoProcessorFormat(pEntry->Format, &uiFlags)))
+				break;
+			if (0 == (uiFlags & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_OUTPUT))
+			{
+				hr = MF_E_UNSUPPORTED_D3D_TYPE;	// Output cannot be supported.
+				break;
+			}
+
+			// Find the index of the best deinterlacing Video Processor.
+			DWORD index;
+			UINT pastFrames, futureFrames;
+			if (FAILED(hr = this->FindDeinterlaceVideoProcessor(pVideoProcessorEnum, &index, &pastFrames, &futureFrames)))
+				break;	// Not found...
+
+			// Create the Video Processor.
+			if (FAILED(hr = this->_D3D11VideoDevice->CreateVideoProcessor(pVideoProcessorEnum, index, &pVideoProcessor)))
+				break;
+			pEntry->PastFrames = pastFrames;
+			pEntry->FutureFrames = futureFrames;
+
+			// Keep them in the entry; they live as long as the pool of this size.
+			SafeRelease(pEntry->Processor);
+			SafeRelease(pEntry->ProcessorEnum);
+			pEntry->ProcessorEnum = pVideoProcessorEnum;
+			pEntry->ProcessorEnum->AddRef();
+			pEntry->Processor = pVideoProcessor;
+			pEntry->Processor->AddRef();
+			pEntry->StreamState.Invalidate();	// A new processor has none of the state.
+
+		} while (FALSE);
+
+		SafeRelease(pVideoProcessor);
+		SafeRelease(pVideoProcessorEnum);
+
+		return hr;
+	}
+	HRESULT Presenter::FindDeinterlaceVideoProcessor(ID3D11VideoProcessorEnumerator* pVideoProcessorEnum, _Out_ DWORD* pIndex, _Out_ UINT* pPastFrames, _Out_ UINT* pFutureFrames)
+	{
+		// Picks the best deinterlacer whose reference frames fit in the history: motion compensation, adaptive, BOB, then blend.
+		// ※ BOB does not require any reference frames, so it is always usable for both progressive/interlaced video.
+
+		static const UINT s_Preference[] = {
+			D3D11_VIDEO_PROCESSOR_PROCESSOR_CAPS_DEINTERLACE_MOTION_COMPENSATION,
+			D3D11_VIDEO_PROCESSOR_PROCESSOR_CAPS_DEINTERLACE_ADAPTIVE,
+			D3D11_VIDEO_PROCESSOR_PROCESSOR_CAPS_DEINTERLACE_BOB,
+			D3D11_VIDEO_PROCESSOR_PROCESSOR_CAPS_DEINTERLACE_BLEND,
+		};
+
+		HRESULT hr = S_OK;
+		D3D11_VIDEO_PROCESSOR_CAPS caps = {};
+
+		*pIndex = 0;
+		*pPastFrames = 0;
+		*pFutureFrames = 0;
+
+		if (FAILED(hr = pVideoProcessorEnum->GetVideoProcessorCaps(&caps)))
+			return hr;
+
+		int bestRank = _countof(s_Preference);
+		for (DWORD i = 0; i < caps.RateConversionCapsCount; i++)
+		{
+			D3D11_VIDEO_PROCESSOR_RATE_CONVERSION_CAPS convCaps = {};
+			if (FAILED(hr = pVideoProcessorEnum->GetVideoProcessorRateConversionCaps(i, &convCaps)))
+				return hr;
+
+			if (convCaps.PastFrames > MAX_PAST_FRAMES || convCaps.FutureFrames > MAX_FUTURE_FRAMES)
+				continue;	// Needs more references than we keep.
+
+			for (int rank = 0; rank < bestRank; rank++)
+			{
+				if (0 != (convCaps.ProcessorCaps & s_Preference[rank]))
+				{
+					bestRank = rank;
+					*pIndex = i;
+					*pPastFrames = convCaps.PastFrames;
+					*pFutureFrames = convCaps.FutureFrames;
+					break;
+				}
 			}
 		}
 
-		return E_FAIL;	// not found
+		return (bestRank < _countof(s_Preference)) ? S_OK : E_FAIL;	// E_FAIL: not found
 	}
 }
@@ -2,7 +2,7 @@
 
 namespace D3D11TextureMediaSink
 {
-	class Presenter
+	class Presenter : public WarmUpTarget
 	{
 	public:
 		Presenter();
@@ -10,14 +10,46 @@ namespace D3D11TextureMediaSink
 
 		BOOL IsReadyNextSample();
 		void SetD3D11(void* pDXGIDeviceManager, void* pD3D11Device);
+		void SetMemoryBudget(TextureMemoryBudget* pBudget, DWORD streamId);
+		void SetHotAttributes(HotAttributeTable* pTable);
+		HRESULT SetOutputFormat(DXGI_FORMAT format);
+		DXGI_FORMAT GetOutputFormat();
+		void SetPassthrough(BOOL bEnable);
+		BOOL GetPassthrough();
+		void SetMultithreadProtection(BOOL bEnable);
+		BOOL GetMultithreadProtection();
+		void SetSharedTextures(BOOL bEnable);
+		BOOL GetSharedTextures();
+		void SetGpuTiming(BOOL bEnable);
+		BOOL GetGpuTiming();
+		void GetGpuTimeStatistics(GpuTimeStatistics* pStatistics);
+		void SetWarmUpHint(UINT32 width, UINT32 height);
+		void GetWarmUpHint(UINT32* pWidth, UINT32* pHeight);
 		IMFDXGIDeviceManager* GetDXGIDeviceManager();
 		ID3D11Device* GetD3D11Device();
-		HRESULT IsSupported(IMFMediaType* pMediaType, DXGI_FORMAT dxgiFormat);
+		HRESULT IsSupported(const CapabilityKey& key, UINT32 width, UINT32 height, DXGI_FORMAT dxgiFormat);
+		CapabilityCache* GetCapabilityCache();
 		HRESULT SetCurrentMediaType(IMFMediaType* pMediaType);
 		void Shutdown();
 		HRESULT Flush();
-		HRESULT ProcessFrame(IMFMediaType* pCurrentType, IMFSample* pSample, UINT32* punInterlaceMode, BOOL* pbDeviceChanged, BOOL* pbProcessAgain, IMFSample** ppOutputSample = NULL);
+		HRESULT ProcessFrame(IMFMediaType* pCurrentType, IMFSample* pSample, UINT32* punInterlaceMode, BOOL* pbDeviceChanged, BOOL* pbProcessAgain, IMFSample** ppOutputSample = NULL, IMFSample** ppSecondFieldSample = NULL);
+		HRESULT DrainHistory(IMFSample** ppOutputSample, IMFSample** ppSecondFieldSample = NULL);	// S_FALSE when no frames are left.
 		HRESULT ReleaseSample(IMFSample* pSample);
+		HRESULT SignalSampleFence(IMFSample* pSample);
+		FrameDescriptor* GetFrameDescriptor(IMFSample* pSample);
+		HRESULT BlendFrames(IMFSample* pFirst, IMFSample* pSecond, float weight, IMFSample** ppOutputSample);
+		void SetScrubCacheBudget(UINT64 budgetBytes);
+		UINT64 GetScrubCacheBudget();
+		void ClearScrubCache();
+		HRESULT CacheFrame(IMFSample* pSample);	// S_FALSE if the scrubbing cache is off or the frame is not cacheable.
+		HRESULT GetCachedFrame(LONGLONG hnsTime, IMFSample** ppOutputSample);	// MF_E_NOT_FOUND if not cached.
+		HRESULT SetThumbnailSize(UINT32 width, UINT32 height);	// 0 x 0: off.
+		void GetThumbnailSize(UINT32* pWidth, UINT32* pHeight);
+		BOOL IsThumbnailMode();
+		HRESULT SetThumbnailRequests(const LONGLONG* pTimes, UINT count);
+		void SetThumbnailCallback(ITMSThumbnailCallback* pCallback);
+		HRESULT ProcessThumbnail(IMFSample* pSample);	// S_FALSE if the frame serves no request.
+		HRESULT FlushThumbnails();						// Delivers the batch even if the atlas is not full.
 
 	private:
 		BOOL _ShutdownComplete = FALSE;
@@ -27,16 +59,88 @@ namespace D3D11TextureMediaSink
 		IMFDXGIDeviceManager*	_DXGIDeviceManager = NULL;
 		ID3D11Device*			_D3D11Device = NULL;
 		ID3D11VideoDevice*      _D3D11VideoDevice = NULL;
-		ID3D11VideoProcessorEnumerator* _D3D11VideoProcessorEnum = NULL;
-		ID3D11VideoProcessor* _D3D11VideoProcessor = NULL;
-		SampleAllocator* _SampleAllocator = NULL;
+		ID3D11DeviceContext*	_D3D11DeviceContext = NULL;		// Immediate context, got once.
+		ID3D11VideoContext*		_D3D11VideoContext = NULL;		//
+		ID3D10Multithread*		_Multithread = NULL;			//
+		volatile BOOL _MultithreadProtection = FALSE;	// Submit the work on the context inside ID3D10Multithread::Enter/Leave. (TMS_MULTITHREAD_PROTECTION)
+		volatile DXGI_FORMAT _OutputFormat = DXGI_FORMAT_B8G8R8A8_UNORM;	// Format of the output textures. (TMS_OUTPUT_FORMAT)
+		UINT32 _YuvMatrix = MFVideoTransferMatrix_BT709;					// MFVideoTransferMatrix of the input.
+		UINT32 _ChromaSiting = 0;											// Colour of the input, got once from the media type. (0: not set)
+		UINT32 _Primaries = MFVideoPrimaries_BT709;							//
+		UINT32 _TransferFunction = MFVideoTransFunc_709;					//
+		UINT64 _InputCount = 0;					// Input samples processed since the media type was set.
+		UINT64 _OutputSourceIndex = 0;			// Index of the input sample the output of the frame being processed was made from.
+		BOOL _InterlacedContent = FALSE;		// The media type is not progressive.
+		ReferenceFrameHistory _History;			// Reference frames for deinterlacing.
+		UINT _FrameNumber = 0;					// InputFrameOrField of the next frame to process.
+		volatile BOOL _Passthrough = FALSE;	// Present the decoder's texture as is when no processing is needed.
+		SampleAllocatorPool _SamplePool;	// Output samples and video processors, per frame size.
+		CapabilityCache _Capabilities;		// Results of IsSupported for this device.
+		volatile BOOL _SharedTextures = FALSE;	// Share the output textures with another process or device. (TMS_SHARED_TEXTURES)
+		UINT64 _SharedBusyCount = 0;			// Shared textures skipped because the consumer was reading them. (TMS_SHARED_BUSY_COUNT)
+		volatile BOOL _GpuTiming = FALSE;	// Measure the GPU time of the blits. (TMS_GPU_TIMING)
+		GpuTimerQueryRing _GpuTimer;		//
+		HotAttributeTable* _HotAttributes = NULL;	// Where the statistics are published for the consumer.
+		UINT32 _HintWidth = 0;				// Size to warm up before the media type is known. (TMS_WARMUP_HINT)
+		UINT32 _HintHeight = 0;				//
+		WarmUpWork _WarmUp;									// Creates the video processor of the current entry in the background.
+		BOOL _FirstFramePending = FALSE;					// No frame has been processed since the media type was set. (TMS_FIRST_FRAME_SETUP_TIME)
+		FrameCache _ScrubCache;					// Copies of the frames processed while scrubbing. (TMS_SCRUB_CACHE_BUDGET)
+		UINT64 _ScrubCacheReserved = 0;			// What it holds, as reserved in the texture memory budget.
+		TextureMemoryBudget* _MemoryBudget = NULL;
+		DWORD _MemoryStreamId = 0;
+		ThumbnailAtlas _Thumbnails;								// Requests and cells of the thumbnail mode. (TMS_THUMBNAIL_SIZE, TMS_THUMBNAIL_TIMES)
+		ITMSThumbnailCallback* _ThumbnailCallback = NULL;		// (TMS_THUMBNAIL_CALLBACK)
+		ID3D11Texture2D* _ThumbnailAtlas = NULL;				// Drawn by the video processor, and its staging copy read back by the CPU.
+		ID3D11Texture2D* _ThumbnailStaging = NULL;				//
+		UINT64 _ThumbnailReserved = 0;							// What they hold, as reserved in the texture memory budget.
 
 		CriticalSection* _csPresenter = NULL;
+		CriticalSection _csDeviceContext;		// Serializes the use of the immediate context by the frame processing and the blending.
+
+		ID3D11VideoProcessorEnumerator* _BlendProcessorEnum = NULL;		// Video processor for the blends of the frame rate conversion.
+		ID3D11VideoProcessor* _BlendProcessor = NULL;					//
+		DXGI_FORMAT _BlendInputFormat = DXGI_FORMAT_UNKNOWN;			// What the blending video processor was created for.
+		DXGI_FORMAT _BlendOutputFormat = DXGI_FORMAT_UNKNOWN;			//
+		UINT32 _BlendWidth = 0;											//
+		UINT32 _BlendHeight = 0;										//
+		ID3D11VideoProcessorEnumerator* _ThumbnailProcessorEnum = NULL;	// Video processor that scales the frames down into the thumbnail atlas.
+		ID3D11VideoProcessor* _ThumbnailProcessor = NULL;				//
+		DXGI_FORMAT _ThumbnailInputFormat = DXGI_FORMAT_UNKNOWN;		// What it was created for.
+		UINT32 _ThumbnailInputWidth = 0;								//
+		UINT32 _ThumbnailInputHeight = 0;								//
 
 
 		HRESULT CheckShutdown() const;
+		BOOL BeginGpuTimer(UINT* pSlot);
+		void EndGpuTimer(UINT slot);
+		void PublishGpuTimeStatistics();
+		void AccountScrubCache();
+		HRESULT CreateThumbnailAtlas();
+		void ReleaseThumbnailAtlas();
+		HRESULT DrawThumbnail(const ReferenceFrameHistory::Frame* pFrame, const TMS_THUMBNAIL& thumbnail);
+		HRESULT ReadBackThumbnails();	// S_FALSE if there is nothing to deliver.
+		void PublishThumbnailStatistics();
+		HRESULT BeginWriteSamples(SampleAllocatorPool::Entry* pEntry, IMFSample** ppSamples, UINT count);
+		ID3D10Multithread* GetMultithread();	// NULL unless the multithread protection is enabled.
+		HRESULT GetOutputView(SampleAllocatorPool::Entry* pEntry, ID3D11Texture2D* pTexture, ID3D11VideoProcessorOutputView** ppOutputView);
 		HRESULT InitializeSampleAllocator();
-		HRESULT ProcessFrameUsingD3D11(ID3D11Texture2D* pTexture2D, UINT dwViewIndex, UINT32 unInterlaceMode, IMFSample** ppVideoOutFrame);
-		HRESULT FindBOBVideoProcessor(_Out_ DWORD* pIndex);
+		HRESULT StartWarmUp();
+		void WaitForWarmUp();
+		HRESULT WarmUp(void* pItem);	// WarmUpTarget: creates the video processor of the pool entry, unless it has one.
+		void DescribeOutput(IMFSample* pOutputSample, LONGLONG hnsProcessTime);
+		void GetOutputColor(TMS_FRAME_DESCRIPTOR* pColor);
+		HRESULT ProcessFramePassthrough(IMFSample* pSample, IMFMediaBuffer* pBuffer, ID3D11Texture2D* pTexture2D, UINT dwViewIndex, UINT32 unInterlaceMode, IMFSample** ppVideoOutFrame);
+		HRESULT ProcessFrameUsingD3D11(IMFSample* pSample, ID3D11Texture2D* pTexture2D, UINT dwViewIndex, UINT32 unInterlaceMode, IMFSample** ppVideoOutFrame, IMFSample** ppSecondFieldFrame);
+		HRESULT GetSampleTexture(IMFSample* pSample, ID3D11Texture2D** ppTexture, UINT* pViewIndex = NULL);
+		HRESULT CreateInputView(ID3D11VideoProcessorEnumerator* pVideoProcessorEnum, const ReferenceFrameHistory::Frame* pFrame, ID3D11VideoProcessorInputView** ppInputView);
+		void CopySampleTimes(IMFSample* pFrom, IMFSample* pTo, UINT index, UINT count);
+		void SetVideoColorSpace(D3D11_VIDEO_PROCESSOR_COLOR_SPACE* pColorSpace, DXGI_FORMAT format);
+		HRESULT CreateBlendProcessor(DXGI_FORMAT inputFormat, UINT32 width, UINT32 height, DXGI_FORMAT outputFormat);
+		void ReleaseBlendProcessor();
+		HRESULT CreateThumbnailProcessor(DXGI_FORMAT inputFormat, UINT32 width, UINT32 height);
+		void ReleaseThumbnailProcessor();
+		HRESULT CreateVideoProcessor(SampleAllocatorPool::Entry* pEntry);
+		HRESULT FindDeinterlaceVideoProcessor(ID3D11VideoProcessorEnumerator* pVideoProcessorEnum, _Out_ DWORD* pIndex, _Out_ UINT* pPastFrames, _Out_ UINT* pFutureFrames);
 	};
 }
@@ -3,6 +3,7 @@
 namespace D3D11TextureMediaSink
 {
 	// Doubly-linked list that holds non-COM objects as elements.
+	// Removed nodes are kept in a free-list and reused by later insertions, so a list with a steady length does not hit the allocator.
 	//
 	template <class T, BOOL NULLABLE = FALSE>
 	class PtrList
@@ -61,8 +62,46 @@ namespace D3D11TextureMediaSink
 		};
 
 	protected:
-		Node    m_anchor;  // Anchor node for the linked list.
-		DWORD   m_count;   // Number of items in the list.
+		static const DWORD FREE_LIST_MAX = 32;	// Maximum number of nodes kept for reuse.
+
+		Node    m_anchor;     // Anchor node for the linked list.
+		DWORD   m_count;      // Number of items in the list.
+		Node*   m_freeList;   // Singly-linked (through next) list of nodes available for reuse.
+		DWORD   m_freeCount;  // Number of nodes in the free-list.
+
+		// AllocNode: Takes a node from the free-list, or creates a new one when the free-list is empty.
+		Node* AllocNode(Ptr item)
+		{
+			if (m_freeList == NULL)
+				return new Node(item);
+
+			Node *pNode = m_freeList;
+			m_freeList = pNode->next;
+			m_freeCount--;
+
+			pNode->prev = NULL;
+			pNode->next = NULL;
+			pNode->item = item;
+
+			return pNode;
+		}
+
+		// FreeNode: Returns the node to the free-list.
+		void FreeNode(Node *pNode)
+		{
+			pNode->item = NULL;
+
+			if (m_freeCount >= FREE_LIST_MAX)
+			{
+				delete pNode;
+				return;
+			}
+
+			pNode->prev = NULL;
+			pNode->next = m_freeList;
+			m_freeList = pNode;
+			m_freeCount++;
+		}
 
 		Node* Front() const
 		{
@@ -82,7 +121,7 @@ namespace D3D11TextureMediaSink
 			if (!item && !NULLABLE)
 				return E_POINTER;
 
-			Node *pNode = new Node(item);
+			Node *pNode = this->AllocNode(item);
 			if (pNode == NULL)
 				return E_OUTOFMEMORY;
 
@@ -132,7 +171,7 @@ namespace D3D11TextureMediaSink
 			if (ppItem)
 				*ppItem = item;
 
-			delete pNode;
+			this->FreeNode(pNode);
 			m_count--;
 
 			return S_OK;
@@ -145,23 +184,33 @@ namespace D3D11TextureMediaSink
 			m_anchor.prev = &m_anchor;
 
 			m_count = 0;
+
+			m_freeList = NULL;
+			m_freeCount = 0;
 		}
 		virtual ~PtrList()
 		{
 			this->Clear();
+
+			// Delete the nodes kept for reuse.
+			while (m_freeList != NULL)
+			{
+				Node *tmp = m_freeList->next;
+				delete m_freeList;
+				m_freeList = tmp;
+			}
+			m_freeCount = 0;
 		}
 
 		void Clear()
 		{
 			Node *n = m_anchor.next;
 
-			// Delete the nodes
+			// Return the nodes to the free-list
 			while (n != &m_anchor)
 			{
-				n->item = NULL;
-
 				Node *tmp = n->next;
-				delete n;
+				this->FreeNode(n);
 				n = tmp;
 			}
 
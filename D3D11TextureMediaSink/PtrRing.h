@@ -0,0 +1,168 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// Array-backed ring buffer that holds non-COM objects as elements.
+	// Has the same insertion/removal surface as PtrList, but does not allocate per element.
+	// The array only grows (doubles) when it becomes full, so a queue with a steady depth never hits the allocator.
+	//
+	template <class T, BOOL NULLABLE = FALSE>
+	class PtrRing
+	{
+	protected:
+		typedef T* Ptr;
+
+		Ptr*    m_items;     // Array of elements.
+		DWORD   m_capacity;  // Number of slots in the array.
+		DWORD   m_head;      // Index of the front element.
+		DWORD   m_count;     // Number of items in the ring.
+
+		DWORD IndexOf(DWORD offset) const
+		{
+			return (m_head + offset) % m_capacity;
+		}
+
+		HRESULT Grow()
+		{
+			DWORD newCapacity = (m_capacity == 0) ? INITIAL_CAPACITY : m_capacity * 2;
+
+			Ptr* pNewItems = new Ptr[newCapacity];
+			if (pNewItems == NULL)
+				return E_OUTOFMEMORY;
+
+			// Copy the elements so that the front comes to index 0.
+			for (DWORD i = 0; i < m_count; i++)
+				pNewItems[i] = m_items[IndexOf(i)];
+
+			delete[] m_items;
+			m_items = pNewItems;
+			m_capacity = newCapacity;
+			m_head = 0;
+
+			return S_OK;
+		}
+
+	public:
+		static const DWORD INITIAL_CAPACITY = 8;
+
+		PtrRing()
+		{
+			m_items = NULL;
+			m_capacity = 0;
+			m_head = 0;
+			m_count = 0;
+		}
+		virtual ~PtrRing()
+		{
+			this->Clear();
+			delete[] m_items;
+		}
+
+		void Clear()
+		{
+			for (DWORD i = 0; i < m_count; i++)
+				m_items[IndexOf(i)] = NULL;
+
+			m_head = 0;
+			m_count = 0;
+		}
+
+		// Insertion functions
+		HRESULT InsertBack(Ptr item)
+		{
+			// Do not allow NULL item pointers unless NULLABLE is true.
+			if (!item && !NULLABLE)
+				return E_POINTER;
+
+			HRESULT hr;
+			if (m_count == m_capacity)
+				if (FAILED(hr = this->Grow()))
+					return hr;
+
+			m_items[IndexOf(m_count)] = item;
+			m_count++;
+
+			return S_OK;
+		}
+		HRESULT InsertFront(Ptr item)
+		{
+			// Do not allow NULL item pointers unless NULLABLE is true.
+			if (!item && !NULLABLE)
+				return E_POINTER;
+
+			HRESULT hr;
+			if (m_count == m_capacity)
+				if (FAILED(hr = this->Grow()))
+					return hr;
+
+			m_head = (m_head + m_capacity - 1) % m_capacity;
+			m_items[m_head] = item;
+			m_count++;
+
+			return S_OK;
+		}
+
+		// RemoveBack: Removes the tail of the ring and returns the value.
+		// ppItem can be NULL if you don't want the item back.
+		HRESULT RemoveBack(Ptr *ppItem)
+		{
+			if (this->IsEmpty())
+				return E_FAIL;
+
+			DWORD index = IndexOf(m_count - 1);
+			if (ppItem)
+				*ppItem = m_items[index];
+			m_items[index] = NULL;
+			m_count--;
+
+			return S_OK;
+		}
+
+		// RemoveFront: Removes the head of the ring and returns the value.
+		// ppItem can be NULL if you don't want the item back.
+		HRESULT RemoveFront(Ptr *ppItem)
+		{
+			if (this->IsEmpty())
+				return E_FAIL;
+
+			if (ppItem)
+				*ppItem = m_items[m_head];
+			m_items[m_head] = NULL;
+			m_head = (m_head + 1) % m_capacity;
+			m_count--;
+
+			return S_OK;
+		}
+
+		// GetBack: Gets the tail item.
+		HRESULT GetBack(Ptr *ppItem)
+		{
+			if (this->IsEmpty())
+				return E_FAIL;
+			if (ppItem == NULL)
+				return E_POINTER;
+
+			*ppItem = m_items[IndexOf(m_count - 1)];
+
+			return S_OK;
+		}
+
+		// GetFront: Gets the front item.
+		HRESULT GetFront(Ptr *ppItem)
+		{
+			if (this->IsEmpty())
+				return E_FAIL;
+			if (ppItem == NULL)
+				return E_POINTER;
+
+			*ppItem = m_items[m_head];
+
+			return S_OK;
+		}
+
+		// GetCount: Returns the number of items in the ring.
+		DWORD GetCount() const { return m_count; }
+
+		bool IsEmpty() const { return (this->GetCount() == 0); }
+	};
+}
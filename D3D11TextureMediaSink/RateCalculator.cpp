@@ -0,0 +1,96 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	RateCalculator::RateCalculator()
+	{
+	}
+	RateCalculator::~RateCalculator()
+	{
+	}
+
+	HRESULT RateCalculator::SetFrameRate(const MFRatio& fps)
+	{
+		HRESULT hr;
+
+		UINT64 avgTimePerFrame = 0;
+		if (FAILED(hr = ::MFFrameRateToAverageTimePerFrame(fps.Numerator, fps.Denominator, &avgTimePerFrame)))
+			return hr;
+		if (avgTimePerFrame == 0)
+			return E_INVALIDARG;
+
+		AutoLock lock(&this->_csRates);
+
+		this->_FrameInterval = (LONGLONG)avgTimePerFrame;
+
+		return S_OK;
+	}
+	void RateCalculator::AddProcessingTime(LONGLONG hnsTime)
+	{
+		AutoLock lock(&this->_csRates);
+
+		this->_ProcessingTime += (max(0LL, hnsTime) - this->_ProcessingTime) / RATE_MEASURE_WEIGHT;
+	}
+	void RateCalculator::AddPresentLatency(LONGLONG hnsTime)
+	{
+		AutoLock lock(&this->_csRates);
+
+		this->_PresentLatency += (max(0LL, hnsTime) - this->_PresentLatency) / RATE_MEASURE_WEIGHT;
+	}
+	LONGLONG RateCalculator::GetProcessingTime()
+	{
+		AutoLock lock(&this->_csRates);
+
+		return this->_ProcessingTime;
+	}
+	LONGLONG RateCalculator::GetPresentLatency()
+	{
+		AutoLock lock(&this->_csRates);
+
+		return this->_PresentLatency;
+	}
+	void RateCalculator::Reset()
+	{
+		AutoLock lock(&this->_csRates);
+
+		this->_ProcessingTime = 0;
+		this->_PresentLatency = 0;
+	}
+
+	float RateCalculator::GetFastestRate(BOOL bThin)
+	{
+		if (bThin)
+			return FLT_MAX;	// The source sends key frames only.
+
+		AutoLock lock(&this->_csRates);
+
+		LONGLONG cost = this->_ProcessingTime + this->_PresentLatency;
+		if (cost <= 0)
+			return RATE_SUPPORT_MAX;	// Nothing measured yet.
+
+		float rate = (float)this->_FrameInterval / (float)cost;
+		if (rate >= TRICKPLAY_THINNING_RATE)
+			return RATE_SUPPORT_MAX;	// The sink thins the frames by itself beyond the threshold.
+
+		return max(1.0f, rate);	// Normal playback is always supported; it just drops late frames.
+	}
+	float RateCalculator::GetSlowestRate()
+	{
+		return 0.0f;	// Scrubbing is supported: the frame is presented at once when the clock is not running.
+	}
+	HRESULT RateCalculator::IsRateSupported(BOOL bThin, float rate, float* pNearestSupportedRate)
+	{
+		float fastest = this->GetFastestRate(bThin);
+
+		if (::fabsf(rate) <= fastest)
+		{
+			if (NULL != pNearestSupportedRate)
+				*pNearestSupportedRate = rate;
+			return S_OK;
+		}
+
+		if (NULL != pNearestSupportedRate)
+			*pNearestSupportedRate = (rate < 0.0f) ? -fastest : fastest;
+		return MF_E_UNSUPPORTED_RATE;
+	}
+}
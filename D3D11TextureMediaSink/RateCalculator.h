@@ -0,0 +1,40 @@
+#pragma once
+
+// Fastest unthinned rate reported when the sink can thin the frames by itself.
+#define RATE_SUPPORT_MAX		128.0f
+
+// Weight of a new measurement in the moving averages (1/n).
+#define RATE_MEASURE_WEIGHT		8
+
+namespace D3D11TextureMediaSink
+{
+	// Playback rates the sink supports, from the measured cost of a frame.
+	// Below TRICKPLAY_THINNING_RATE every frame is processed, so a frame must be processed and presented within its display
+	// time at the rate: (processing time + presentation latency) <= frame interval / rate. Above it, the sink thins the frames
+	// by itself and processes at most the source frame rate, so any rate will do if the threshold itself is reachable.
+	// With thinning by the source (key frames only), there is no limit.
+	//
+	class RateCalculator
+	{
+	public:
+		RateCalculator();
+		~RateCalculator();
+
+		HRESULT SetFrameRate(const MFRatio& fps);
+		void AddProcessingTime(LONGLONG hnsTime);
+		void AddPresentLatency(LONGLONG hnsTime);
+		LONGLONG GetProcessingTime();
+		LONGLONG GetPresentLatency();
+		void Reset();	// Forgets the measurements.
+
+		float GetFastestRate(BOOL bThin);	// Absolute value; the same in both directions.
+		float GetSlowestRate();				// The same thinned or not.
+		HRESULT IsRateSupported(BOOL bThin, float rate, float* pNearestSupportedRate);
+
+	private:
+		LONGLONG _FrameInterval = 333667;	// 100ns units
+		LONGLONG _ProcessingTime = 0;		// Moving averages; 100ns units
+		LONGLONG _PresentLatency = 0;		//
+		CriticalSection _csRates;
+	};
+}
@@ -0,0 +1,85 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	ReferenceFrameHistory::ReferenceFrameHistory()
+	{
+		ZeroMemory(this->_Frames, sizeof(this->_Frames));
+	}
+	ReferenceFrameHistory::~ReferenceFrameHistory()
+	{
+		this->Clear();
+	}
+
+	HRESULT ReferenceFrameHistory::Push(IMFSample* pSample, ID3D11Texture2D* pTexture, UINT viewIndex, UINT32 interlaceMode)
+	{
+		if (NULL == pSample || NULL == pTexture)
+			return E_POINTER;
+
+		// Frames of another size or format cannot be references of this one.
+		D3D11_TEXTURE2D_DESC desc;
+		pTexture->GetDesc(&desc);
+		if (desc.Width != this->_Width || desc.Height != this->_Height || desc.Format != this->_Format)
+		{
+			this->Clear();
+			this->_Width = desc.Width;
+			this->_Height = desc.Height;
+			this->_Format = desc.Format;
+		}
+
+		// Overwrite the oldest frame when full.
+		this->_Newest = (this->_Newest + 1) % CAPACITY;
+		Frame* pFrame = &this->_Frames[this->_Newest];
+		this->ReleaseFrame(pFrame);
+
+		pFrame->Sample = pSample;
+		pFrame->Sample->AddRef();
+		pFrame->Texture = pTexture;
+		pFrame->Texture->AddRef();
+		pFrame->ViewIndex = viewIndex;
+		pFrame->InterlaceMode = interlaceMode;
+
+		if (this->_Count < CAPACITY)
+			this->_Count++;
+		if (this->_Pending < this->_Count)
+			this->_Pending++;
+
+		return S_OK;
+	}
+	void ReferenceFrameHistory::Clear()
+	{
+		for (DWORD i = 0; i < CAPACITY; i++)
+			this->ReleaseFrame(&this->_Frames[i]);
+
+		this->_Count = 0;
+		this->_Pending = 0;
+	}
+	const ReferenceFrameHistory::Frame* ReferenceFrameHistory::GetFrame(DWORD age) const
+	{
+		if (age >= this->_Count)
+			return NULL;
+
+		return &this->_Frames[(this->_Newest + CAPACITY - age) % CAPACITY];
+	}
+
+	const ReferenceFrameHistory::Frame* ReferenceFrameHistory::TakeTarget(DWORD lag)
+	{
+		if (lag >= this->_Pending)
+			return NULL;	// Not enough frames after it yet.
+
+		// It and the frames before it are done; the ones after it are still to be output.
+		this->_Pending = lag;
+
+		return this->GetFrame(lag);
+	}
+
+	// private
+
+	void ReferenceFrameHistory::ReleaseFrame(Frame* pFrame)
+	{
+		SafeRelease(pFrame->Texture);
+		SafeRelease(pFrame->Sample);
+		pFrame->ViewIndex = 0;
+		pFrame->InterlaceMode = MFVideoInterlace_Progressive;
+	}
+}
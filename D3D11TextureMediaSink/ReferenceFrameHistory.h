@@ -0,0 +1,47 @@
+#pragma once
+
+#define MAX_PAST_FRAMES		3	// Maximum number of backward reference frames for deinterlacing.
+#define MAX_FUTURE_FRAMES	2	// Maximum number of forward reference frames for deinterlacing.
+
+namespace D3D11TextureMediaSink
+{
+	// Recent input frames, kept as reference frames (ppPastSurfaces/ppFutureSurfaces) for the deinterlacer.
+	// Each frame holds a reference to the input sample, so the decoder does not reuse its surface meanwhile.
+	// With future reference frames, the newest frames are pending: pushed, but not output yet. At the end of the stream they
+	// are taken one by one with fewer future references (TakeTarget with a smaller lag).
+	//
+	class ReferenceFrameHistory
+	{
+	public:
+		struct Frame
+		{
+			IMFSample* Sample;
+			ID3D11Texture2D* Texture;
+			UINT ViewIndex;
+			UINT32 InterlaceMode;
+		};
+
+		static const DWORD CAPACITY = MAX_PAST_FRAMES + 1 + MAX_FUTURE_FRAMES;
+
+		ReferenceFrameHistory();
+		~ReferenceFrameHistory();
+
+		HRESULT Push(IMFSample* pSample, ID3D11Texture2D* pTexture, UINT viewIndex, UINT32 interlaceMode);
+		void Clear();
+		DWORD GetCount() const { return this->_Count; }
+		const Frame* GetFrame(DWORD age) const;	// age 0 is the newest frame.
+		DWORD GetPendingCount() const { return this->_Pending; }
+		const Frame* TakeTarget(DWORD lag);		// The frame to output, lag frames behind the newest; NULL if it is not pending.
+
+	private:
+		Frame _Frames[CAPACITY];
+		DWORD _Newest = 0;	// Index of the newest frame.
+		DWORD _Count = 0;
+		DWORD _Pending = 0;	// The newest frames not output yet.
+		UINT _Width = 0;	// Size and format of the frames in the history.
+		UINT _Height = 0;	//
+		DXGI_FORMAT _Format = DXGI_FORMAT_UNKNOWN;
+
+		void ReleaseFrame(Frame* pFrame);
+	};
+}
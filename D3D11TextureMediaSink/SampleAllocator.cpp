@@ -2,18 +2,37 @@
 
 namespace D3D11TextureMediaSink
 {
-	SampleAllocator::SampleAllocator()
+	SampleAllocator::SampleAllocator(TextureMemoryBudget* pBudget, DWORD streamId)
 	{
+		this->_Budget = pBudget;
+		this->_StreamId = streamId;
+
+		for (int i = 0; i < SAMPLE_MAX; i++)
+		{
+			this->_SampleQueue[i] = NULL;
+			this->_OwnBuffers[i] = NULL;
+			this->_SharedHandles[i] = NULL;
+			ZeroMemory(&this->_Descriptors[i], sizeof(FrameDescriptor));
+		}
+
+		// Create an event object to signal when a sample becomes available.
+		this->_FreeSampleAvailable = ::CreateEvent(NULL, FALSE, FALSE, NULL);	 // Note that usually the second argument is FALSE.
+
+		// Create an event object to signal that no initialization is in progress.
+		this->_InitializedEvent = ::CreateEvent(NULL, TRUE, TRUE, NULL);
 	}
 	SampleAllocator::~SampleAllocator()
 	{
+		this->Shutdown();
+
+		::CloseHandle(this->_InitializedEvent);
+		::CloseHandle(this->_FreeSampleAvailable);
 	}
 
-	HRESULT SampleAllocator::Initialize(ID3D11Device* pD3DDevice, int width, int height)
+	HRESULT SampleAllocator::Initialize(ID3D11Device* pD3DDevice, int width, int height, DXGI_FORMAT format)
 	{
 		HRESULT hr = S_OK;
-		// Create an event object to signal when a sample becomes available.
-		this->_FreeSampleAvailable = ::CreateEvent(NULL, FALSE, FALSE, NULL);	 // Note that usually the second argument is FALSE.
+		OutputPlane planes[OUTPUT_PLANE_MAX];
 
 		for (int i = 0; i < SAMPLE_MAX; i++)
 		{
@@ -33,15 +52,24 @@ namespace D3D11TextureMediaSink
 				desc.ArraySize = 1;
 				desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
 				desc.CPUAccessFlags = 0;
-				desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;	// Fixed format.
+				desc.Format = format;	// Specified format.
 				desc.Width = width;		// Specified width.
 				desc.Height = height;	// Specified height.
 				desc.MipLevels = 1;
 				desc.SampleDesc = { 1, 0 };
 				desc.Usage = D3D11_USAGE_DEFAULT;
+				if (this->_Shared)
+					desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED_NTHANDLE | D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX;
 				if (FAILED(hr = pD3DDevice->CreateTexture2D(&desc, NULL, &pTexture)))
 					break;
 
+				// Publish the texture to the consumer, and sequence the access to it.
+				if (this->_Shared)
+				{
+					if (FAILED(hr = this->InitializeShared(i, pTexture, pSample)))
+						break;
+				}
+
 				// Create a media buffer from the texture.
 				if (FAILED(hr = ::MFCreateDXGISurfaceBuffer(__uuidof(ID3D11Texture2D), pTexture, 0, FALSE, &pBuffer)))
 					break;
@@ -50,13 +78,24 @@ namespace D3D11TextureMediaSink
 				if (FAILED(hr = pSample->AddBuffer(pBuffer)))
 					break;
 
-				// Initialize the sample state to READY.
-				if (FAILED(hr = pSample->SetUINT32(SAMPLE_STATE, SAMPLE_STATE_READY)))
+				// Describe the layout of the texture to the consumer.
+				if (FAILED(hr = pSample->SetUINT32(TMS_SAMPLE_FORMAT, format)) ||
+					FAILED(hr = pSample->SetUINT32(TMS_SAMPLE_PLANE_COUNT, GetOutputPlanes(format, width, height, planes))) ||
+					FAILED(hr = ::MFSetAttributeSize(pSample, MF_MT_FRAME_SIZE, width, height)))
 					break;
 
+				// Initialize the sample state to READY, and describe the texture.
+				ZeroMemory(&this->_Descriptors[i], sizeof(FrameDescriptor));
+				this->_Descriptors[i].State = SAMPLE_STATE_READY;
+				this->_Descriptors[i].Frame.Width = width;
+				this->_Descriptors[i].Frame.Height = height;
+				this->_Descriptors[i].Frame.Format = format;
+
 				// Add the completed sample to the queue.
 				this->_SampleQueue[i] = pSample;
 				this->_SampleQueue[i]->AddRef();
+				this->_OwnBuffers[i] = pBuffer;
+				this->_OwnBuffers[i]->AddRef();
 
 			} while (FALSE);
 
@@ -65,36 +104,234 @@ namespace D3D11TextureMediaSink
 			SafeRelease(pSample);
 
 			if (FAILED(hr))
+			{
+				// Release the samples created so far.
+				for (int j = 0; j < i; j++)
+				{
+					SafeRelease(this->_OwnBuffers[j]);
+					SafeRelease(this->_SampleQueue[j]);
+				}
+				this->ReleaseShared();
 				return hr;
+			}
+		}
+
+		// Create the fences. A sample without one is simply taken as completed.
+		for (int i = 0; i < SAMPLE_MAX; i++)
+		{
+			D3D11EventFence* pFence = new D3D11EventFence();
+			if (FAILED(pFence->Initialize(pD3DDevice)))
+			{
+				delete pFence;
+				pFence = NULL;
+			}
+			this->_Fences.Attach(i, pFence);
+		}
+
+		// Account for the textures. (Going over the budget is handled by the owner of the allocator.)
+		if (NULL != this->_Budget)
+		{
+			this->_ReservedBytes = GetTotalBytes(width, height, format);
+			this->_Budget->Reserve(this->_StreamId, this->_ReservedBytes);
 		}
 
 		this->_IsShutdown = FALSE;
 
 		return S_OK;
 	}
+	HRESULT SampleAllocator::InitializeAsync(ID3D11Device* pD3DDevice, int width, int height, DXGI_FORMAT format)
+	{
+		if (NULL == pD3DDevice)
+			return E_POINTER;
+
+		// Wait for the previous initialization, if any.
+		this->WaitForInitialized();
+
+		this->_InitializeDevice = pD3DDevice;
+		this->_InitializeDevice->AddRef();
+		this->_InitializeWidth = width;
+		this->_InitializeHeight = height;
+		this->_InitializeFormat = format;
+		this->_InitializeResult = S_OK;
+		::ResetEvent(this->_InitializedEvent);
+
+		// Create the textures on a worker thread. GetSample waits until this completes.
+		if (NULL == this->_InitializeWork)
+		{
+			this->_InitializeWork = ::CreateThreadpoolWork(&SampleAllocator::InitializeProcProxy, this, NULL);
+			if (NULL == this->_InitializeWork)
+			{
+				SafeRelease(this->_InitializeDevice);
+				::SetEvent(this->_InitializedEvent);
+				return HRESULT_FROM_WIN32(::GetLastError());
+			}
+		}
+		::SubmitThreadpoolWork(this->_InitializeWork);
+
+		return S_OK;
+	}
 	HRESULT SampleAllocator::Shutdown()
+	{
+		// Let the initialization in progress finish first.
+		if (NULL != this->_InitializeWork)
+		{
+			::WaitForThreadpoolWorkCallbacks(this->_InitializeWork, FALSE);
+			::CloseThreadpoolWork(this->_InitializeWork);
+			this->_InitializeWork = NULL;
+		}
+
+		IUnknown* pSources[SAMPLE_MAX] = {};
+		{
+			AutoLock lock(&this->_csSampleAllocator);
+
+			if (this->_IsShutdown)
+				return S_FALSE;
+
+			this->_IsShutdown = TRUE;
+
+			for (int i = 0; i < SAMPLE_MAX; i++)
+			{
+				pSources[i] = this->DetachPassthrough(i);
+				SafeRelease(this->_OwnBuffers[i]);
+				SafeRelease(this->_SampleQueue[i]);
+			}
+			this->_Fences.Clear();
+			this->ReleaseShared();
+		}
+
+		// Give the input samples back to the decoder outside of the lock.
+		for (int i = 0; i < SAMPLE_MAX; i++)
+			SafeRelease(pSources[i]);
+
+		if (NULL != this->_Budget && 0 != this->_ReservedBytes)
+		{
+			this->_Budget->Release(this->_StreamId, this->_ReservedBytes);
+			this->_ReservedBytes = 0;
+		}
+
+		return S_OK;
+	}
+	DWORD SampleAllocator::GetOutstandingCount()
 	{
 		AutoLock lock(&this->_csSampleAllocator);
 
 		if (this->_IsShutdown)
-			return S_FALSE;
+			return 0;
+
+		// Count the samples that are lent out (not READY).
+		DWORD count = 0;
+		for (int i = 0; i < SAMPLE_MAX; i++)
+		{
+			if (SAMPLE_STATE_READY != this->_Descriptors[i].State)
+				count++;
+		}
+
+		return count;
+	}
+	FrameDescriptor* SampleAllocator::GetDescriptor(IMFSample* pSample)
+	{
+		AutoLock lock(&this->_csSampleAllocator);
 
-		this->_IsShutdown = TRUE;
+		if (this->_IsShutdown || NULL == pSample)
+			return NULL;
 
 		for (int i = 0; i < SAMPLE_MAX; i++)
-			this->_SampleQueue[i]->Release();
+		{
+			if (this->_SampleQueue[i] == pSample)
+				return &this->_Descriptors[i];
+		}
 
-		return S_OK;
+		return NULL;
+	}
+	UINT64 SampleAllocator::GetTotalBytes(UINT32 width, UINT32 height, DXGI_FORMAT format)
+	{
+		return GetOutputFrameBytes(format, width, height) * SAMPLE_MAX;
 	}
 	HRESULT SampleAllocator::CheckShutdown()
 	{
 		return (this->_IsShutdown) ? MF_E_SHUTDOWN : S_OK;
 	}
+	HRESULT SampleAllocator::InitializeShared(int index, ID3D11Texture2D* pTexture, IMFSample* pSample)
+	{
+		HRESULT hr = S_OK;
+		IDXGIResource1* pResource = NULL;
+		IDXGIKeyedMutex* pKeyedMutex = NULL;
+
+		do
+		{
+			// An NT handle can be duplicated into another process, unlike the legacy shared handle.
+			if (FAILED(hr = pTexture->QueryInterface(__uuidof(IDXGIResource1), (void**)&pResource)))
+				break;
+			if (FAILED(hr = pResource->CreateSharedHandle(NULL, DXGI_SHARED_RESOURCE_READ | DXGI_SHARED_RESOURCE_WRITE, NULL, &this->_SharedHandles[index])))
+				break;
+			if (FAILED(hr = pSample->SetUINT64(TMS_SAMPLE_SHARED_HANDLE, (UINT64)(ULONG_PTR)this->_SharedHandles[index])))
+				break;
+
+			if (FAILED(hr = pTexture->QueryInterface(__uuidof(IDXGIKeyedMutex), (void**)&pKeyedMutex)))
+				break;
+			this->_SharedRing.Attach(index, new DxgiKeyedMutex(pKeyedMutex));
+
+		} while (FALSE);
+
+		SafeRelease(pKeyedMutex);
+		SafeRelease(pResource);
+
+		return hr;
+	}
+	void SampleAllocator::ReleaseShared()
+	{
+		this->_SharedRing.Clear();
+
+		for (int i = 0; i < SAMPLE_MAX; i++)
+		{
+			if (NULL != this->_SharedHandles[i])
+			{
+				::CloseHandle(this->_SharedHandles[i]);
+				this->_SharedHandles[i] = NULL;
+			}
+		}
+	}
+	IUnknown* SampleAllocator::DetachPassthrough(int index)
+	{
+		// Called with _csSampleAllocator held. Returns the reference to the input sample; the caller releases it outside of the lock.
+		IMFSample* pSample = this->_SampleQueue[index];
+		IUnknown* pSource = NULL;
+
+		if (NULL == pSample || FAILED(pSample->GetUnknown(SAMPLE_PASSTHROUGH_SOURCE, IID_PPV_ARGS(&pSource))))
+			return NULL;	// Not in passthrough.
+
+		pSample->DeleteItem(SAMPLE_PASSTHROUGH_SOURCE);
+		pSample->RemoveAllBuffers();
+		pSample->AddBuffer(this->_OwnBuffers[index]);
+
+		return pSource;
+	}
+	HRESULT SampleAllocator::WaitForInitialized()
+	{
+		if (::WaitForSingleObject(this->_InitializedEvent, ALLOCATOR_TIMEOUT) == WAIT_TIMEOUT)
+			return MF_E_NOT_INITIALIZED;
+
+		return this->_InitializeResult;
+	}
+	void CALLBACK SampleAllocator::InitializeProcProxy(PTP_CALLBACK_INSTANCE pInstance, void* arg, PTP_WORK pWork)
+	{
+		SampleAllocator* pThis = reinterpret_cast<SampleAllocator*>(arg);
 
-	HRESULT SampleAllocator::GetSample(IMFSample** ppSample)
+		pThis->_InitializeResult = pThis->Initialize(pThis->_InitializeDevice, pThis->_InitializeWidth, pThis->_InitializeHeight, pThis->_InitializeFormat);
+		SafeRelease(pThis->_InitializeDevice);
+
+		// Notify that the initialization is complete.
+		::SetEvent(pThis->_InitializedEvent);
+	}
+
+	HRESULT SampleAllocator::GetSample(IMFSample** ppSample, DWORD dwTimeout)
 	{
 		HRESULT hr = S_OK;
 
+		// If the textures are being created in the background, wait for them.
+		if (FAILED(hr = this->WaitForInitialized()))
+			return hr;
+
 		// Have we already shutdown?
 		if (FAILED(hr = this->CheckShutdown()))
 			return hr;
@@ -105,38 +342,37 @@ namespace D3D11TextureMediaSink
 		// Look for an available sample.
 		while (TRUE)
 		{
-			int status[SAMPLE_MAX];
+			BOOL ready[SAMPLE_MAX];
 
 			{
 				AutoLock lock(&this->_csSampleAllocator);
 
 				for (int i = 0; i < SAMPLE_MAX; i++)
 				{
-					// If the value of the SAMPLE_STATE attribute is READY, the sample is available.
-
-					UINT32 state;
-					if (FAILED(hr = this->_SampleQueue[i]->GetUINT32(SAMPLE_STATE, &state)))
-						return hr;
-
-					status[i] = state;
+					// If the state of the sample is READY, the sample is available.
+					ready[i] = (this->_Descriptors[i].State == SAMPLE_STATE_READY);
+				}
 
-					if (state == SAMPLE_STATE_READY)
-					{
-						*ppSample = this->_SampleQueue[i];	// The sample is available, so lend it out.
-						(*ppSample)->AddRef();
+				// Prefer the ones the GPU is done with.
+				int index = this->_Fences.Select(ready, SAMPLE_MAX);
+				if (index >= 0)
+				{
+					*ppSample = this->_SampleQueue[index];	// The sample is available, so lend it out.
+					(*ppSample)->AddRef();
+					::InterlockedExchange(&this->_Descriptors[index].State, SAMPLE_STATE_UPDATING);
+					this->_Descriptors[index].SegmentStart = FALSE;
 
-						//TCHAR buf[1024];
-						//wsprintf(buf, L"SampleAllocator::GetSample - [%d](%X)OK!\n", i, *ppSample);
-						//OutputDebugString(buf);
+					//TCHAR buf[1024];
+					//wsprintf(buf, L"SampleAllocator::GetSample - [%d](%X)OK!\n", index, *ppSample);
+					//OutputDebugString(buf);
 
-						return S_OK;
-					}
+					return S_OK;
 				}
 
 			} // end of the lock scope
 
 			// If there are no available samples, wait until one becomes available.
-			if (::WaitForSingleObject(this->_FreeSampleAvailable, 5000) == WAIT_TIMEOUT)
+			if (::WaitForSingleObject(this->_FreeSampleAvailable, dwTimeout) == WAIT_TIMEOUT)
 				break;	 // If the wait times out, give up and return an error.
 		}
 
@@ -145,40 +381,172 @@ namespace D3D11TextureMediaSink
 	}
 	HRESULT SampleAllocator::ReleaseSample(IMFSample* pSample)
 	{
+		HRESULT hr = MF_E_NOT_FOUND;
+		IUnknown* pSource = NULL;
+
+		// scope for lock
+		{
+			AutoLock lock(&this->_csSampleAllocator);
+
+			// Is the allocator shut down?
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			if (NULL == pSample)
+				return E_POINTER;
+
+			hr = MF_E_NOT_FOUND;
+
+			// Look for the sample that was lent out.
+			for (int i = 0; i < SAMPLE_MAX; i++)
+			{
+				if (this->_SampleQueue[i] == pSample)
+				{
+					//pSample->Release();	--> Not releasing since we will reuse it.
+
+					// If it was presenting the decoder's buffer, put its own buffer back.
+					pSource = this->DetachPassthrough(i);
+
+					// Never written; the consumer keeps what it had.
+					if (this->_Shared)
+						this->_SharedRing.AbortWrite(i);
+
+					// Reset the state to READY.
+					::InterlockedExchange(&this->_Descriptors[i].State, SAMPLE_STATE_READY);
+					this->_Fences.Released(i);
+
+					//TCHAR buf[1024];
+					//wsprintf(buf, L"SampleAllocator::ReleaseSample - [%d]OK!\n", i);
+					//OutputDebugString(buf);
+
+					// Notify that a sample is available.
+					::SetEvent(this->_FreeSampleAvailable);
+
+					hr = S_OK;
+					break;
+				}
+			}
+		}
+
+		// Give the input sample back to the decoder outside of the lock.
+		SafeRelease(pSource);
+
+		//if (hr == MF_E_NOT_FOUND) OutputDebugString(L"SampleAllocator::ReleaseSample - No Sample...\n");
+		return hr;	// MF_E_NOT_FOUND: The sample is not from our allocator.
+	}
+	void SampleAllocator::SetShared(BOOL bShared)
+	{
+		this->_Shared = bShared;
+	}
+	BOOL SampleAllocator::IsShared()
+	{
+		return this->_Shared;
+	}
+	HRESULT SampleAllocator::BeginWrite(IMFSample* pSample)
+	{
+		if (!this->_Shared)
+			return S_OK;
+
 		AutoLock lock(&this->_csSampleAllocator);
 
-		HRESULT hr = S_OK;
+		HRESULT hr;
 
-		// Is the allocator shut down?
 		if (FAILED(hr = this->CheckShutdown()))
 			return hr;
 
-		if (NULL == pSample)
-			return E_POINTER;
-
-		// Look for the sample that was lent out.
 		for (int i = 0; i < SAMPLE_MAX; i++)
 		{
 			if (this->_SampleQueue[i] == pSample)
-			{
-				//pSample->Release();	--> Not releasing since we will reuse it.
+				return this->_SharedRing.BeginWrite(i);
+		}
 
-				// Reset the SAMPLE_STATE attribute to READY.
-				if (FAILED(hr = pSample->SetUINT32(SAMPLE_STATE, SAMPLE_STATE_READY)))
-					return hr;
+		return MF_E_NOT_FOUND;
+	}
+	HRESULT SampleAllocator::EndWrite(IMFSample* pSample)
+	{
+		if (!this->_Shared)
+			return S_OK;
 
-				//TCHAR buf[1024];
-				//wsprintf(buf, L"SampleAllocator::ReleaseSample - [%d]OK!\n", i);
-				//OutputDebugString(buf);
+		AutoLock lock(&this->_csSampleAllocator);
 
-				// Notify that a sample is available.
-				::SetEvent(this->_FreeSampleAvailable);
+		HRESULT hr;
 
-				return S_OK;
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		for (int i = 0; i < SAMPLE_MAX; i++)
+		{
+			if (this->_SampleQueue[i] != pSample)
+				continue;
+
+			UINT64 sequence = 0;
+			if (FAILED(hr = this->_SharedRing.EndWrite(i, &sequence)))
+				return hr;
+
+			this->_Descriptors[i].Frame.SharedSequence = sequence;
+			return pSample->SetUINT64(TMS_SAMPLE_SHARED_SEQUENCE, sequence);
+		}
+
+		return MF_E_NOT_FOUND;
+	}
+	HRESULT SampleAllocator::SignalFence(IMFSample* pSample)
+	{
+		AutoLock lock(&this->_csSampleAllocator);
+
+		HRESULT hr;
+
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		for (int i = 0; i < SAMPLE_MAX; i++)
+		{
+			if (this->_SampleQueue[i] != pSample)
+				continue;
+
+			return this->_Fences.Signal(i);
+		}
+
+		return MF_E_NOT_FOUND;
+	}
+	void SampleAllocator::PollFences()
+	{
+		AutoLock lock(&this->_csSampleAllocator);
+
+		if (this->_IsShutdown)
+			return;
+
+		this->_Fences.Poll();
+	}
+	HRESULT SampleAllocator::AttachPassthrough(IMFSample* pSample, IMFSample* pSourceSample, IMFMediaBuffer* pSourceBuffer)
+	{
+		AutoLock lock(&this->_csSampleAllocator);
+
+		HRESULT hr = S_OK;
+
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		if (NULL == pSample || NULL == pSourceSample || NULL == pSourceBuffer)
+			return E_POINTER;
+
+		for (int i = 0; i < SAMPLE_MAX; i++)
+		{
+			if (this->_SampleQueue[i] != pSample)
+				continue;
+
+			// Present the decoder's buffer instead of our texture. The input sample is kept alive (and out of the decoder's hands) until the sample comes back.
+			if (FAILED(hr = pSample->RemoveAllBuffers()) ||
+				FAILED(hr = pSample->AddBuffer(pSourceBuffer)) ||
+				FAILED(hr = pSample->SetUnknown(SAMPLE_PASSTHROUGH_SOURCE, pSourceSample)))
+			{
+				IUnknown* pSource = this->DetachPassthrough(i);
+				SafeRelease(pSource);
+				return hr;
 			}
+
+			return S_OK;
 		}
 
-		//OutputDebugString(L"SampleAllocator::ReleaseSample - No Sample...\n");
-		return MF_E_NOT_FOUND;	// The sample is not from our allocator.
+		return MF_E_NOT_FOUND;
 	}
 }
@@ -1,33 +1,90 @@
 #pragma once
 
-// {FD13125A-546C-4271-98DC-CA2058682AC7}
-// Custom attribute (uint) for IMFSample
-DEFINE_GUID(SAMPLE_STATE, 0xfd13125a, 0x546c, 0x4271, 0x98, 0xdc, 0xca, 0x20, 0x58, 0x68, 0x2a, 0xc7);
+// State of a sample (FrameDescriptor::State)
 #define SAMPLE_STATE_READY		0	// Unused
 #define SAMPLE_STATE_UPDATING	1	// Updating
 #define SAMPLE_STATE_SCHEDULED	2	// Scheduled
 #define SAMPLE_STATE_PRESENT	3	// Presenting
 
+// {49159EF5-AE34-42C5-A1FD-19B9081D9C2F}
+// Custom attribute (IUnknown) for IMFSample; the input sample whose buffer is presented in passthrough mode.
+DEFINE_GUID(SAMPLE_PASSTHROUGH_SOURCE, 0x49159ef5, 0xae34, 0x42c5, 0xa1, 0xfd, 0x19, 0xb9, 0x08, 0x1d, 0x9c, 0x2f);
+
 #define SAMPLE_MAX		5
 
 namespace D3D11TextureMediaSink
 {
+	// What the sink knows about a sample of the allocator. One per sample, for the lifetime of the allocator, so that the frame
+	// path never goes through the attribute store of the sample. The attributes are set on the sample only for the consumer.
+	struct FrameDescriptor
+	{
+		volatile LONG State;		// SAMPLE_STATE_*
+		volatile LONG Epoch;		// The scheduler epoch in which the sample was scheduled.
+		UINT64 Sequence;			// Order in which the sample was queued by the scheduler; 0 when not queued. (Under Scheduler::_csDrain)
+		BOOL SegmentStart;			// The first frame after an end-of-segment marker. (TMS_SEGMENT_GAP)
+		TMS_FRAME_DESCRIPTOR Frame;	// Written while the sample is UPDATING; read once it is scheduled.
+	};
+
 	class SampleAllocator
 	{
 	public:
-		SampleAllocator();
+		SampleAllocator(TextureMemoryBudget* pBudget = NULL, DWORD streamId = 0);
 		~SampleAllocator();
 
-		HRESULT Initialize(ID3D11Device* pD3DDevice, int width, int height);
+		void SetShared(BOOL bShared);	// Before Initialize.
+		BOOL IsShared();
+		HRESULT Initialize(ID3D11Device* pD3DDevice, int width, int height, DXGI_FORMAT format);
+		HRESULT InitializeAsync(ID3D11Device* pD3DDevice, int width, int height, DXGI_FORMAT format);
+		HRESULT WaitForInitialized();	// Waits for the textures being built in the background, if any.
 		HRESULT Shutdown();
-		HRESULT GetSample(IMFSample** ppSample);
+		HRESULT GetSample(IMFSample** ppSample, DWORD dwTimeout = 5000);	// dwTimeout: milliseconds to wait for a free sample.
 		HRESULT ReleaseSample(IMFSample* pSample);
+		HRESULT AttachPassthrough(IMFSample* pSample, IMFSample* pSourceSample, IMFMediaBuffer* pSourceBuffer);
+		HRESULT BeginWrite(IMFSample* pSample);		// Shared textures: S_FALSE if the consumer is reading it. (Context lock held.)
+		HRESULT EndWrite(IMFSample* pSample);		// Shared textures: hands it to the consumer. (Context lock held.)
+		HRESULT SignalFence(IMFSample* pSample);	// The consumer is done with the sample; mark the point on the GPU. (Context lock held.)
+		void PollFences();							// Learn which marked points the GPU has passed. (Context lock held.)
+		DWORD GetOutstandingCount();
+		FrameDescriptor* GetDescriptor(IMFSample* pSample);	// NULL if the sample is not from this allocator.
+
+		static UINT64 GetTotalBytes(UINT32 width, UINT32 height, DXGI_FORMAT format);
 
 	private:
+		const DWORD ALLOCATOR_TIMEOUT = 5000; // 5 seconds
+
 		BOOL _IsShutdown = TRUE;
 		IMFSample* _SampleQueue[SAMPLE_MAX];
+		IMFMediaBuffer* _OwnBuffers[SAMPLE_MAX];	// The buffer of each sample's own texture, to restore after passthrough.
+		FrameDescriptor _Descriptors[SAMPLE_MAX];
 		CriticalSection _csSampleAllocator;
 		HANDLE _FreeSampleAvailable;
+
+		// GPU completion of the consumer's work on each sample.
+		SampleFenceList _Fences;
+
+		// Sharing with another process or device.
+		BOOL _Shared = FALSE;
+		HANDLE _SharedHandles[SAMPLE_MAX];
+		SharedFrameRing _SharedRing;
+
+		// Memory accounting.
+		TextureMemoryBudget* _Budget;
+		DWORD _StreamId;
+		UINT64 _ReservedBytes = 0;
+
+		// Asynchronous initialization.
+		PTP_WORK _InitializeWork = NULL;
+		HANDLE _InitializedEvent;			// Manual-reset; signaled while no initialization is in progress.
+		HRESULT _InitializeResult = S_OK;
+		ID3D11Device* _InitializeDevice = NULL;
+		int _InitializeWidth = 0;
+		int _InitializeHeight = 0;
+		DXGI_FORMAT _InitializeFormat = DXGI_FORMAT_UNKNOWN;
+
 		HRESULT CheckShutdown();
+		IUnknown* DetachPassthrough(int index);
+		HRESULT InitializeShared(int index, ID3D11Texture2D* pTexture, IMFSample* pSample);
+		void ReleaseShared();
+		static void CALLBACK InitializeProcProxy(PTP_CALLBACK_INSTANCE pInstance, void* arg, PTP_WORK pWork);
 	};
 }
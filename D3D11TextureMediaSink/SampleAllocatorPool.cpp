@@ -0,0 +1,241 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	SampleAllocatorPool::SampleAllocatorPool()
+	{
+	}
+	SampleAllocatorPool::~SampleAllocatorPool()
+	{
+		this->Shutdown();
+	}
+
+	void SampleAllocatorPool::SetMemoryBudget(TextureMemoryBudget* pBudget, DWORD streamId)
+	{
+		AutoLock lock(&this->_csPool);
+
+		this->_MemoryBudget = pBudget;
+		this->_StreamId = streamId;
+	}
+	void SampleAllocatorPool::SetCacheBudget(UINT64 budgetBytes)
+	{
+		AutoLock lock(&this->_csPool);
+
+		this->_Cache.SetBudget(budgetBytes);
+	}
+	void SampleAllocatorPool::SetShared(BOOL bShared)
+	{
+		AutoLock lock(&this->_csPool);
+
+		this->_Shared = bShared;
+	}
+	HRESULT SampleAllocatorPool::Activate(ID3D11Device* pD3DDevice, UINT32 width, UINT32 height, DXGI_FORMAT format)
+	{
+		HRESULT hr = S_OK;
+		Entry* pEntry = NULL;
+
+		if (FAILED(hr = this->Acquire(pD3DDevice, width, height, format, &pEntry)))
+			return hr;
+
+		{
+			AutoLock lock(&this->_csPool);
+
+			// Make it current. The previous current entry stays in the cache.
+			this->_Cache.SetCurrent(pEntry);
+		}
+
+		// The cache may have grown beyond the budget.
+		this->Trim();
+
+		return S_OK;
+	}
+	HRESULT SampleAllocatorPool::Acquire(ID3D11Device* pD3DDevice, UINT32 width, UINT32 height, DXGI_FORMAT format, Entry** ppEntry)
+	{
+		if (NULL == pD3DDevice || NULL == ppEntry)
+			return E_POINTER;
+
+		if (width == 0 || height == 0)
+			return E_INVALIDARG;
+
+		AutoLock lock(&this->_csPool);
+
+		HRESULT hr = S_OK;
+
+		// Is it already in the cache?
+		Entry* pEntry = static_cast<Entry*>(this->_Cache.Find(width, height, format, this->_Shared));
+		if (NULL != pEntry)
+		{
+			*ppEntry = pEntry;
+			return S_OK;
+		}
+
+		// Create a new entry. The textures are built in the background, and the caller does not wait for them.
+		pEntry = new Entry();
+		ZeroMemory(pEntry, sizeof(Entry));
+		pEntry->Width = width;
+		pEntry->Height = height;
+		pEntry->Format = format;
+		pEntry->OutputWidth = AlignOutputSize(format, width);
+		pEntry->OutputHeight = AlignOutputSize(format, height);
+		pEntry->Allocator = new SampleAllocator(this->_MemoryBudget, this->_StreamId);
+		pEntry->Shared = this->_Shared;
+		pEntry->Allocator->SetShared(pEntry->Shared);
+
+		// If the memory budget asks for it, scale the output down.
+		if (NULL != this->_MemoryBudget)
+		{
+			UINT32 divisor = this->_MemoryBudget->GetOutputDivisor(SampleAllocator::GetTotalBytes(width, height, format));
+			if (divisor > 1)
+			{
+				pEntry->OutputWidth = max(2U, (width / divisor) & ~1);		// Keep it even for the planar formats.
+				pEntry->OutputHeight = max(2U, (height / divisor) & ~1);	//
+			}
+		}
+
+		pEntry->Bytes = SampleAllocator::GetTotalBytes(pEntry->OutputWidth, pEntry->OutputHeight, format);
+
+		if (FAILED(hr = pEntry->Allocator->InitializeAsync(pD3DDevice, pEntry->OutputWidth, pEntry->OutputHeight, format)) ||
+			FAILED(hr = this->_Cache.Insert(pEntry)))
+		{
+			this->DeleteEntry(pEntry);
+			return hr;
+		}
+
+		*ppEntry = pEntry;
+		return S_OK;
+	}
+	SampleAllocatorPool::Entry* SampleAllocatorPool::GetCurrent()
+	{
+		AutoLock lock(&this->_csPool);
+
+		return static_cast<Entry*>(this->_Cache.GetCurrent());
+	}
+	HRESULT SampleAllocatorPool::ReleaseSample(IMFSample* pSample)
+	{
+		AutoLock lock(&this->_csPool);
+
+		HRESULT hr;
+		Entry* pCurrent = static_cast<Entry*>(this->_Cache.GetCurrent());
+
+		// Most samples belong to the current entry.
+		if (NULL != pCurrent)
+		{
+			if ((hr = pCurrent->Allocator->ReleaseSample(pSample)) != MF_E_NOT_FOUND)
+				return hr;
+		}
+
+		// Otherwise, look for the entry that owns it.
+		// Note: The entries are not destroyed here, even if they are drained. That is left to Trim.
+		for (SamplePoolCacheItem* pItem = this->_Cache.Front(); pItem != NULL; pItem = this->_Cache.Next(pItem))
+		{
+			Entry* pEntry = static_cast<Entry*>(pItem);
+			if (pEntry == pCurrent)
+				continue;
+
+			if ((hr = pEntry->Allocator->ReleaseSample(pSample)) != MF_E_NOT_FOUND)
+				return hr;
+		}
+
+		return MF_E_NOT_FOUND;	// The sample is not from our allocators.
+	}
+	FrameDescriptor* SampleAllocatorPool::GetDescriptor(IMFSample* pSample)
+	{
+		AutoLock lock(&this->_csPool);
+
+		FrameDescriptor* pDescriptor;
+		Entry* pCurrent = static_cast<Entry*>(this->_Cache.GetCurrent());
+
+		if (NULL != pCurrent)
+		{
+			if (NULL != (pDescriptor = pCurrent->Allocator->GetDescriptor(pSample)))
+				return pDescriptor;
+		}
+
+		// An entry with samples lent out is not destroyed, so the descriptor stays valid until the sample comes back.
+		for (SamplePoolCacheItem* pItem = this->_Cache.Front(); pItem != NULL; pItem = this->_Cache.Next(pItem))
+		{
+			Entry* pEntry = static_cast<Entry*>(pItem);
+			if (pEntry == pCurrent)
+				continue;
+
+			if (NULL != (pDescriptor = pEntry->Allocator->GetDescriptor(pSample)))
+				return pDescriptor;
+		}
+
+		return NULL;
+	}
+	HRESULT SampleAllocatorPool::SignalFence(IMFSample* pSample)
+	{
+		AutoLock lock(&this->_csPool);
+
+		HRESULT hr;
+		Entry* pCurrent = static_cast<Entry*>(this->_Cache.GetCurrent());
+
+		if (NULL != pCurrent)
+		{
+			if ((hr = pCurrent->Allocator->SignalFence(pSample)) != MF_E_NOT_FOUND)
+				return hr;
+		}
+
+		for (SamplePoolCacheItem* pItem = this->_Cache.Front(); pItem != NULL; pItem = this->_Cache.Next(pItem))
+		{
+			Entry* pEntry = static_cast<Entry*>(pItem);
+			if (pEntry == pCurrent)
+				continue;
+
+			if ((hr = pEntry->Allocator->SignalFence(pSample)) != MF_E_NOT_FOUND)
+				return hr;
+		}
+
+		return MF_E_NOT_FOUND;
+	}
+	void SampleAllocatorPool::PollFences()
+	{
+		AutoLock lock(&this->_csPool);
+
+		// Only the current entry gives out new samples in the steady state.
+		Entry* pCurrent = static_cast<Entry*>(this->_Cache.GetCurrent());
+		if (NULL != pCurrent)
+			pCurrent->Allocator->PollFences();
+	}
+	void SampleAllocatorPool::Trim()
+	{
+		AutoLock lock(&this->_csPool);
+
+		BOOL bOverMemoryBudget = (NULL != this->_MemoryBudget && this->_MemoryBudget->IsOverBudget());
+
+		SamplePoolCacheItem* pVictim;
+		while (NULL != (pVictim = this->_Cache.TakeVictim(bOverMemoryBudget, this)))
+			this->DeleteEntry(static_cast<Entry*>(pVictim));
+	}
+	void SampleAllocatorPool::Shutdown()
+	{
+		AutoLock lock(&this->_csPool);
+
+		SamplePoolCacheItem* pItem;
+		while (NULL != (pItem = this->_Cache.TakeFront()))
+			this->DeleteEntry(static_cast<Entry*>(pItem));
+	}
+
+	// SamplePoolCacheTarget
+
+	UINT SampleAllocatorPool::GetOutstandingCount(SamplePoolCacheItem* pItem)
+	{
+		return static_cast<Entry*>(pItem)->Allocator->GetOutstandingCount();
+	}
+
+	// private
+
+	void SampleAllocatorPool::DeleteEntry(Entry* pEntry)
+	{
+		if (NULL == pEntry)
+			return;
+
+		delete pEntry->Allocator;	// Shuts down the allocator.
+		for (int i = 0; i < SAMPLE_MAX; i++)
+			SafeRelease(pEntry->OutputViews[i]);
+		SafeRelease(pEntry->Processor);
+		SafeRelease(pEntry->ProcessorEnum);
+		delete pEntry;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// A set of SampleAllocators keyed by (width, height, format).
+	// When the media type changes, the pool of the previous size is kept (together with its video processor),
+	// so that switching back to a recently used size does not create any textures. Pools that are not current
+	// are destroyed in least-recently-used order when their total size exceeds the cache budget (SamplePoolCache).
+	//
+	class SampleAllocatorPool : public SamplePoolCacheTarget
+	{
+	public:
+		// Entry of the pool. The size of the input frames and the format are in SamplePoolCacheItem.
+		struct Entry : public SamplePoolCacheItem
+		{
+			UINT32 OutputWidth;		// Size of the output textures. Smaller than the input if the memory budget lowered it.
+			UINT32 OutputHeight;	//
+			SampleAllocator* Allocator;
+			ID3D11VideoProcessorEnumerator* ProcessorEnum;	// Video processor for this size. Created lazily by the presenter.
+			ID3D11VideoProcessor* Processor;				//
+			UINT PastFrames;								// Reference frames needed by the processor.
+			UINT FutureFrames;								//
+			ID3D11Texture2D* ViewTextures[SAMPLE_MAX];					// Output views of the textures, cached. (Each view holds its texture.)
+			ID3D11VideoProcessorOutputView* OutputViews[SAMPLE_MAX];	//
+			VideoProcessorStateCache StreamState;			// The state last set on the video processor; set again only when it changes.
+		};
+
+		SampleAllocatorPool();
+		~SampleAllocatorPool();
+
+		void SetMemoryBudget(TextureMemoryBudget* pBudget, DWORD streamId);
+		void SetCacheBudget(UINT64 budgetBytes);
+		void SetShared(BOOL bShared);	// For the entries created from now on. Entries are not shared between the two modes.
+		HRESULT Activate(ID3D11Device* pD3DDevice, UINT32 width, UINT32 height, DXGI_FORMAT format);	// Gets or creates the entry and makes it current.
+		HRESULT Acquire(ID3D11Device* pD3DDevice, UINT32 width, UINT32 height, DXGI_FORMAT format, Entry** ppEntry);
+		Entry* GetCurrent();
+		HRESULT ReleaseSample(IMFSample* pSample);
+		HRESULT SignalFence(IMFSample* pSample);
+		FrameDescriptor* GetDescriptor(IMFSample* pSample);	// Valid while the sample is lent out. NULL if it is not from our allocators.
+		void PollFences();
+		void Trim();	// Destroys entries, so it must be called only from the (serialized) processing path; never from ReleaseSample.
+		void Shutdown();
+
+		// SamplePoolCacheTarget
+		UINT GetOutstandingCount(SamplePoolCacheItem* pItem);
+
+	private:
+		SamplePoolCache _Cache;							// The entries. The one of the current media type is never destroyed by Trim.
+		BOOL _Shared = FALSE;
+		TextureMemoryBudget* _MemoryBudget = NULL;
+		DWORD _StreamId = 0;
+		CriticalSection _csPool;
+
+		void DeleteEntry(Entry* pEntry);
+	};
+}
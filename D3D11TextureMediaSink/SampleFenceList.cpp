@@ -0,0 +1,89 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	SampleFenceList::SampleFenceList()
+	{
+	}
+	SampleFenceList::~SampleFenceList()
+	{
+		this->Clear();
+	}
+
+	void SampleFenceList::Attach(UINT index, GpuFence* pFence)
+	{
+		if (index >= SAMPLE_FENCE_MAX)
+		{
+			delete pFence;
+			return;
+		}
+
+		if (NULL != this->_Slots[index].Fence)
+			delete this->_Slots[index].Fence;
+
+		this->_Slots[index].Fence = pFence;
+		this->_Slots[index].Signaled = FALSE;
+		this->_Slots[index].ReleaseOrder = 0;
+	}
+	void SampleFenceList::Clear()
+	{
+		for (UINT i = 0; i < SAMPLE_FENCE_MAX; i++)
+		{
+			if (NULL != this->_Slots[i].Fence)
+				delete this->_Slots[i].Fence;
+		}
+		ZeroMemory(this->_Slots, sizeof(this->_Slots));
+		this->_ReleaseCounter = 0;
+	}
+
+	void SampleFenceList::Released(UINT index)
+	{
+		if (index < SAMPLE_FENCE_MAX)
+			this->_Slots[index].ReleaseOrder = ++this->_ReleaseCounter;
+	}
+	HRESULT SampleFenceList::Signal(UINT index)
+	{
+		if (index >= SAMPLE_FENCE_MAX)
+			return E_INVALIDARG;
+
+		if (NULL == this->_Slots[index].Fence)
+			return S_FALSE;	// Not supported; always taken as completed.
+
+		HRESULT hr;
+		if (FAILED(hr = this->_Slots[index].Fence->Signal()))
+			return hr;
+
+		this->_Slots[index].Signaled = TRUE;
+		return S_OK;
+	}
+	void SampleFenceList::Poll()
+	{
+		for (UINT i = 0; i < SAMPLE_FENCE_MAX; i++)
+		{
+			if (this->_Slots[i].Signaled && this->_Slots[i].Fence->IsCompleted())
+				this->_Slots[i].Signaled = FALSE;
+		}
+	}
+	BOOL SampleFenceList::IsCompleted(UINT index)
+	{
+		return (index < SAMPLE_FENCE_MAX) ? !this->_Slots[index].Signaled : TRUE;
+	}
+	int SampleFenceList::Select(const BOOL* pReady, UINT count)
+	{
+		int bestCompleted = -1;
+		int bestAny = -1;
+		for (UINT i = 0; i < count && i < SAMPLE_FENCE_MAX; i++)
+		{
+			if (!pReady[i])
+				continue;
+
+			const Slot& slot = this->_Slots[i];
+			if (bestAny < 0 || slot.ReleaseOrder < this->_Slots[bestAny].ReleaseOrder)
+				bestAny = (int)i;
+			if (!slot.Signaled && (bestCompleted < 0 || slot.ReleaseOrder < this->_Slots[bestCompleted].ReleaseOrder))
+				bestCompleted = (int)i;
+		}
+
+		return (bestCompleted >= 0) ? bestCompleted : bestAny;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#define SAMPLE_FENCE_MAX		16	// Maximum number of samples.
+
+namespace D3D11TextureMediaSink
+{
+	// The fences of the samples of an allocator, and the order in which the samples came back to it.
+	// Picks the free sample to write next: the one that came back first among those the GPU is done with, or if there are none,
+	// the one that came back first. Writing to a sample the GPU is still reading is correct on the same device, but makes the
+	// GPU wait for the consumer.
+	// Not thread safe; the allocator calls it under its own lock.
+	//
+	class SampleFenceList
+	{
+	public:
+		SampleFenceList();
+		~SampleFenceList();
+
+		void Attach(UINT index, GpuFence* pFence);	// Takes ownership. NULL: no fence, the sample is always taken as completed.
+		void Clear();								// Deletes all the fences.
+
+		void Released(UINT index);		// The sample came back to the allocator.
+		HRESULT Signal(UINT index);		// The consumer is done with the sample. S_FALSE if it has no fence.
+		void Poll();					// Learns which fences the GPU has passed.
+		BOOL IsCompleted(UINT index);	// As of the last Poll.
+		int Select(const BOOL* pReady, UINT count);	// The free sample to write next, among the ready ones; -1 if none is ready.
+
+	private:
+		struct Slot
+		{
+			GpuFence* Fence;
+			BOOL Signaled;			// Signaled, and the GPU had not passed it at the last Poll.
+			UINT64 ReleaseOrder;	// Value of _ReleaseCounter when the sample came back.
+		};
+
+		Slot _Slots[SAMPLE_FENCE_MAX] = {};
+		UINT64 _ReleaseCounter = 0;
+	};
+}
@@ -0,0 +1,119 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	SamplePoolCache::SamplePoolCache()
+	{
+	}
+	SamplePoolCache::~SamplePoolCache()
+	{
+	}
+
+	void SamplePoolCache::SetBudget(UINT64 budgetBytes)
+	{
+		this->_Budget = budgetBytes;
+	}
+	UINT64 SamplePoolCache::GetBudget()
+	{
+		return this->_Budget;
+	}
+
+	SamplePoolCacheItem* SamplePoolCache::Find(UINT32 width, UINT32 height, DXGI_FORMAT format, BOOL bShared)
+	{
+		for (SamplePoolCacheItem* pItem = this->_Items.Front(); pItem != NULL; pItem = this->_Items.Next(pItem))
+		{
+			if (pItem->Width == width && pItem->Height == height && pItem->Format == format && pItem->Shared == bShared)
+			{
+				pItem->LastUsed = ++this->_UseCounter;
+				return pItem;
+			}
+		}
+
+		return NULL;
+	}
+	HRESULT SamplePoolCache::Insert(SamplePoolCacheItem* pItem)
+	{
+		if (NULL == pItem)
+			return E_POINTER;
+
+		pItem->LastUsed = ++this->_UseCounter;
+		return this->_Items.InsertBack(pItem);
+	}
+	void SamplePoolCache::SetCurrent(SamplePoolCacheItem* pItem)
+	{
+		this->_Current = pItem;
+	}
+	SamplePoolCacheItem* SamplePoolCache::GetCurrent()
+	{
+		return this->_Current;
+	}
+
+	SamplePoolCacheItem* SamplePoolCache::Front()
+	{
+		return this->_Items.Front();
+	}
+	SamplePoolCacheItem* SamplePoolCache::Next(SamplePoolCacheItem* pItem)
+	{
+		return this->_Items.Next(pItem);
+	}
+	UINT SamplePoolCache::GetCount()
+	{
+		return this->_Items.GetCount();
+	}
+	UINT64 SamplePoolCache::GetCachedBytes()
+	{
+		UINT64 bytes = 0;
+		for (SamplePoolCacheItem* pItem = this->_Items.Front(); pItem != NULL; pItem = this->_Items.Next(pItem))
+		{
+			if (pItem != this->_Current)
+				bytes += pItem->Bytes;
+		}
+
+		return bytes;
+	}
+
+	SamplePoolCacheItem* SamplePoolCache::TakeVictim(BOOL bOverMemoryBudget, SamplePoolCacheTarget* pTarget)
+	{
+		if (NULL == pTarget)
+			return NULL;
+
+		// When the memory budget is exceeded, no pools of the other sizes are cached at all.
+		UINT64 budget = bOverMemoryBudget ? 0 : this->_Budget;
+
+		// Total size of the pools that are not current, and the least recently used one of them that can be destroyed.
+		UINT64 cachedBytes = 0;
+		SamplePoolCacheItem* pVictim = NULL;
+
+		for (SamplePoolCacheItem* pItem = this->_Items.Front(); pItem != NULL; pItem = this->_Items.Next(pItem))
+		{
+			if (pItem == this->_Current)
+				continue;
+
+			cachedBytes += pItem->Bytes;
+
+			// Pools with samples still lent out are kept until they come back.
+			if (0 != pTarget->GetOutstandingCount(pItem))
+				continue;
+
+			if (NULL == pVictim || pItem->LastUsed < pVictim->LastUsed)
+				pVictim = pItem;
+		}
+
+		if (cachedBytes <= budget || NULL == pVictim)
+			return NULL;	// Within the budget, or nothing can be destroyed right now.
+
+		this->_Items.Remove(pVictim);
+		return pVictim;
+	}
+	SamplePoolCacheItem* SamplePoolCache::TakeFront()
+	{
+		SamplePoolCacheItem* pItem = NULL;
+		if (FAILED(this->_Items.RemoveFront(&pItem)))
+			return NULL;
+
+		if (pItem == this->_Current)
+			this->_Current = NULL;
+
+		return pItem;
+	}
+}
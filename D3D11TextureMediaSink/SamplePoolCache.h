@@ -0,0 +1,58 @@
+#pragma once
+
+// Default memory budget for the pools of sizes that are not current (bytes).
+#define POOL_CACHE_BUDGET_DEFAULT	(256ULL * 1024 * 1024)
+
+namespace D3D11TextureMediaSink
+{
+	// A sample pool of one frame size, as far as the cache goes. Derive the pool from it.
+	struct SamplePoolCacheItem : public IntrusiveListEntry
+	{
+		UINT32 Width;			// Size of the input frames.
+		UINT32 Height;			//
+		DXGI_FORMAT Format;
+		BOOL Shared;			// The textures are shared with another process or device.
+		UINT64 Bytes;			// Size of the textures of the pool.
+		UINT64 LastUsed;		// Value of the use counter when the pool was last used.
+	};
+
+	struct SamplePoolCacheTarget
+	{
+		virtual ~SamplePoolCacheTarget() {}
+
+		virtual UINT GetOutstandingCount(SamplePoolCacheItem* pItem) = 0;	// Samples of the pool still lent out.
+	};
+
+	// The sample pools kept per frame size, and the order in which those that are not current are destroyed:
+	// least recently used first, once their total size exceeds the budget, and never while samples are lent out.
+	// Not thread safe; SampleAllocatorPool calls it under _csPool.
+	//
+	class SamplePoolCache
+	{
+	public:
+		SamplePoolCache();
+		~SamplePoolCache();
+
+		void SetBudget(UINT64 budgetBytes);
+		UINT64 GetBudget();
+
+		SamplePoolCacheItem* Find(UINT32 width, UINT32 height, DXGI_FORMAT format, BOOL bShared);	// Marks it used. NULL if none.
+		HRESULT Insert(SamplePoolCacheItem* pItem);	// Marks it used.
+		void SetCurrent(SamplePoolCacheItem* pItem);	// The current pool is never destroyed.
+		SamplePoolCacheItem* GetCurrent();
+
+		SamplePoolCacheItem* Front();	// The pools in the order inserted.
+		SamplePoolCacheItem* Next(SamplePoolCacheItem* pItem);
+		UINT GetCount();
+		UINT64 GetCachedBytes();		// Of the pools that are not current.
+
+		SamplePoolCacheItem* TakeVictim(BOOL bOverMemoryBudget, SamplePoolCacheTarget* pTarget);	// The next pool to destroy, removed. NULL if none.
+		SamplePoolCacheItem* TakeFront();	// Removed, current or not. NULL when empty.
+
+	private:
+		IntrusiveList<SamplePoolCacheItem> _Items;
+		SamplePoolCacheItem* _Current = NULL;
+		UINT64 _UseCounter = 0;
+		UINT64 _Budget = POOL_CACHE_BUDGET_DEFAULT;
+	};
+}
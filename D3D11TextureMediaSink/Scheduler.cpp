@@ -2,20 +2,21 @@
 
 namespace D3D11TextureMediaSink
 {
-	Scheduler::Scheduler(CriticalSection* critSec)
+	Scheduler::Scheduler()
 	{
 		this->_presentationSampleQueue = new ThreadSafeComPtrQueue<IMFSample>();
 		this->_ScheduleEventQueue = new ThreadSafePtrQueue<ScheduleEvent>();
-		this->_csStreamSinkAndScheduler = critSec;
 		this->_frameInterval = 0;
 		this->_quarterFrameInterval = 0;
 
 		this->_MsgEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
-		this->_FlushCompleteEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+		this->_FrameDoneEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
 	}
 	Scheduler::~Scheduler()
 	{
 		this->Stop();
+
+		::CloseHandle(this->_FrameDoneEvent);
 	}
 
 	HRESULT Scheduler::SetFrameRate(const MFRatio& fps)
@@ -41,93 +42,251 @@ namespace D3D11TextureMediaSink
 
 	HRESULT Scheduler::Start(IMFClock* pClock)
 	{
-		HRESULT hr = S_OK;
+		AutoLock lockThread(&this->_csThread);
+
+		{
+			AutoLock lock(&this->_csScheduler);
+
+			// Update the presentation clock.
+			SafeRelease(this->_PresentationClock);
+			this->_PresentationClock = pClock;
+			if (NULL != this->_PresentationClock)
+				this->_PresentationClock->AddRef();
 
-		// Update the presentation clock.
-		SafeRelease(this->_PresentationClock);
-		this->_PresentationClock = pClock;
-		if (NULL != this->_PresentationClock)
-			this->_PresentationClock->AddRef();
+			// The frame rate conversion starts over.
+			this->_Frc.Reset();
+			this->_HasLastTick = FALSE;
+		}
 
-		// Start the scheduler thread.
+		// Start the scheduler thread. _csScheduler is not held while waiting for it.
 		this->_threadStartNotification = ::CreateEvent(NULL, FALSE, FALSE, NULL);
 		this->_threadHandle = ::CreateThreadpoolWork(&Scheduler::SchedulerThreadProcProxy, this, NULL);    // Allocate a worker thread
 		::SubmitThreadpoolWork(this->_threadHandle);    // Start one worker thread
 		DWORD r = ::WaitForSingleObject(this->_threadStartNotification, SCHEDULER_TIMEOUT);    // Wait for startup to complete
-		this->_threadIsRunning = true;
 		::CloseHandle(this->_threadStartNotification);
 
+		{
+			AutoLock lock(&this->_csScheduler);
+			this->_threadIsRunning = TRUE;
+		}
+
 		return S_OK;
 	}
 	HRESULT Scheduler::Stop()
 	{
-		if (this->_threadIsRunning == FALSE)
-			return S_FALSE; // not running
+		AutoLock lockThread(&this->_csThread);
 
-		// Set the termination event and notify the thread.
-		this->_ScheduleEventQueue->Queue(new ScheduleEvent(eTerminate));
-		::SetEvent(this->_MsgEvent);
-		::WaitForThreadpoolWorkCallbacks(this->_threadHandle, FALSE);    // Wait for the worker thread to end
-		this->_threadIsRunning = FALSE;
+		{
+			AutoLock lock(&this->_csScheduler);
 
-		// Destroy all samples in the queue.
-		this->_presentationSampleQueue->Clear();
+			if (this->_threadIsRunning == FALSE)
+				return S_FALSE; // not running
+
+			// Set the termination event and notify the thread.
+			this->_ScheduleEventQueue->Queue(new ScheduleEvent(eTerminate));
+			::SetEvent(this->_MsgEvent);
+		}
+
+		// Wait for the worker thread to end. _csScheduler is not held, so the callers of ScheduleSample, Flush and EndDrain
+		// are not blocked behind a frame the thread is presenting.
+		::WaitForThreadpoolWorkCallbacks(this->_threadHandle, FALSE);
+		::CloseThreadpoolWork(this->_threadHandle);
+		this->_threadHandle = NULL;
+
+		// From here on, samples are presented as they are scheduled instead of queued.
+		IMFClock* pClock;
+		{
+			AutoLock lock(&this->_csScheduler);
+
+			this->_threadIsRunning = FALSE;
+			pClock = this->_PresentationClock;
+			this->_PresentationClock = NULL;
+		}
+
+		// Return all samples in the queue.
+		this->DiscardAllSamples();
 
 		// Release the presentation clock.
-		SafeRelease(this->_PresentationClock);
+		SafeRelease(pClock);
 
 		return S_OK;
 	}
 	HRESULT Scheduler::Flush()
 	{
-		AutoLock lock(this->_csStreamSinkAndScheduler);
-
-		if (this->_threadIsRunning)
+		BOOL bThreadIsRunning;
 		{
-			// Set a flush event and notify the thread.
-			this->_ScheduleEventQueue->Queue(new ScheduleEvent(eFlush));
-			::SetEvent(this->_MsgEvent);
+			AutoLock lock(&this->_csScheduler);
+
+			// Start a new epoch. All samples scheduled so far become stale, and are discarded instead of presented.
+			::InterlockedIncrement(&this->_Epoch);
 
-			// Wait for the flush to complete.
-			DWORD r = ::WaitForSingleObject(this->_FlushCompleteEvent, SCHEDULER_TIMEOUT);
-			DWORD s = r;
+			// The frame on display is no longer a neighbour of the frames to come.
+			this->_Frc.Reset();
+
+			bThreadIsRunning = this->_threadIsRunning;
+			if (bThreadIsRunning)
+			{
+				// Set a flush event and notify the thread. The caller does not wait for the thread.
+				this->_ScheduleEventQueue->Queue(new ScheduleEvent(eFlush));
+				::SetEvent(this->_MsgEvent);
+			}
 		}
 
+		// No thread to hand the stale samples to; return them now, outside the lock.
+		if (!bThreadIsRunning)
+			this->DiscardStaleSamples();
+
 		return S_OK;
 	}
 
+	void Scheduler::PublishStatistics()
+	{
+		if (NULL == this->_HotAttributes)
+			return;
+
+		FrcStatistics stats;
+		this->_Frc.GetStatistics(&stats);
+
+		this->_HotAttributes->Set(TMS_FRC_TICK_COUNT, stats.Ticks);
+		this->_HotAttributes->Set(TMS_FRC_REPEAT_COUNT, stats.Repeats);
+		this->_HotAttributes->Set(TMS_FRC_SKIP_COUNT, stats.Skips);
+		this->_HotAttributes->Set(TMS_FRC_BLEND_COUNT, stats.Blends);
+		this->_HotAttributes->Set(TMS_FRC_JUDDER_MAX, (UINT64)stats.JudderMax);
+		this->_HotAttributes->Set(TMS_FRC_JUDDER_MEAN, (stats.Ticks > 0) ? (UINT64)(stats.JudderTotal / (LONGLONG)stats.Ticks) : 0);
+	}
+
 	HRESULT Scheduler::ScheduleSample(IMFSample* pSample, BOOL bPresentNow)
 	{
 		if (NULL == this->_PresentCallback)
 			return MF_E_NOT_INITIALIZED;
 
+		if (!bPresentNow)
+		{
+			AutoLock lock(&this->_csScheduler);
+
+			// (B) With a clock, store the sample in the presentation queue and notify the scheduler thread.
+			// Under the lock, so that Stop, which takes the clock away, discards it if the thread does not present it.
+			if (NULL != this->_PresentationClock)
+				return this->QueueSample(pSample);
+		}
+
+		// (A) Present the sample immediately. Outside the lock: the callback takes the locks of the stream sink and the presenter.
+		return this->PresentSample(pSample);
+	}
+	HRESULT Scheduler::QueueSample(IMFSample* pSample)
+	{
 		HRESULT hr = S_OK;
 
-		if (bPresentNow || (NULL == this->_PresentationClock))
+		FrameDescriptor* pDescriptor = this->_PresentCallback->GetFrameDescriptor(pSample);
+		if (NULL == pDescriptor)
+			return MF_E_NOT_FOUND;
+		::InterlockedExchange(&pDescriptor->State, SAMPLE_STATE_SCHEDULED);
+
+		// Stamp the sample with the current epoch, and with its place in the order of the queued samples.
+		::InterlockedExchange(&pDescriptor->Epoch, this->GetEpoch());
 		{
-			// (A) Present the sample immediately.
+			AutoLock lockDrain(&this->_csDrain);
+			pDescriptor->Sequence = ++this->_LastSequence;
+		}
 
-			if (FAILED(hr = this->PresentSample(pSample)))
-				return hr;
+		// Keep the queue in presentation order. In reverse playback (or from a decoder that outputs out of order) the samples
+		// do not always arrive in it. Samples of an older epoch, or of a segment already drained, stay in front, whatever their
+		// timestamps. A sample without a timestamp goes to the back.
+		LONGLONG hnsTime;
+		if (SUCCEEDED(pSample->GetSampleTime(&hnsTime)))
+		{
+			SampleOrder order(this, hnsTime);
+			hr = this->_presentationSampleQueue->InsertOrdered(pSample, &order);
 		}
 		else
 		{
-			// (B) Store the sample in the presentation queue and notify the scheduler thread.
+			hr = this->_presentationSampleQueue->Queue(pSample);
+		}
+		if (FAILED(hr))
+		{
+			this->RetireSequence(this->TakeSequence(pSample));
+			return hr;
+		}
 
-			if (FAILED(hr = pSample->SetUINT32(SAMPLE_STATE, SAMPLE_STATE_SCHEDULED)))
-				return hr;
+		//TCHAR buf[1024];
+		//wsprintf(buf, L"Scheduler::ScheduleSample - queued.(%X)\n", pSample);
+		//OutputDebugString(buf);
 
-			this->_presentationSampleQueue->Queue(pSample);
+		this->_ScheduleEventQueue->Queue(new ScheduleEvent(eSchedule));
+		::SetEvent(this->_MsgEvent);
 
-			//TCHAR buf[1024];
-			//wsprintf(buf, L"Scheduler::ScheduleSample - queued.(%X)\n", pSample);
-			//OutputDebugString(buf);
+		return S_OK;
+	}
 
-			this->_ScheduleEventQueue->Queue(new ScheduleEvent(eSchedule));
-			::SetEvent(this->_MsgEvent);
+	void Scheduler::BeginDrain()
+	{
+		AutoLock lock(&this->_csDrain);
+
+		// Every sample queued so far belongs to the drain, so the ones not retired yet are all of it.
+		this->_IsDraining = TRUE;
+		this->_DrainSequence = this->_LastSequence;
+		this->_DrainPending = this->_LastSequence - this->_RetiredCount;
+
+		// The samples of the next segment go behind them, even if their timestamps start over.
+		this->_SegmentSequence = this->_LastSequence;
+	}
+	BOOL Scheduler::IsDrained()
+	{
+		AutoLock lock(&this->_csDrain);
+
+		if (!this->_IsDraining || 0 == this->_DrainPending)
+			return TRUE;
+
+		// The frame on display, left queued to be blended with the next one, is the last one of the drain.
+		return (1 == this->_DrainPending && 0 != this->_HeldSequence && this->_HeldSequence <= this->_DrainSequence);
+	}
+	void Scheduler::EndDrain(BOOL bDrop)
+	{
+		UINT64 drainSequence;
+		{
+			AutoLock lockDrain(&this->_csDrain);
+
+			if (!this->_IsDraining)
+				return;
+			this->_IsDraining = FALSE;
+			drainSequence = this->_DrainSequence;
 		}
 
-		return S_OK;
+		if (!bDrop || NULL == this->_PresentCallback)
+			return;
+
+		BOOL bThreadIsRunning;
+		{
+			AutoLock lock(&this->_csScheduler);
+
+			// The samples of the drain still queued become stale, as if flushed; the ones after them do not.
+			// (A sample that the thread has taken out of the queue at this moment is presented as usual.)
+			LONG staleEpoch = this->GetEpoch() - 1;
+			IMFSample* pQueued = NULL;
+			for (DWORD i = 0; SUCCEEDED(this->_presentationSampleQueue->GetAt(i, &pQueued)); i++)
+			{
+				FrameDescriptor* pDescriptor = this->_PresentCallback->GetFrameDescriptor(pQueued);
+				if (NULL != pDescriptor)
+				{
+					AutoLock lockDrain(&this->_csDrain);
+					if (0 != pDescriptor->Sequence && pDescriptor->Sequence <= drainSequence)
+						::InterlockedExchange(&pDescriptor->Epoch, staleEpoch);
+				}
+				pQueued->Release();
+			}
+
+			bThreadIsRunning = this->_threadIsRunning;
+			if (bThreadIsRunning)
+			{
+				// Set a drop event and notify the thread. The caller does not wait for the thread.
+				this->_ScheduleEventQueue->Queue(new ScheduleEvent(eDrop));
+				::SetEvent(this->_MsgEvent);
+			}
+		}
+
+		// No thread to hand the stale samples to; return them now, outside the lock.
+		if (!bThreadIsRunning)
+			this->DiscardStaleSamples();
 	}
 
 	void CALLBACK Scheduler::SchedulerThreadProcProxy(PTP_CALLBACK_INSTANCE pInstance, LPVOID arg, PTP_WORK pWork)
@@ -188,9 +347,23 @@ namespace D3D11TextureMediaSink
 
 					case eFlush:
 						//OutputDebugString(L"Scheduler::Thread, processing eFlush event.\n");
-						this->_presentationSampleQueue->Clear();	// Clear the queue
-						lWait = INFINITE;
-						::SetEvent(this->_FlushCompleteEvent); // Notify that flushing is complete
+						this->DiscardStaleSamples();	// Return the samples scheduled before the flush.
+						this->_HasLastTick = FALSE;
+						if (FAILED(this->ProcessSamplesInQueue(&lWait)))    // Samples scheduled after the flush may be waiting.
+						{
+							bExitThread = TRUE;
+							break;
+						}
+						break;
+
+					case eDrop:
+						//OutputDebugString(L"Scheduler::Thread, processing eDrop event.\n");
+						this->DiscardStaleSamples();	// Return the samples of the drain that ran out of time.
+						if (FAILED(this->ProcessSamplesInQueue(&lWait)))
+						{
+							bExitThread = TRUE;
+							break;
+						}
 						break;
 
 					case eSchedule:
@@ -206,6 +379,8 @@ namespace D3D11TextureMediaSink
 						}
 						break;
 					}
+
+					delete pEvent;
 				}
 			}
 		}
@@ -220,6 +395,10 @@ namespace D3D11TextureMediaSink
 		if (NULL == plNextSleep)
 			return E_POINTER;
 
+		// With the frame rate conversion, the samples are presented on the output ticks instead.
+		if (this->IsFrcActive())
+			return this->ProcessTick(plNextSleep);
+
 		*plNextSleep = 0;
 
 		while (0 < this->_presentationSampleQueue->GetCount())
@@ -229,6 +408,14 @@ namespace D3D11TextureMediaSink
 			if (FAILED(hr = this->_presentationSampleQueue->Dequeue(&pSample)))
 				return hr;
 
+			// A sample from before the last flush is discarded without being presented.
+			if (this->IsStale(pSample))
+			{
+				this->DiscardSample(pSample);
+				pSample->Release();
+				continue;
+			}
+
 			// Determine whether to display the sample.
 			if (FAILED(hr = this->ProcessSample(pSample, plNextSleep)))
 				return hr;
@@ -236,8 +423,11 @@ namespace D3D11TextureMediaSink
 			if (0 < *plNextSleep)   // If it is not yet time to display,
 			{
 				this->_presentationSampleQueue->PutBack(pSample);  // put the sample back in the queue
+				pSample->Release();
 				break;      // and exit the loop.
 			}
+
+			pSample->Release();
 		}
 
 		if (0 == *plNextSleep)
@@ -250,6 +440,7 @@ namespace D3D11TextureMediaSink
 		HRESULT hr = S_OK;
 		*plNextSleep = 0;
 		bool bPresentNow = true;
+		LONGLONG hnsDelta = 0;
 
 		if (NULL != this->_PresentationClock)   // Check if there is a clock
 		{
@@ -265,7 +456,7 @@ namespace D3D11TextureMediaSink
 				return hr;
 
 			// Calculate the time until the presentation of the sample. A negative value means that the sample is delayed.
-			LONGLONG hnsDelta = hnsPresentationTime - hnsTimeNow;
+			hnsDelta = hnsPresentationTime - hnsTimeNow;
 			if (0 > this->_playbackRate)
 			{
 				// In reverse playback, the clock also runs in reverse. Therefore, the time is reversed.
@@ -299,6 +490,10 @@ namespace D3D11TextureMediaSink
 		// Present the sample.
 		if (bPresentNow)
 		{
+			// How late the presentation is, in real time, for the supported rates.
+			if (NULL != this->_PresentationClock && 0 != this->_playbackRate)
+				this->_Rates.AddPresentLatency((LONGLONG)(-hnsDelta / ::fabsf(this->_playbackRate)));
+
 			this->PresentSample(pSample);
 
 			//TCHAR buf[1024];
@@ -308,6 +503,248 @@ namespace D3D11TextureMediaSink
 
 		return S_OK;
 	}
+	BOOL Scheduler::IsFrcActive()
+	{
+		// Only in normal forward playback with a clock.
+		return (TMS_FRC_MODE_OFF != this->_Frc.GetMode()) && (NULL != this->_PresentationClock) && (0 < this->_playbackRate);
+	}
+	HRESULT Scheduler::ProcessTick(DWORD* plNextSleep)
+	{
+		HRESULT hr = S_OK;
+		*plNextSleep = INFINITE;
+
+		// Samples from before the last flush are discarded without being presented.
+		this->DiscardStaleSamples();
+
+		if (0 == this->_presentationSampleQueue->GetCount())
+			return S_OK;	// Wait for samples.
+
+		// Get the current time from the clock, and the output tick it falls in.
+		LONGLONG hnsTimeNow;
+		MFTIME hnsSystemTime;
+		if (FAILED(hr = this->_PresentationClock->GetCorrelatedTime(0, &hnsTimeNow, &hnsSystemTime)))
+			return hr;
+		UINT32 mode = this->_Frc.GetMode();
+		LONGLONG hnsTickInterval = this->_Frc.GetTickInterval();
+		LONGLONG hnsTick = this->_Frc.GetTickTime(hnsTimeNow);
+
+		// Each tick is handled once.
+		if (!this->_HasLastTick || hnsTick != this->_LastTick)
+		{
+			this->_LastTick = hnsTick;
+			this->_HasLastTick = TRUE;
+
+			// Peek at the samples at the front of the queue.
+			IMFSample* pSamples[FRC_LOOKAHEAD_MAX] = {};
+			LONGLONG sampleTimes[FRC_LOOKAHEAD_MAX] = {};
+			UINT count = 0;
+			while (count < FRC_LOOKAHEAD_MAX && SUCCEEDED(this->_presentationSampleQueue->GetAt(count, &pSamples[count])))
+			{
+				// A stale sample is never blended, even behind the front. (Discarded unless the queue let go of it meanwhile.)
+				if (this->IsStale(pSamples[count]))
+				{
+					if (S_OK == this->_presentationSampleQueue->Remove(pSamples[count]))
+						this->DiscardSample(pSamples[count]);
+					SafeRelease(pSamples[count]);
+					continue;
+				}
+
+				if (FAILED(pSamples[count]->GetSampleTime(&sampleTimes[count])))
+					sampleTimes[count] = 0;    // It is normal to have no timestamp.
+				count++;
+			}
+
+			FrcDecision decision;
+			this->_Frc.Decide(hnsTick, sampleTimes, count, &decision);
+			if (decision.Action != Frc_Wait)
+				this->PublishStatistics();
+
+			// Return the samples that are no longer needed.
+			for (UINT i = 0; i < decision.Drop; i++)
+			{
+				IMFSample* pSample = NULL;
+				if (this->_presentationSampleQueue->Dequeue(&pSample) != S_OK)
+					break;
+				this->DiscardSample(pSample);
+				pSample->Release();
+			}
+
+			if (Frc_Present == decision.Action && TMS_FRC_MODE_REPEAT_SKIP == mode)
+			{
+				// Present the sample itself, on the output tick.
+				IMFSample* pSample = NULL;
+				if (this->_presentationSampleQueue->Dequeue(&pSample) == S_OK)
+				{
+					pSample->SetSampleTime(hnsTick);
+					pSample->SetSampleDuration(hnsTickInterval);
+					this->PresentSample(pSample);
+					pSample->Release();
+				}
+			}
+			else if (Frc_Present == decision.Action || Frc_Blend == decision.Action)
+			{
+				// The samples stay in the queue, as they are blended again at the next ticks. A new frame is presented.
+				IMFSample* pSecond = (Frc_Blend == decision.Action) ? pSamples[decision.Index + 1] : NULL;
+				if (MF_E_UNSUPPORTED_D3D_TYPE == this->_PresentCallback->BlendFrames(pSamples[decision.Index], pSecond, decision.Weight, hnsTick, hnsTickInterval))
+				{
+					// The device cannot blend; repeat or skip from the next tick on.
+					this->_Frc.SetMode(TMS_FRC_MODE_REPEAT_SKIP);
+				}
+				// Otherwise, a frame that could not be blended (no free sample, etc.) just repeats the previous one.
+			}
+
+			// How late the tick is handled, in real time, for the supported rates.
+			if (Frc_Present == decision.Action || Frc_Blend == decision.Action)
+				this->_Rates.AddPresentLatency((LONGLONG)((hnsTimeNow - hnsTick) / this->_playbackRate));
+
+			for (UINT i = 0; i < count; i++)
+				SafeRelease(pSamples[i]);
+		}
+
+		// Nothing changes before a new sample arrives, if the queue is empty or (when blending) holds only the frame on display.
+		DWORD remaining = this->_presentationSampleQueue->GetCount();
+		if (0 == remaining)
+			return S_OK;
+		if (1 == remaining && TMS_FRC_MODE_BLEND == mode)
+		{
+			IMFSample* pFront = NULL;
+			LONGLONG hnsFrontTime = 0;
+			if (SUCCEEDED(this->_presentationSampleQueue->GetAt(0, &pFront)))
+			{
+				pFront->GetSampleTime(&hnsFrontTime);
+				if (hnsFrontTime <= hnsTick)
+					this->HoldSample(pFront);
+				pFront->Release();
+			}
+			if (hnsFrontTime <= hnsTick)
+				return S_OK;
+		}
+
+		// Sleep until the next tick.
+		*plNextSleep = this->MFTimeToMsec(hnsTick + hnsTickInterval - hnsTimeNow);
+		*plNextSleep = ::abs((int)(*plNextSleep / this->_playbackRate));   // Reflect the playback rate.
+		if (*plNextSleep == 0)	// To avoid being treated as INFINITE when it is exactly 0.
+			*plNextSleep = 1;
+
+		return S_OK;
+	}
+	LONG Scheduler::GetEpoch()
+	{
+		return ::InterlockedCompareExchange(&this->_Epoch, 0, 0);	// Read atomically; Flush increments it from other threads.
+	}
+	BOOL Scheduler::IsStale(IMFSample* pSample)
+	{
+		FrameDescriptor* pDescriptor = this->_PresentCallback->GetFrameDescriptor(pSample);
+		if (NULL == pDescriptor)
+			return FALSE;
+
+		return (::InterlockedCompareExchange(&pDescriptor->Epoch, 0, 0) != this->GetEpoch());
+	}
+	BOOL Scheduler::SampleOrder::IsBefore(IMFSample* pQueued)
+	{
+		return !this->_Scheduler->IsStale(pQueued) && !this->_Scheduler->IsOfEarlierSegment(pQueued) && this->_Scheduler->IsPresentedBefore(this->_Time, pQueued);
+	}
+	BOOL Scheduler::IsPresentedBefore(LONGLONG hnsTime, IMFSample* pSample)
+	{
+		LONGLONG hnsSampleTime;
+		if (FAILED(pSample->GetSampleTime(&hnsSampleTime)))
+			return FALSE;	// Samples without a timestamp keep their place.
+
+		// In reverse playback, the later times are presented first.
+		return (0 > this->_playbackRate) ? (hnsTime > hnsSampleTime) : (hnsTime < hnsSampleTime);
+	}
+	BOOL Scheduler::IsOfEarlierSegment(IMFSample* pSample)
+	{
+		FrameDescriptor* pDescriptor = this->_PresentCallback->GetFrameDescriptor(pSample);
+		if (NULL == pDescriptor)
+			return FALSE;
+
+		AutoLock lock(&this->_csDrain);
+
+		return (0 != pDescriptor->Sequence && pDescriptor->Sequence <= this->_SegmentSequence);
+	}
+	void Scheduler::DiscardStaleSamples()
+	{
+		// Stale samples are always in front of the samples scheduled after the flush, or after the drain they were dropped from.
+		IMFSample* pSample = NULL;
+		while (this->_presentationSampleQueue->Dequeue(&pSample) == S_OK)	// If empty, Dequeue() returns S_FALSE.
+		{
+			if (!this->IsStale(pSample))
+			{
+				this->_presentationSampleQueue->PutBack(pSample);
+				pSample->Release();
+				break;
+			}
+
+			this->DiscardSample(pSample);
+			pSample->Release();
+		}
+	}
+	void Scheduler::DiscardAllSamples()
+	{
+		IMFSample* pSample = NULL;
+		while (this->_presentationSampleQueue->Dequeue(&pSample) == S_OK)	// If empty, Dequeue() returns S_FALSE.
+		{
+			if (NULL != this->_PresentCallback)
+				this->DiscardSample(pSample);
+			pSample->Release();
+		}
+	}
+	void Scheduler::DiscardSample(IMFSample* pSample)
+	{
+		UINT64 sequence = this->TakeSequence(pSample);	// Before the descriptor goes back to the pool with the sample.
+
+		this->_PresentCallback->DiscardFrame(pSample);
+
+		this->RetireSequence(sequence);
+	}
+	UINT64 Scheduler::TakeSequence(IMFSample* pSample)
+	{
+		FrameDescriptor* pDescriptor = this->_PresentCallback->GetFrameDescriptor(pSample);
+		if (NULL == pDescriptor)
+			return 0;
+
+		AutoLock lock(&this->_csDrain);
+
+		UINT64 sequence = pDescriptor->Sequence;
+		pDescriptor->Sequence = 0;
+
+		return sequence;
+	}
+	void Scheduler::RetireSequence(UINT64 sequence)
+	{
+		if (0 == sequence)
+			return;	// Was not queued.
+
+		{
+			AutoLock lock(&this->_csDrain);
+
+			this->_RetiredCount++;
+			if (this->_IsDraining && sequence <= this->_DrainSequence && 0 < this->_DrainPending)
+				this->_DrainPending--;
+			if (sequence == this->_HeldSequence)
+				this->_HeldSequence = 0;
+		}
+
+		::SetEvent(this->_FrameDoneEvent);
+	}
+	void Scheduler::HoldSample(IMFSample* pSample)
+	{
+		FrameDescriptor* pDescriptor = this->_PresentCallback->GetFrameDescriptor(pSample);
+		if (NULL == pDescriptor)
+			return;
+
+		BOOL bChanged;
+		{
+			AutoLock lock(&this->_csDrain);
+
+			bChanged = (this->_HeldSequence != pDescriptor->Sequence);
+			this->_HeldSequence = pDescriptor->Sequence;
+		}
+
+		if (bChanged)
+			::SetEvent(this->_FrameDoneEvent);	// A drain may be waiting for it.
+	}
 	int Scheduler::MFTimeToMsec(LONGLONG time)
 	{
 		const LONGLONG ONE_SECOND = 10000000; // One second in hns
@@ -319,9 +756,13 @@ namespace D3D11TextureMediaSink
 	{
 		HRESULT hr = S_OK;
 
+		UINT64 sequence = this->TakeSequence(pSample);
+
 		// Callback invocation.
 		this->_PresentCallback->PresentFrame(pSample);
 
+		this->RetireSequence(sequence);
+
 		return S_OK;
 	}
 }
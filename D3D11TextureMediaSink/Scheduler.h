@@ -5,43 +5,85 @@ namespace D3D11TextureMediaSink
 	struct SchedulerCallback
 	{
 		virtual HRESULT PresentFrame(IMFSample* pSample) = 0;
+		virtual HRESULT DiscardFrame(IMFSample* pSample) = 0;	// Called for samples that will never be presented (flushed or stale).
+		virtual HRESULT BlendFrames(IMFSample* pFirst, IMFSample* pSecond, float weight, LONGLONG hnsTime, LONGLONG hnsDuration) = 0;	// Presents a new frame blended from two frames (pSecond may be NULL).
+		virtual FrameDescriptor* GetFrameDescriptor(IMFSample* pSample) = 0;	// NULL if the sample is not from the presenter.
 	};
 
 	class Scheduler
 	{
 	public:
-		Scheduler(CriticalSection* critSec);
+		Scheduler();
 		~Scheduler();
 
 		void SetCallback(SchedulerCallback* pCB)
 		{
 			this->_PresentCallback = pCB;
 		}
+		void SetHotAttributes(HotAttributeTable* pTable)
+		{
+			this->_HotAttributes = pTable;
+		}
 		HRESULT SetFrameRate(const MFRatio& fps);
 		HRESULT SetClockRate(float playbackRate);
+		FrameRateConverter* GetFrameRateConverter()
+		{
+			return &this->_Frc;
+		}
+		RateCalculator* GetRateCalculator()
+		{
+			return &this->_Rates;
+		}
 
 		HRESULT Start(IMFClock* pClock);
 		HRESULT Stop();
-		HRESULT Flush();
+		HRESULT Flush();	// Does not wait; samples scheduled before the flush are discarded lazily by the scheduler thread.
 
 		HRESULT ScheduleSample(IMFSample* pSample, BOOL bPresentNow);
+		void PublishStatistics();	// Of the frame rate conversion, to the hot attributes.
+
+		// Drain: waiting for the samples scheduled so far, but not for the ones scheduled after them.
+		void BeginDrain();
+		BOOL IsDrained();				// When blending, the last frame stays queued while on display; it counts as drained.
+		void EndDrain(BOOL bDrop);		// With bDrop, the samples of the drain still queued are discarded instead of presented.
+		HANDLE GetFrameDoneEvent()		// Signaled whenever a queued sample is presented or discarded.
+		{
+			return this->_FrameDoneEvent;
+		}
 
 	private:
 		const int SCHEDULER_TIMEOUT = 5000; // 5 seconds
 		const int _INFINITE = -1;
 
-		CriticalSection* _csStreamSinkAndScheduler;
+		CriticalSection _csThread;				// Serializes Start and Stop. Taken before _csScheduler; the scheduler thread never takes it.
+		CriticalSection _csScheduler;			// Protects the thread state and the clock. Never held while waiting for the thread or calling the callback.
 		SchedulerCallback*  _PresentCallback = NULL;
+		HotAttributeTable* _HotAttributes = NULL;
 		MFTIME _frameInterval;
 		LONGLONG _quarterFrameInterval;		// Precomputed for frequent use
 		float _playbackRate = 1.0f;
 		IMFClock* _PresentationClock = NULL;	// Can be set to NULL
+		volatile LONG _Epoch = 0;				// Incremented by every flush. Samples stamped with an older epoch are stale.
+		FrameRateConverter _Frc;				// Timing of the frame rate conversion.
+		RateCalculator _Rates;					// Supported rates, from the measured cost of a frame.
+		LONGLONG _LastTick = 0;					// The last output tick handled by the scheduler thread.
+		BOOL _HasLastTick = FALSE;				//
+		CriticalSection _csDrain;				// Protects the sequences below. A leaf; never calls out while held.
+		UINT64 _LastSequence = 0;				// Of the last sample queued.
+		UINT64 _RetiredCount = 0;				// Queued samples presented or discarded so far.
+		BOOL _IsDraining = FALSE;
+		UINT64 _DrainSequence = 0;				// The last sample of the drain.
+		UINT64 _DrainPending = 0;				// Samples of the drain not yet presented or discarded.
+		UINT64 _SegmentSequence = 0;			// The last sample of the segments drained so far. The samples after it never go in front of it.
+		UINT64 _HeldSequence = 0;				// The sample left queued while on display when blending; 0 if none.
+		HANDLE _FrameDoneEvent = NULL;
 
 		enum ScheduleEventType
 		{
 			eTerminate,
 			eSchedule,
 			eFlush,
+			eDrop,
 		};
 		class ScheduleEvent
 		{
@@ -58,12 +100,36 @@ namespace D3D11TextureMediaSink
 		HANDLE _threadStartNotification;
 		ThreadSafePtrQueue<ScheduleEvent>* _ScheduleEventQueue;
 		HANDLE _MsgEvent = NULL;
-		HANDLE _FlushCompleteEvent = NULL;
 
 		static void CALLBACK SchedulerThreadProcProxy(PTP_CALLBACK_INSTANCE pInstance, void* arg, PTP_WORK pWork);
 		UINT SchedulerThreadProcPrivate();
 		HRESULT ProcessSamplesInQueue(DWORD* plNextSleep);
+		HRESULT QueueSample(IMFSample* pSample);	// _csScheduler held.
+
+		// Presentation order of a sample to queue, for InsertOrdered.
+		class SampleOrder : public QueueOrder<IMFSample>
+		{
+		public:
+			SampleOrder(Scheduler* pScheduler, LONGLONG hnsTime) : _Scheduler(pScheduler), _Time(hnsTime) {}
+			BOOL IsBefore(IMFSample* pQueued);
+
+		private:
+			Scheduler* _Scheduler;
+			LONGLONG _Time;
+		};
+		LONG GetEpoch();
+		BOOL IsStale(IMFSample* pSample);
+		BOOL IsPresentedBefore(LONGLONG hnsTime, IMFSample* pSample);
+		BOOL IsOfEarlierSegment(IMFSample* pSample);
+		void DiscardStaleSamples();
+		void DiscardAllSamples();
+		void DiscardSample(IMFSample* pSample);
+		UINT64 TakeSequence(IMFSample* pSample);
+		void RetireSequence(UINT64 sequence);
+		void HoldSample(IMFSample* pSample);
 		HRESULT ProcessSample(IMFSample* pSample, DWORD* plNextSleep);
+		BOOL IsFrcActive();
+		HRESULT ProcessTick(DWORD* plNextSleep);
 		int MFTimeToMsec(LONGLONG time);
 		HRESULT PresentSample(IMFSample* pSample);
 	};
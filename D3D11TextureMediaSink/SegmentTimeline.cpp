@@ -0,0 +1,66 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	SegmentTimeline::SegmentTimeline()
+	{
+	}
+	SegmentTimeline::~SegmentTimeline()
+	{
+	}
+
+	void SegmentTimeline::EndOfSegment(UINT64 position)
+	{
+		// With no sample in between, the last of several markers counts.
+		this->_HasBoundary = TRUE;
+		this->_Boundary = position;
+	}
+	LONGLONG SegmentTimeline::GetSampleOffset(LONGLONG hnsSampleTime, UINT64 samplesDone)
+	{
+		// Is it the first sample after an end-of-segment marker? (The samples are done in the order they were placed.)
+		if (this->_HasBoundary && this->_Boundary <= samplesDone)
+		{
+			this->_HasBoundary = FALSE;
+			this->_StartPending = TRUE;
+
+			// In gapless mode, the segment starts where the previous one ended, whatever its own timestamps.
+			this->_Offset = (this->_Gapless && this->_HasEnd) ? (this->_End - hnsSampleTime) : 0;
+		}
+
+		return this->_Offset;
+	}
+	LONGLONG SegmentTimeline::GetOffset()
+	{
+		return this->_Offset;
+	}
+	BOOL SegmentTimeline::FrameScheduled(LONGLONG hnsTime, LONGLONG hnsDuration)
+	{
+		this->_End = hnsTime + hnsDuration;
+		this->_HasEnd = TRUE;
+
+		BOOL bStart = this->_StartPending;
+		this->_StartPending = FALSE;
+		return bStart;
+	}
+	void SegmentTimeline::Restart()
+	{
+		this->_Offset = 0;
+		this->_HasEnd = FALSE;
+	}
+	void SegmentTimeline::Clear()
+	{
+		this->_HasBoundary = FALSE;
+		this->_Offset = 0;
+		this->_HasEnd = FALSE;
+		this->_StartPending = FALSE;
+	}
+
+	LONGLONG SegmentTimeline::GetGap(MFTIME hnsPreviousPresented, LONGLONG hnsPreviousDuration, float rate, MFTIME hnsNow)
+	{
+		if (0.0f >= rate)
+			return 0;
+
+		LONGLONG hnsGap = hnsNow - hnsPreviousPresented - (LONGLONG)(hnsPreviousDuration / rate);
+		return (0 < hnsGap) ? hnsGap : 0;
+	}
+}
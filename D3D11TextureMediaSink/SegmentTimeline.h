@@ -0,0 +1,45 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// The timeline of the segments of a playlist played on one stream (TMS_GAPLESS, TMS_SEGMENT_GAP).
+	// In gapless mode, the first sample after an end-of-segment marker is rebased onto the end of the last frame scheduled,
+	// whatever its own timestamp, and so is the rest of its segment. The frames of the next segment are processed while the
+	// previous one is still on display, and follow it without a gap.
+	// Not thread safe: the stream sink calls it under _csStreamSink.
+	//
+	class SegmentTimeline
+	{
+	public:
+		SegmentTimeline();
+		~SegmentTimeline();
+
+		void SetGapless(BOOL bGapless)
+		{
+			this->_Gapless = bGapless;	// From the next segment on.
+		}
+		BOOL GetGapless()
+		{
+			return this->_Gapless;
+		}
+
+		void EndOfSegment(UINT64 position);							// The marker comes after that many samples.
+		LONGLONG GetSampleOffset(LONGLONG hnsSampleTime, UINT64 samplesDone);	// Of the next sample, with the samples done before it.
+		LONGLONG GetOffset();										// Of the current segment.
+		BOOL FrameScheduled(LONGLONG hnsTime, LONGLONG hnsDuration);	// Rebased time. TRUE for the first frame of a segment.
+		void Restart();		// A start at a new position: the clock is on the timestamps of the source again.
+		void Clear();		// A detach: the markers of the previous source are gone too.
+
+		// How long the display stayed on the previous frame beyond its duration at the rate, before the next one. 0 if not at all.
+		static LONGLONG GetGap(MFTIME hnsPreviousPresented, LONGLONG hnsPreviousDuration, float rate, MFTIME hnsNow);
+
+	private:
+		volatile BOOL _Gapless = FALSE;
+		BOOL _HasBoundary = FALSE;		// The sample at _Boundary starts a new segment.
+		UINT64 _Boundary = 0;			// Position of the last end-of-segment marker.
+		LONGLONG _Offset = 0;			// Added to the sample times of the current segment.
+		BOOL _HasEnd = FALSE;			//
+		LONGLONG _End = 0;				// End of the last frame scheduled, offset included.
+		BOOL _StartPending = FALSE;		// The next frame scheduled is the first of a segment.
+	};
+}
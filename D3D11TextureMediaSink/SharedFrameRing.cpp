@@ -0,0 +1,158 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	SharedFrameRing::SharedFrameRing()
+	{
+	}
+	SharedFrameRing::~SharedFrameRing()
+	{
+		this->Clear();
+	}
+
+	void SharedFrameRing::Attach(UINT slot, SharedSlotMutex* pMutex)
+	{
+		if (slot >= SHARED_RING_MAX)
+		{
+			delete pMutex;
+			return;
+		}
+
+		AutoLock lock(&this->_csRing);
+
+		if (NULL != this->_Slots[slot].Mutex)
+			delete this->_Slots[slot].Mutex;
+
+		this->_Slots[slot].Mutex = pMutex;
+		this->_Slots[slot].Writing = FALSE;
+	}
+	void SharedFrameRing::Clear()
+	{
+		AutoLock lock(&this->_csRing);
+
+		for (UINT i = 0; i < SHARED_RING_MAX; i++)
+		{
+			if (NULL != this->_Slots[i].Mutex)
+			{
+				// Do not leave the consumer waiting on a slot that will never be written.
+				if (this->_Slots[i].Writing)
+					this->_Slots[i].Mutex->Release(this->_Slots[i].AcquiredKey);
+				delete this->_Slots[i].Mutex;
+			}
+		}
+		ZeroMemory(this->_Slots, sizeof(this->_Slots));
+	}
+
+	HRESULT SharedFrameRing::BeginWrite(UINT slot)
+	{
+		if (slot >= SHARED_RING_MAX)
+			return E_INVALIDARG;
+
+		AutoLock lock(&this->_csRing);
+
+		Slot* pSlot = &this->_Slots[slot];
+		if (NULL == pSlot->Mutex)
+			return E_UNEXPECTED;
+		if (pSlot->Writing)
+			return S_OK;
+
+		HRESULT hr;
+
+		// Read and given back by the consumer, or never read at all. Anything else means the consumer holds it now.
+		static const UINT64 keys[2] = { SHARED_KEY_PRODUCER, SHARED_KEY_CONSUMER };
+		for (int i = 0; i < 2; i++)
+		{
+			if (FAILED(hr = pSlot->Mutex->TryAcquire(keys[i])))
+				return hr;
+
+			if (S_OK == hr)
+			{
+				pSlot->Writing = TRUE;
+				pSlot->AcquiredKey = keys[i];
+				return S_OK;
+			}
+		}
+
+		this->_BusyCount++;
+		return S_FALSE;
+	}
+	HRESULT SharedFrameRing::EndWrite(UINT slot, _Out_ UINT64* pSequence)
+	{
+		if (NULL == pSequence)
+			return E_POINTER;
+		if (slot >= SHARED_RING_MAX)
+			return E_INVALIDARG;
+
+		AutoLock lock(&this->_csRing);
+
+		Slot* pSlot = &this->_Slots[slot];
+		if (NULL == pSlot->Mutex || !pSlot->Writing)
+			return E_UNEXPECTED;
+
+		pSlot->Writing = FALSE;
+
+		HRESULT hr;
+		if (FAILED(hr = pSlot->Mutex->Release(SHARED_KEY_CONSUMER)))
+			return hr;
+
+		*pSequence = this->_NextSequence++;
+		return S_OK;
+	}
+	void SharedFrameRing::AbortWrite(UINT slot)
+	{
+		if (slot >= SHARED_RING_MAX)
+			return;
+
+		AutoLock lock(&this->_csRing);
+
+		Slot* pSlot = &this->_Slots[slot];
+		if (NULL == pSlot->Mutex || !pSlot->Writing)
+			return;
+
+		// Back the way it was acquired: a frame not yet read stays readable.
+		pSlot->Writing = FALSE;
+		pSlot->Mutex->Release(pSlot->AcquiredKey);
+	}
+	BOOL SharedFrameRing::IsWriting(UINT slot)
+	{
+		if (slot >= SHARED_RING_MAX)
+			return FALSE;
+
+		AutoLock lock(&this->_csRing);
+
+		return this->_Slots[slot].Writing;
+	}
+	UINT64 SharedFrameRing::GetBusyCount()
+	{
+		AutoLock lock(&this->_csRing);
+
+		return this->_BusyCount;
+	}
+
+
+	DxgiKeyedMutex::DxgiKeyedMutex(IDXGIKeyedMutex* pKeyedMutex)
+	{
+		this->_KeyedMutex = pKeyedMutex;
+		this->_KeyedMutex->AddRef();
+	}
+	DxgiKeyedMutex::~DxgiKeyedMutex()
+	{
+		SafeRelease(this->_KeyedMutex);
+	}
+
+	HRESULT DxgiKeyedMutex::TryAcquire(UINT64 key)
+	{
+		HRESULT hr = this->_KeyedMutex->AcquireSync(key, 0);
+
+		if (WAIT_TIMEOUT == hr)
+			return S_FALSE;
+		if (WAIT_ABANDONED == hr)
+			return S_OK;	// The consumer went away while holding it; it is ours now.
+
+		return hr;
+	}
+	HRESULT DxgiKeyedMutex::Release(UINT64 key)
+	{
+		return this->_KeyedMutex->ReleaseSync(key);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#define SHARED_RING_MAX			16	// Maximum number of slots.
+#define SHARED_KEY_PRODUCER		0	// Key to acquire the texture for writing. The consumer releases with it.
+#define SHARED_KEY_CONSUMER		1	// Key to acquire the texture for reading. The producer releases with it.
+
+namespace D3D11TextureMediaSink
+{
+	// The keyed mutex of a shared texture, behind SharedFrameRing.
+	//
+	class SharedSlotMutex
+	{
+	public:
+		virtual ~SharedSlotMutex() {}
+
+		virtual HRESULT TryAcquire(UINT64 key) = 0;	// Does not wait. S_FALSE if it is held, or is not released with the key.
+		virtual HRESULT Release(UINT64 key) = 0;
+	};
+
+	// Key sequencing of the shared output textures, so that a consumer in another process (or on another device) never blocks the sink.
+	// Each slot goes around: the producer acquires it with SHARED_KEY_PRODUCER, writes, and releases it with SHARED_KEY_CONSUMER;
+	// the consumer acquires it with SHARED_KEY_CONSUMER, reads, and releases it with SHARED_KEY_PRODUCER.
+	// A frame the consumer never read is taken back with SHARED_KEY_CONSUMER. A slot the consumer is reading is skipped; the
+	// producer writes another one. Each written frame gets a sequence number, so the consumer can tell the newest.
+	//
+	class SharedFrameRing
+	{
+	public:
+		SharedFrameRing();
+		~SharedFrameRing();
+
+		void Attach(UINT slot, SharedSlotMutex* pMutex);	// Takes ownership.
+		void Clear();										// Deletes all the mutexes.
+
+		HRESULT BeginWrite(UINT slot);							// S_FALSE if the consumer is reading it.
+		HRESULT EndWrite(UINT slot, _Out_ UINT64* pSequence);	// Hands it to the consumer.
+		void AbortWrite(UINT slot);								// Gives up writing; the slot keeps its previous frame.
+		BOOL IsWriting(UINT slot);
+		UINT64 GetBusyCount();									// Times a slot was skipped because the consumer was reading it.
+
+	private:
+		struct Slot
+		{
+			SharedSlotMutex* Mutex;
+			BOOL Writing;
+			UINT64 AcquiredKey;		// The key it was acquired with while writing.
+		};
+
+		Slot _Slots[SHARED_RING_MAX] = {};
+		UINT64 _NextSequence = 1;
+		UINT64 _BusyCount = 0;
+		CriticalSection _csRing;
+	};
+
+	// SharedSlotMutex with IDXGIKeyedMutex.
+	// The caller must serialize the use of the immediate context, as for any other work on it.
+	//
+	class DxgiKeyedMutex : public SharedSlotMutex
+	{
+	public:
+		DxgiKeyedMutex(IDXGIKeyedMutex* pKeyedMutex);
+		~DxgiKeyedMutex();
+
+		// SharedSlotMutex
+		HRESULT TryAcquire(UINT64 key);
+		HRESULT Release(UINT64 key);
+
+	private:
+		IDXGIKeyedMutex* _KeyedMutex = NULL;
+	};
+}
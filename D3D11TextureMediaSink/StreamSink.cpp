@@ -79,27 +79,27 @@ namespace D3D11TextureMediaSink
 	// another one if the number of falls below the lo water threshold
 	//
 #define SAMPLE_QUEUE_HIWATER_THRESHOLD 3
-	// maximum # of past reference frames required for deinterlacing
-#define MAX_PAST_FRAMES         3
 
 
 	// method
 
-	StreamSink::StreamSink(IMFMediaSink* pParentMediaSink, CriticalSection* critsec, Scheduler* pScheduler, Presenter* pPresenter) :
+	StreamSink::StreamSink(IMFMediaSink* pParentMediaSink, Scheduler* pScheduler, Presenter* pPresenter) :
 		_WorkQueueCB(this, &StreamSink::OnDispatchWorkItem)
 	{
 		this->Initialize();
 
 		this->_ReferenceCount = 1;
 		this->_ShutdownFlag = FALSE;
-		this->_PreprocessingQueue = new ThreadSafeComPtrQueue<IUnknown>();
+		this->_PreprocessingQueue = new ThreadSafeComPtrQueue<IMFSample>();
 		this->_ParentMediaSink = pParentMediaSink;
-		this->_csStreamSinkAndScheduler = critsec;
+		this->_csStreamSink = new CriticalSection();
+		this->_csProcessing = new CriticalSection();
 		this->_csPresentedSample = new CriticalSection();
 		this->_Scheduler = pScheduler;
 		this->_Presenter = pPresenter;
 
 		::MFAllocateWorkQueueEx(MF_STANDARD_WORKQUEUE, &this->m_WorkQueueId);
+		this->_DrainWait = ::CreateThreadpoolWait(&StreamSink::DrainWaitProcProxy, this, NULL);
 
 		// Create an event queue.
 		::MFCreateEventQueue(&this->_EventQueue);
@@ -112,7 +112,7 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::Start\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csStreamSink);
 
 		HRESULT hr = S_OK;
 
@@ -126,6 +126,14 @@ namespace D3D11TextureMediaSink
 			{
 				// We're starting from a "new" position
 				this->_StartTime = start;        // Cache the start time.
+				this->_TrickPlay.Reset();
+				this->_Segments.Restart();       // The clock is on the timestamps of the source again.
+
+				// Measure the time to the first frame at the new position.
+				AutoLock lockPresented(this->_csPresentedSample);
+				this->_FirstFrameTimer.Start(::MFGetSystemTime());
+				if (NULL != this->_HotAttributes)
+					this->_HotAttributes->Set(TMS_FIRST_FRAME_LATENCY, 0);
 			}
 
 			// Update the presentation clock.
@@ -148,7 +156,7 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::Pause\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csStreamSink);
 
 		HRESULT hr;
 
@@ -164,7 +172,7 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::Restart\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csStreamSink);
 
 		HRESULT hr;
 
@@ -180,7 +188,7 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::Stop\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csStreamSink);
 
 		HRESULT hr;
 
@@ -199,7 +207,20 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::Shutdown\n");
 
-		AutoLock(this->_csStreamSinkAndScheduler);
+		AutoLock lockProcessing(this->_csProcessing);	// Wait for the processing in progress to finish.
+		AutoLock lock(this->_csStreamSink);
+
+		this->_ShutdownFlag = TRUE;
+
+		// No more drain checks. One in progress only queues a work item, so it is waited for before the work queue goes.
+		this->CancelDrain();
+		if (NULL != this->_DrainWait)
+		{
+			::SetThreadpoolWait(this->_DrainWait, NULL, NULL);
+			::WaitForThreadpoolWaitCallbacks(this->_DrainWait, TRUE);
+			::CloseThreadpoolWait(this->_DrainWait);
+			this->_DrainWait = NULL;
+		}
 
 		this->_EventQueue->Shutdown();
 		SafeRelease(this->_EventQueue);
@@ -207,6 +228,7 @@ namespace D3D11TextureMediaSink
 		::MFUnlockWorkQueue(this->m_WorkQueueId);
 
 		this->_PreprocessingQueue->Clear();
+		this->_Markers.Clear();
 
 		SafeRelease(this->_PresentationClock);
 
@@ -217,6 +239,51 @@ namespace D3D11TextureMediaSink
 
 		return S_OK;
 	}
+	HRESULT StreamSink::Detach()
+	{
+		//OutputDebugString(L"StreamSink::Detach\n");
+
+		AutoLock lockProcessing(this->_csProcessing);	// Wait for the processing in progress to finish.
+		AutoLock lock(this->_csStreamSink);
+
+		HRESULT hr;
+
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		// The samples and markers of the previous source are dropped; its session is going away.
+		this->_PreprocessingQueue->Clear();
+		this->_Markers.Clear();
+		this->CancelDrain();
+		this->_Segments.Clear();
+		this->_Presenter->ClearScrubCache();	// The frames of the next source are other frames at the same times.
+
+		// The next session gets a new event queue. A request of the previous one still pending ends with MF_E_SHUTDOWN.
+		this->_EventQueue->Shutdown();
+		SafeRelease(this->_EventQueue);
+		if (FAILED(hr = ::MFCreateEventQueue(&this->_EventQueue)))
+			return hr;
+
+		SafeRelease(this->_PresentationClock);
+
+		// Back to the state before the first start. The media type is kept; the next source sets its own anyway.
+		this->_State = (NULL != this->_CurrentType) ? State_Ready : State_TypeNotSet;
+		this->_OutstandingSampleRequests = 0;
+		this->_WaitingForOnClockStart = FALSE;
+		this->_ConsumeData = ProcessFrames;
+		this->_TrickPlay.Reset();
+
+		// Give the reference frames back to the decoder of the previous source. The frame on display is kept.
+		hr = this->_Presenter->Flush();
+
+		// Measure the time to the first frame of the next source.
+		AutoLock lockPresented(this->_csPresentedSample);
+		this->_SwitchTimer.Start(::MFGetSystemTime());
+		if (NULL != this->_HotAttributes)
+			this->_HotAttributes->Set(TMS_SWITCH_LATENCY, 0);
+
+		return hr;
+	}
 
 	void StreamSink::LockPresentedSample(IMFSample** ppSample)
 	{
@@ -227,9 +294,30 @@ namespace D3D11TextureMediaSink
 	}
 	void StreamSink::UnlockPresentedSample()
 	{
+		// The consumer's work on the sample is on the GPU's queue by now; the allocator learns when the GPU has done it.
+		if (NULL != this->_PresentedSample && NULL != this->_Presenter)
+			this->_Presenter->SignalSampleFence(this->_PresentedSample);
+
 		this->_csPresentedSample->Unlock();
 	}
 
+	HRESULT StreamSink::GetPresentedDescriptor(TMS_FRAME_DESCRIPTOR* pDescriptor)
+	{
+		AutoLock lock(this->_csPresentedSample);
+
+		if (NULL == this->_PresentedSample)
+			return MF_E_ATTRIBUTENOTFOUND;
+
+		FrameDescriptor* pFrameDescriptor = this->GetFrameDescriptor(this->_PresentedSample);
+		if (NULL == pFrameDescriptor)
+			return MF_E_ATTRIBUTENOTFOUND;
+
+		*pDescriptor = pFrameDescriptor->Frame;
+		pDescriptor->Epoch = (UINT32)pFrameDescriptor->Epoch;
+
+		return S_OK;
+	}
+
 	// IUnknown Implementation
 
 	ULONG	StreamSink::AddRef()
@@ -291,7 +379,7 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::Flush\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csProcessing);
 
 		HRESULT hr;
 
@@ -306,8 +394,9 @@ namespace D3D11TextureMediaSink
 			if (FAILED(hr = this->ProcessSamplesFromQueue(this->_ConsumeData)))
 				break;
 
-			hr = this->_Scheduler->Flush();	// This call blocks until the scheduler threads discards all scheduled samples.
+			hr = this->_Scheduler->Flush();	// This call does not wait; the scheduler thread discards the stale samples lazily.
 			hr = this->_Presenter->Flush();
+			this->_TrickPlay.Reset();
 
 		} while (FALSE);
 
@@ -319,7 +408,7 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::GetIdentifier\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csStreamSink);
 
 		if (pdwIdentifier == NULL)
 			return E_POINTER;
@@ -339,7 +428,7 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::GetMediaSink\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csStreamSink);
 
 		HRESULT hr;
 
@@ -359,7 +448,7 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::GetMediaTypeHandler\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csStreamSink);
 
 		if (ppHandler == NULL)
 			return E_POINTER;
@@ -376,10 +465,9 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::PlaceMarker\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csStreamSink);
 
 		HRESULT hr = S_OK;
-		IMarker* pMarker = NULL;
 
 		do
 		{
@@ -391,13 +479,16 @@ namespace D3D11TextureMediaSink
 			if (FAILED(hr = this->ValidateOperation(OpPlaceMarker)))
 				break;
 
-			// Create a marker and add it to the pre-processing queue.
-			if (FAILED(hr = Marker::Create(eMarkerType, pvarMarkerValue, pvarContextValue, &pMarker)))
-				break;
-			if (FAILED(hr = this->_PreprocessingQueue->Queue(pMarker)))
+			// Add a marker after the samples placed so far.
+			if (FAILED(hr = this->_Markers.PlaceMarker(eMarkerType, pvarMarkerValue, pvarContextValue)))
 				break;
 
-			// If the stream is not paused, queue an asynchronous operation to process the marker/sample.
+			// The next sample starts a new segment.
+			if (MFSTREAMSINK_MARKER_ENDOFSEGMENT == eMarkerType)
+				this->_Segments.EndOfSegment(this->_Markers.GetSamplesPlaced());
+
+			// If the stream is not paused, queue an asynchronous operation to complete the marker. It does not wait for any
+			// processing; only for the samples before it.
 			if (this->_State != State_Paused)
 			{
 				if (FAILED(hr = this->QueueAsyncOperation(OpPlaceMarker)))
@@ -406,8 +497,6 @@ namespace D3D11TextureMediaSink
 
 		} while (FALSE);
 
-		SafeRelease(pMarker);
-
 		return hr;
 	}
 	HRESULT StreamSink::ProcessSample(__RPC__in_opt IMFSample* pSample)
@@ -416,7 +505,7 @@ namespace D3D11TextureMediaSink
 
 		//OutputDebugString(L"StreamSink::ProcessSample\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csStreamSink);
 
 		if (NULL == pSample)
 			return E_POINTER;
@@ -441,6 +530,7 @@ namespace D3D11TextureMediaSink
 		// Add the sample to the pre-processing queue.
 		if (FAILED(hr = this->_PreprocessingQueue->Queue(pSample)))
 			return hr;
+		this->_Markers.SamplePlaced();
 
 		// If not paused or stopped, perform the asynchronous processSample operation.
 		if (this->_State != State_Paused && this->_State != State_Stopped)
@@ -455,29 +545,35 @@ namespace D3D11TextureMediaSink
 	// IMFMediaEventGenerator (in IMFStreamSink) Implementation
 	HRESULT StreamSink::BeginGetEvent(IMFAsyncCallback* pCallback, IUnknown* punkState)
 	{
-		AutoLock lock(this->_csStreamSinkAndScheduler);
-
 		HRESULT hr;
+		IMFMediaEventQueue* pQueue = NULL;
 
-		// Is shutdown completed?
-		if (FAILED(hr = this->CheckShutdown()))
+		// Get the event queue. (The event queue is thread-safe, so no lock is held while calling it.)
+		if (FAILED(hr = this->GetEventQueue(&pQueue)))
 			return hr;
 
 		// Delegate to the event queue.
-		return this->_EventQueue->BeginGetEvent(pCallback, punkState);
+		hr = pQueue->BeginGetEvent(pCallback, punkState);
+
+		SafeRelease(pQueue);
+
+		return hr;
 	}
 	HRESULT StreamSink::EndGetEvent(IMFAsyncResult* pResult, _Out_ IMFMediaEvent** ppEvent)
 	{
-		AutoLock lock(this->_csStreamSinkAndScheduler);
-
 		HRESULT hr;
+		IMFMediaEventQueue* pQueue = NULL;
 
-		// Is shutdown completed?
-		if (FAILED(hr = this->CheckShutdown()))
+		// Get the event queue. (The event queue is thread-safe, so no lock is held while calling it.)
+		if (FAILED(hr = this->GetEventQueue(&pQueue)))
 			return hr;
 
 		// Delegate to the event queue.
-		return this->_EventQueue->EndGetEvent(pResult, ppEvent);
+		hr = pQueue->EndGetEvent(pResult, ppEvent);
+
+		SafeRelease(pQueue);
+
+		return hr;
 	}
 	HRESULT StreamSink::GetEvent(DWORD dwFlags, __RPC__deref_out_opt IMFMediaEvent** ppEvent)
 	{
@@ -490,18 +586,9 @@ namespace D3D11TextureMediaSink
 
 		do
 		{
-			// scope for lock
-			{
-				AutoLock lock(this->_csStreamSinkAndScheduler);
-
-				// Is shutdown completed?
-				if (FAILED(hr = this->CheckShutdown()))
-					break;
-
-				// Get the pointer to the event queue.
-				pQueue = this->_EventQueue;
-				pQueue->AddRef();
-			}
+			// Get the pointer to the event queue.
+			if (FAILED(hr = this->GetEventQueue(&pQueue)))
+				break;
 
 			// Now get the event.
 			hr = pQueue->GetEvent(dwFlags, ppEvent);
@@ -516,16 +603,19 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::QueueEvent\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
-
 		HRESULT hr;
+		IMFMediaEventQueue* pQueue = NULL;
 
-		// Is already shutdown?
-		if (FAILED(hr = this->CheckShutdown()))
+		// Get the event queue. (The event queue is thread-safe, so no lock is held while calling it.)
+		if (FAILED(hr = this->GetEventQueue(&pQueue)))
 			return hr;
 
 		// Delegate to the event queue.
-		return this->_EventQueue->QueueEventParamVar(met, guidExtendedType, hrStatus, pvValue);
+		hr = pQueue->QueueEventParamVar(met, guidExtendedType, hrStatus, pvValue);
+
+		SafeRelease(pQueue);
+
+		return hr;
 	}
 
 	// IMFMediaTypeHandler Implementation
@@ -534,7 +624,7 @@ namespace D3D11TextureMediaSink
 	{
 		//OutputDebugString(L"StreamSink::GetCurrentMediaType\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csStreamSink);
 
 		if (ppMediaType == NULL)
 			return E_POINTER;
@@ -635,7 +725,6 @@ namespace D3D11TextureMediaSink
 		//OutputDebugString(L"StreamSink::IsMediaTypeSuppored\n");
 
 		HRESULT hr = S_OK;
-		GUID subType = GUID_NULL;
 
 		// We don't return any "close match" types.
 		if (ppMediaType)
@@ -648,39 +737,12 @@ namespace D3D11TextureMediaSink
 		if (NULL == pMediaType)
 			return E_POINTER;
 
-		// Get the subtype of the media type to be checked.
-		if (FAILED(hr = pMediaType->GetGUID(MF_MT_SUBTYPE, &subType)))
+		// Known for this device, or probed once.
+		DXGI_FORMAT dxgiFormat = DXGI_FORMAT_UNKNOWN;
+		if (FAILED(hr = this->_Presenter->GetCapabilityCache()->Negotiate(pMediaType, this, &dxgiFormat)))
 			return hr;
 
-		// Is it in the preferred format list?
-		hr = MF_E_INVALIDMEDIATYPE;
-		for (DWORD i = 0; i < s_dwNumVideoFormats; i++)
-		{
-			if (subType == (*s_pVideoFormats[i]))
-			{
-				hr = S_OK;
-				break;
-			}
-		}
-		if (FAILED(hr))
-			return hr;		// Not found; preferred format not supported
-
-		// Get the corresponding DXGI format.
-		DWORD i = 0;
-		while (s_DXGIFormatMapping[i].Subtype != GUID_NULL)
-		{
-			const FormatEntry& e = s_DXGIFormatMapping[i];
-			if (e.Subtype == subType)
-			{
-				this->_dxgiFormat = e.DXGIFormat;
-				break;
-			}
-			i++;
-		}
-
-		// Is it supported by the presenter?
-		if (FAILED(hr = this->_Presenter->IsSupported(pMediaType, this->_dxgiFormat)))
-			return hr;
+		this->_dxgiFormat = dxgiFormat;
 
 		return S_OK;
 	}
@@ -692,26 +754,44 @@ namespace D3D11TextureMediaSink
 			return E_POINTER;
 
 		HRESULT hr = S_OK;
+		BOOL bSizeChangeOnly = FALSE;
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		// Processing of the queued samples must not see the presenter while it is being reconfigured.
+		AutoLock lockProcessing(this->_csProcessing);
 
+		// scope for lock
+		{
+			AutoLock lock(this->_csStreamSink);
 
-		// Shutdown completed?
-		if (FAILED(hr = this->CheckShutdown()))
-			return hr;
+			// Shutdown completed?
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
 
-		// Can operate?
-		if (FAILED(hr = this->ValidateOperation(OpSetMediaType)))
-			return hr;
+			// Can operate?
+			if (FAILED(hr = this->ValidateOperation(OpSetMediaType)))
+				return hr;
 
-		// Is the specified media type supported?
-		if (FAILED(hr = this->IsMediaTypeSupported(pMediaType, NULL)))
-			return hr;
+			// Is the specified media type supported?
+			if (FAILED(hr = this->IsMediaTypeSupported(pMediaType, NULL)))
+				return hr;
+
+			// If only the frame size changes (e.g. adaptive streaming switching renditions), the queued samples of the previous
+			// size can still be presented, since the presenter keeps a pool per size.
+			if (NULL != this->_CurrentType)
+			{
+				GUID oldSubtype = GUID_NULL, newSubtype = GUID_NULL;
+				this->_CurrentType->GetGUID(MF_MT_SUBTYPE, &oldSubtype);
+				pMediaType->GetGUID(MF_MT_SUBTYPE, &newSubtype);
+				bSizeChangeOnly =
+					(oldSubtype == newSubtype) &&
+					(::MFGetAttributeUINT32(this->_CurrentType, MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive) == ::MFGetAttributeUINT32(pMediaType, MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+			}
 
-		// Update the current media type to the specified media type.
-		SafeRelease(this->_CurrentType);
-		this->_CurrentType = pMediaType;
-		this->_CurrentType->AddRef();
+			// Update the current media type to the specified media type.
+			SafeRelease(this->_CurrentType);
+			this->_CurrentType = pMediaType;
+			this->_CurrentType->AddRef();
+		}
 
 		// Get and save the interlace mode.
 		hr = pMediaType->GetUINT32(MF_MT_INTERLACE_MODE, &this->_InterlaceMode);
@@ -720,6 +800,9 @@ namespace D3D11TextureMediaSink
 		MFRatio fps = { 0, 0 };
 		if (SUCCEEDED(this->GetFrameRate(pMediaType, &fps)) && (fps.Numerator != 0) && (fps.Denominator != 0))
 		{
+			this->_TrickPlay.SetFrameRate(fps);	// Of the input frames.
+			this->_Scheduler->GetRateCalculator()->SetFrameRate(fps);
+
 			if (MFVideoInterlace_FieldInterleavedUpperFirst == this->_InterlaceMode ||
 				MFVideoInterlace_FieldInterleavedLowerFirst == this->_InterlaceMode ||
 				MFVideoInterlace_FieldSingleUpper == this->_InterlaceMode ||
@@ -736,6 +819,8 @@ namespace D3D11TextureMediaSink
 			// we'll use an arbitary default. (Although it's unlikely the video source
 			// does not have a frame rate.)
 			this->_Scheduler->SetFrameRate(s_DefaultFrameRate);
+			this->_TrickPlay.SetFrameRate(s_DefaultFrameRate);
+			this->_Scheduler->GetRateCalculator()->SetFrameRate(s_DefaultFrameRate);
 		}
 
 		// Modify the required number of samples based on the media type (progressive or interlace).
@@ -746,28 +831,37 @@ namespace D3D11TextureMediaSink
 		}
 		else
 		{
-			// Assume we will need a maximum of 3 backward reference frames for deinterlacing
-			// However, one of the frames is "shared" with SVR
-			hr = this->SetUINT32(MF_SA_REQUIRED_SAMPLE_COUNT, SAMPLE_QUEUE_HIWATER_THRESHOLD + MAX_PAST_FRAMES - 1);
+			// The presenter holds on to up to MAX_PAST_FRAMES backward and MAX_FUTURE_FRAMES forward reference frames for deinterlacing.
+			hr = this->SetUINT32(MF_SA_REQUIRED_SAMPLE_COUNT, SAMPLE_QUEUE_HIWATER_THRESHOLD + MAX_PAST_FRAMES + MAX_FUTURE_FRAMES);
 		}
 
-		// Set the media type to the presenter.
+		// Set the media type to the presenter. (Without holding _csStreamSink, so that samples can still be received meanwhile.)
 		if (SUCCEEDED(hr))
 		{
 			if (FAILED(hr = this->_Presenter->SetCurrentMediaType(pMediaType)))
 				return hr;
 		}
 
-		// If not starting or pausing, return to the ready status.
-		if (State_Started != this->_State && State_Paused != this->_State)
+		BOOL bFlush = FALSE;
+
+		// scope for lock
 		{
-			this->_State = State_Ready;
+			AutoLock lock(this->_csStreamSink);
+
+			// If not starting or pausing, return to the ready status.
+			if (State_Started != this->_State && State_Paused != this->_State)
+			{
+				this->_State = State_Ready;
+			}
+			else if (!bSizeChangeOnly)
+			{
+				// If starting or pausing, flush the samples in the queue as this is a format change.
+				bFlush = TRUE;
+			}
 		}
-		else
-		{
-			// If starting or pausing, flush the samples in the queue as this is a format change.
+
+		if (bFlush)
 			hr = this->Flush();
-		}
 
 		return hr;
 	}
@@ -800,6 +894,51 @@ namespace D3D11TextureMediaSink
 		return hr;
 	}
 
+	void StreamSink::SetClockRate(float rate)
+	{
+		// Decides the thinning of the frames from now on.
+		this->_TrickPlay.SetRate(rate);
+		if (NULL != this->_HotAttributes)
+			this->_HotAttributes->Set(TMS_TRICKPLAY_THINNING, this->_TrickPlay.IsThinning());
+
+		// Tell the client that the rate change has taken effect.
+		this->QueueEvent(MEStreamSinkRateChanged, GUID_NULL, S_OK, NULL);
+	}
+	HRESULT StreamSink::PresentCachedFrame(LONGLONG hnsTime)
+	{
+		AutoLock lock(this->_csProcessing);	// Serialized with the processing, which presents the frames while scrubbing.
+
+		HRESULT hr;
+
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		// Only while scrubbing; when started, the frames come from the source on time.
+		if (State_Started == this->_State)
+			return MF_E_INVALIDREQUEST;
+
+		IMFSample* pOutSample = NULL;
+		if (FAILED(hr = this->_Presenter->GetCachedFrame(hnsTime, &pOutSample)))
+			return hr;
+
+		if (FAILED(hr = this->_Scheduler->ScheduleSample(pOutSample, TRUE)))
+			this->_Presenter->ReleaseSample(pOutSample);
+
+		SafeRelease(pOutSample);
+
+		return hr;
+	}
+	HRESULT StreamSink::SetDrainTimeout(UINT64 hnsTimeout)
+	{
+		if (hnsTimeout > (UINT64)MAXLONGLONG)
+			return E_INVALIDARG;
+
+		// From the next end-of-segment marker on.
+		::InterlockedExchange64(&this->_DrainTimeout, (LONGLONG)hnsTimeout);
+
+		return S_OK;
+	}
+
 	// SchedulerCallback Implementation
 
 	HRESULT StreamSink::PresentFrame(IMFSample* pSample)
@@ -808,15 +947,30 @@ namespace D3D11TextureMediaSink
 
 		AutoLock lock(this->_csPresentedSample);
 
-		HRESULT hr = S_OK;
+		FrameDescriptor* pDescriptor = this->GetFrameDescriptor(pSample);
+		if (NULL == pDescriptor)
+			return MF_E_NOT_FOUND;
+
+		MFTIME hnsNow = ::MFGetSystemTime();
+
+		// The first frame of a segment: how long has the last frame of the previous one stayed beyond its duration?
+		if (pDescriptor->SegmentStart)
+		{
+			pDescriptor->SegmentStart = FALSE;
+
+			FrameDescriptor* pPrevious = (NULL != this->_PresentedSample) ? this->GetFrameDescriptor(this->_PresentedSample) : NULL;
+			float rate = ::fabsf(this->_TrickPlay.GetRate());
+			if (NULL != pPrevious && 0.0f < rate && NULL != this->_HotAttributes)
+				this->_HotAttributes->Set(TMS_SEGMENT_GAP, (UINT64)SegmentTimeline::GetGap(pPrevious->Frame.PresentTime, pPrevious->Frame.SampleDuration, rate, hnsNow));
+		}
 
 		// Release the current sample.
 		if (NULL != this->_PresentedSample)
 			this->_Presenter->ReleaseSample(this->_PresentedSample);
 
-		// Update the specified sample's SAMPLE_STATE to PRESENT.
-		if (FAILED(hr = pSample->SetUINT32(SAMPLE_STATE, SAMPLE_STATE_PRESENT)))
-			return hr;
+		// Update the state of the specified sample to PRESENT.
+		::InterlockedExchange(&pDescriptor->State, SAMPLE_STATE_PRESENT);
+		pDescriptor->Frame.PresentTime = hnsNow;
 
 
 
@@ -828,12 +982,115 @@ namespace D3D11TextureMediaSink
 		// Swap the samples.
 		this->_PresentedSample = pSample;
 
+		// The first frame since the start? Since the detach?
+		MFTIME hnsPresented = ::MFGetSystemTime();
+		UINT64 latency;
+		if (this->_FirstFrameTimer.FramePresented(hnsPresented, &latency) && NULL != this->_HotAttributes)
+			this->_HotAttributes->Set(TMS_FIRST_FRAME_LATENCY, latency);
+		if (this->_SwitchTimer.FramePresented(hnsPresented, &latency) && NULL != this->_HotAttributes)
+			this->_HotAttributes->Set(TMS_SWITCH_LATENCY, latency);
+
 		return S_OK;
 	}
+	FrameDescriptor* StreamSink::GetFrameDescriptor(IMFSample* pSample)
+	{
+		Presenter* pPresenter = this->_Presenter;
+
+		// Has the object been shut down?
+		if (NULL == pPresenter)
+			return NULL;
+
+		return pPresenter->GetFrameDescriptor(pSample);
+	}
+	HRESULT StreamSink::DiscardFrame(IMFSample* pSample)
+	{
+		Presenter* pPresenter = this->_Presenter;
+
+		// Has the object been shut down?
+		if (NULL == pPresenter)
+			return MF_E_SHUTDOWN;
+
+		// Return the sample to the allocator without presenting it.
+		return pPresenter->ReleaseSample(pSample);
+	}
+	HRESULT StreamSink::BlendFrames(IMFSample* pFirst, IMFSample* pSecond, float weight, LONGLONG hnsTime, LONGLONG hnsDuration)
+	{
+		Presenter* pPresenter = this->_Presenter;
+
+		// Has the object been shut down?
+		if (NULL == pPresenter)
+			return MF_E_SHUTDOWN;
+
+		HRESULT hr;
+
+		// Have the presenter make a new frame from the two.
+		IMFSample* pOutSample = NULL;
+		if (FAILED(hr = pPresenter->BlendFrames(pFirst, pSecond, weight, &pOutSample)))
+			return hr;
+
+		// The new frame is on the output tick.
+		pOutSample->SetSampleTime(hnsTime);
+		pOutSample->SetSampleDuration(hnsDuration);
+		FrameDescriptor* pDescriptor = pPresenter->GetFrameDescriptor(pOutSample);
+		if (NULL != pDescriptor)
+		{
+			pDescriptor->Frame.SampleTime = hnsTime;
+			pDescriptor->Frame.SampleDuration = hnsDuration;
+
+			// The first frame blended from a new segment counts as its first frame.
+			FrameDescriptor* pFirstDescriptor = pPresenter->GetFrameDescriptor(pFirst);
+			if (NULL != pFirstDescriptor && pFirstDescriptor->SegmentStart)
+			{
+				pDescriptor->SegmentStart = TRUE;
+				pFirstDescriptor->SegmentStart = FALSE;
+			}
+		}
+
+		if (FAILED(hr = this->PresentFrame(pOutSample)))
+			pPresenter->ReleaseSample(pOutSample);
+
+		SafeRelease(pOutSample);
+
+		return hr;
+	}
 
 
 	// private
 
+	HRESULT StreamSink::CheckMediaType(const CapabilityKey& key, UINT32 width, UINT32 height, DXGI_FORMAT* pDXGIFormat)
+	{
+		HRESULT hr;
+
+		// Is it in the preferred format list?
+		hr = MF_E_INVALIDMEDIATYPE;
+		for (DWORD i = 0; i < s_dwNumVideoFormats; i++)
+		{
+			if (key.Subtype == (*s_pVideoFormats[i]))
+			{
+				hr = S_OK;
+				break;
+			}
+		}
+		if (FAILED(hr))
+			return hr;		// Not found; preferred format not supported
+
+		// Get the corresponding DXGI format.
+		DWORD i = 0;
+		while (s_DXGIFormatMapping[i].Subtype != GUID_NULL)
+		{
+			const FormatEntry& e = s_DXGIFormatMapping[i];
+			if (e.Subtype == key.Subtype)
+			{
+				*pDXGIFormat = e.DXGIFormat;
+				break;
+			}
+			i++;
+		}
+
+		// Is it supported by the presenter?
+		return this->_Presenter->IsSupported(key, width, height, *pDXGIFormat);
+	}
+
 	HRESULT StreamSink::CheckShutdown() const
 	{
 		return (this->_ShutdownFlag) ? MF_E_SHUTDOWN : S_OK;
@@ -887,11 +1144,27 @@ namespace D3D11TextureMediaSink
 
 		return hr;
 	}
+	HRESULT StreamSink::GetEventQueue(IMFMediaEventQueue** ppQueue)
+	{
+		AutoLock lock(this->_csStreamSink);
+
+		HRESULT hr;
+
+		// Is already shutdown?
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		// Return the event queue with a reference, so that it can be used after the lock is released.
+		*ppQueue = this->_EventQueue;
+		(*ppQueue)->AddRef();
+
+		return S_OK;
+	}
 	HRESULT StreamSink::OnDispatchWorkItem(IMFAsyncResult* pAsyncResult)
 	{
 		//OutputDebugString(L"StreamSink::OnDispatchWorkItem\n");
 
-		AutoLock lock(this->_csStreamSinkAndScheduler);
+		AutoLock lock(this->_csProcessing);
 
 		HRESULT hr;
 
@@ -919,7 +1192,10 @@ namespace D3D11TextureMediaSink
 					break;
 
 				// Increment the sample request count and queue the MEStreamSinkRequestSample event
-				this->_OutstandingSampleRequests++;
+				{
+					AutoLock lockStreamSink(this->_csStreamSink);
+					this->_OutstandingSampleRequests++;
+				}
 				if (FAILED(hr = this->QueueEvent(MEStreamSinkRequestSample, GUID_NULL, hr, NULL)))
 					break;
 
@@ -932,7 +1208,10 @@ namespace D3D11TextureMediaSink
 
 				// Flush the stream sink and reset the sample request count
 				this->Flush();
-				this->_OutstandingSampleRequests = 0;
+				{
+					AutoLock lockStreamSink(this->_csStreamSink);
+					this->_OutstandingSampleRequests = 0;
+				}
 
 				// Queue the MEStreamSinkStopped event
 				if (FAILED(hr = this->QueueEvent(MEStreamSinkStopped, GUID_NULL, hr, NULL)))
@@ -947,7 +1226,6 @@ namespace D3D11TextureMediaSink
 				break;
 
 			case OpProcessSample:
-			case OpPlaceMarker:
 
 				if (!(this->_WaitingForOnClockStart))
 				{
@@ -955,6 +1233,15 @@ namespace D3D11TextureMediaSink
 						break;
 				}
 				break;
+
+			case OpPlaceMarker:
+
+				if (!(this->_WaitingForOnClockStart))
+				{
+					if (FAILED(hr = this->CompleteMarkers()))
+						break;
+				}
+				break;
 			}
 
 			SafeRelease(pState);
@@ -1002,143 +1289,376 @@ namespace D3D11TextureMediaSink
 		//OutputDebugString(L"StreamSink::ProcessSamplesFromQueue\n");
 
 		HRESULT hr = S_OK;
-		IUnknown* pUnk = nullptr;
+		IMFSample* pSample = nullptr;
 		BOOL bProcessMoreSamples = TRUE;
 		BOOL bDeviceChanged = FALSE;
 		BOOL bProcessAgain = FALSE;
+		IMFPresentationClock* pClock = NULL;
+		IMFMediaType* pCurrentType = NULL;
 
-		// About samples/markers in the queue...
-		while (this->_PreprocessingQueue->Dequeue(&pUnk) == S_OK)	// If empty, Dequeue() returns S_FALSE.
+		// Take references to the clock and the media type, so that they stay valid without holding _csStreamSink.
+		{
+			AutoLock lock(this->_csStreamSink);
+
+			pClock = this->_PresentationClock;
+			if (NULL != pClock)
+				pClock->AddRef();
+
+			pCurrentType = this->_CurrentType;
+			if (NULL != pCurrentType)
+				pCurrentType->AddRef();
+		}
+
+		// About samples in the queue...
+		while (this->_PreprocessingQueue->Dequeue(&pSample) == S_OK)	// If empty, Dequeue() returns S_FALSE.
 		{
 			bProcessMoreSamples = TRUE;
-			IMarker* pMarker = NULL;
-			IMFSample* pSample = NULL;
+			bProcessAgain = FALSE;
 			IMFSample* pOutSample = NULL;
+			IMFSample* pSecondOutSample = NULL;
 
 			do
 			{
-				// Check if pUnk is a marker or a sample.
-				if ((hr = pUnk->QueryInterface(__uuidof(IMarker), (void**)&pMarker)) == E_NOINTERFACE)
+				if (bConsumeData == ProcessFrames)
 				{
-					if (FAILED(hr = pUnk->QueryInterface(IID_IMFSample, (void**)&pSample)))
+					if (NULL == pClock || NULL == pCurrentType)
+					{
+						hr = MF_E_NOT_INITIALIZED;
 						break;
-				}
-
-				// Process branching for markers and samples.
-
-				if (pMarker)
-				{
-					// (A) When a marker is detected.
+					}
 
-					HRESULT hrStatus = S_OK;  // Status code for marker event.
+					// Check the clock.
+					LONGLONG clockTime;
+					MFTIME systemTime;
+					if (FAILED(hr = pClock->GetCorrelatedTime(0, &clockTime, &systemTime)))	// Get the current time (before video processing).
+						break;
+					LONGLONG sampleTime;
+					if (FAILED(hr = pSample->GetSampleTime(&sampleTime)))	// Get the display time of the sample.
+						break;
+					LONGLONG hnsOffset = this->GetSegmentOffset(sampleTime);	// In gapless mode, on the timeline of the first segment.
+					if (this->_Presenter->IsThumbnailMode())
+					{
+						// Only the frames at the requested times are processed, into the thumbnail atlas, whatever the clock. Nothing is presented.
+						hr = this->_Presenter->ProcessThumbnail(pSample);
+						break;
+					}
+					sampleTime += hnsOffset;
+					if (!this->_TrickPlay.ShouldProcess(sampleTime))
+					{
+						// At a high rate, only the frames that can be shown are processed.
+						if (NULL != this->_HotAttributes)
+							this->_HotAttributes->Set(TMS_TRICKPLAY_THINNED_COUNT, this->_TrickPlay.GetThinnedCount());
+						break;
+					}
+					if (this->_TrickPlay.IsLate(sampleTime, clockTime))
+					{
+						// If the sample is delayed with respect to the clock, drop the sample here.
+						_OutputDebugString(_T("drop1.[sampleTime:%lld, clockTime:%lld]\n"), sampleTime / 10000, clockTime / 10000);
+						break;
+					}
 
-					PROPVARIANT var;
-					::PropVariantInit(&var);
+					// While scrubbing, a frame processed before is presented again from the cache, without any processing.
+					BOOL bScrubbing = (State_Started != this->_State);
+					if (bScrubbing && SUCCEEDED(this->_Presenter->GetCachedFrame(sampleTime, &pOutSample)))
+					{
+						if (FAILED(hr = this->_Scheduler->ScheduleSample(pOutSample, TRUE)))
+							this->_Presenter->ReleaseSample(pOutSample);
+						bProcessMoreSamples = FALSE;
+						break;
+					}
 
-					if (this->_ConsumeData == DropFrames)
-						hrStatus = E_ABORT;
+					// Perform video processing on the sample with the presenter and obtain an output sample.
+					MFTIME hnsProcessStart = ::MFGetSystemTime();
+					if (FAILED(hr = this->_Presenter->ProcessFrame(pCurrentType, pSample, &this->_InterlaceMode, &bDeviceChanged, &bProcessAgain, &pOutSample, &pSecondOutSample)))
+						break;
+					this->_Scheduler->GetRateCalculator()->AddProcessingTime(::MFGetSystemTime() - hnsProcessStart);	// For the supported rates.
 
-					do
-					{
-						if (FAILED(hr = pMarker->GetContext(&var)))
+					// Notify the client if the device has changed.
+					if (bDeviceChanged)
+						if (FAILED(hr = this->QueueEvent(MEStreamSinkDeviceChanged, GUID_NULL, S_OK, NULL)))
 							break;
 
-						// Communicate the marker status to the client.
-						if (FAILED(hr = this->QueueEvent(MEStreamSinkMarker, GUID_NULL, hrStatus, &var)))
+					// If the input sample is not used, return it to the queue.
+					if (bProcessAgain)
+						if (FAILED(hr = this->_PreprocessingQueue->PutBack(pSample)))
 							break;
 
-					} while (FALSE);
-
-					::PropVariantClear(&var);
-
-					hr = S_OK;
-					break;
-				}
-				else
-				{
-					// (B) When a sample is detected.
+					if (FAILED(hr = pClock->GetCorrelatedTime(0, &clockTime, &systemTime)))	// Get the current time again after video processing
+						break;
 
-					if (bConsumeData == ProcessFrames)
+					// Schedule the output samples; the second one is the second field of an interlaced frame.
+					// (The output may be of an earlier input when the deinterlacer uses future reference frames, so its own time is checked.)
+					IMFSample* pOutSamples[2] = { pOutSample, pSecondOutSample };
+					for (int i = 0; i < 2; i++)
 					{
-						// Check the clock.
-						LONGLONG clockTime;
-						MFTIME systemTime;
-						if (FAILED(hr = this->_PresentationClock->GetCorrelatedTime(0, &clockTime, &systemTime)))	// Get the current time (before video processing).
-							break;
-						LONGLONG sampleTime;
-						if (FAILED(hr = pSample->GetSampleTime(&sampleTime)))	// Get the display time of the sample.
-							break;
-						if (sampleTime < clockTime)
+						if (NULL == pOutSamples[i])
+							continue;
+
+						LONGLONG outTime = sampleTime - hnsOffset;
+						pOutSamples[i]->GetSampleTime(&outTime);
+						outTime += hnsOffset;
+						if (this->_TrickPlay.IsLate(outTime, clockTime))
 						{
-							// If the sample is delayed with respect to the clock, drop the sample here.
-							_OutputDebugString(_T("drop1.[sampleTime:%lld, clockTime:%lld]\n"), sampleTime / 10000, clockTime / 10000);
-							break;
+							// If the sample is delayed relative to the clock, discard (drop) the sample here (part 2), and give it back to the presenter.
+							_OutputDebugString(_T("drop2.[sampleTime:%lld, clockTime:%lld]\n"), outTime / 10000, clockTime / 10000);
+							this->_Presenter->ReleaseSample(pOutSamples[i]);
+							continue;
 						}
 
-						// Perform video processing on the sample with the presenter and obtain an output sample.
-						if (FAILED(hr = this->_Presenter->ProcessFrame(this->_CurrentType, pSample, &this->_InterlaceMode, &bDeviceChanged, &bProcessAgain, &pOutSample)))
-							break;
-
-						// Notify the client if the device has changed.
-						if (bDeviceChanged)
-							if (FAILED(hr = this->QueueEvent(MEStreamSinkDeviceChanged, GUID_NULL, S_OK, NULL)))
-								break;
-
-						// If the input sample is not used, return it to the queue.
-						if (bProcessAgain)
-							if (FAILED(hr = this->_PreprocessingQueue->PutBack(pSample)))
-								break;
+						this->BeginSegmentFrame(pOutSamples[i], hnsOffset, outTime);
 
-						if (FAILED(hr = this->_PresentationClock->GetCorrelatedTime(0, &clockTime, &systemTime)))	// Get the current time again after video processing
+						bool bPresentNow = (State_Started != this->_State);	// Immediately display in non-normal playback modes (scrubbing, redraws, etc.)
+						if (bPresentNow)
+							this->_Presenter->CacheFrame(pOutSamples[i]);	// For the next seek back to it.
+						if (FAILED(hr = this->_Scheduler->ScheduleSample(pOutSamples[i], bPresentNow)))
 							break;
+						bProcessMoreSamples = FALSE;
 
-						if (sampleTime < clockTime)
-						{
-							// If the sample is delayed relative to the clock, discard (drop) the sample here (part 2).
-							_OutputDebugString(_T("drop2.[sampleTime:%lld, clockTime:%lld]\n"), sampleTime / 10000, clockTime / 10000);
-							break;
-						}
-
-						if (NULL != pOutSample)
-						{
-							bool bPresentNow = (State_Started != this->_State);	// Immediately display in non-normal playback modes (scrubbing, redraws, etc.)
-							hr = this->_Scheduler->ScheduleSample(pOutSample, bPresentNow);
-							bProcessMoreSamples = FALSE;
-
-							//_OutputDebugString(_T("scheduled.[sampleTime:%lld, clockTime:%lld]\n"), sampleTime / 10000, clockTime / 10000);
-						}
+						//_OutputDebugString(_T("scheduled.[sampleTime:%lld, clockTime:%lld]\n"), outTime / 10000, clockTime / 10000);
 					}
 				}
 			} while (FALSE);
 
-			SafeRelease(pUnk);
-			SafeRelease(pMarker);
 			SafeRelease(pSample);
 			SafeRelease(pOutSample);
+			SafeRelease(pSecondOutSample);
+
+			// The sample has been scheduled or dropped, unless it was put back. The markers behind it need not wait any longer.
+			if (!bProcessAgain)
+				this->_Markers.SampleDone();
+			HRESULT hrMarkers = this->CompleteMarkers();
+			if (SUCCEEDED(hr))
+				hr = hrMarkers;
 
 			if (!bProcessMoreSamples)
 				break;
 
 		} // while loop
 
-		SafeRelease(pUnk);
+		// Markers placed after the last sample, or while the queue was empty.
+		if (SUCCEEDED(hr))
+			hr = this->CompleteMarkers();
+
+		SafeRelease(pSample);
+		SafeRelease(pCurrentType);
+		SafeRelease(pClock);
 
 		return hr;
 	}
+	HRESULT StreamSink::CompleteMarkers()
+	{
+		return this->_Markers.Complete(this);
+	}
+	HRESULT StreamSink::CompleteMarker(IMarker* pMarker)
+	{
+		HRESULT hr = S_OK;
+
+		MFSTREAMSINK_MARKER_TYPE type = MFSTREAMSINK_MARKER_DEFAULT;
+		pMarker->GetType(&type);
+
+		// The samples before a marker that are dropped by a flush cancel it.
+		HRESULT hrStatus = (this->_ConsumeData == DropFrames) ? E_ABORT : S_OK;
+
+		// The end of a segment also waits until the frames before it have been presented, for a gapless transition.
+		if (MFSTREAMSINK_MARKER_ENDOFSEGMENT == type)
+		{
+			if (FAILED(hrStatus))
+			{
+				this->CancelDrain();
+			}
+			else if (!this->_Draining && FAILED(hr = this->DrainHistory()))
+			{
+				return hr;
+			}
+			else if (S_FALSE == this->DrainFrames())
+			{
+				return S_FALSE;	// Checked again when the scheduler is done with a frame, or at the deadline.
+			}
+			else
+			{
+				this->_Presenter->FlushThumbnails();	// The thumbnails of the segment are delivered, even if the atlas is not full.
+			}
+		}
+
+		PROPVARIANT var;
+		::PropVariantInit(&var);
+
+		do
+		{
+			if (FAILED(hr = pMarker->GetContext(&var)))
+				break;
+
+			// Communicate the marker status to the client.
+			if (FAILED(hr = this->QueueEvent(MEStreamSinkMarker, GUID_NULL, hrStatus, &var)))
+				break;
+
+		} while (FALSE);
+
+		::PropVariantClear(&var);
+
+		return hr;
+	}
+	HRESULT StreamSink::DrainHistory()
+	{
+		HRESULT hr = S_OK;
+
+		// The end of the segment (or of the stream, which is the end of its last segment) has no frames after it.
+		// The last frames are still on the segment's timeline: the next segment starts with the next sample.
+		LONGLONG hnsOffset;
+		{
+			AutoLock lock(this->_csStreamSink);
+			hnsOffset = this->_Segments.GetOffset();
+		}
+
+		while (SUCCEEDED(hr))
+		{
+			IMFSample* pOutSamples[2] = { NULL, NULL };
+			if (S_OK != (hr = this->_Presenter->DrainHistory(&pOutSamples[0], &pOutSamples[1])))
+				break;
+
+			// Scheduled like the outputs of ProcessSamplesFromQueue. (Not checked against the clock: these are the last frames.)
+			for (int i = 0; i < 2; i++)
+			{
+				if (NULL == pOutSamples[i])
+					continue;
+
+				LONGLONG outTime = 0;
+				pOutSamples[i]->GetSampleTime(&outTime);
+				outTime += hnsOffset;
+				this->BeginSegmentFrame(pOutSamples[i], hnsOffset, outTime);
+
+				bool bPresentNow = (State_Started != this->_State);
+				if (bPresentNow)
+					this->_Presenter->CacheFrame(pOutSamples[i]);
+				if (FAILED(hr = this->_Scheduler->ScheduleSample(pOutSamples[i], bPresentNow)))
+					break;
+			}
+
+			SafeRelease(pOutSamples[0]);
+			SafeRelease(pOutSamples[1]);
+		}
+
+		return SUCCEEDED(hr) ? S_OK : hr;
+	}
+	LONGLONG StreamSink::GetSegmentOffset(LONGLONG hnsSampleTime)
+	{
+		AutoLock lock(this->_csStreamSink);
+
+		return this->_Segments.GetSampleOffset(hnsSampleTime, this->_Markers.GetSamplesDone());
+	}
+	void StreamSink::BeginSegmentFrame(IMFSample* pOutSample, LONGLONG hnsOffset, LONGLONG hnsTime)
+	{
+		FrameDescriptor* pDescriptor = this->GetFrameDescriptor(pOutSample);
+
+		if (0 != hnsOffset)
+		{
+			pOutSample->SetSampleTime(hnsTime);
+			if (NULL != pDescriptor)
+				pDescriptor->Frame.SampleTime = hnsTime;
+		}
+
+		LONGLONG hnsDuration = 0;
+		pOutSample->GetSampleDuration(&hnsDuration);
+
+		BOOL bSegmentStart;
+		{
+			AutoLock lock(this->_csStreamSink);
+			bSegmentStart = this->_Segments.FrameScheduled(hnsTime, hnsDuration);
+		}
+
+		// The gap to the previous segment is measured when the first frame of this one is presented.
+		if (bSegmentStart && NULL != pDescriptor)
+			pDescriptor->SegmentStart = TRUE;
+	}
+	HRESULT StreamSink::DrainFrames()
+	{
+		LONGLONG hnsTimeout = this->_DrainTimeout;
+		MFTIME hnsNow = ::MFGetSystemTime();
+
+		if (!this->_Draining)
+		{
+			if (0 == hnsTimeout)
+				return S_OK;	// The marker does not wait.
+
+			// The frames scheduled so far are the ones before the marker; the ones of the next segment may follow at once.
+			this->_Scheduler->BeginDrain();
+			this->_Draining = TRUE;
+			this->_DrainDeadline = hnsNow + hnsTimeout;
+		}
+
+		if (!this->_Scheduler->IsDrained())
+		{
+			if (State_Started != this->_State)
+			{
+				// No frame is presented while paused; the wait starts over when the stream is resumed.
+				this->_DrainDeadline = hnsNow + hnsTimeout;
+				return S_FALSE;
+			}
+
+			if (hnsNow < this->_DrainDeadline)
+			{
+				// Wait for the scheduler to be done with a frame, up to the deadline. (A negative due time is relative.)
+				ULARGE_INTEGER due;
+				due.QuadPart = (ULONGLONG)(hnsNow - this->_DrainDeadline);
+				FILETIME ftDue = { due.LowPart, due.HighPart };
+				::SetThreadpoolWait(this->_DrainWait, this->_Scheduler->GetFrameDoneEvent(), &ftDue);
+				return S_FALSE;
+			}
+
+			// Out of time. The frames still scheduled are dropped, so that they do not run into the next segment.
+			this->_Scheduler->EndDrain(TRUE);
+			this->_DrainTimeoutCount++;
+			if (NULL != this->_HotAttributes)
+				this->_HotAttributes->Set(TMS_DRAIN_TIMEOUT_COUNT, this->_DrainTimeoutCount);
+		}
+		else
+		{
+			this->_Scheduler->EndDrain(FALSE);
+		}
+
+		::SetThreadpoolWait(this->_DrainWait, NULL, NULL);
+		this->_Draining = FALSE;
+
+		return S_OK;
+	}
+	void StreamSink::CancelDrain()
+	{
+		if (!this->_Draining)
+			return;
+
+		::SetThreadpoolWait(this->_DrainWait, NULL, NULL);
+		if (NULL != this->_Scheduler)
+			this->_Scheduler->EndDrain(FALSE);
+		this->_Draining = FALSE;
+	}
+	void CALLBACK StreamSink::DrainWaitProcProxy(PTP_CALLBACK_INSTANCE pInstance, void* arg, PTP_WAIT pWait, TP_WAIT_RESULT result)
+	{
+		// Check the drain again on the work queue, where the markers are completed. (Signaled or timed out alike.)
+		reinterpret_cast<StreamSink*>(arg)->QueueAsyncOperation(OpPlaceMarker);
+	}
 	HRESULT StreamSink::RequestSamples()
 	{
 		//OutputDebugString(L"StreamSink::RequestSamples\n");
 
 		HRESULT hr = S_OK;
 
-		while (this->NeedMoreSamples())
+		while (TRUE)
 		{
 			// Is shutdown requested?
 			if (FAILED(hr = this->CheckShutdown()))
 				return hr;
 
+			// scope for lock
+			{
+				AutoLock lock(this->_csStreamSink);
+
+				if (!this->NeedMoreSamples())
+					break;
+
+				this->_OutstandingSampleRequests++;
+			}
+
 			// Sends MEStreamSinkRequestSample to the client.
-			this->_OutstandingSampleRequests++;
 			if (FAILED(hr = this->QueueEvent(MEStreamSinkRequestSample, GUID_NULL, S_OK, NULL)))
 				return hr;
 		}
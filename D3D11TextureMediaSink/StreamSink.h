@@ -1,5 +1,8 @@
 #pragma once
 
+// Default of TMS_DRAIN_TIMEOUT; 100ns units.
+#define DRAIN_TIMEOUT_DEFAULT	10000000LL
+
 namespace D3D11TextureMediaSink
 {
 	class StreamSink :
@@ -7,7 +10,9 @@ namespace D3D11TextureMediaSink
 		public IMFStreamSink,
 		public IMFMediaTypeHandler,
 		public IMFGetService,
-		public SchedulerCallback
+		public SchedulerCallback,
+		public MarkerTarget,
+		public CapabilityProvider
 	{
 	public:
 		static GUID const* const s_pVideoFormats[];
@@ -19,7 +24,7 @@ namespace D3D11TextureMediaSink
 			DXGI_FORMAT     DXGIFormat;
 		} s_DXGIFormatMapping[];
 
-		StreamSink(IMFMediaSink* pParentMediaSink, CriticalSection* critsec, Scheduler* pScheduler, Presenter* pPresenter);
+		StreamSink(IMFMediaSink* pParentMediaSink, Scheduler* pScheduler, Presenter* pPresenter);
 		~StreamSink();
 
 		inline BOOL IsActive() const // IsActive: The "active" state is started or paused.
@@ -32,9 +37,31 @@ namespace D3D11TextureMediaSink
 		HRESULT Restart();
 		HRESULT Stop();
 		HRESULT Shutdown();
+		HRESULT Detach();	// Forgets the source, but keeps the presenter and the frame on display.
+
+		void SetClockRate(float rate);
+		HRESULT SetDrainTimeout(UINT64 hnsTimeout);
+		UINT64 GetDrainTimeout()
+		{
+			return (UINT64)this->_DrainTimeout;
+		}
+		HRESULT PresentCachedFrame(LONGLONG hnsTime);	// From the scrubbing cache. (TMS_SCRUB_TIME)
+		void SetGapless(BOOL bGapless)
+		{
+			this->_Segments.SetGapless(bGapless);	// From the next segment on.
+		}
+		BOOL GetGapless()
+		{
+			return this->_Segments.GetGapless();
+		}
+		void SetHotAttributes(HotAttributeTable* pTable)
+		{
+			this->_HotAttributes = pTable;
+		}
 
 		void LockPresentedSample(IMFSample** ppSample);
 		void UnlockPresentedSample();
+		HRESULT GetPresentedDescriptor(TMS_FRAME_DESCRIPTOR* pDescriptor);	// MF_E_ATTRIBUTENOTFOUND if no frame is presented.
 
 		// IUnknown declarations
 		STDMETHODIMP_(ULONG) AddRef();
@@ -68,6 +95,9 @@ namespace D3D11TextureMediaSink
 
 		// SchedulerCallback declarations
 		HRESULT PresentFrame(IMFSample* pSample);
+		HRESULT DiscardFrame(IMFSample* pSample);
+		HRESULT BlendFrames(IMFSample* pFirst, IMFSample* pSecond, float weight, LONGLONG hnsTime, LONGLONG hnsDuration);
+		FrameDescriptor* GetFrameDescriptor(IMFSample* pSample);
 
 	private:
 		// State enum: Defines the current state of the stream.
@@ -105,10 +135,10 @@ namespace D3D11TextureMediaSink
 		// object for the callback state (pState). Then, when the callback is invoked,
 		// we can use the object to determine which asynchronous operation to perform.
 		// Optional data can include a sample (IMFSample) or a marker.
-		// When ProcessSample is called, we use it to queue a sample. When ProcessMarker is
-		// called, we use it to queue a marker. This way, samples and markers can live in
-		// the same queue. We need this because the sink has to serialize marker events
-		// with sample processing.
+		// When ProcessSample is called, we use it to process the queued samples. When PlaceMarker
+		// is called, we use it to complete the queued markers. The samples and the markers are in
+		// separate queues; a marker remembers how many samples came before it, so that its event
+		// is serialized with sample processing without waiting for the samples after it.
 		class AsyncOperation : public IUnknown
 		{
 		public:
@@ -131,17 +161,19 @@ namespace D3D11TextureMediaSink
 		static BOOL ValidStateMatrix[State_Count][Op_Count]; // Defines a look-up table that says which operations are valid from which states.
 
 		long _ReferenceCount;
-		BOOL _ShutdownFlag = false;
-		CriticalSection* _csStreamSinkAndScheduler;
+		volatile BOOL _ShutdownFlag = false;			// Read without locks; written under _csStreamSink.
+		CriticalSection* _csStreamSink;				// Protects the state, the media type, the clock and the sample requests. Held only briefly.
+		CriticalSection* _csProcessing;				// Serializes processing of the pre-processing queue (work items, flush and format change).
 		CriticalSection* _csPresentedSample;
 
-		State _State = State_TypeNotSet;
+		volatile State _State = State_TypeNotSet;	// Read without locks; written under _csStreamSink.
 		IMFMediaSink* _ParentMediaSink = NULL;
 		Presenter* _Presenter = NULL;
 		Scheduler* _Scheduler = NULL;
 		IMFMediaType* _CurrentType = NULL;
 		IMFMediaEventQueue* _EventQueue = NULL;
-		ThreadSafeComPtrQueue<IUnknown>* _PreprocessingQueue;          // Queue to hold samples and markers. Applies to: ProcessSample, PlaceMarker
+		ThreadSafeComPtrQueue<IMFSample>* _PreprocessingQueue;         // Queue to hold samples. Applies to: ProcessSample
+		MarkerSequence _Markers;                                       // Markers keyed to the samples placed before them. Applies to: PlaceMarker
 		DWORD                       m_WorkQueueId;                  // ID of the work queue for asynchronous operations.
 		AsyncCallback<StreamSink> _WorkQueueCB;                  // Callback for the work queue.
 		ConsumeState _ConsumeData = ConsumeState::ProcessFrames;                  // Flag to indicate process or drop frames
@@ -152,12 +184,32 @@ namespace D3D11TextureMediaSink
 		DWORD _OutstandingSampleRequests = 0;   // Outstanding reuqests for samples.
 		IMFPresentationClock* _PresentationClock = NULL;
 		IMFSample* _PresentedSample = NULL;
+		TrickPlayPolicy _TrickPlay;			// Thinning and lateness for fast and reverse playback.
+		HotAttributeTable* _HotAttributes = NULL;	// Where the statistics are published for the consumer.
+		FirstFrameTimer _FirstFrameTimer;		// From the start at a new position to its first frame. (Under _csPresentedSample) (TMS_FIRST_FRAME_LATENCY)
+		FirstFrameTimer _SwitchTimer;			// From the detach to the first frame of the next source. (Under _csPresentedSample) (TMS_SWITCH_LATENCY)
+		volatile LONGLONG _DrainTimeout = DRAIN_TIMEOUT_DEFAULT;	// (TMS_DRAIN_TIMEOUT)
+		BOOL _Draining = FALSE;					// An end-of-segment marker is waiting for the frames before it. (Under _csProcessing)
+		MFTIME _DrainDeadline = 0;				// System time when the frames still scheduled are dropped. (Under _csProcessing)
+		UINT64 _DrainTimeoutCount = 0;			// (Under _csProcessing) (TMS_DRAIN_TIMEOUT_COUNT)
+		PTP_WAIT _DrainWait = NULL;				// Completes the markers again when the scheduler is done with a frame, or at the deadline.
+		SegmentTimeline _Segments;				// (TMS_GAPLESS) (Under _csStreamSink)
 
 		HRESULT CheckShutdown() const;
+		HRESULT CheckMediaType(const CapabilityKey& key, UINT32 width, UINT32 height, DXGI_FORMAT* pDXGIFormat);	// CapabilityProvider. Without the cache.
 		HRESULT GetFrameRate(IMFMediaType* pType, MFRatio* pRatio);
 		HRESULT QueueAsyncOperation(StreamOperation op);
+		HRESULT GetEventQueue(IMFMediaEventQueue** ppQueue);
 		HRESULT OnDispatchWorkItem(IMFAsyncResult* pAsyncResult);
 		HRESULT ProcessSamplesFromQueue(ConsumeState bConsumeData);
+		HRESULT CompleteMarkers();	// Sends the events of the markers whose samples are all done. (Under _csProcessing)
+		HRESULT CompleteMarker(IMarker* pMarker);	// MarkerTarget. (Under _csProcessing)
+		HRESULT DrainHistory();		// Schedules the frames the deinterlacer still holds back as references. (Under _csProcessing)
+		HRESULT DrainFrames();		// S_FALSE while the frames before an end-of-segment marker are still scheduled. (Under _csProcessing)
+		void CancelDrain();			// (Under _csProcessing)
+		LONGLONG GetSegmentOffset(LONGLONG hnsSampleTime);	// Of the sample in front of the pre-processing queue. (Under _csProcessing)
+		void BeginSegmentFrame(IMFSample* pOutSample, LONGLONG hnsOffset, LONGLONG hnsTime);	// Before the output sample is scheduled.
+		static void CALLBACK DrainWaitProcProxy(PTP_CALLBACK_INSTANCE pInstance, void* arg, PTP_WAIT pWait, TP_WAIT_RESULT result);
 		HRESULT ValidateOperation(StreamOperation op);
 		HRESULT DispatchProcessSample(AsyncOperation *pOp);
 		HRESULT RequestSamples();
@@ -2,6 +2,51 @@
 
 namespace D3D11TextureMediaSink
 {
+	// Attributes kept in the hot table. The rest are in the generic attribute store.
+	static const struct
+	{
+		const GUID* Key;
+		MF_ATTRIBUTE_TYPE Type;
+	} s_HotAttributes[] = {
+		// Configuration; published by the sink when set.
+		{ &TMS_KEEP_ALIVE, MF_ATTRIBUTE_UINT32 },
+		{ &TMS_OUTPUT_FORMAT, MF_ATTRIBUTE_UINT32 },
+		{ &TMS_PASSTHROUGH, MF_ATTRIBUTE_UINT32 },
+		{ &TMS_MULTITHREAD_PROTECTION, MF_ATTRIBUTE_UINT32 },
+		{ &TMS_SHARED_TEXTURES, MF_ATTRIBUTE_UINT32 },
+		{ &TMS_GPU_TIMING, MF_ATTRIBUTE_UINT32 },
+		{ &TMS_FRC_MODE, MF_ATTRIBUTE_UINT32 },
+		{ &TMS_FRC_TARGET_RATE, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_WARMUP_HINT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_DRAIN_TIMEOUT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_GAPLESS, MF_ATTRIBUTE_UINT32 },
+		{ &TMS_SCRUB_CACHE_BUDGET, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_THUMBNAIL_SIZE, MF_ATTRIBUTE_UINT64 },
+		// Statistics; published by the scheduler, the stream sink and the presenter as they change.
+		{ &TMS_FRC_TICK_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_FRC_REPEAT_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_FRC_SKIP_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_FRC_BLEND_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_FRC_JUDDER_MAX, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_FRC_JUDDER_MEAN, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_TRICKPLAY_THINNING, MF_ATTRIBUTE_UINT32 },
+		{ &TMS_TRICKPLAY_THINNED_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_FIRST_FRAME_LATENCY, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_SWITCH_LATENCY, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_FIRST_FRAME_SETUP_TIME, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_SHARED_BUSY_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_GPU_TIME_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_GPU_TIME_MEAN, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_GPU_TIME_MAX, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_GPU_TIME_LOST_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_DRAIN_TIMEOUT_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_SEGMENT_GAP, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_SCRUB_CACHE_HIT_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_SCRUB_CACHE_MISS_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_THUMBNAIL_PENDING_COUNT, MF_ATTRIBUTE_UINT64 },
+		{ &TMS_THUMBNAIL_MISSED_COUNT, MF_ATTRIBUTE_UINT64 },
+	};
+
 	HRESULT TextureMediaSink::CreateInstance(_In_ REFIID iid, _COM_Outptr_ void** ppSink, void* pDXGIDeviceManager, void* pD3D11Device)
 	{
 		if (ppSink == NULL)
@@ -41,6 +86,15 @@ namespace D3D11TextureMediaSink
 	}
 	TextureMediaSink::~TextureMediaSink()
 	{
+		// Kept alive and only detached: nobody calls Shutdown any more, so the last reference does the real one.
+		if (this->_KeepAlive && !this->_ShutdownFlag)
+		{
+			this->_KeepAlive = FALSE;
+			this->Shutdown();
+		}
+
+		if (0 != this->_MemoryStreamId)
+			TextureMemoryBudget::GetGlobal()->UnregisterStream(this->_MemoryStreamId);
 	}
 
 	// IUnknown Implementation
@@ -70,6 +124,14 @@ namespace D3D11TextureMediaSink
 		{
 			*ppv = static_cast<IMFAttributes*>(this);
 		}
+		else if (iid == __uuidof(IMFRateSupport))
+		{
+			*ppv = static_cast<IMFRateSupport*>(this);
+		}
+		else if (iid == __uuidof(IMFGetService))
+		{
+			*ppv = static_cast<IMFGetService*>(this);
+		}
 		else
 		{
 			*ppv = NULL;
@@ -230,6 +292,10 @@ namespace D3D11TextureMediaSink
 	{
 		if (!this->_ShutdownFlag)
 		{
+			// Kept alive for the next source?
+			if (this->_KeepAlive)
+				return this->Detach();
+
 			this->_ShutdownFlag = TRUE;
 
 			if (NULL != this->_PresentationClock)
@@ -243,6 +309,10 @@ namespace D3D11TextureMediaSink
 
 			this->_Presenter->Shutdown();
 			this->_Presenter = NULL;
+
+			// The textures are all gone; leave the memory budget.
+			TextureMemoryBudget::GetGlobal()->UnregisterStream(this->_MemoryStreamId);
+			this->_MemoryStreamId = 0;
 		}
 
 		return MF_E_SHUTDOWN;
@@ -280,9 +350,11 @@ namespace D3D11TextureMediaSink
 	{
 		HRESULT hr = S_OK;
 
-		// Set the new rate to the scheduler.
+		// Set the new rate to the scheduler, and to the stream for thinning.
 		if (NULL != this->_Scheduler)
 			hr = this->_Scheduler->SetClockRate(flRate);
+		if (NULL != this->_StreamSink)
+			this->_StreamSink->SetClockRate(flRate);
 
 		return hr;
 	}
@@ -301,7 +373,7 @@ namespace D3D11TextureMediaSink
 		// is a seek request. We need to flush all pending samples.
 		if (this->_StreamSink->IsActive() && llClockStartOffset != PRESENTATION_CURRENT_POSITION)
 		{
-			// This call blocks until the scheduler threads discards all scheduled samples.
+			// This call does not wait for the scheduler thread; samples scheduled before the seek are discarded lazily.
 			if (FAILED(hr = this->_StreamSink->Flush()))
 				return hr;
 		}
@@ -337,8 +409,200 @@ namespace D3D11TextureMediaSink
 		return S_OK;
 	}
 
+	// IMFRateSupport Implementation
+
+	HRESULT TextureMediaSink::GetFastestRate(MFRATE_DIRECTION eDirection, BOOL fThin, _Out_ float* pflRate)
+	{
+		if (NULL == pflRate)
+			return E_POINTER;
+
+		AutoLock lock(this->_csMediaSink);
+
+		HRESULT hr;
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		// From the measured cost of a frame. The same in both directions.
+		float rate = this->_Scheduler->GetRateCalculator()->GetFastestRate(fThin);
+		*pflRate = (MFRATE_REVERSE == eDirection) ? -rate : rate;
+
+		return S_OK;
+	}
+	HRESULT TextureMediaSink::GetSlowestRate(MFRATE_DIRECTION eDirection, BOOL fThin, _Out_ float* pflRate)
+	{
+		if (NULL == pflRate)
+			return E_POINTER;
+
+		AutoLock lock(this->_csMediaSink);
+
+		HRESULT hr;
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		float rate = this->_Scheduler->GetRateCalculator()->GetSlowestRate();
+		*pflRate = (MFRATE_REVERSE == eDirection) ? -rate : rate;
+
+		return S_OK;
+	}
+	HRESULT TextureMediaSink::IsRateSupported(BOOL fThin, float flRate, _Out_opt_ float* pflNearestSupportedRate)
+	{
+		AutoLock lock(this->_csMediaSink);
+
+		HRESULT hr;
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		return this->_Scheduler->GetRateCalculator()->IsRateSupported(fThin, flRate, pflNearestSupportedRate);
+	}
+
+	// IMFGetService Implementation
+
+	HRESULT TextureMediaSink::GetService(__RPC__in REFGUID guidService, __RPC__in REFIID riid, __RPC__deref_out_opt LPVOID* ppvObject)
+	{
+		if (NULL == ppvObject)
+			return E_POINTER;
+
+		// The media session looks for IMFRateSupport through this service.
+		if (guidService == MF_RATE_CONTROL_SERVICE)
+		{
+			if (riid == __uuidof(IMFRateSupport))
+			{
+				*ppvObject = static_cast<IMFRateSupport*>(this);
+				this->AddRef();
+				return S_OK;
+			}
+			return E_NOINTERFACE;
+		}
+
+		return MF_E_UNSUPPORTED_SERVICE;
+	}
+
 	// IMFAttributes Implementation
+	// The hot attributes are not in the generic store; every method that reads items goes through both.
+
+	HRESULT TextureMediaSink::GetItem(__RPC__in REFGUID guidKey, __RPC__inout_opt PROPVARIANT* pValue)
+	{
+		if (this->_HotAttributes.GetItem(guidKey, NULL))
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			if (NULL != pValue)
+				this->_HotAttributes.GetItem(guidKey, pValue);
+			return S_OK;
+		}
+		return MFAttributesImpl::GetItem(guidKey, pValue);
+	}
+	HRESULT TextureMediaSink::GetItemType(__RPC__in REFGUID guidKey, __RPC__out MF_ATTRIBUTE_TYPE* pType)
+	{
+		if (NULL == pType)
+			return E_POINTER;
+
+		if (this->_HotAttributes.GetItemType(guidKey, pType))
+			return S_OK;
+		return MFAttributesImpl::GetItemType(guidKey, pType);
+	}
+	HRESULT TextureMediaSink::CompareItem(__RPC__in REFGUID guidKey, __RPC__in REFPROPVARIANT Value, __RPC__out BOOL* pbResult)
+	{
+		if (NULL == pbResult)
+			return E_POINTER;
+
+		if (this->_HotAttributes.CompareItem(guidKey, Value, pbResult))
+			return S_OK;
+		return MFAttributesImpl::CompareItem(guidKey, Value, pbResult);
+	}
+	HRESULT TextureMediaSink::Compare(__RPC__in_opt IMFAttributes* pTheirs, MF_ATTRIBUTES_MATCH_TYPE MatchType, __RPC__out BOOL* pbResult)
+	{
+		// Compare a copy of all the items, as the store has no way to see the hot ones.
+		IMFAttributes* pOurs = NULL;
+		HRESULT hr = S_OK;
+		do
+		{
+			if (FAILED(hr = ::MFCreateAttributes(&pOurs, this->_HotAttributes.GetCount())))
+				break;
+			if (FAILED(hr = this->CopyAllItems(pOurs)))
+				break;
+
+			hr = pOurs->Compare(pTheirs, MatchType, pbResult);
+
+		} while (FALSE);
+
+		SafeRelease(pOurs);
 
+		return hr;
+	}
+	HRESULT TextureMediaSink::GetUINT32(__RPC__in REFGUID guidKey, __RPC__out UINT32* punValue)
+	{
+		if (guidKey == TMS_MEMORY_POLICY)
+		{
+			if (NULL == punValue)
+				return E_POINTER;
+
+			*punValue = TextureMemoryBudget::GetGlobal()->GetPolicy();
+			return S_OK;
+		}
+		// The hot attributes are read without any lock.
+		UINT64 value;
+		if (this->_HotAttributes.Get(guidKey, MF_ATTRIBUTE_UINT32, &value))
+		{
+			if (NULL == punValue)
+				return E_POINTER;
+
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			*punValue = (UINT32)value;
+			return S_OK;
+		}
+		return MFAttributesImpl::GetUINT32(guidKey, punValue);
+	}
+	HRESULT TextureMediaSink::GetUINT64(__RPC__in REFGUID guidKey, __RPC__out UINT64* punValue)
+	{
+		if (guidKey == TMS_MEMORY_BUDGET || guidKey == TMS_MEMORY_TOTAL_BYTES || guidKey == TMS_MEMORY_CURRENT_BYTES || guidKey == TMS_MEMORY_PEAK_BYTES)
+		{
+			if (NULL == punValue)
+				return E_POINTER;
+
+			TextureMemoryBudget* pBudget = TextureMemoryBudget::GetGlobal();
+
+			if (guidKey == TMS_MEMORY_BUDGET)
+			{
+				*punValue = pBudget->GetBudget();
+				return S_OK;
+			}
+			if (guidKey == TMS_MEMORY_TOTAL_BYTES)
+			{
+				*punValue = pBudget->GetTotalBytes();
+				return S_OK;
+			}
+
+			// The values of this sink.
+			UINT64 currentBytes = 0, peakBytes = 0;
+			HRESULT hr;
+			if (FAILED(hr = pBudget->GetStreamBytes(this->_MemoryStreamId, &currentBytes, &peakBytes)))
+				return hr;
+
+			*punValue = (guidKey == TMS_MEMORY_CURRENT_BYTES) ? currentBytes : peakBytes;
+			return S_OK;
+		}
+		// The hot attributes are read without any lock.
+		UINT64 value;
+		if (this->_HotAttributes.Get(guidKey, MF_ATTRIBUTE_UINT64, &value))
+		{
+			if (NULL == punValue)
+				return E_POINTER;
+
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			*punValue = value;
+			return S_OK;
+		}
+		return MFAttributesImpl::GetUINT64(guidKey, punValue);
+	}
 	HRESULT TextureMediaSink::GetUnknown(__RPC__in REFGUID guidKey, __RPC__in REFIID riid, __RPC__deref_out_opt LPVOID* ppv)
 	{
 		if (guidKey == TMS_SAMPLE)
@@ -354,6 +618,322 @@ namespace D3D11TextureMediaSink
 		}
 		return E_INVALIDARG;
 	}
+	HRESULT TextureMediaSink::GetBlobSize(__RPC__in REFGUID guidKey, __RPC__out UINT32* pcbBlobSize)
+	{
+		if (guidKey == TMS_GPU_TIME_HISTOGRAM)
+		{
+			if (NULL == pcbBlobSize)
+				return E_POINTER;
+
+			*pcbBlobSize = sizeof(UINT64) * TMS_GPU_TIME_HISTOGRAM_BUCKETS;
+			return S_OK;
+		}
+		if (guidKey == TMS_SAMPLE_DESCRIPTOR)
+		{
+			if (NULL == pcbBlobSize)
+				return E_POINTER;
+
+			*pcbBlobSize = sizeof(TMS_FRAME_DESCRIPTOR);
+			return S_OK;
+		}
+		return MFAttributesImpl::GetBlobSize(guidKey, pcbBlobSize);
+	}
+	HRESULT TextureMediaSink::GetBlob(__RPC__in REFGUID guidKey, __RPC__out_ecount_full(cbBufSize) UINT8* pBuf, UINT32 cbBufSize, __RPC__inout_opt UINT32* pcbBlobSize)
+	{
+		if (guidKey == TMS_GPU_TIME_HISTOGRAM)
+		{
+			if (NULL == pBuf)
+				return E_POINTER;
+
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			if (cbBufSize < sizeof(UINT64) * TMS_GPU_TIME_HISTOGRAM_BUCKETS)
+				return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+
+			GpuTimeStatistics stats;
+			this->_Presenter->GetGpuTimeStatistics(&stats);
+			memcpy(pBuf, stats.Buckets, sizeof(stats.Buckets));
+			if (NULL != pcbBlobSize)
+				*pcbBlobSize = sizeof(stats.Buckets);
+			return S_OK;
+		}
+		if (guidKey == TMS_SAMPLE_DESCRIPTOR)
+		{
+			if (NULL == pBuf)
+				return E_POINTER;
+
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			if (cbBufSize < sizeof(TMS_FRAME_DESCRIPTOR))
+				return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+
+			TMS_FRAME_DESCRIPTOR descriptor;
+			if (FAILED(hr = this->_StreamSink->GetPresentedDescriptor(&descriptor)))
+				return hr;
+			memcpy(pBuf, &descriptor, sizeof(descriptor));
+			if (NULL != pcbBlobSize)
+				*pcbBlobSize = sizeof(descriptor);
+			return S_OK;
+		}
+		return MFAttributesImpl::GetBlob(guidKey, pBuf, cbBufSize, pcbBlobSize);
+	}
+	HRESULT TextureMediaSink::GetAllocatedBlob(__RPC__in REFGUID guidKey, __RPC__deref_out_ecount_full_opt(*pcbSize) UINT8** ppBuf, __RPC__out UINT32* pcbSize)
+	{
+		if (guidKey == TMS_GPU_TIME_HISTOGRAM || guidKey == TMS_SAMPLE_DESCRIPTOR)
+		{
+			if (NULL == ppBuf || NULL == pcbSize)
+				return E_POINTER;
+
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			// Freed by the caller with CoTaskMemFree, as for any other blob.
+			UINT32 cbSize = 0;
+			if (FAILED(hr = this->GetBlobSize(guidKey, &cbSize)))
+				return hr;
+			UINT8* pBuf = (UINT8*)::CoTaskMemAlloc(cbSize);
+			if (NULL == pBuf)
+				return E_OUTOFMEMORY;
+
+			if (FAILED(hr = this->GetBlob(guidKey, pBuf, cbSize, NULL)))
+			{
+				::CoTaskMemFree(pBuf);
+				return hr;
+			}
+
+			*ppBuf = pBuf;
+			*pcbSize = cbSize;
+			return S_OK;
+		}
+		return MFAttributesImpl::GetAllocatedBlob(guidKey, ppBuf, pcbSize);
+	}
+	HRESULT TextureMediaSink::SetItem(__RPC__in REFGUID guidKey, __RPC__in REFPROPVARIANT Value)
+	{
+		// A hot attribute is set as by its typed setter, so that the component gets it and the table is updated.
+		MF_ATTRIBUTE_TYPE type;
+		if (this->_HotAttributes.GetItemType(guidKey, &type))
+		{
+			if (MF_ATTRIBUTE_UINT32 == type && VT_UI4 == Value.vt)
+				return this->SetUINT32(guidKey, Value.ulVal);
+			if (MF_ATTRIBUTE_UINT64 == type && VT_UI8 == Value.vt)
+				return this->SetUINT64(guidKey, Value.uhVal.QuadPart);
+			return MF_E_INVALIDTYPE;
+		}
+		return MFAttributesImpl::SetItem(guidKey, Value);
+	}
+	HRESULT TextureMediaSink::SetUINT32(__RPC__in REFGUID guidKey, UINT32 unValue)
+	{
+		if (guidKey == TMS_MEMORY_POLICY)
+		{
+			return TextureMemoryBudget::GetGlobal()->SetPolicy(unValue);
+		}
+		if (guidKey == TMS_KEEP_ALIVE)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			this->_KeepAlive = unValue ? TRUE : FALSE;
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_OUTPUT_FORMAT)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			if (FAILED(hr = this->_Presenter->SetOutputFormat((DXGI_FORMAT)unValue)))
+				return hr;
+
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_PASSTHROUGH)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			this->_Presenter->SetPassthrough(unValue ? TRUE : FALSE);
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_MULTITHREAD_PROTECTION)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			this->_Presenter->SetMultithreadProtection(unValue ? TRUE : FALSE);
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_SHARED_TEXTURES)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			this->_Presenter->SetSharedTextures(unValue ? TRUE : FALSE);
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_TRICKPLAY_THINNING)
+		{
+			return E_ACCESSDENIED;	// Read only.
+		}
+		if (guidKey == TMS_GPU_TIMING)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			this->_Presenter->SetGpuTiming(unValue ? TRUE : FALSE);
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_FRC_MODE)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			FrameRateConverter* pFrc = this->_Scheduler->GetFrameRateConverter();
+			if (FAILED(hr = pFrc->SetMode(unValue)))
+				return hr;
+
+			pFrc->ResetStatistics();
+			this->_Scheduler->PublishStatistics();
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_GAPLESS)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			this->_StreamSink->SetGapless(unValue ? TRUE : FALSE);
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		return MFAttributesImpl::SetUINT32(guidKey, unValue);
+	}
+	HRESULT TextureMediaSink::SetUINT64(__RPC__in REFGUID guidKey, UINT64 unValue)
+	{
+		if (guidKey == TMS_MEMORY_BUDGET)
+		{
+			TextureMemoryBudget::GetGlobal()->SetBudget(unValue);
+			return S_OK;
+		}
+		if (guidKey == TMS_MEMORY_TOTAL_BYTES || guidKey == TMS_MEMORY_CURRENT_BYTES || guidKey == TMS_MEMORY_PEAK_BYTES)
+		{
+			return E_ACCESSDENIED;	// Read only.
+		}
+		if (guidKey == TMS_FRC_TARGET_RATE)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			MFRatio fps = { (DWORD)(unValue >> 32), (DWORD)(unValue & 0xFFFFFFFF) };
+			if (FAILED(hr = this->_Scheduler->GetFrameRateConverter()->SetTargetRate(fps)))
+				return hr;
+
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_WARMUP_HINT)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			this->_Presenter->SetWarmUpHint((UINT32)(unValue >> 32), (UINT32)(unValue & 0xFFFFFFFF));
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_DRAIN_TIMEOUT)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			if (FAILED(hr = this->_StreamSink->SetDrainTimeout(unValue)))
+				return hr;
+
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_SCRUB_CACHE_BUDGET)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			this->_Presenter->SetScrubCacheBudget(unValue);
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_SCRUB_TIME)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			return this->_StreamSink->PresentCachedFrame((LONGLONG)unValue);
+		}
+		if (guidKey == TMS_THUMBNAIL_SIZE)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			if (FAILED(hr = this->_Presenter->SetThumbnailSize((UINT32)(unValue >> 32), (UINT32)(unValue & 0xFFFFFFFF))))
+				return hr;
+
+			this->PublishConfiguration();
+			return S_OK;
+		}
+		if (guidKey == TMS_FRC_TICK_COUNT || guidKey == TMS_FRC_REPEAT_COUNT || guidKey == TMS_FRC_SKIP_COUNT ||
+			guidKey == TMS_FRC_BLEND_COUNT || guidKey == TMS_FRC_JUDDER_MAX || guidKey == TMS_FRC_JUDDER_MEAN ||
+			guidKey == TMS_TRICKPLAY_THINNED_COUNT ||
+			guidKey == TMS_GPU_TIME_COUNT || guidKey == TMS_GPU_TIME_MEAN || guidKey == TMS_GPU_TIME_MAX || guidKey == TMS_GPU_TIME_LOST_COUNT ||
+			guidKey == TMS_SHARED_BUSY_COUNT ||
+			guidKey == TMS_FIRST_FRAME_LATENCY || guidKey == TMS_FIRST_FRAME_SETUP_TIME || guidKey == TMS_SWITCH_LATENCY ||
+			guidKey == TMS_DRAIN_TIMEOUT_COUNT || guidKey == TMS_SEGMENT_GAP ||
+			guidKey == TMS_SCRUB_CACHE_HIT_COUNT || guidKey == TMS_SCRUB_CACHE_MISS_COUNT ||
+			guidKey == TMS_THUMBNAIL_PENDING_COUNT || guidKey == TMS_THUMBNAIL_MISSED_COUNT)
+		{
+			return E_ACCESSDENIED;	// Read only.
+		}
+		return MFAttributesImpl::SetUINT64(guidKey, unValue);
+	}
+	HRESULT TextureMediaSink::SetBlob(__RPC__in REFGUID guidKey, __RPC__in_ecount_full(cbBufSize) const UINT8* pBuf, UINT32 cbBufSize)
+	{
+		if (guidKey == TMS_GPU_TIME_HISTOGRAM || guidKey == TMS_SAMPLE_DESCRIPTOR)
+		{
+			return E_ACCESSDENIED;	// Read only.
+		}
+		if (guidKey == TMS_THUMBNAIL_TIMES)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			if (0 != cbBufSize % sizeof(LONGLONG))
+				return E_INVALIDARG;
+
+			return this->_Presenter->SetThumbnailRequests((const LONGLONG*)pBuf, cbBufSize / sizeof(LONGLONG));
+		}
+		return MFAttributesImpl::SetBlob(guidKey, pBuf, cbBufSize);
+	}
 	HRESULT TextureMediaSink::SetUnknown(__RPC__in REFGUID guidKey, __RPC__in_opt IUnknown* pUnknown)
 	{
 		if (guidKey == TMS_SAMPLE)
@@ -361,28 +941,146 @@ namespace D3D11TextureMediaSink
 			this->_StreamSink->UnlockPresentedSample();
 			return S_OK;
 		}
+		if (guidKey == TMS_THUMBNAIL_CALLBACK)
+		{
+			HRESULT hr;
+			if (FAILED(hr = this->CheckShutdown()))
+				return hr;
+
+			ITMSThumbnailCallback* pCallback = NULL;
+			if (NULL != pUnknown && FAILED(hr = pUnknown->QueryInterface(__uuidof(ITMSThumbnailCallback), (void**)&pCallback)))
+				return hr;
+
+			this->_Presenter->SetThumbnailCallback(pCallback);
+			SafeRelease(pCallback);
+			return S_OK;
+		}
 		return E_INVALIDARG;
 	}
+	HRESULT TextureMediaSink::GetCount(__RPC__out UINT32* pcItems)
+	{
+		if (NULL == pcItems)
+			return E_POINTER;
+
+		// The items of the store first, then the hot ones.
+		HRESULT hr;
+		if (FAILED(hr = MFAttributesImpl::GetCount(pcItems)))
+			return hr;
+
+		*pcItems += this->_HotAttributes.GetCount();
+		return S_OK;
+	}
+	HRESULT TextureMediaSink::GetItemByIndex(UINT32 unIndex, __RPC__out GUID* pguidKey, __RPC__inout_opt PROPVARIANT* pValue)
+	{
+		if (NULL == pguidKey)
+			return E_POINTER;
+
+		UINT32 count;
+		HRESULT hr;
+		if (FAILED(hr = MFAttributesImpl::GetCount(&count)))
+			return hr;
+
+		if (unIndex < count)
+			return MFAttributesImpl::GetItemByIndex(unIndex, pguidKey, pValue);
+
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		return this->_HotAttributes.GetItemByIndex(unIndex - count, pguidKey, pValue) ? S_OK : E_INVALIDARG;
+	}
+	HRESULT TextureMediaSink::CopyAllItems(__RPC__in_opt IMFAttributes* pDest)
+	{
+		if (NULL == pDest)
+			return E_POINTER;
+
+		HRESULT hr;
+		if (FAILED(hr = MFAttributesImpl::CopyAllItems(pDest)))
+			return hr;
+
+		if (FAILED(hr = this->CheckShutdown()))
+			return hr;
+
+		return this->_HotAttributes.CopyAllItems(pDest);
+	}
 
 
 	// private
 
 	HRESULT TextureMediaSink::Initialize()
 	{
+		HRESULT hr;
+
 		this->_ShutdownFlag = FALSE;
 		this->_csMediaSink = new CriticalSection();
-		this->_csStreamSinkAndScheduler = new CriticalSection();
+
+		// Create the attribute store.
+		if (FAILED(hr = MFAttributesImpl::Initialize()))
+			return hr;
+
+		// Join the texture memory budget. (This fails if the budget is exceeded and new streams are refused.)
+		if (FAILED(hr = TextureMemoryBudget::GetGlobal()->RegisterStream(&this->_MemoryStreamId)))
+			return hr;
 
 		this->_PresentationClock = NULL;
-		this->_Scheduler = new Scheduler(this->_csStreamSinkAndScheduler);
+		this->_Scheduler = new Scheduler();
 		this->_Presenter = new Presenter();
-		this->_StreamSink = new StreamSink(this, this->_csStreamSinkAndScheduler, this->_Scheduler, this->_Presenter);
+		this->_StreamSink = new StreamSink(this, this->_Scheduler, this->_Presenter);
+		this->_Presenter->SetMemoryBudget(TextureMemoryBudget::GetGlobal(), this->_MemoryStreamId);
 
 		// Register CStreamSink with the scheduler's callback.
 		this->_Scheduler->SetCallback(static_cast<SchedulerCallback*>(this->_StreamSink));
 
+		// The attributes polled by the consumer are published to the hot table by the components that change them.
+		for (int i = 0; i < _countof(s_HotAttributes); i++)
+		{
+			if (FAILED(hr = this->_HotAttributes.Register(*s_HotAttributes[i].Key, s_HotAttributes[i].Type, 0)))
+				return hr;
+		}
+		this->_Scheduler->SetHotAttributes(&this->_HotAttributes);
+		this->_StreamSink->SetHotAttributes(&this->_HotAttributes);
+		this->_Presenter->SetHotAttributes(&this->_HotAttributes);
+		this->PublishConfiguration();
+
 		return S_OK;
 	}
+	void TextureMediaSink::PublishConfiguration()
+	{
+		// Read back from the components, which may adjust the values.
+		MFRatio fps = this->_Scheduler->GetFrameRateConverter()->GetTargetRate();
+		UINT32 hintWidth, hintHeight;
+		this->_Presenter->GetWarmUpHint(&hintWidth, &hintHeight);
+		UINT32 thumbnailWidth, thumbnailHeight;
+		this->_Presenter->GetThumbnailSize(&thumbnailWidth, &thumbnailHeight);
+
+		this->_HotAttributes.Set(TMS_KEEP_ALIVE, this->_KeepAlive);
+		this->_HotAttributes.Set(TMS_OUTPUT_FORMAT, this->_Presenter->GetOutputFormat());
+		this->_HotAttributes.Set(TMS_PASSTHROUGH, this->_Presenter->GetPassthrough());
+		this->_HotAttributes.Set(TMS_MULTITHREAD_PROTECTION, this->_Presenter->GetMultithreadProtection());
+		this->_HotAttributes.Set(TMS_SHARED_TEXTURES, this->_Presenter->GetSharedTextures());
+		this->_HotAttributes.Set(TMS_GPU_TIMING, this->_Presenter->GetGpuTiming());
+		this->_HotAttributes.Set(TMS_FRC_MODE, this->_Scheduler->GetFrameRateConverter()->GetMode());
+		this->_HotAttributes.Set(TMS_FRC_TARGET_RATE, ((UINT64)fps.Numerator << 32) | fps.Denominator);	// Packed as MFSetAttributeRatio does.
+		this->_HotAttributes.Set(TMS_WARMUP_HINT, ((UINT64)hintWidth << 32) | hintHeight);				// Packed as MFSetAttributeSize does.
+		this->_HotAttributes.Set(TMS_DRAIN_TIMEOUT, this->_StreamSink->GetDrainTimeout());
+		this->_HotAttributes.Set(TMS_GAPLESS, this->_StreamSink->GetGapless());
+		this->_HotAttributes.Set(TMS_SCRUB_CACHE_BUDGET, this->_Presenter->GetScrubCacheBudget());
+		this->_HotAttributes.Set(TMS_THUMBNAIL_SIZE, ((UINT64)thumbnailWidth << 32) | thumbnailHeight);	// Packed as MFSetAttributeSize does.
+	}
+	HRESULT TextureMediaSink::Detach()
+	{
+		AutoLock lock(this->_csMediaSink);
+
+		// Leave the clock of the previous session.
+		if (NULL != this->_PresentationClock)
+			this->_PresentationClock->RemoveClockStateSink(this);
+		SafeRelease(this->_PresentationClock);
+
+		// Return the scheduled samples to the pool. The scheduler starts again with the next clock.
+		if (NULL != this->_Scheduler)
+			this->_Scheduler->Stop();
+
+		return this->_StreamSink->Detach();
+	}
 	HRESULT TextureMediaSink::CheckShutdown() const
 	{
 		return (this->_ShutdownFlag) ? MF_E_SHUTDOWN : S_OK;
@@ -5,7 +5,9 @@ namespace D3D11TextureMediaSink
 	class TextureMediaSink :
 		public MFAttributesImpl<IMFAttributes>,
 		public IMFMediaSink,
-		public IMFClockStateSink
+		public IMFClockStateSink,
+		public IMFRateSupport,
+		public IMFGetService
 	{
 	public:
 		static HRESULT CreateInstance(_In_ REFIID iid, _COM_Outptr_ void** ppSink, void* pDXGIDeviceManager, void* pD3D11Device);
@@ -42,22 +44,65 @@ namespace D3D11TextureMediaSink
 		STDMETHODIMP OnClockStart(MFTIME hnsSystemTime, LONGLONG llClockStartOffset);
 		STDMETHODIMP OnClockStop(MFTIME hnsSystemTime);
 
+		// IMFRateSupport declaration
+
+		STDMETHODIMP GetFastestRate(MFRATE_DIRECTION eDirection, BOOL fThin, _Out_ float* pflRate);
+		STDMETHODIMP GetSlowestRate(MFRATE_DIRECTION eDirection, BOOL fThin, _Out_ float* pflRate);
+		STDMETHODIMP IsRateSupported(BOOL fThin, float flRate, _Out_opt_ float* pflNearestSupportedRate);
+
+		// IMFGetService declaration
+
+		STDMETHODIMP GetService(__RPC__in REFGUID guidService, __RPC__in REFIID riid, __RPC__deref_out_opt LPVOID* ppvObject);
+
 		// IMFAttributes declaration
+		STDMETHODIMP GetItem(__RPC__in REFGUID guidKey, __RPC__inout_opt PROPVARIANT* pValue);
+		STDMETHODIMP GetItemType(__RPC__in REFGUID guidKey, __RPC__out MF_ATTRIBUTE_TYPE* pType);
+		STDMETHODIMP CompareItem(__RPC__in REFGUID guidKey, __RPC__in REFPROPVARIANT Value, __RPC__out BOOL* pbResult);
+		STDMETHODIMP Compare(__RPC__in_opt IMFAttributes* pTheirs, MF_ATTRIBUTES_MATCH_TYPE MatchType, __RPC__out BOOL* pbResult);
+		STDMETHODIMP GetUINT32(__RPC__in REFGUID guidKey, __RPC__out UINT32* punValue);
+		STDMETHODIMP GetUINT64(__RPC__in REFGUID guidKey, __RPC__out UINT64* punValue);
 		STDMETHODIMP GetUnknown(__RPC__in REFGUID guidKey, __RPC__in REFIID riid, __RPC__deref_out_opt LPVOID* ppv);
+		STDMETHODIMP GetBlobSize(__RPC__in REFGUID guidKey, __RPC__out UINT32* pcbBlobSize);
+		STDMETHODIMP GetBlob(__RPC__in REFGUID guidKey, __RPC__out_ecount_full(cbBufSize) UINT8* pBuf, UINT32 cbBufSize, __RPC__inout_opt UINT32* pcbBlobSize);
+		STDMETHODIMP GetAllocatedBlob(__RPC__in REFGUID guidKey, __RPC__deref_out_ecount_full_opt(*pcbSize) UINT8** ppBuf, __RPC__out UINT32* pcbSize);
+		STDMETHODIMP SetItem(__RPC__in REFGUID guidKey, __RPC__in REFPROPVARIANT Value);
+		STDMETHODIMP SetUINT32(__RPC__in REFGUID guidKey, UINT32 unValue);
+		STDMETHODIMP SetUINT64(__RPC__in REFGUID guidKey, UINT64 unValue);
+		STDMETHODIMP SetBlob(__RPC__in REFGUID guidKey, __RPC__in_ecount_full(cbBufSize) const UINT8* pBuf, UINT32 cbBufSize);
 		STDMETHODIMP SetUnknown(__RPC__in REFGUID guidKey, __RPC__in_opt IUnknown* pUnknown);
+		STDMETHODIMP GetCount(__RPC__out UINT32* pcItems);
+		STDMETHODIMP GetItemByIndex(UINT32 unIndex, __RPC__out GUID* pguidKey, __RPC__inout_opt PROPVARIANT* pValue);
+		STDMETHODIMP CopyAllItems(__RPC__in_opt IMFAttributes* pDest);
 
 	private:
 		long _ReferenceCount;
 		BOOL _ShutdownFlag = false;
+		volatile BOOL _KeepAlive = FALSE;		// Shutdown only detaches the sink from the session. (TMS_KEEP_ALIVE)
+		HotAttributeTable _HotAttributes;		// Attributes the consumer polls, readable without locks.
 		IMFPresentationClock* _PresentationClock = NULL;
 		StreamSink* _StreamSink = NULL;
 		Scheduler* _Scheduler = NULL;
 		Presenter* _Presenter = NULL;
+		DWORD _MemoryStreamId = 0;				// ID of this sink in the global texture memory budget. 0 if not registered.
 
+		// Lock order: when more than one lock is held, they must be acquired in this order.
+		//   TextureMediaSink::_csMediaSink
+		//   -> StreamSink::_csProcessing -> StreamSink::_csStreamSink
+		//   -> Scheduler::_csThread -> Scheduler::_csScheduler
+		//   -> StreamSink::_csPresentedSample
+		//   -> Presenter::_csPresenter -> Presenter::_csDeviceContext -> WarmUpWork::_csCreate
+		//   -> SampleAllocatorPool::_csPool
+		//   -> SampleAllocator::_csSampleAllocator
+		//   -> TextureMemoryBudget::_csBudget
+		// The locks inside the thread-safe queues, FrameRateConverter::_csFrc, RateCalculator::_csRates, TrickPlayPolicy::_csTrickPlay,
+		// Scheduler::_csDrain, FrameCache::_csCache, ThumbnailAtlas::_csAtlas, HotAttributeTable::_csWriter and GpuTimerQueryRing::_csTimer
+		// are leaves and never call out while held. (Except _csTimer to the D3D11 queries, and the presentation queue's to the descriptors
+		// of the samples, under _csPool and _csSampleAllocator, in InsertOrdered.) The hot attributes are read without any lock.
 		CriticalSection* _csMediaSink;				// Critical section for MediaSink
-		CriticalSection* _csStreamSinkAndScheduler; // Critical section for StreamSink and Scheduler
 
 		HRESULT Initialize();
+		HRESULT Detach();
+		void PublishConfiguration();
 		HRESULT CheckShutdown() const;
 	};
 }
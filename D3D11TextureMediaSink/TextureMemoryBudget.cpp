@@ -0,0 +1,182 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	TextureMemoryBudget* TextureMemoryBudget::GetGlobal()
+	{
+		static TextureMemoryBudget s_Global;
+		return &s_Global;
+	}
+
+	TextureMemoryBudget::TextureMemoryBudget(UINT64 budgetBytes)
+	{
+		this->_Budget = budgetBytes;
+	}
+	TextureMemoryBudget::~TextureMemoryBudget()
+	{
+		StreamEntry* pEntry = NULL;
+		while (SUCCEEDED(this->_Streams.RemoveFront(&pEntry)))
+			delete pEntry;
+	}
+
+	void TextureMemoryBudget::SetBudget(UINT64 budgetBytes)
+	{
+		AutoLock lock(&this->_csBudget);
+
+		this->_Budget = budgetBytes;
+	}
+	UINT64 TextureMemoryBudget::GetBudget()
+	{
+		AutoLock lock(&this->_csBudget);
+
+		return this->_Budget;
+	}
+	HRESULT TextureMemoryBudget::SetPolicy(UINT32 policy)
+	{
+		if (policy != TMS_MEMORY_POLICY_SHRINK_POOLS &&
+			policy != TMS_MEMORY_POLICY_LOWER_OUTPUT_SIZE &&
+			policy != TMS_MEMORY_POLICY_REFUSE_NEW_STREAMS)
+			return E_INVALIDARG;
+
+		AutoLock lock(&this->_csBudget);
+
+		this->_Policy = policy;
+
+		return S_OK;
+	}
+	UINT32 TextureMemoryBudget::GetPolicy()
+	{
+		AutoLock lock(&this->_csBudget);
+
+		return this->_Policy;
+	}
+
+	HRESULT TextureMemoryBudget::RegisterStream(DWORD* pStreamId)
+	{
+		if (NULL == pStreamId)
+			return E_POINTER;
+
+		AutoLock lock(&this->_csBudget);
+
+		// Refuse new streams while the budget is exceeded?
+		if (this->_Policy == TMS_MEMORY_POLICY_REFUSE_NEW_STREAMS && this->_TotalBytes > this->_Budget)
+			return E_OUTOFMEMORY;
+
+		StreamEntry* pEntry = new StreamEntry();
+		pEntry->Id = this->_NextStreamId++;
+		pEntry->CurrentBytes = 0;
+		pEntry->PeakBytes = 0;
+
+		HRESULT hr;
+		if (FAILED(hr = this->_Streams.InsertBack(pEntry)))
+		{
+			delete pEntry;
+			return hr;
+		}
+
+		*pStreamId = pEntry->Id;
+		return S_OK;
+	}
+	void TextureMemoryBudget::UnregisterStream(DWORD streamId)
+	{
+		AutoLock lock(&this->_csBudget);
+
+		StreamEntry* pEntry = this->FindStream(streamId);
+		if (NULL == pEntry)
+			return;
+
+		// Whatever the stream still holds is given back.
+		this->_TotalBytes -= pEntry->CurrentBytes;
+		this->_Streams.Remove(pEntry);
+		delete pEntry;
+	}
+	HRESULT TextureMemoryBudget::Reserve(DWORD streamId, UINT64 bytes)
+	{
+		AutoLock lock(&this->_csBudget);
+
+		StreamEntry* pEntry = this->FindStream(streamId);
+		if (NULL == pEntry)
+			return MF_E_NOT_FOUND;
+
+		// The reservation is always granted; S_FALSE tells the caller that the budget is now exceeded and the policy should be applied.
+		pEntry->CurrentBytes += bytes;
+		if (pEntry->PeakBytes < pEntry->CurrentBytes)
+			pEntry->PeakBytes = pEntry->CurrentBytes;
+		this->_TotalBytes += bytes;
+
+		return (this->_TotalBytes > this->_Budget) ? S_FALSE : S_OK;
+	}
+	void TextureMemoryBudget::Release(DWORD streamId, UINT64 bytes)
+	{
+		AutoLock lock(&this->_csBudget);
+
+		StreamEntry* pEntry = this->FindStream(streamId);
+		if (NULL == pEntry)
+			return;
+
+		// Never release more than the stream holds.
+		if (bytes > pEntry->CurrentBytes)
+			bytes = pEntry->CurrentBytes;
+
+		pEntry->CurrentBytes -= bytes;
+		this->_TotalBytes -= bytes;
+	}
+
+	BOOL TextureMemoryBudget::IsOverBudget()
+	{
+		AutoLock lock(&this->_csBudget);
+
+		return (this->_TotalBytes > this->_Budget);
+	}
+	UINT64 TextureMemoryBudget::GetTotalBytes()
+	{
+		AutoLock lock(&this->_csBudget);
+
+		return this->_TotalBytes;
+	}
+	HRESULT TextureMemoryBudget::GetStreamBytes(DWORD streamId, UINT64* pCurrentBytes, UINT64* pPeakBytes)
+	{
+		AutoLock lock(&this->_csBudget);
+
+		StreamEntry* pEntry = this->FindStream(streamId);
+		if (NULL == pEntry)
+			return MF_E_NOT_FOUND;
+
+		if (NULL != pCurrentBytes)
+			*pCurrentBytes = pEntry->CurrentBytes;
+		if (NULL != pPeakBytes)
+			*pPeakBytes = pEntry->PeakBytes;
+
+		return S_OK;
+	}
+	UINT32 TextureMemoryBudget::GetOutputDivisor(UINT64 bytes)
+	{
+		AutoLock lock(&this->_csBudget);
+
+		// Only under TMS_MEMORY_POLICY_LOWER_OUTPUT_SIZE.
+		if (this->_Policy != TMS_MEMORY_POLICY_LOWER_OUTPUT_SIZE)
+			return 1;
+
+		UINT64 available = (this->_TotalBytes < this->_Budget) ? (this->_Budget - this->_TotalBytes) : 0;
+
+		// Halve the width and height (a quarter of the bytes) until it fits.
+		UINT32 divisor = 1;
+		while (divisor < TEXTURE_MEMORY_OUTPUT_DIVISOR_MAX && bytes / ((UINT64)divisor * divisor) > available)
+			divisor *= 2;
+
+		return divisor;
+	}
+
+	// private
+
+	TextureMemoryBudget::StreamEntry* TextureMemoryBudget::FindStream(DWORD streamId)
+	{
+		for (StreamEntry* pEntry = this->_Streams.Front(); pEntry != NULL; pEntry = this->_Streams.Next(pEntry))
+		{
+			if (pEntry->Id == streamId)
+				return pEntry;
+		}
+
+		return NULL;
+	}
+}
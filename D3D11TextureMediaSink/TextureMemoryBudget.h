@@ -0,0 +1,54 @@
+#pragma once
+
+// Default texture memory budget for the whole process (bytes).
+#define TEXTURE_MEMORY_BUDGET_DEFAULT	(1024ULL * 1024 * 1024)
+
+// Largest divisor of the output size under TMS_MEMORY_POLICY_LOWER_OUTPUT_SIZE.
+#define TEXTURE_MEMORY_OUTPUT_DIVISOR_MAX	8
+
+namespace D3D11TextureMediaSink
+{
+	// Accounting of the texture memory held by the sinks, and the policy applied when it exceeds the budget.
+	// Every SampleAllocator reserves the size of its textures here, per stream.
+	//
+	class TextureMemoryBudget
+	{
+	public:
+		static TextureMemoryBudget* GetGlobal();	// The budget shared by all sinks in the process.
+
+		TextureMemoryBudget(UINT64 budgetBytes = TEXTURE_MEMORY_BUDGET_DEFAULT);
+		~TextureMemoryBudget();
+
+		void SetBudget(UINT64 budgetBytes);
+		UINT64 GetBudget();
+		HRESULT SetPolicy(UINT32 policy);
+		UINT32 GetPolicy();
+
+		HRESULT RegisterStream(DWORD* pStreamId);
+		void UnregisterStream(DWORD streamId);
+		HRESULT Reserve(DWORD streamId, UINT64 bytes);
+		void Release(DWORD streamId, UINT64 bytes);
+
+		BOOL IsOverBudget();
+		UINT64 GetTotalBytes();
+		HRESULT GetStreamBytes(DWORD streamId, UINT64* pCurrentBytes, UINT64* pPeakBytes);
+		UINT32 GetOutputDivisor(UINT64 bytes);
+
+	private:
+		struct StreamEntry : public IntrusiveListEntry
+		{
+			DWORD Id;
+			UINT64 CurrentBytes;
+			UINT64 PeakBytes;
+		};
+
+		UINT64 _Budget;
+		UINT32 _Policy = TMS_MEMORY_POLICY_SHRINK_POOLS;
+		UINT64 _TotalBytes = 0;
+		DWORD _NextStreamId = 1;
+		IntrusiveList<StreamEntry> _Streams;
+		CriticalSection _csBudget;
+
+		StreamEntry* FindStream(DWORD streamId);
+	};
+}
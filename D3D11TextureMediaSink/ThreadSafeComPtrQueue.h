@@ -2,7 +2,15 @@
 
 namespace D3D11TextureMediaSink
 {
+	// Decides where ThreadSafeComPtrQueue::InsertOrdered puts an item.
+	template <class T>
+	struct QueueOrder
+	{
+		virtual BOOL IsBefore(T* pQueued) = 0;	// Does the item go in front of the queued one? (Called with the queue locked.)
+	};
+
 	// Thread-safe queue that contains COM objects.
+	// Elements are stored in an array-backed ring, so queueing does not allocate in steady state.
 	// 
 	template <class T>
 	class ThreadSafeComPtrQueue
@@ -56,6 +64,64 @@ namespace D3D11TextureMediaSink
 
 			return hr;
 		}
+		HRESULT GetAt(DWORD offset, T** pp)	// Peeks at an item without removing it.
+		{
+			::EnterCriticalSection(&m_lock);
+
+			HRESULT hr = m_list.GetAt(offset, pp);
+
+			::LeaveCriticalSection(&m_lock);
+
+			return hr;
+		}
+		// Inserts the item in front of the queued items it goes before, walking from the back and stopping at the first one it
+		// does not. The walk and the insertion are one step, so neither the consumer nor another producer comes in between.
+		HRESULT InsertOrdered(T* p, QueueOrder<T>* pOrder)
+		{
+			::EnterCriticalSection(&m_lock);
+
+			DWORD offset = m_list.GetCount();
+			while (0 < offset)
+			{
+				T* pQueued = NULL;
+				if (FAILED(m_list.GetAt(offset - 1, &pQueued)))
+					break;
+				BOOL bBefore = pOrder->IsBefore(pQueued);
+				pQueued->Release();	// Still held by the queue.
+				if (!bBefore)
+					break;
+				offset--;
+			}
+			HRESULT hr = m_list.InsertAt(offset, p);
+
+			::LeaveCriticalSection(&m_lock);
+
+			return hr;
+		}
+		// Removes the item wherever it is in the queue. S_FALSE if it is not queued any more.
+		HRESULT Remove(T* p)
+		{
+			::EnterCriticalSection(&m_lock);
+
+			HRESULT hr = S_FALSE;
+			for (DWORD offset = 0; offset < m_list.GetCount(); offset++)
+			{
+				T* pQueued = NULL;
+				if (FAILED(m_list.GetAt(offset, &pQueued)))
+					break;
+				pQueued->Release();	// Still held by the queue.
+				if (pQueued == p)
+				{
+					hr = m_list.RemoveAt(offset, NULL);
+					break;
+				}
+			}
+
+			::LeaveCriticalSection(&m_lock);
+
+			return hr;
+		}
+
 		DWORD GetCount(void)
 		{
 			::EnterCriticalSection(&m_lock);
@@ -78,6 +144,6 @@ namespace D3D11TextureMediaSink
 
 	private:
 		CRITICAL_SECTION    m_lock;
-		ComPtrListEx<T>     m_list;
+		ComPtrRing<T>       m_list;
 	};
 }
@@ -3,6 +3,7 @@
 namespace D3D11TextureMediaSink
 {
 	// Thread-safe queue with non-COM objects as elements.
+	// Elements are stored in an array-backed ring, so queueing does not allocate in steady state.
 	// 
 	template <class T>
 	class ThreadSafePtrQueue
@@ -77,6 +78,6 @@ namespace D3D11TextureMediaSink
 
 	private:
 		CRITICAL_SECTION    m_lock;
-		PtrList<T>     m_list;
+		PtrRing<T>     m_list;
 	};
 }
@@ -0,0 +1,172 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	ThumbnailAtlas::ThumbnailAtlas()
+	{
+	}
+	ThumbnailAtlas::~ThumbnailAtlas()
+	{
+	}
+
+	HRESULT ThumbnailAtlas::SetLayout(UINT32 thumbnailWidth, UINT32 thumbnailHeight, UINT32 maxAtlasSize)
+	{
+		// Both or neither.
+		if ((0 == thumbnailWidth) != (0 == thumbnailHeight))
+			return E_INVALIDARG;
+
+		// At least one cell must fit.
+		if (thumbnailWidth > maxAtlasSize || thumbnailHeight > maxAtlasSize)
+			return E_INVALIDARG;
+
+		AutoLock lock(&this->_csAtlas);
+
+		this->_ThumbnailWidth = thumbnailWidth;
+		this->_ThumbnailHeight = thumbnailHeight;
+		this->_Columns = (0 < thumbnailWidth) ? min((UINT)THUMBNAIL_ATLAS_COLUMNS, maxAtlasSize / thumbnailWidth) : 0;
+		this->_Rows = (0 < thumbnailHeight) ? min((UINT)THUMBNAIL_ATLAS_ROWS, maxAtlasSize / thumbnailHeight) : 0;
+		this->_CellCount = 0;
+
+		return S_OK;
+	}
+	void ThumbnailAtlas::GetThumbnailSize(UINT32* pWidth, UINT32* pHeight)
+	{
+		AutoLock lock(&this->_csAtlas);
+
+		*pWidth = this->_ThumbnailWidth;
+		*pHeight = this->_ThumbnailHeight;
+	}
+	void ThumbnailAtlas::GetAtlasSize(UINT32* pWidth, UINT32* pHeight)
+	{
+		AutoLock lock(&this->_csAtlas);
+
+		*pWidth = this->_ThumbnailWidth * this->_Columns;
+		*pHeight = this->_ThumbnailHeight * this->_Rows;
+	}
+	BOOL ThumbnailAtlas::IsEnabled()
+	{
+		AutoLock lock(&this->_csAtlas);
+
+		return (0 < this->_ThumbnailWidth);
+	}
+
+	HRESULT ThumbnailAtlas::SetRequests(const LONGLONG* pTimes, UINT count)
+	{
+		if (NULL == pTimes && 0 < count)
+			return E_POINTER;
+		if (count > TMS_THUMBNAIL_REQUEST_MAX)
+			return E_INVALIDARG;
+
+		AutoLock lock(&this->_csAtlas);
+
+		if (0 < count)
+		{
+			memcpy(this->_Requests, pTimes, sizeof(LONGLONG) * count);
+			::qsort(this->_Requests, count, sizeof(LONGLONG), &ThumbnailAtlas::CompareTimes);
+		}
+		this->_RequestCount = count;
+		this->_NextRequest = 0;
+		this->_MissedCount = 0;
+		this->_CellCount = 0;
+
+		return S_OK;
+	}
+	UINT ThumbnailAtlas::GetPendingCount()
+	{
+		AutoLock lock(&this->_csAtlas);
+
+		return this->_RequestCount - this->_NextRequest;
+	}
+	UINT ThumbnailAtlas::GetMissedCount()
+	{
+		AutoLock lock(&this->_csAtlas);
+
+		return this->_MissedCount;
+	}
+
+	BOOL ThumbnailAtlas::Match(LONGLONG hnsSampleTime, LONGLONG hnsDuration, _Out_ TMS_THUMBNAIL* pThumbnail)
+	{
+		AutoLock lock(&this->_csAtlas);
+
+		if (0 == this->_ThumbnailWidth)
+			return FALSE;	// Off.
+
+		// The requests before the frame were passed (a sparse decode after a seek, or requests closer together than the
+		// frames); a later frame would show the wrong picture, so they are missed.
+		while (this->_NextRequest < this->_RequestCount && this->_Requests[this->_NextRequest] < hnsSampleTime)
+		{
+			this->_NextRequest++;
+			this->_MissedCount++;
+		}
+
+		// No request left, or no free cell until the batch is taken?
+		if (this->_NextRequest >= this->_RequestCount || this->_CellCount >= this->_Columns * this->_Rows)
+			return FALSE;
+
+		// The frame on display at the request serves it. A frame without a duration only at its own time.
+		LONGLONG hnsRequest = this->_Requests[this->_NextRequest];
+		if (hnsSampleTime + max(1LL, hnsDuration) <= hnsRequest)
+			return FALSE;
+
+		// The cells are filled row by row.
+		UINT cell = this->_CellCount++;
+		TMS_THUMBNAIL* pCell = &this->_Cells[cell];
+		pCell->RequestTime = hnsRequest;
+		pCell->SampleTime = hnsSampleTime;
+		pCell->X = (cell % this->_Columns) * this->_ThumbnailWidth;
+		pCell->Y = (cell / this->_Columns) * this->_ThumbnailHeight;
+		pCell->Width = this->_ThumbnailWidth;
+		pCell->Height = this->_ThumbnailHeight;
+		this->_NextRequest++;
+
+		*pThumbnail = *pCell;
+		return TRUE;
+	}
+	BOOL ThumbnailAtlas::IsBatchReady()
+	{
+		AutoLock lock(&this->_csAtlas);
+
+		if (0 == this->_CellCount)
+			return FALSE;
+
+		return (this->_CellCount >= this->_Columns * this->_Rows || this->_NextRequest >= this->_RequestCount);
+	}
+	UINT ThumbnailAtlas::TakeBatch(_Out_writes_(THUMBNAIL_ATLAS_CELLS) TMS_THUMBNAIL* pThumbnails)
+	{
+		AutoLock lock(&this->_csAtlas);
+
+		UINT count = this->_CellCount;
+		memcpy(pThumbnails, this->_Cells, sizeof(TMS_THUMBNAIL) * count);
+		this->_CellCount = 0;
+
+		return count;
+	}
+
+	void ThumbnailAtlas::FitFrame(UINT32 frameWidth, UINT32 frameHeight, const TMS_THUMBNAIL& thumbnail, _Out_ RECT* pRect)
+	{
+		// As large as the cell allows, keeping the aspect ratio of the frame, and centered.
+		UINT32 width = thumbnail.Width;
+		UINT32 height = thumbnail.Height;
+		if (0 < frameWidth && 0 < frameHeight)
+		{
+			if ((UINT64)frameWidth * thumbnail.Height > (UINT64)frameHeight * thumbnail.Width)
+				height = max(1U, (UINT32)((UINT64)thumbnail.Width * frameHeight / frameWidth));	// Wider than the cell: bars above and below.
+			else
+				width = max(1U, (UINT32)((UINT64)thumbnail.Height * frameWidth / frameHeight));	// Taller: bars on the sides.
+		}
+
+		pRect->left = (LONG)(thumbnail.X + (thumbnail.Width - width) / 2);
+		pRect->top = (LONG)(thumbnail.Y + (thumbnail.Height - height) / 2);
+		pRect->right = pRect->left + (LONG)width;
+		pRect->bottom = pRect->top + (LONG)height;
+	}
+
+	// private
+
+	int __cdecl ThumbnailAtlas::CompareTimes(const void* p1, const void* p2)
+	{
+		LONGLONG time1 = *(const LONGLONG*)p1;
+		LONGLONG time2 = *(const LONGLONG*)p2;
+		return (time1 < time2) ? -1 : ((time1 > time2) ? 1 : 0);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#define THUMBNAIL_ATLAS_COLUMNS		8		// Most cells of the atlas in a row, and in a column.
+#define THUMBNAIL_ATLAS_ROWS		8		//
+#define THUMBNAIL_ATLAS_CELLS		(THUMBNAIL_ATLAS_COLUMNS * THUMBNAIL_ATLAS_ROWS)
+
+namespace D3D11TextureMediaSink
+{
+	// The requests of the thumbnail mode, and the packing of their thumbnails into the cells of an atlas that is read back in batches.
+	// The requested times are kept sorted. A frame serves every pending request it covers, each into the next free cell; the
+	// requests it has already passed are missed, never served by a later frame. The batch is ready when the cells are full or no
+	// request is left.
+	//
+	class ThumbnailAtlas
+	{
+	public:
+		ThumbnailAtlas();
+		~ThumbnailAtlas();
+
+		HRESULT SetLayout(UINT32 thumbnailWidth, UINT32 thumbnailHeight, UINT32 maxAtlasSize);	// 0 x 0: off. Drops the batch.
+		void GetThumbnailSize(UINT32* pWidth, UINT32* pHeight);
+		void GetAtlasSize(UINT32* pWidth, UINT32* pHeight);		// 0 x 0 when off.
+		BOOL IsEnabled();
+
+		HRESULT SetRequests(const LONGLONG* pTimes, UINT count);	// Replaces the pending requests. Drops the batch.
+		UINT GetPendingCount();
+		UINT GetMissedCount();		// Requests passed by the frames since SetRequests.
+
+		BOOL Match(LONGLONG hnsSampleTime, LONGLONG hnsDuration, _Out_ TMS_THUMBNAIL* pThumbnail);	// The next request the frame serves, in its cell.
+		BOOL IsBatchReady();	// The cells are full, or the last request has been served.
+		UINT TakeBatch(_Out_writes_(THUMBNAIL_ATLAS_CELLS) TMS_THUMBNAIL* pThumbnails);	// Empties the cells.
+
+		static void FitFrame(UINT32 frameWidth, UINT32 frameHeight, const TMS_THUMBNAIL& thumbnail, _Out_ RECT* pRect);	// Letterboxed in the cell.
+
+	private:
+		UINT32 _ThumbnailWidth = 0;
+		UINT32 _ThumbnailHeight = 0;
+		UINT _Columns = 0;
+		UINT _Rows = 0;
+		LONGLONG _Requests[TMS_THUMBNAIL_REQUEST_MAX] = {};	// Sorted.
+		UINT _RequestCount = 0;
+		UINT _NextRequest = 0;						// The requests before it have been served or missed.
+		UINT _MissedCount = 0;
+		TMS_THUMBNAIL _Cells[THUMBNAIL_ATLAS_CELLS] = {};
+		UINT _CellCount = 0;						// Cells used by the batch.
+		CriticalSection _csAtlas;
+
+		static int __cdecl CompareTimes(const void* p1, const void* p2);
+	};
+}
@@ -0,0 +1,116 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	TrickPlayPolicy::TrickPlayPolicy()
+	{
+	}
+	TrickPlayPolicy::~TrickPlayPolicy()
+	{
+	}
+
+	HRESULT TrickPlayPolicy::SetFrameRate(const MFRatio& fps)
+	{
+		HRESULT hr;
+
+		UINT64 avgTimePerFrame = 0;
+		if (FAILED(hr = ::MFFrameRateToAverageTimePerFrame(fps.Numerator, fps.Denominator, &avgTimePerFrame)))
+			return hr;
+		if (avgTimePerFrame == 0)
+			return E_INVALIDARG;
+
+		AutoLock lock(&this->_csTrickPlay);
+
+		this->_FrameInterval = (LONGLONG)avgTimePerFrame;
+
+		return S_OK;
+	}
+	void TrickPlayPolicy::SetRate(float rate)
+	{
+		AutoLock lock(&this->_csTrickPlay);
+
+		// A change of direction or speed starts the selection anew.
+		if (rate != this->_Rate)
+			this->_HasNext = FALSE;
+
+		this->_Rate = rate;
+	}
+	float TrickPlayPolicy::GetRate()
+	{
+		AutoLock lock(&this->_csTrickPlay);
+
+		return this->_Rate;
+	}
+	BOOL TrickPlayPolicy::IsThinning()
+	{
+		AutoLock lock(&this->_csTrickPlay);
+
+		return (::fabsf(this->_Rate) > TRICKPLAY_THINNING_RATE);
+	}
+	BOOL TrickPlayPolicy::IsReverse()
+	{
+		AutoLock lock(&this->_csTrickPlay);
+
+		return (this->_Rate < 0.0f);
+	}
+
+	void TrickPlayPolicy::Reset()
+	{
+		AutoLock lock(&this->_csTrickPlay);
+
+		this->_HasNext = FALSE;
+	}
+	BOOL TrickPlayPolicy::ShouldProcess(LONGLONG sampleTime)
+	{
+		AutoLock lock(&this->_csTrickPlay);
+
+		float absRate = ::fabsf(this->_Rate);
+		if (absRate <= TRICKPLAY_THINNING_RATE)
+			return TRUE;	// Every frame is shown.
+
+		// One frame is shown for every |rate| frames of media time.
+		LONGLONG slot = (LONGLONG)(absRate * this->_FrameInterval);
+
+		if (this->_Rate > 0.0f)
+		{
+			if (this->_HasNext && sampleTime < this->_NextTime)
+			{
+				this->_ThinnedCount++;
+				return FALSE;
+			}
+			this->_NextTime = sampleTime + slot;
+		}
+		else
+		{
+			// In reverse playback, the media time runs backwards.
+			if (this->_HasNext && sampleTime > this->_NextTime)
+			{
+				this->_ThinnedCount++;
+				return FALSE;
+			}
+			this->_NextTime = sampleTime - slot;
+		}
+
+		this->_HasNext = TRUE;
+		return TRUE;
+	}
+	BOOL TrickPlayPolicy::IsLate(LONGLONG sampleTime, LONGLONG clockTime)
+	{
+		AutoLock lock(&this->_csTrickPlay);
+
+		// In reverse playback, the clock also runs in reverse, so a frame is late if it is after the clock.
+		return (this->_Rate < 0.0f) ? (sampleTime > clockTime) : (sampleTime < clockTime);
+	}
+	BOOL TrickPlayPolicy::IsBefore(LONGLONG sampleTime1, LONGLONG sampleTime2)
+	{
+		AutoLock lock(&this->_csTrickPlay);
+
+		return (this->_Rate < 0.0f) ? (sampleTime1 > sampleTime2) : (sampleTime1 < sampleTime2);
+	}
+	UINT64 TrickPlayPolicy::GetThinnedCount()
+	{
+		AutoLock lock(&this->_csTrickPlay);
+
+		return this->_ThinnedCount;
+	}
+}
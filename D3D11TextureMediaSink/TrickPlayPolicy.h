@@ -0,0 +1,39 @@
+#pragma once
+
+// Above this playback rate (absolute value), only the frames that can actually be shown are processed.
+#define TRICKPLAY_THINNING_RATE	2.0f
+
+namespace D3D11TextureMediaSink
+{
+	// Decisions of the stream sink for fast and reverse playback.
+	// At high rates, the display cannot show every frame; at the source frame rate, one frame is shown for every |rate| frames
+	// of media time. This class picks those frames, so that the others are dropped before any video processing, and tells
+	// whether a frame is late in the direction of playback.
+	//
+	class TrickPlayPolicy
+	{
+	public:
+		TrickPlayPolicy();
+		~TrickPlayPolicy();
+
+		HRESULT SetFrameRate(const MFRatio& fps);
+		void SetRate(float rate);
+		float GetRate();
+		BOOL IsThinning();
+		BOOL IsReverse();
+
+		void Reset();	// Starts anew. (start, seek, flush)
+		BOOL ShouldProcess(LONGLONG sampleTime);
+		BOOL IsLate(LONGLONG sampleTime, LONGLONG clockTime);
+		BOOL IsBefore(LONGLONG sampleTime1, LONGLONG sampleTime2);	// Is the first one presented before the second one?
+		UINT64 GetThinnedCount();
+
+	private:
+		float _Rate = 1.0f;
+		LONGLONG _FrameInterval = 333667;	// 100ns units
+		BOOL _HasNext = FALSE;
+		LONGLONG _NextTime = 0;				// Media time of the next frame to show while thinning.
+		UINT64 _ThinnedCount = 0;
+		CriticalSection _csTrickPlay;
+	};
+}
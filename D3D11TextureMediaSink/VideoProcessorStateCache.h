@@ -0,0 +1,48 @@
+#pragma once
+
+// Groups of the stream state of a video processor, as the presenter sets them.
+#define VP_STATE_FRAME_FORMAT	0x1		// The frame format of input stream 0.
+#define VP_STATE_GEOMETRY		0x2		// The output rate, the rectangles and the background. They depend on the pool entry only.
+#define VP_STATE_COLOR_SPACE	0x4		// The input and output color spaces, from the YUV matrix.
+#define VP_STATE_ALL			(VP_STATE_FRAME_FORMAT | VP_STATE_GEOMETRY | VP_STATE_COLOR_SPACE)
+
+namespace D3D11TextureMediaSink
+{
+	// The stream state last set on a video processor.
+	// The state belongs to the processor and stays until it is changed, so only the groups that differ from the last frame
+	// are set again. All zeros is a processor with no state set.
+	//
+	class VideoProcessorStateCache
+	{
+	public:
+		// A new processor has none of the state.
+		void Invalidate()
+		{
+			this->_IsSet = FALSE;
+		}
+
+		// Returns the VP_STATE_* groups to set for a frame. From then on, they count as set.
+		DWORD Update(UINT32 frameFormat, UINT32 yuvMatrix)
+		{
+			DWORD groups = 0;
+
+			if (!this->_IsSet)
+				groups = VP_STATE_ALL;
+			if (frameFormat != this->_FrameFormat)
+				groups |= VP_STATE_FRAME_FORMAT;
+			if (yuvMatrix != this->_YuvMatrix)
+				groups |= VP_STATE_COLOR_SPACE;
+
+			this->_IsSet = TRUE;
+			this->_FrameFormat = frameFormat;
+			this->_YuvMatrix = yuvMatrix;
+
+			return groups;
+		}
+
+	private:
+		BOOL _IsSet = FALSE;
+		UINT32 _FrameFormat = 0;
+		UINT32 _YuvMatrix = 0;
+	};
+}
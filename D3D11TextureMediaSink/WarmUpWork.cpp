@@ -0,0 +1,75 @@
+#include "stdafx.h"
+
+namespace D3D11TextureMediaSink
+{
+	WarmUpWork::WarmUpWork()
+	{
+	}
+	WarmUpWork::~WarmUpWork()
+	{
+		this->Close();
+	}
+
+	HRESULT WarmUpWork::Start(WarmUpTarget* pTarget, void* pItem)
+	{
+		if (NULL == pTarget)
+			return E_POINTER;
+
+		// One at a time; the target of the work in progress must not change under it.
+		this->Wait();
+
+		if (NULL == this->_Work)
+		{
+			this->_Work = ::CreateThreadpoolWork(&WarmUpWork::WorkProxy, this, NULL);
+			if (NULL == this->_Work)
+				return HRESULT_FROM_WIN32(::GetLastError());	// The first use creates it, then.
+		}
+
+		this->_Target = pTarget;
+		this->_Item = pItem;
+		::SubmitThreadpoolWork(this->_Work);
+
+		return S_OK;
+	}
+	HRESULT WarmUpWork::Ensure(WarmUpTarget* pTarget, void* pItem, LONGLONG* phnsWait)
+	{
+		if (NULL == pTarget)
+			return E_POINTER;
+
+		// If the warm-up is creating it, wait for that rather than create another one.
+		MFTIME hnsStart = ::MFGetSystemTime();
+		AutoLock lock(&this->_csCreate);
+
+		HRESULT hr = pTarget->WarmUp(pItem);
+
+		if (NULL != phnsWait)
+			*phnsWait += ::MFGetSystemTime() - hnsStart;
+
+		return hr;
+	}
+	void WarmUpWork::Wait()
+	{
+		if (NULL != this->_Work)
+			::WaitForThreadpoolWorkCallbacks(this->_Work, FALSE);
+	}
+	void WarmUpWork::Close()
+	{
+		if (NULL != this->_Work)
+		{
+			::WaitForThreadpoolWorkCallbacks(this->_Work, FALSE);
+			::CloseThreadpoolWork(this->_Work);
+			this->_Work = NULL;
+		}
+	}
+
+	// private
+
+	void CALLBACK WarmUpWork::WorkProxy(PTP_CALLBACK_INSTANCE pInstance, void* arg, PTP_WORK pWork)
+	{
+		WarmUpWork* pThis = reinterpret_cast<WarmUpWork*>(arg);
+
+		// A failure is left to the first use, which tries again and reports it.
+		AutoLock lock(&pThis->_csCreate);
+		pThis->_Target->WarmUp(pThis->_Item);
+	}
+}
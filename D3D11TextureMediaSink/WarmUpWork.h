@@ -0,0 +1,37 @@
+#pragma once
+
+namespace D3D11TextureMediaSink
+{
+	// What the warm-up creates, for WarmUpWork.
+	//
+	class WarmUpTarget
+	{
+	public:
+		virtual ~WarmUpTarget() {}
+
+		virtual HRESULT WarmUp(void* pItem) = 0;	// Creates the object of the item, unless it already has one.
+	};
+
+	// Creates an object on a threadpool work item ahead of its first use, so that the first use waits for what is left of the
+	// creation at most, and never creates a second one. The object itself is created by the target.
+	//
+	class WarmUpWork
+	{
+	public:
+		WarmUpWork();
+		~WarmUpWork();
+
+		HRESULT Start(WarmUpTarget* pTarget, void* pItem);								// Does not wait for the creation.
+		HRESULT Ensure(WarmUpTarget* pTarget, void* pItem, LONGLONG* phnsWait = NULL);	// Creates it now, or waits for the warm-up creating it. Adds the time spent to *phnsWait.
+		void Wait();																	// Waits for the work in progress, if any.
+		void Close();																	// Waits, and frees the work item.
+
+	private:
+		PTP_WORK _Work = NULL;
+		WarmUpTarget* _Target = NULL;	// What the work in progress creates. Not changed until it is done.
+		void* _Item = NULL;				//
+		CriticalSection _csCreate;		// Serializes the creation by the work and by Ensure.
+
+		static void CALLBACK WorkProxy(PTP_CALLBACK_INSTANCE pInstance, void* arg, PTP_WORK pWork);
+	};
+}
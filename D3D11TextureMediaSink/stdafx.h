@@ -22,6 +22,8 @@
 #include <mfreadwrite.h>
 #include <evr.h>
 #include <d3d11.h>
+#include <d3d10.h>	// ID3D10Multithread
+#include <dxgi1_2.h>
 #include <cguid.h>
 #include <process.h>
 #include <avrt.h>
@@ -52,16 +54,45 @@ template <class T> inline void SafeRelease(T*& pT)
 #include "AsyncCallback.h"
 #include "CriticalSection.h"
 #include "AutoLock.h"
+#include "DeviceContextLock.h"
 #include "ComPtrListEx.h"
+#include "ComPtrRing.h"
+#include "IntrusiveList.h"
 #include "MFAttributesImpl.h"
 #include "PtrList.h"
+#include "PtrRing.h"
 #include "ThreadSafeComPtrQueue.h"
 #include "ThreadSafePtrQueue.h"
 #include "IMarker.h"
 #include "Marker.h"
+#include "MarkerSequence.h"
+#include "OutputFormat.h"
+#include "Fnv1a.h"
+#include "CapabilityCache.h"
+#include "HotAttributeTable.h"
+#include "TextureMemoryBudget.h"
+#include "ReferenceFrameHistory.h"
+#include "GpuFence.h"
+#include "SampleFenceList.h"
+#include "SharedFrameRing.h"
+#include "VideoProcessorStateCache.h"
 #include "SampleAllocator.h"
+#include "SamplePoolCache.h"
+#include "SampleAllocatorPool.h"
+#include "FrameDescription.h"
+#include "FrameCache.h"
+#include "ThumbnailAtlas.h"
+#include "FrameRateConverter.h"
+#include "RateCalculator.h"
 #include "Scheduler.h"
+#include "PassthroughPolicy.h"
+#include "GpuTimerQueryRing.h"
+#include "D3D11GpuTimerQueryProvider.h"
+#include "WarmUpWork.h"
+#include "FirstFrameTimer.h"
 #include "Presenter.h"
+#include "TrickPlayPolicy.h"
+#include "SegmentTimeline.h"
 #include "StreamSink.h"
 #include "TextureMediaSink.h"
 
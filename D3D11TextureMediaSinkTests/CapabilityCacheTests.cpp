@@ -0,0 +1,205 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	CapabilityKey Key(UINT32 width, UINT32 height, const GUID& subtype = MFVideoFormat_NV12)
+	{
+		CapabilityKey key = {};
+		key.Subtype = subtype;
+		key.WidthBucket = width;
+		key.HeightBucket = height;
+		key.FrameRateNumerator = 30000;
+		key.FrameRateDenominator = 1001;
+		return key;
+	}
+	CapabilityResult Result(HRESULT hr, DXGI_FORMAT format = DXGI_FORMAT_NV12)
+	{
+		CapabilityResult result = { hr, format };
+		return result;
+	}
+
+	class FakeCapabilityProvider : public CapabilityProvider
+	{
+	public:
+		HRESULT Answer = S_OK;
+		UINT Probes = 0;
+		UINT32 Width = 0;
+		UINT32 Height = 0;
+
+		HRESULT CheckMediaType(const CapabilityKey& key, UINT32 width, UINT32 height, _Out_ DXGI_FORMAT* pDXGIFormat)
+		{
+			this->Probes++;
+			this->Width = width;
+			this->Height = height;
+			*pDXGIFormat = DXGI_FORMAT_NV12;
+			return this->Answer;
+		}
+	};
+}
+
+TEST(MakeKeyRoundsTheSizeUpAndKeepsTheRealOne)
+{
+	FakeMediaType* pType = new FakeMediaType(MFVideoFormat_NV12, 1920, 1080);
+
+	CapabilityKey key;
+	UINT32 width = 0, height = 0;
+	CHECK_EQUAL(S_OK, CapabilityCache::MakeKey(pType, &key, &width, &height));
+	CHECK(MFVideoFormat_NV12 == key.Subtype);
+	CHECK_EQUAL(1920u, key.WidthBucket);
+	CHECK_EQUAL(1088u, key.HeightBucket);	// The bucket is only the cache key...
+	CHECK_EQUAL(1920u, width);
+	CHECK_EQUAL(1080u, height);				// ...the probe gets the frame size itself.
+
+	// The defaults of the optional attributes.
+	CHECK_EQUAL(30000u, key.FrameRateNumerator);
+	CHECK_EQUAL(1001u, key.FrameRateDenominator);
+	CHECK(!key.Interlaced);
+
+	pType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_FieldInterleavedUpperFirst);
+	::MFSetAttributeSize(pType, MF_MT_FRAME_RATE, 25, 1);
+	CHECK_EQUAL(S_OK, CapabilityCache::MakeKey(pType, &key));
+	CHECK(key.Interlaced);
+	CHECK_EQUAL(25u, key.FrameRateNumerator);
+
+	pType->Release();
+}
+
+TEST(MakeKeyNeedsTheSubtypeAndTheSize)
+{
+	CapabilityKey key;
+	CHECK_EQUAL(E_POINTER, CapabilityCache::MakeKey(NULL, &key));
+
+	FakeMediaType* pType = new FakeMediaType(MFVideoFormat_NV12, 640, 480);
+	CHECK_EQUAL(E_POINTER, CapabilityCache::MakeKey(pType, NULL));
+	pType->DeleteItem(MF_MT_FRAME_SIZE);
+	CHECK(FAILED(CapabilityCache::MakeKey(pType, &key)));
+	pType->Release();
+}
+
+TEST(SizesInTheSameBucketShareTheAnswer)
+{
+	CapabilityCache cache;
+	FakeMediaType* pType1080 = new FakeMediaType(MFVideoFormat_NV12, 1920, 1080);
+	FakeMediaType* pType1088 = new FakeMediaType(MFVideoFormat_NV12, 1920, 1088);
+	FakeMediaType* pType720 = new FakeMediaType(MFVideoFormat_NV12, 1280, 720);
+
+	CapabilityKey key1080, key1088, key720;
+	CapabilityCache::MakeKey(pType1080, &key1080);
+	CapabilityCache::MakeKey(pType1088, &key1088);
+	CapabilityCache::MakeKey(pType720, &key720);
+
+	cache.Insert(key1080, Result(S_OK));
+
+	CapabilityResult result;
+	CHECK(cache.Find(key1088, &result));
+	CHECK_EQUAL(S_OK, result.Result);
+	CHECK_EQUAL(DXGI_FORMAT_NV12, result.Format);
+	CHECK(!cache.Find(key720, &result));
+	CHECK_EQUAL(1u, cache.GetHitCount());
+	CHECK_EQUAL(1u, cache.GetMissCount());
+
+	pType1080->Release();
+	pType1088->Release();
+	pType720->Release();
+}
+
+TEST(EveryFieldOfTheKeyCounts)
+{
+	CapabilityCache cache;
+	cache.Insert(Key(640, 480), Result(S_OK));
+
+	CapabilityKey other[5] = { Key(640, 480, MFVideoFormat_YUY2), Key(656, 480), Key(640, 496), Key(640, 480), Key(640, 480) };
+	other[3].FrameRateNumerator = 25;
+	other[4].Interlaced = TRUE;
+
+	CapabilityResult result;
+	for (int i = 0; i < 5; i++)
+		CHECK(!cache.Find(other[i], &result));
+	CHECK(cache.Find(Key(640, 480), &result));
+}
+
+TEST(InsertReplacesTheAnswer)
+{
+	CapabilityCache cache;
+	cache.Insert(Key(640, 480), Result(MF_E_UNSUPPORTED_D3D_TYPE));
+	cache.Insert(Key(640, 480), Result(S_OK));
+
+	CapabilityResult result;
+	CHECK(cache.Find(Key(640, 480), &result));
+	CHECK_EQUAL(S_OK, result.Result);
+}
+
+TEST(AFullTableStartsOver)
+{
+	CapabilityCache cache;
+	const int count = CAPABILITY_CACHE_SLOTS * 3 / 4;
+	for (int i = 0; i < count; i++)
+		cache.Insert(Key(16 * (i + 1), 16), Result(S_OK));
+
+	// All of them are found while the table is 3/4 full.
+	CapabilityResult result;
+	for (int i = 0; i < count; i++)
+		CHECK(cache.Find(Key(16 * (i + 1), 16), &result));
+
+	// One more, and only that one is left.
+	cache.Insert(Key(16, 32), Result(S_OK));
+	CHECK(cache.Find(Key(16, 32), &result));
+	CHECK(!cache.Find(Key(16, 16), &result));
+}
+
+TEST(InvalidateForgetsTheDevice)
+{
+	CapabilityCache cache;
+	cache.Insert(Key(640, 480), Result(S_OK));
+	cache.Invalidate();
+
+	CapabilityResult result;
+	CHECK(!cache.Find(Key(640, 480), &result));
+}
+
+TEST(NegotiateProbesEachTypeOnce)
+{
+	CapabilityCache cache;
+	FakeCapabilityProvider provider;
+	FakeMediaType* pType = new FakeMediaType(MFVideoFormat_NV12, 1920, 1080);
+
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	CHECK_EQUAL(S_OK, cache.Negotiate(pType, &provider, &format));
+	CHECK_EQUAL(DXGI_FORMAT_NV12, format);
+	CHECK_EQUAL(1080u, provider.Height);	// Probed with the frame size, not the bucket.
+
+	format = DXGI_FORMAT_UNKNOWN;
+	CHECK_EQUAL(S_OK, cache.Negotiate(pType, &provider, &format));
+	CHECK_EQUAL(DXGI_FORMAT_NV12, format);
+	CHECK_EQUAL(1u, provider.Probes);
+
+	// A transient error is asked again.
+	cache.Invalidate();
+	provider.Answer = E_OUTOFMEMORY;
+	CHECK_EQUAL(E_OUTOFMEMORY, cache.Negotiate(pType, &provider, &format));
+	provider.Answer = MF_E_UNSUPPORTED_D3D_TYPE;
+	CHECK_EQUAL(MF_E_UNSUPPORTED_D3D_TYPE, cache.Negotiate(pType, &provider, &format));
+	CHECK_EQUAL(MF_E_UNSUPPORTED_D3D_TYPE, cache.Negotiate(pType, &provider, &format));
+	CHECK_EQUAL(3u, provider.Probes);
+
+	CHECK_EQUAL(E_POINTER, cache.Negotiate(NULL, &provider, &format));
+	CHECK_EQUAL(E_POINTER, cache.Negotiate(pType, NULL, &format));
+	pType->Release();
+}
+
+TEST(OnlyDefiniteAnswersAreCached)
+{
+	CHECK(CapabilityCache::IsCacheable(S_OK));
+	CHECK(CapabilityCache::IsCacheable(MF_E_INVALIDMEDIATYPE));
+	CHECK(CapabilityCache::IsCacheable(MF_E_UNSUPPORTED_D3D_TYPE));
+	CHECK(CapabilityCache::IsCacheable(E_INVALIDARG));
+	CHECK(!CapabilityCache::IsCacheable(E_OUTOFMEMORY));
+	CHECK(!CapabilityCache::IsCacheable(MF_E_SHUTDOWN));
+}
+
+TEST_MAIN()
@@ -0,0 +1,177 @@
+// Media type negotiation at session start, with and without the capability cache.
+//
+// Topology resolution probes every output type of the decoder, for every rendition of the stream, and does so more than once
+// (partial resolution, full resolution, the type change after the first sample). Here that is TYPE_COUNT types probed three
+// times through CapabilityCache::Negotiate, as StreamSink::IsMediaTypeSupported does. The provider takes PROBE_COST_US for
+// each answer, about what creating a video processor enumerator costs; without the cache, every probe pays it.
+//
+// Prints the time of the first pass (cold), of the passes after it (warm), and of the same probes without the cache. The
+// number of passes can be given as the first argument. The run fails only if the cache answers differently from the provider.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+#include <chrono>
+#include <stdlib.h>
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	const long PROBE_COST_US = 200;
+	long s_Passes = 3;
+
+	// A subtype the decoder offers and the sink does not take.
+	const GUID SUBTYPE_UNSUPPORTED = { 0x34363248, 0x0000, 0x0010, { 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 } };
+
+	const GUID* const SUBTYPES[] = { &MFVideoFormat_NV12, &MFVideoFormat_YUY2, &MFVideoFormat_RGB32, &MFVideoFormat_ARGB32, &SUBTYPE_UNSUPPORTED };
+	const UINT32 SIZES[][2] = { { 640, 360 }, { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+	const UINT32 INTERLACE_MODES[] = { MFVideoInterlace_Progressive, MFVideoInterlace_MixedInterlaceOrProgressive };
+	const UINT TYPE_COUNT = _countof(SUBTYPES) * _countof(SIZES) * _countof(INTERLACE_MODES);
+
+	// The presenter, with the cost of creating an enumerator for each probe.
+	class SlowCapabilityProvider : public CapabilityProvider
+	{
+	public:
+		UINT Probes = 0;
+
+		HRESULT CheckMediaType(const CapabilityKey& key, UINT32 width, UINT32 height, _Out_ DXGI_FORMAT* pDXGIFormat)
+		{
+			this->Probes++;
+
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::microseconds(PROBE_COST_US);
+			while (std::chrono::steady_clock::now() < end)
+				;
+
+			return Answer(key, width, pDXGIFormat);
+		}
+
+		static HRESULT Answer(const CapabilityKey& key, UINT32 width, _Out_ DXGI_FORMAT* pDXGIFormat)
+		{
+			if (MFVideoFormat_NV12 == key.Subtype)
+				*pDXGIFormat = DXGI_FORMAT_NV12;
+			else if (MFVideoFormat_YUY2 == key.Subtype)
+				*pDXGIFormat = DXGI_FORMAT_YUY2;
+			else if (MFVideoFormat_RGB32 == key.Subtype || MFVideoFormat_ARGB32 == key.Subtype)
+				*pDXGIFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
+			else
+				return MF_E_INVALIDMEDIATYPE;
+
+			// The video processor of this device does not deinterlace RGB, nor take YUY2 at 4K.
+			if (key.Interlaced && DXGI_FORMAT_B8G8R8A8_UNORM == *pDXGIFormat)
+				return MF_E_UNSUPPORTED_D3D_TYPE;
+			if (width > 1920 && DXGI_FORMAT_YUY2 == *pDXGIFormat)
+				return MF_E_UNSUPPORTED_D3D_TYPE;
+
+			return S_OK;
+		}
+	};
+
+	struct Topology
+	{
+		FakeMediaType* Types[TYPE_COUNT];
+
+		Topology()
+		{
+			UINT n = 0;
+			for (UINT s = 0; s < _countof(SUBTYPES); s++)
+			{
+				for (UINT z = 0; z < _countof(SIZES); z++)
+				{
+					for (UINT i = 0; i < _countof(INTERLACE_MODES); i++)
+					{
+						FakeMediaType* pType = new FakeMediaType(*SUBTYPES[s], SIZES[z][0], SIZES[z][1]);
+						::MFSetAttributeRatio(pType, MF_MT_FRAME_RATE, 30000, 1001);
+						pType->SetUINT32(MF_MT_INTERLACE_MODE, INTERLACE_MODES[i]);
+						this->Types[n++] = pType;
+					}
+				}
+			}
+		}
+		~Topology()
+		{
+			for (UINT n = 0; n < TYPE_COUNT; n++)
+				this->Types[n]->Release();
+		}
+	};
+
+	// Probes every type once. Returns FALSE if an answer differs from the provider's.
+	BOOL ProbeAll(Topology* pTopology, CapabilityCache* pCache, SlowCapabilityProvider* pProvider)
+	{
+		BOOL bSame = TRUE;
+		for (UINT n = 0; n < TYPE_COUNT; n++)
+		{
+			DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+			HRESULT hr;
+			if (NULL != pCache)
+			{
+				hr = pCache->Negotiate(pTopology->Types[n], pProvider, &format);
+			}
+			else
+			{
+				CapabilityKey key;
+				UINT32 width, height;
+				CapabilityCache::MakeKey(pTopology->Types[n], &key, &width, &height);
+				hr = pProvider->CheckMediaType(key, width, height, &format);
+			}
+
+			CapabilityKey key;
+			UINT32 width;
+			CapabilityCache::MakeKey(pTopology->Types[n], &key, &width);
+			DXGI_FORMAT expectedFormat = DXGI_FORMAT_UNKNOWN;
+			HRESULT expected = SlowCapabilityProvider::Answer(key, width, &expectedFormat);
+			if (hr != expected || (SUCCEEDED(hr) && format != expectedFormat))
+				bSame = FALSE;
+		}
+		return bSame;
+	}
+
+	double Microseconds(std::chrono::steady_clock::time_point begin)
+	{
+		return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count() / 1000.0;
+	}
+}
+
+TEST(NegotiationCostsOneProbePerType)
+{
+	Topology topology;
+	printf("  %u types, %ld passes, %ld us per probe\n", TYPE_COUNT, s_Passes, PROBE_COST_US);
+
+	// Without the cache.
+	SlowCapabilityProvider uncachedProvider;
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	for (long pass = 0; pass < s_Passes; pass++)
+		CHECK(ProbeAll(&topology, NULL, &uncachedProvider));
+	double uncached = Microseconds(begin);
+
+	// With the cache: the first pass probes, the others look up.
+	CapabilityCache cache;
+	SlowCapabilityProvider provider;
+	begin = std::chrono::steady_clock::now();
+	CHECK(ProbeAll(&topology, &cache, &provider));
+	double cold = Microseconds(begin);
+	CHECK_EQUAL(TYPE_COUNT, provider.Probes);
+
+	begin = std::chrono::steady_clock::now();
+	for (long pass = 1; pass < s_Passes; pass++)
+		CHECK(ProbeAll(&topology, &cache, &provider));
+	double warm = Microseconds(begin);
+	CHECK_EQUAL(TYPE_COUNT, provider.Probes);	// Nothing probed again.
+
+	long warmProbes = (s_Passes - 1) * (long)TYPE_COUNT;
+	printf("  uncached       %10.1f us  %8.3f us/probe  %u provider calls\n", uncached, uncached / (s_Passes * TYPE_COUNT), uncachedProvider.Probes);
+	printf("  cached, cold   %10.1f us  %8.3f us/probe  %u provider calls\n", cold, cold / TYPE_COUNT, provider.Probes);
+	if (warmProbes > 0)
+		printf("  cached, warm   %10.1f us  %8.3f us/probe  0 provider calls\n", warm, warm / warmProbes);
+	printf("  session start  %10.1f us with the cache, %.1f us without\n", cold + warm, uncached);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		s_Passes = max(1L, atol(argv[1]));
+
+	return TestHarness::RunAll();
+}
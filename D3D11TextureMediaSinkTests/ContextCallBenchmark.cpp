@@ -0,0 +1,183 @@
+// Calls on the device context per presented frame.
+//
+// The presenter gets its contexts once, sets the stream state of the video processor only when VideoProcessorStateCache
+// says it changed, and submits the work of a frame inside one DeviceContextLock. Here the same sequence of calls is made on
+// a fake context that counts them, for a few timelines, and compared with what the presenter did before: get the immediate
+// context and query the video context, set the whole state and release both, on every frame.
+//
+// Prints the calls per frame of each timeline. The run fails if the steady state is anything but the blits, or if a frame
+// enters the multithread protection more than once.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+
+#include <vector>
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	const UINT32 PROGRESSIVE = 0;		// D3D11_VIDEO_FRAME_FORMAT
+	const UINT32 TOP_FIELD_FIRST = 1;	//
+	const UINT32 BT601 = 2;				// MFVideoTransferMatrix
+	const UINT32 BT709 = 1;				//
+
+	// The immediate context and the video context, as far as the presenter calls them for a frame.
+	class FakeContext
+	{
+	public:
+		int GetContexts = 0;	// GetImmediateContext, QueryInterface(ID3D11VideoContext) and the two Releases.
+		int StateCalls = 0;		// VideoProcessorSet*.
+		int Blits = 0;			// VideoProcessorBlt.
+
+		int GetTotal() const { return this->GetContexts + this->StateCalls + this->Blits; }
+	};
+
+	// The multithread protection of the device.
+	class FakeMultithread : public ID3D10Multithread
+	{
+	public:
+		int Enters = 0;
+		int Depth = 0;
+		int MaxDepth = 0;
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppv) { return E_NOINTERFACE; }
+		ULONG STDMETHODCALLTYPE AddRef() { return 1; }
+		ULONG STDMETHODCALLTYPE Release() { return 1; }
+		void STDMETHODCALLTYPE Enter()
+		{
+			this->Enters++;
+			this->Depth++;
+			this->MaxDepth = max(this->MaxDepth, this->Depth);
+		}
+		void STDMETHODCALLTYPE Leave() { this->Depth--; }
+		BOOL STDMETHODCALLTYPE SetMultithreadProtected(BOOL bMTProtect) { return TRUE; }
+		BOOL STDMETHODCALLTYPE GetMultithreadProtected() { return TRUE; }
+	};
+
+	struct Frame
+	{
+		UINT32 FrameFormat;
+		UINT32 YuvMatrix;
+	};
+
+	// Presenter::ProcessFrameUsingD3D11: the state groups that changed, then one blit per output field.
+	void PresentFrame(FakeContext* pContext, CriticalSection* pLock, ID3D10Multithread* pMultithread, VideoProcessorStateCache* pState, const Frame& frame)
+	{
+		DeviceContextLock lockContext(pLock, pMultithread);
+
+		DWORD groups = pState->Update(frame.FrameFormat, frame.YuvMatrix);
+		if (groups & VP_STATE_FRAME_FORMAT)
+			pContext->StateCalls += 1;	// SetStreamFrameFormat
+		if (groups & VP_STATE_GEOMETRY)
+			pContext->StateCalls += 5;	// SetStreamOutputRate, SetStreamSourceRect, SetStreamDestRect, SetOutputTargetRect, SetOutputBackgroundColor
+		if (groups & VP_STATE_COLOR_SPACE)
+			pContext->StateCalls += 2;	// SetStreamColorSpace, SetOutputColorSpace
+
+		pContext->Blits += (PROGRESSIVE == frame.FrameFormat) ? 1 : 2;
+	}
+
+	// The presenter before the contexts and the state were cached.
+	void PresentFrameUncached(FakeContext* pContext, const Frame& frame)
+	{
+		pContext->GetContexts += 4;
+		pContext->StateCalls += 8;
+		pContext->Blits += (PROGRESSIVE == frame.FrameFormat) ? 1 : 2;
+	}
+
+	struct Report
+	{
+		double CallsPerFrame;
+		double UncachedCallsPerFrame;
+		int SteadyStateCalls;	// Calls other than the blits after the first frame.
+		int Enters;
+		int MaxDepth;
+	};
+
+	Report Play(const char* name, const std::vector<Frame>& frames)
+	{
+		FakeContext context;
+		FakeContext uncached;
+		FakeMultithread multithread;
+		CriticalSection lock;
+		VideoProcessorStateCache state;
+		state.Invalidate();	// A new processor, as when the pool entry creates it.
+
+		int steady = 0;
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			int before = context.GetContexts + context.StateCalls;
+			PresentFrame(&context, &lock, &multithread, &state, frames[i]);
+			PresentFrameUncached(&uncached, frames[i]);
+			if (0 < i)
+				steady += context.GetContexts + context.StateCalls - before;
+		}
+
+		Report report = {
+			(double)context.GetTotal() / frames.size(),
+			(double)uncached.GetTotal() / frames.size(),
+			steady,
+			multithread.Enters,
+			multithread.MaxDepth };
+		printf("  %-22s %5.2f calls per frame (uncached %5.2f), %d state calls after the first frame, %d enters for %d frames\n",
+			name, report.CallsPerFrame, report.UncachedCallsPerFrame, report.SteadyStateCalls, report.Enters, (int)frames.size());
+		return report;
+	}
+
+	std::vector<Frame> Timeline(int count, UINT32 frameFormat, UINT32 yuvMatrix)
+	{
+		Frame frame = { frameFormat, yuvMatrix };
+		return std::vector<Frame>(count, frame);
+	}
+}
+
+TEST(ProgressiveSteadyStateIsOneBlitPerFrame)
+{
+	Report report = Play("progressive", Timeline(100, PROGRESSIVE, BT709));
+	CHECK_EQUAL(0, report.SteadyStateCalls);
+	CHECK_EQUAL(100, report.Enters);
+	CHECK_EQUAL(1, report.MaxDepth);
+	CHECK(report.CallsPerFrame < 1.1);
+	CHECK(report.UncachedCallsPerFrame >= 13.0);
+}
+
+TEST(InterlacedFieldsShareOneSubmission)
+{
+	Report report = Play("interlaced", Timeline(100, TOP_FIELD_FIRST, BT601));
+	CHECK_EQUAL(0, report.SteadyStateCalls);
+	CHECK_EQUAL(100, report.Enters);	// Both fields inside one Enter/Leave.
+	CHECK_EQUAL(1, report.MaxDepth);
+	CHECK(report.CallsPerFrame < 2.1);
+}
+
+TEST(ChangesSetOnlyTheirGroup)
+{
+	// The cadence flips to interlaced and back: the frame format is set twice more, and nothing else.
+	std::vector<Frame> frames = Timeline(50, PROGRESSIVE, BT709);
+	std::vector<Frame> interlaced = Timeline(10, TOP_FIELD_FIRST, BT709);
+	frames.insert(frames.end(), interlaced.begin(), interlaced.end());
+	std::vector<Frame> progressive = Timeline(40, PROGRESSIVE, BT709);
+	frames.insert(frames.end(), progressive.begin(), progressive.end());
+	CHECK_EQUAL(2, Play("cadence change", frames).SteadyStateCalls);
+
+	// The media type changes the matrix: the two color spaces are set again.
+	frames = Timeline(50, PROGRESSIVE, BT601);
+	std::vector<Frame> hd = Timeline(50, PROGRESSIVE, BT709);
+	frames.insert(frames.end(), hd.begin(), hd.end());
+	CHECK_EQUAL(2, Play("matrix change", frames).SteadyStateCalls);
+}
+
+TEST(NewProcessorGetsTheWholeState)
+{
+	VideoProcessorStateCache state;
+	state.Invalidate();
+	CHECK_EQUAL((DWORD)VP_STATE_ALL, state.Update(PROGRESSIVE, BT709));
+	CHECK_EQUAL(0u, state.Update(PROGRESSIVE, BT709));
+	CHECK_EQUAL((DWORD)VP_STATE_COLOR_SPACE, state.Update(PROGRESSIVE, BT601));
+	CHECK_EQUAL((DWORD)VP_STATE_FRAME_FORMAT, state.Update(TOP_FIELD_FIRST, BT601));
+
+	state.Invalidate();
+	CHECK_EQUAL((DWORD)VP_STATE_ALL, state.Update(TOP_FIELD_FIRST, BT601));
+}
+
+TEST_MAIN()
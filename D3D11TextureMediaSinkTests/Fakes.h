@@ -0,0 +1,441 @@
+#pragma once
+
+// Fakes of the COM objects the sink talks to. They are reference counted like the real ones and count the calls made to them.
+
+#include "stdafx.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Fakes
+{
+	// IUnknown only; enough for the COM containers.
+	class FakeUnknown : public IUnknown
+	{
+	public:
+		FakeUnknown() : _RefCount(1) {}
+		virtual ~FakeUnknown() {}
+
+		STDMETHODIMP QueryInterface(REFIID riid, void** ppv)
+		{
+			if (NULL == ppv)
+				return E_POINTER;
+			if (riid != IID_IUnknown)
+			{
+				*ppv = NULL;
+				return E_NOINTERFACE;
+			}
+			*ppv = static_cast<IUnknown*>(this);
+			this->AddRef();
+			return S_OK;
+		}
+		STDMETHODIMP_(ULONG) AddRef() { return InterlockedIncrement(&this->_RefCount); }
+		STDMETHODIMP_(ULONG) Release()
+		{
+			LONG count = InterlockedDecrement(&this->_RefCount);
+			if (0 == count)
+				delete this;
+			return count;
+		}
+
+		LONG GetRefCount() { return this->_RefCount; }
+
+	private:
+		volatile LONG _RefCount;
+	};
+
+	// A texture that only has a description.
+	class FakeTexture : public ID3D11Texture2D
+	{
+	public:
+		FakeTexture(UINT width, UINT height, DXGI_FORMAT format) : _RefCount(1)
+		{
+			ZeroMemory(&this->_Desc, sizeof(this->_Desc));
+			this->_Desc.Width = width;
+			this->_Desc.Height = height;
+			this->_Desc.MipLevels = 1;
+			this->_Desc.ArraySize = 1;
+			this->_Desc.Format = format;
+		}
+		virtual ~FakeTexture() {}
+
+		// IUnknown
+		STDMETHODIMP QueryInterface(REFIID riid, void** ppv)
+		{
+			if (NULL == ppv)
+				return E_POINTER;
+			*ppv = NULL;
+			return E_NOINTERFACE;
+		}
+		STDMETHODIMP_(ULONG) AddRef() { return InterlockedIncrement(&this->_RefCount); }
+		STDMETHODIMP_(ULONG) Release()
+		{
+			LONG count = InterlockedDecrement(&this->_RefCount);
+			if (0 == count)
+				delete this;
+			return count;
+		}
+
+		// ID3D11Texture2D
+		void STDMETHODCALLTYPE GetDesc(D3D11_TEXTURE2D_DESC* pDesc) { *pDesc = this->_Desc; }
+
+		LONG GetRefCount() { return this->_RefCount; }
+
+	private:
+		volatile LONG _RefCount;
+		D3D11_TEXTURE2D_DESC _Desc;
+	};
+
+	// The attribute store of a sample or a media type, in a vector. Every call to it is counted in AttributeCalls.
+	template <class Base> class FakeAttributes : public Base
+	{
+	public:
+		volatile LONG AttributeCalls = 0;
+
+		FakeAttributes() : _RefCount(1) {}
+		virtual ~FakeAttributes()
+		{
+			for (size_t i = 0; i < this->_Items.size(); i++)
+				SafeRelease(this->_Items[i].Unknown);
+		}
+
+		// IUnknown
+		STDMETHODIMP QueryInterface(REFIID riid, void** ppv)
+		{
+			if (NULL == ppv)
+				return E_POINTER;
+			*ppv = NULL;
+			return E_NOINTERFACE;
+		}
+		STDMETHODIMP_(ULONG) AddRef() { return InterlockedIncrement(&this->_RefCount); }
+		STDMETHODIMP_(ULONG) Release()
+		{
+			LONG count = InterlockedDecrement(&this->_RefCount);
+			if (0 == count)
+				delete this;
+			return count;
+		}
+
+		// IMFAttributes
+		STDMETHODIMP GetUINT32(REFGUID guidKey, UINT32* punValue)
+		{
+			InterlockedIncrement(&this->AttributeCalls);
+			Item* pItem = this->Find(guidKey);
+			if (NULL == pItem || MF_ATTRIBUTE_UINT32 != pItem->Type)
+				return MF_E_ATTRIBUTENOTFOUND;
+			*punValue = (UINT32)pItem->Value;
+			return S_OK;
+		}
+		STDMETHODIMP GetUINT64(REFGUID guidKey, UINT64* punValue)
+		{
+			InterlockedIncrement(&this->AttributeCalls);
+			Item* pItem = this->Find(guidKey);
+			if (NULL == pItem || MF_ATTRIBUTE_UINT64 != pItem->Type)
+				return MF_E_ATTRIBUTENOTFOUND;
+			*punValue = pItem->Value;
+			return S_OK;
+		}
+		STDMETHODIMP GetGUID(REFGUID guidKey, GUID* pguidValue)
+		{
+			InterlockedIncrement(&this->AttributeCalls);
+			Item* pItem = this->Find(guidKey);
+			if (NULL == pItem || MF_ATTRIBUTE_GUID != pItem->Type)
+				return MF_E_ATTRIBUTENOTFOUND;
+			*pguidValue = pItem->Guid;
+			return S_OK;
+		}
+		STDMETHODIMP GetUnknown(REFGUID guidKey, REFIID riid, LPVOID* ppv)
+		{
+			InterlockedIncrement(&this->AttributeCalls);
+			Item* pItem = this->Find(guidKey);
+			if (NULL == pItem || MF_ATTRIBUTE_IUNKNOWN != pItem->Type)
+				return MF_E_ATTRIBUTENOTFOUND;
+			pItem->Unknown->AddRef();
+			*ppv = pItem->Unknown;
+			return S_OK;
+		}
+		STDMETHODIMP SetUINT32(REFGUID guidKey, UINT32 unValue)
+		{
+			InterlockedIncrement(&this->AttributeCalls);
+			Item* pItem = this->Add(guidKey, MF_ATTRIBUTE_UINT32);
+			pItem->Value = unValue;
+			return S_OK;
+		}
+		STDMETHODIMP SetUINT64(REFGUID guidKey, UINT64 unValue)
+		{
+			InterlockedIncrement(&this->AttributeCalls);
+			Item* pItem = this->Add(guidKey, MF_ATTRIBUTE_UINT64);
+			pItem->Value = unValue;
+			return S_OK;
+		}
+		STDMETHODIMP SetGUID(REFGUID guidKey, REFGUID guidValue)
+		{
+			InterlockedIncrement(&this->AttributeCalls);
+			Item* pItem = this->Add(guidKey, MF_ATTRIBUTE_GUID);
+			pItem->Guid = guidValue;
+			return S_OK;
+		}
+		STDMETHODIMP SetUnknown(REFGUID guidKey, IUnknown* pUnknown)
+		{
+			InterlockedIncrement(&this->AttributeCalls);
+			Item* pItem = this->Add(guidKey, MF_ATTRIBUTE_IUNKNOWN);
+			pItem->Unknown = pUnknown;
+			if (NULL != pUnknown)
+				pUnknown->AddRef();
+			return S_OK;
+		}
+		STDMETHODIMP DeleteItem(REFGUID guidKey)
+		{
+			InterlockedIncrement(&this->AttributeCalls);
+			for (size_t i = 0; i < this->_Items.size(); i++)
+			{
+				if (this->_Items[i].Key == guidKey)
+				{
+					SafeRelease(this->_Items[i].Unknown);
+					this->_Items.erase(this->_Items.begin() + i);
+					break;
+				}
+			}
+			return S_OK;
+		}
+
+	private:
+		struct Item
+		{
+			GUID Key;
+			MF_ATTRIBUTE_TYPE Type;
+			UINT64 Value;
+			GUID Guid;
+			IUnknown* Unknown;
+		};
+
+		volatile LONG _RefCount;
+		std::vector<Item> _Items;
+
+		Item* Find(REFGUID guidKey)
+		{
+			for (size_t i = 0; i < this->_Items.size(); i++)
+				if (this->_Items[i].Key == guidKey)
+					return &this->_Items[i];
+			return NULL;
+		}
+		Item* Add(REFGUID guidKey, MF_ATTRIBUTE_TYPE type)
+		{
+			Item* pItem = this->Find(guidKey);
+			if (NULL == pItem)
+			{
+				Item item = {};
+				item.Key = guidKey;
+				this->_Items.push_back(item);
+				pItem = &this->_Items.back();
+			}
+			SafeRelease(pItem->Unknown);
+			pItem->Type = type;
+			return pItem;
+		}
+	};
+
+
+	// A media type; the attribute store only.
+	class FakeMediaType : public FakeAttributes<IMFMediaType>
+	{
+	public:
+		FakeMediaType(REFGUID subtype, UINT32 width, UINT32 height)
+		{
+			this->SetGUID(MF_MT_SUBTYPE, subtype);
+			::MFSetAttributeSize(this, MF_MT_FRAME_SIZE, width, height);
+			this->AttributeCalls = 0;
+		}
+	};
+
+	// A sample with an attribute store, and the descriptor the allocator would keep for it.
+	// The sample time, duration and flags are not attributes, and are not counted.
+	class FakeSample : public FakeAttributes<IMFSample>
+	{
+	public:
+		D3D11TextureMediaSink::FrameDescriptor Descriptor;
+		volatile LONG PresentCount = 0;	// Counted by FakeSchedulerCallback.
+		volatile LONG DiscardCount = 0;	//
+
+		FakeSample(LONGLONG hnsTime = 0, LONGLONG hnsDuration = 0) : _Time(hnsTime), _Duration(hnsDuration), _HasTime(TRUE)
+		{
+			ZeroMemory(&this->Descriptor, sizeof(this->Descriptor));
+		}
+
+		void ClearTime() { this->_HasTime = FALSE; }
+
+		// IMFSample
+		STDMETHODIMP GetSampleFlags(DWORD* pdwSampleFlags) { *pdwSampleFlags = this->_Flags; return S_OK; }
+		STDMETHODIMP SetSampleFlags(DWORD dwSampleFlags) { this->_Flags = dwSampleFlags; return S_OK; }
+		STDMETHODIMP GetSampleTime(LONGLONG* phnsSampleTime)
+		{
+			std::lock_guard<std::mutex> lock(this->_TimeMutex);
+			if (!this->_HasTime)
+				return MF_E_NO_SAMPLE_TIMESTAMP;
+			*phnsSampleTime = this->_Time;
+			return S_OK;
+		}
+		STDMETHODIMP SetSampleTime(LONGLONG hnsSampleTime)
+		{
+			std::lock_guard<std::mutex> lock(this->_TimeMutex);
+			this->_Time = hnsSampleTime;
+			this->_HasTime = TRUE;
+			return S_OK;
+		}
+		STDMETHODIMP GetSampleDuration(LONGLONG* phnsSampleDuration)
+		{
+			std::lock_guard<std::mutex> lock(this->_TimeMutex);
+			*phnsSampleDuration = this->_Duration;
+			return S_OK;
+		}
+		STDMETHODIMP SetSampleDuration(LONGLONG hnsSampleDuration)
+		{
+			std::lock_guard<std::mutex> lock(this->_TimeMutex);
+			this->_Duration = hnsSampleDuration;
+			return S_OK;
+		}
+
+	private:
+		std::mutex _TimeMutex;
+		LONGLONG _Time;
+		LONGLONG _Duration;
+		BOOL _HasTime;
+		DWORD _Flags = 0;
+	};
+
+	// A presentation clock whose time is set by the test. In real-time mode, it runs from the time set at the given rate.
+	class FakeClock : public IMFClock
+	{
+	public:
+		FakeClock() : _RefCount(1) {}
+		virtual ~FakeClock() {}
+
+		void SetTime(LONGLONG hnsTime)
+		{
+			std::lock_guard<std::mutex> lock(this->_Mutex);
+			this->_Time = hnsTime;
+			this->_Start = ::MFGetSystemTime();
+		}
+		void SetRealTime(BOOL bRealTime, float rate = 1.0f)
+		{
+			std::lock_guard<std::mutex> lock(this->_Mutex);
+			this->_RealTime = bRealTime;
+			this->_Rate = rate;
+			this->_Start = ::MFGetSystemTime();
+		}
+		LONGLONG GetTime()
+		{
+			LONGLONG hnsTime;
+			MFTIME hnsSystemTime;
+			this->GetCorrelatedTime(0, &hnsTime, &hnsSystemTime);
+			return hnsTime;
+		}
+
+		// IUnknown
+		STDMETHODIMP QueryInterface(REFIID riid, void** ppv)
+		{
+			if (NULL == ppv)
+				return E_POINTER;
+			*ppv = NULL;
+			return E_NOINTERFACE;
+		}
+		STDMETHODIMP_(ULONG) AddRef() { return InterlockedIncrement(&this->_RefCount); }
+		STDMETHODIMP_(ULONG) Release()
+		{
+			LONG count = InterlockedDecrement(&this->_RefCount);
+			if (0 == count)
+				delete this;
+			return count;
+		}
+
+		// IMFClock
+		STDMETHODIMP GetCorrelatedTime(DWORD dwReserved, LONGLONG* pllClockTime, MFTIME* phnsSystemTime)
+		{
+			std::lock_guard<std::mutex> lock(this->_Mutex);
+			MFTIME hnsNow = ::MFGetSystemTime();
+			*phnsSystemTime = hnsNow;
+			*pllClockTime = this->_RealTime ? this->_Time + (LONGLONG)((hnsNow - this->_Start) * this->_Rate) : this->_Time;
+			return S_OK;
+		}
+
+	private:
+		volatile LONG _RefCount;
+		std::mutex _Mutex;
+		LONGLONG _Time = 0;
+		MFTIME _Start = 0;
+		BOOL _RealTime = FALSE;
+		float _Rate = 1.0f;
+	};
+
+	// Records what the scheduler does with the FakeSamples given to it.
+	class FakeSchedulerCallback : public D3D11TextureMediaSink::SchedulerCallback
+	{
+	public:
+		struct Blend
+		{
+			FakeSample* First;
+			FakeSample* Second;
+			float Weight;
+			LONGLONG Time;
+		};
+
+		DWORD PresentDelayMilliseconds = 0;	// Time PresentFrame takes.
+		HRESULT BlendResult = S_OK;
+
+		HRESULT PresentFrame(IMFSample* pSample)
+		{
+			FakeSample* pFake = static_cast<FakeSample*>(pSample);
+			InterlockedIncrement(&pFake->PresentCount);
+			if (0 < this->PresentDelayMilliseconds)
+				std::this_thread::sleep_for(std::chrono::milliseconds(this->PresentDelayMilliseconds));
+			std::lock_guard<std::mutex> lock(this->_Mutex);
+			this->_Presented.push_back(pFake);
+			return S_OK;
+		}
+		HRESULT DiscardFrame(IMFSample* pSample)
+		{
+			FakeSample* pFake = static_cast<FakeSample*>(pSample);
+			InterlockedIncrement(&pFake->DiscardCount);
+			std::lock_guard<std::mutex> lock(this->_Mutex);
+			this->_Discarded.push_back(pFake);
+			return S_OK;
+		}
+		HRESULT BlendFrames(IMFSample* pFirst, IMFSample* pSecond, float weight, LONGLONG hnsTime, LONGLONG hnsDuration)
+		{
+			std::lock_guard<std::mutex> lock(this->_Mutex);
+			Blend blend = { static_cast<FakeSample*>(pFirst), static_cast<FakeSample*>(pSecond), weight, hnsTime };
+			this->_Blends.push_back(blend);
+			return this->BlendResult;
+		}
+		D3D11TextureMediaSink::FrameDescriptor* GetFrameDescriptor(IMFSample* pSample)
+		{
+			return &static_cast<FakeSample*>(pSample)->Descriptor;
+		}
+
+		std::vector<FakeSample*> GetPresented() { std::lock_guard<std::mutex> lock(this->_Mutex); return this->_Presented; }
+		std::vector<FakeSample*> GetDiscarded() { std::lock_guard<std::mutex> lock(this->_Mutex); return this->_Discarded; }
+		std::vector<Blend> GetBlends() { std::lock_guard<std::mutex> lock(this->_Mutex); return this->_Blends; }
+		size_t GetRetiredCount() { std::lock_guard<std::mutex> lock(this->_Mutex); return this->_Presented.size() + this->_Discarded.size(); }
+
+		// Waits until at least count samples are presented or discarded. FALSE on timeout.
+		BOOL WaitForRetired(size_t count, DWORD timeoutMilliseconds = 5000)
+		{
+			std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+			while (this->GetRetiredCount() < count)
+			{
+				if (std::chrono::steady_clock::now() > deadline)
+					return FALSE;
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			return TRUE;
+		}
+
+	private:
+		std::mutex _Mutex;
+		std::vector<FakeSample*> _Presented;
+		std::vector<FakeSample*> _Discarded;
+		std::vector<Blend> _Blends;
+	};
+}
@@ -0,0 +1,281 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	const LONGLONG FRAME = 400000;	// 100ns units, at 25 fps.
+	const UINT64 BYTES = 1920 * 1080 * 4;
+
+	TMS_FRAME_DESCRIPTOR Frame(LONGLONG hnsTime, LONGLONG hnsDuration = FRAME)
+	{
+		TMS_FRAME_DESCRIPTOR frame = {};
+		frame.SampleTime = hnsTime;
+		frame.SampleDuration = hnsDuration;
+		return frame;
+	}
+
+	// The resources (textures) of the frames, released at the end.
+	struct Resources
+	{
+		std::vector<FakeUnknown*> Items;
+
+		~Resources()
+		{
+			for (size_t i = 0; i < this->Items.size(); i++)
+				this->Items[i]->Release();
+		}
+		FakeUnknown* New()
+		{
+			FakeUnknown* pItem = new FakeUnknown();
+			this->Items.push_back(pItem);
+			return pItem;
+		}
+	};
+
+	// Finds the frame at the time, and checks that it is the one of the resource.
+	BOOL FindResource(FrameCache* pCache, LONGLONG hnsTime, IUnknown* pExpected)
+	{
+		TMS_FRAME_DESCRIPTOR frame;
+		IUnknown* pResource = NULL;
+		BOOL bFound = pCache->Find(hnsTime, &frame, &pResource);
+		BOOL bSame = (pResource == pExpected);
+		SafeRelease(pResource);
+		return bFound && bSame;
+	}
+}
+
+TEST(FindReturnsTheFrameOnDisplayAtTheTime)
+{
+	Resources resources;
+	FrameCache cache;
+	cache.SetBudget(10 * BYTES);
+
+	FakeUnknown* pFrames[3];
+	for (int i = 0; i < 3; i++)
+	{
+		pFrames[i] = resources.New();
+		CHECK_EQUAL(S_OK, cache.Insert(Frame(i * FRAME), BYTES, pFrames[i]));
+	}
+	CHECK_EQUAL(3u, cache.GetCount());
+	CHECK_EQUAL(3 * BYTES, cache.GetBytes());
+
+	CHECK(FindResource(&cache, 0, pFrames[0]));
+	CHECK(FindResource(&cache, FRAME + FRAME / 2, pFrames[1]));
+	CHECK(FindResource(&cache, 3 * FRAME - 1, pFrames[2]));
+
+	TMS_FRAME_DESCRIPTOR frame;
+	IUnknown* pResource = NULL;
+	CHECK(!cache.Find(3 * FRAME, &frame, &pResource));	// Past the last frame.
+	CHECK(NULL == pResource);
+	CHECK(!cache.Find(-1, &frame, &pResource));
+
+	CHECK_EQUAL(3u, cache.GetHitCount());
+	CHECK_EQUAL(2u, cache.GetMissCount());
+
+	// The found frame comes with its descriptor, and a reference of its own.
+	CHECK(cache.Find(FRAME, &frame, &pResource));
+	CHECK_EQUAL(FRAME, frame.SampleTime);
+	CHECK_EQUAL(FRAME, frame.SampleDuration);
+	CHECK_EQUAL(3, pFrames[1]->GetRefCount());
+	SafeRelease(pResource);
+	CHECK_EQUAL(2, pFrames[1]->GetRefCount());
+}
+
+TEST(FrameWithoutDurationIsFoundOnlyAtItsTime)
+{
+	Resources resources;
+	FrameCache cache;
+	cache.SetBudget(10 * BYTES);
+
+	FakeUnknown* pFrame = resources.New();
+	CHECK_EQUAL(S_OK, cache.Insert(Frame(FRAME, 0), BYTES, pFrame));
+	CHECK(FindResource(&cache, FRAME, pFrame));
+	CHECK(!FindResource(&cache, FRAME + 1, pFrame));
+
+	// The latest frame that starts before the time wins over an earlier one that lasts longer.
+	FakeUnknown* pLong = resources.New();
+	FakeUnknown* pLater = resources.New();
+	CHECK_EQUAL(S_OK, cache.Insert(Frame(10 * FRAME, 5 * FRAME), BYTES, pLong));
+	CHECK_EQUAL(S_OK, cache.Insert(Frame(12 * FRAME), BYTES, pLater));
+	CHECK(FindResource(&cache, 12 * FRAME, pLater));
+	CHECK(FindResource(&cache, 13 * FRAME, pLong));
+}
+
+TEST(LeastRecentlyUsedFrameIsEvictedFirst)
+{
+	Resources resources;
+	FrameCache cache;
+	cache.SetBudget(3 * BYTES);
+
+	FakeUnknown* pFrames[4];
+	for (int i = 0; i < 3; i++)
+	{
+		pFrames[i] = resources.New();
+		CHECK_EQUAL(S_OK, cache.Insert(Frame(i * FRAME), BYTES, pFrames[i]));
+	}
+
+	// Seeking back to the first frame makes it the most recent; the second one goes.
+	CHECK(FindResource(&cache, 0, pFrames[0]));
+	pFrames[3] = resources.New();
+	CHECK_EQUAL(S_OK, cache.Insert(Frame(3 * FRAME), BYTES, pFrames[3]));
+
+	CHECK_EQUAL(3u, cache.GetCount());
+	CHECK(FindResource(&cache, 0, pFrames[0]));
+	CHECK(!FindResource(&cache, FRAME, pFrames[1]));
+	CHECK(FindResource(&cache, 2 * FRAME, pFrames[2]));
+	CHECK(FindResource(&cache, 3 * FRAME, pFrames[3]));
+	CHECK_EQUAL(1, pFrames[1]->GetRefCount());	// Released by the cache.
+}
+
+TEST(BudgetBoundsTheFramesKept)
+{
+	Resources resources;
+	FrameCache cache;
+
+	// No budget: the cache is off.
+	FakeUnknown* pFrame = resources.New();
+	CHECK_EQUAL(0u, cache.GetBudget());
+	CHECK_EQUAL(S_FALSE, cache.Insert(Frame(0), BYTES, pFrame));
+	IUnknown* pReusable = NULL;
+	CHECK_EQUAL(S_FALSE, cache.Reserve(BYTES, &pReusable));
+	CHECK(NULL == pReusable);
+	CHECK_EQUAL(0u, cache.GetCount());
+
+	// A lower budget evicts at once, the least recent first.
+	cache.SetBudget(4 * BYTES);
+	for (int i = 0; i < 4; i++)
+		CHECK_EQUAL(S_OK, cache.Insert(Frame(i * FRAME), BYTES, resources.New()));
+	cache.SetBudget(2 * BYTES + BYTES / 2);
+	CHECK_EQUAL(2u, cache.GetCount());
+	CHECK_EQUAL(2 * BYTES, cache.GetBytes());
+	CHECK(FindResource(&cache, 3 * FRAME, resources.Items[4]));
+
+	// A frame larger than the budget is never kept.
+	CHECK_EQUAL(S_FALSE, cache.Insert(Frame(10 * FRAME), 3 * BYTES, resources.New()));
+	CHECK_EQUAL(2u, cache.GetCount());
+}
+
+TEST(ReserveHandsBackAnEvictedResourceOfTheSameSize)
+{
+	Resources resources;
+	FrameCache cache;
+	cache.SetBudget(2 * BYTES);
+
+	FakeUnknown* pSmall = resources.New();
+	FakeUnknown* pFirst = resources.New();
+	CHECK_EQUAL(S_OK, cache.Insert(Frame(0), BYTES / 2, pSmall));
+	CHECK_EQUAL(S_OK, cache.Insert(Frame(FRAME), BYTES, pFirst));
+	CHECK_EQUAL(S_OK, cache.Insert(Frame(2 * FRAME), BYTES / 2, resources.New()));
+
+	// Room for one more frame of BYTES: the small one is evicted, then the first full one, which is handed back.
+	IUnknown* pReusable = NULL;
+	CHECK_EQUAL(S_OK, cache.Reserve(BYTES, &pReusable));
+	CHECK(pFirst == pReusable);
+	CHECK_EQUAL(2, pFirst->GetRefCount());	// The cache's reference, now the caller's.
+	CHECK_EQUAL(1, pSmall->GetRefCount());
+	CHECK_EQUAL(1u, cache.GetCount());
+
+	CHECK_EQUAL(S_OK, cache.Insert(Frame(3 * FRAME), BYTES, pReusable));
+	SafeRelease(pReusable);
+	CHECK(FindResource(&cache, 3 * FRAME, pFirst));
+
+	// Enough room already: nothing is evicted or handed back.
+	cache.SetBudget(10 * BYTES);
+	CHECK_EQUAL(S_OK, cache.Reserve(BYTES, &pReusable));
+	CHECK(NULL == pReusable);
+	CHECK_EQUAL(2u, cache.GetCount());
+}
+
+TEST(InsertReplacesTheFrameOfTheSameTime)
+{
+	Resources resources;
+	FrameCache cache;
+	cache.SetBudget(10 * BYTES);
+
+	FakeUnknown* pOld = resources.New();
+	FakeUnknown* pNew = resources.New();
+	CHECK_EQUAL(S_OK, cache.Insert(Frame(FRAME), BYTES, pOld));
+	CHECK_EQUAL(S_OK, cache.Insert(Frame(FRAME), BYTES, pNew));
+
+	CHECK_EQUAL(1u, cache.GetCount());
+	CHECK_EQUAL(BYTES, cache.GetBytes());
+	CHECK_EQUAL(1, pOld->GetRefCount());
+	CHECK(FindResource(&cache, FRAME, pNew));
+	CHECK_EQUAL(E_POINTER, cache.Insert(Frame(0), BYTES, NULL));
+}
+
+TEST(SlotsBoundTheFramesKeptWhateverTheBudget)
+{
+	Resources resources;
+	FrameCache cache;
+	cache.SetBudget((FRAME_CACHE_SLOTS + 10) * BYTES);
+
+	for (int i = 0; i <= FRAME_CACHE_SLOTS; i++)
+		CHECK_EQUAL(S_OK, cache.Insert(Frame(i * FRAME), BYTES, resources.New()));
+
+	CHECK_EQUAL((UINT)FRAME_CACHE_SLOTS, cache.GetCount());
+	CHECK(!FindResource(&cache, 0, resources.Items[0]));
+	CHECK(FindResource(&cache, FRAME_CACHE_SLOTS * FRAME, resources.Items[FRAME_CACHE_SLOTS]));
+}
+
+TEST(ClearReleasesEveryFrame)
+{
+	Resources resources;
+	{
+		FrameCache cache;
+		cache.SetBudget(10 * BYTES);
+		for (int i = 0; i < 5; i++)
+			cache.Insert(Frame(i * FRAME), BYTES, resources.New());
+
+		cache.Clear();
+		CHECK_EQUAL(0u, cache.GetCount());
+		CHECK_EQUAL(0u, cache.GetBytes());
+		for (int i = 0; i < 5; i++)
+			CHECK_EQUAL(1, resources.Items[i]->GetRefCount());
+
+		// The destructor releases what is left.
+		cache.Insert(Frame(0), BYTES, resources.Items[0]);
+	}
+	CHECK_EQUAL(1, resources.Items[0]->GetRefCount());
+}
+
+TEST(RepeatedScrubbingHitsTheCache)
+{
+	// The editing tool scrubs back and forth over the same range; each frame not found is processed and inserted.
+	const int RANGE = 40;
+	const int PASSES = 6;
+	Resources resources;
+	FrameCache cache;
+	cache.SetBudget(RANGE * BYTES);
+
+	for (int pass = 0; pass < PASSES; pass++)
+	{
+		for (int i = 0; i < RANGE; i++)
+		{
+			int n = (pass & 1) ? RANGE - 1 - i : i;
+			TMS_FRAME_DESCRIPTOR frame;
+			IUnknown* pResource = NULL;
+			if (!cache.Find(n * FRAME + FRAME / 3, &frame, &pResource))
+			{
+				IUnknown* pReusable = NULL;
+				CHECK_EQUAL(S_OK, cache.Reserve(BYTES, &pReusable));
+				CHECK_EQUAL(S_OK, cache.Insert(Frame(n * FRAME), BYTES, (NULL != pReusable) ? pReusable : resources.New()));
+				SafeRelease(pReusable);
+			}
+			SafeRelease(pResource);
+		}
+	}
+
+	UINT64 hits = cache.GetHitCount();
+	UINT64 misses = cache.GetMissCount();
+	printf("  %d passes over %d frames: %llu hits, %llu misses (%.0f%% hit rate)\n", PASSES, RANGE,
+		(unsigned long long)hits, (unsigned long long)misses, 100.0 * hits / (hits + misses));
+	CHECK_EQUAL((UINT64)RANGE, misses);	// Only the first pass processes.
+	CHECK_EQUAL((UINT64)(RANGE * (PASSES - 1)), hits);
+}
+
+TEST_MAIN()
@@ -0,0 +1,216 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+
+#include <deque>
+#include <sstream>
+#include <string>
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	// Feeds a source timeline through the converter tick by tick, the way the scheduler does: the queued frames are looked at
+	// up to FRC_LOOKAHEAD_MAX, the ones in front of the decision are dropped, and a frame presented in the repeat/skip mode
+	// leaves the queue (blended frames stay, as they are blended again at the next ticks). Returns the decisions as text, one per tick:
+	//   P<n>       present source frame n
+	//   R          repeat
+	//   B<n>:<w>   blend of frames n and n + 1, w = weight of n + 1 in percent
+	//   W          wait
+	std::string Run(FrameRateConverter* pFrc, UINT32 sourceNumerator, UINT32 sourceDenominator, int frames, int ticks)
+	{
+		UINT64 sourceInterval = 0;
+		::MFFrameRateToAverageTimePerFrame(sourceNumerator, sourceDenominator, &sourceInterval);
+
+		std::deque<int> queue;
+		for (int i = 0; i < frames; i++)
+			queue.push_back(i);
+
+		std::ostringstream trace;
+		for (int tick = 0; tick < ticks; tick++)
+		{
+			LONGLONG tickTime = tick * pFrc->GetTickInterval();
+
+			LONGLONG times[FRC_LOOKAHEAD_MAX];
+			UINT count = 0;
+			for (; count < FRC_LOOKAHEAD_MAX && count < queue.size(); count++)
+				times[count] = queue[count] * (LONGLONG)sourceInterval;
+
+			FrcDecision decision;
+			pFrc->Decide(tickTime, times, count, &decision);
+			for (UINT i = 0; i < decision.Drop; i++)
+				queue.pop_front();
+
+			if (0 < tick)
+				trace << ' ';
+			switch (decision.Action)
+			{
+			case Frc_Present:
+				trace << 'P' << queue[0];
+				if (TMS_FRC_MODE_REPEAT_SKIP == pFrc->GetMode())
+					queue.pop_front();
+				break;
+			case Frc_Repeat:
+				trace << 'R';
+				break;
+			case Frc_Blend:
+				trace << 'B' << queue[0] << ':' << (int)(decision.Weight * 100.0f + 0.5f);
+				break;
+			default:
+				trace << 'W';
+				break;
+			}
+		}
+
+		return trace.str();
+	}
+	MFRatio Rate(DWORD numerator, DWORD denominator = 1)
+	{
+		MFRatio rate = { numerator, denominator };
+		return rate;
+	}
+}
+
+TEST(RepeatSkip24To60IsTwoThreePulldown)
+{
+	FrameRateConverter frc;
+	CHECK_EQUAL(S_OK, frc.SetMode(TMS_FRC_MODE_REPEAT_SKIP));
+	CHECK_EQUAL(S_OK, frc.SetTargetRate(Rate(60)));
+
+	CHECK_EQUAL(std::string("P0 R P1 R R P2 R P3 R R P4 R P5 R R"), Run(&frc, 24, 1, 8, 15));
+
+	FrcStatistics statistics;
+	frc.GetStatistics(&statistics);
+	CHECK_EQUAL(15u, statistics.Ticks);
+	CHECK_EQUAL(9u, statistics.Repeats);
+	CHECK_EQUAL(0u, statistics.Skips);
+	CHECK_EQUAL(0u, statistics.Blends);
+}
+
+TEST(RepeatSkip60To24SkipsFrames)
+{
+	FrameRateConverter frc;
+	CHECK_EQUAL(S_OK, frc.SetMode(TMS_FRC_MODE_REPEAT_SKIP));
+	CHECK_EQUAL(S_OK, frc.SetTargetRate(Rate(24)));
+
+	// Each tick shows the last frame that starts within half a tick of it; the ones before it are never shown.
+	CHECK_EQUAL(std::string("P1 P3 P6 P8 P11 P13"), Run(&frc, 60, 1, 16, 6));
+
+	FrcStatistics statistics;
+	frc.GetStatistics(&statistics);
+	CHECK_EQUAL(0u, statistics.Repeats);
+	CHECK_EQUAL(8u, statistics.Skips);
+}
+
+TEST(Blend25To60)
+{
+	FrameRateConverter frc;
+	CHECK_EQUAL(S_OK, frc.SetMode(TMS_FRC_MODE_BLEND));
+	CHECK_EQUAL(S_OK, frc.SetTargetRate(Rate(60)));
+
+	// 2.4 ticks per frame: the weight of the next frame grows by 1 / 2.4 per tick.
+	CHECK_EQUAL(std::string("P0 B0:42 B0:83 B1:25 B1:67 B2:8 B2:50 B2:92 B3:33 B3:75 B4:17 B4:58"), Run(&frc, 25, 1, 8, 12));
+
+	FrcStatistics statistics;
+	frc.GetStatistics(&statistics);
+	CHECK_EQUAL(12u, statistics.Ticks);
+	CHECK_EQUAL(11u, statistics.Blends);
+	CHECK_EQUAL(0u, statistics.Skips);
+}
+
+TEST(SameRatePresentsEveryFrameWithoutJudder)
+{
+	FrameRateConverter frc;
+	CHECK_EQUAL(S_OK, frc.SetMode(TMS_FRC_MODE_BLEND));
+	CHECK_EQUAL(S_OK, frc.SetTargetRate(Rate(30000, 1001)));
+
+	CHECK_EQUAL(std::string("P0 P1 P2 P3 P4 P5"), Run(&frc, 30000, 1001, 8, 6));
+
+	FrcStatistics statistics;
+	frc.GetStatistics(&statistics);
+	CHECK_EQUAL(0, statistics.JudderMax);
+	CHECK_EQUAL(0, statistics.JudderTotal);
+}
+
+TEST(PulldownJudderIsMeasured)
+{
+	FrameRateConverter frc;
+	CHECK_EQUAL(S_OK, frc.SetMode(TMS_FRC_MODE_REPEAT_SKIP));
+	CHECK_EQUAL(S_OK, frc.SetTargetRate(Rate(60)));
+	Run(&frc, 24, 1, 8, 15);
+
+	// A repeat shows no motion where one tick of it was expected; a new frame shows 2.5 ticks of motion at once.
+	FrcStatistics statistics;
+	frc.GetStatistics(&statistics);
+	CHECK_EQUAL(416667 - 166667, statistics.JudderMax);
+	CHECK(0 < statistics.JudderTotal);
+
+	frc.ResetStatistics();
+	frc.GetStatistics(&statistics);
+	CHECK_EQUAL(0u, statistics.Ticks);
+	CHECK_EQUAL(0, statistics.JudderTotal);
+}
+
+TEST(SameTimelineGivesTheSameOutput)
+{
+	FrameRateConverter frc;
+	CHECK_EQUAL(S_OK, frc.SetMode(TMS_FRC_MODE_BLEND));
+	CHECK_EQUAL(S_OK, frc.SetTargetRate(Rate(50)));
+
+	std::string first = Run(&frc, 24000, 1001, 40, 60);
+	frc.Reset();
+	std::string second = Run(&frc, 24000, 1001, 40, 60);
+	CHECK_EQUAL(first, second);
+}
+
+TEST(NothingToShowWaitsUntilTheFirstPresent)
+{
+	FrameRateConverter frc;
+	CHECK_EQUAL(S_OK, frc.SetMode(TMS_FRC_MODE_REPEAT_SKIP));
+
+	FrcDecision decision;
+	frc.Decide(0, NULL, 0, &decision);
+	CHECK_EQUAL(Frc_Wait, decision.Action);
+
+	LONGLONG future = 10000000;
+	frc.Decide(0, &future, 1, &decision);
+	CHECK_EQUAL(Frc_Wait, decision.Action);
+
+	LONGLONG now = 0;
+	frc.Decide(0, &now, 1, &decision);
+	CHECK_EQUAL(Frc_Present, decision.Action);
+
+	// Once something is on display, an empty queue repeats it.
+	frc.Decide(frc.GetTickInterval(), NULL, 0, &decision);
+	CHECK_EQUAL(Frc_Repeat, decision.Action);
+
+	frc.Reset();
+	frc.Decide(2 * frc.GetTickInterval(), NULL, 0, &decision);
+	CHECK_EQUAL(Frc_Wait, decision.Action);
+}
+
+TEST(TicksAreOnAGridFromZero)
+{
+	FrameRateConverter frc;
+	CHECK_EQUAL(S_OK, frc.SetTargetRate(Rate(50)));
+	CHECK_EQUAL(200000, frc.GetTickInterval());
+
+	CHECK_EQUAL(0, frc.GetTickTime(0));
+	CHECK_EQUAL(0, frc.GetTickTime(199999));
+	CHECK_EQUAL(200000, frc.GetTickTime(200000));
+	CHECK_EQUAL(-200000, frc.GetTickTime(-1));
+	CHECK_EQUAL(-200000, frc.GetTickTime(-200000));
+	CHECK_EQUAL(-400000, frc.GetTickTime(-200001));
+}
+
+TEST(InvalidSettingsAreRejected)
+{
+	FrameRateConverter frc;
+	CHECK_EQUAL(E_INVALIDARG, frc.SetMode(TMS_FRC_MODE_BLEND + 1));
+	CHECK_EQUAL(E_INVALIDARG, frc.SetTargetRate(Rate(0)));
+	CHECK_EQUAL(E_INVALIDARG, frc.SetTargetRate(Rate(60, 0)));
+
+	CHECK_EQUAL((UINT32)TMS_FRC_MODE_OFF, frc.GetMode());
+	CHECK_EQUAL(60u, frc.GetTargetRate().Numerator);
+}
+
+TEST_MAIN()
@@ -0,0 +1,218 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	// The GPU, as the ring sees it: the measurements finish in order, as far as Complete has got.
+	class FakeGpu : public GpuTimerQueryProvider
+	{
+	public:
+		LONGLONG Times[GPU_TIMER_QUERY_SLOTS] = {};	// Time measured in each slot.
+		BOOL Valid[GPU_TIMER_QUERY_SLOTS] = {};		//
+		BOOL Done[GPU_TIMER_QUERY_SLOTS] = {};		// The GPU has got past the end of the slot.
+		int Begins = 0;
+		int Ends = 0;
+		int Polls = 0;
+		BOOL* pDeleted;
+
+		FakeGpu(BOOL* pDeleted = NULL) : pDeleted(pDeleted) {}
+		~FakeGpu()
+		{
+			if (NULL != this->pDeleted)
+				*this->pDeleted = TRUE;
+		}
+
+		void Complete(UINT slot, LONGLONG hnsTime, BOOL bValid = TRUE)
+		{
+			this->Times[slot] = hnsTime;
+			this->Valid[slot] = bValid;
+			this->Done[slot] = TRUE;
+		}
+
+		HRESULT Begin(UINT slot)
+		{
+			this->Begins++;
+			this->Done[slot] = FALSE;
+			return S_OK;
+		}
+		HRESULT End(UINT slot)
+		{
+			this->Ends++;
+			return S_OK;
+		}
+		HRESULT GetResult(UINT slot, BOOL* pbValid, LONGLONG* phnsTime)
+		{
+			// Never waits for the GPU.
+			this->Polls++;
+			if (!this->Done[slot])
+				return S_FALSE;
+			*pbValid = this->Valid[slot];
+			*phnsTime = this->Times[slot];
+			return S_OK;
+		}
+	};
+
+	UINT Measure(GpuTimerQueryRing* pRing)
+	{
+		UINT slot = 0;
+		CHECK_EQUAL(S_OK, pRing->Begin(&slot));
+		CHECK_EQUAL(S_OK, pRing->End(slot));
+		return slot;
+	}
+}
+
+TEST(ResultsGoToTheHistogramInOrder)
+{
+	GpuTimerQueryRing ring;
+	FakeGpu* pGpu = new FakeGpu();
+	ring.SetProvider(pGpu);
+
+	UINT slot1 = Measure(&ring);
+	UINT slot2 = Measure(&ring);
+	UINT slot3 = Measure(&ring);
+
+	// The second one is done, but the first one is not: nothing can be read yet.
+	pGpu->Complete(slot2, 3 * TMS_GPU_TIME_BUCKET_WIDTH);
+	ring.Resolve();
+	GpuTimeStatistics statistics;
+	ring.GetStatistics(&statistics);
+	CHECK_EQUAL(0u, statistics.Count);
+
+	pGpu->Complete(slot1, 1000);
+	pGpu->Complete(slot3, 100 * TMS_GPU_TIME_BUCKET_WIDTH);	// Longer than the histogram.
+	ring.Resolve();
+	ring.GetStatistics(&statistics);
+	CHECK_EQUAL(3u, statistics.Count);
+	CHECK_EQUAL(0u, statistics.Lost);
+	CHECK_EQUAL(1000 + 103 * TMS_GPU_TIME_BUCKET_WIDTH, statistics.Total);
+	CHECK_EQUAL(100 * TMS_GPU_TIME_BUCKET_WIDTH, statistics.Max);
+	CHECK_EQUAL(1u, statistics.Buckets[0]);
+	CHECK_EQUAL(1u, statistics.Buckets[3]);
+	CHECK_EQUAL(1u, statistics.Buckets[TMS_GPU_TIME_HISTOGRAM_BUCKETS - 1]);
+}
+
+TEST(AFullRingSkipsTheMeasurementInsteadOfWaiting)
+{
+	GpuTimerQueryRing ring;
+	FakeGpu* pGpu = new FakeGpu();
+	ring.SetProvider(pGpu);
+
+	for (int i = 0; i < GPU_TIMER_QUERY_SLOTS; i++)
+		Measure(&ring);
+
+	// The GPU is behind by all the slots: the next one is not measured, and the caller is not held up.
+	UINT slot = 0;
+	CHECK_EQUAL(S_FALSE, ring.Begin(&slot));
+	CHECK_EQUAL(GPU_TIMER_QUERY_SLOTS, pGpu->Begins);
+
+	GpuTimeStatistics statistics;
+	ring.GetStatistics(&statistics);
+	CHECK_EQUAL(1u, statistics.Lost);
+
+	// Once the oldest one is done, Begin makes room by itself.
+	pGpu->Complete(0, 5000);
+	CHECK_EQUAL(S_OK, ring.Begin(&slot));
+	CHECK_EQUAL(0u, slot);
+	ring.GetStatistics(&statistics);
+	CHECK_EQUAL(1u, statistics.Count);
+}
+
+TEST(SlotsWrapAround)
+{
+	GpuTimerQueryRing ring;
+	FakeGpu* pGpu = new FakeGpu();
+	ring.SetProvider(pGpu);
+
+	for (int i = 0; i < 3 * GPU_TIMER_QUERY_SLOTS; i++)
+	{
+		UINT slot = Measure(&ring);
+		CHECK_EQUAL((UINT)(i % GPU_TIMER_QUERY_SLOTS), slot);
+		pGpu->Complete(slot, 2 * TMS_GPU_TIME_BUCKET_WIDTH);
+		ring.Resolve();
+	}
+
+	GpuTimeStatistics statistics;
+	ring.GetStatistics(&statistics);
+	CHECK_EQUAL(3u * GPU_TIMER_QUERY_SLOTS, statistics.Count);
+	CHECK_EQUAL(3u * GPU_TIMER_QUERY_SLOTS, statistics.Buckets[2]);
+}
+
+TEST(UntrustedResultsAreLost)
+{
+	GpuTimerQueryRing ring;
+	FakeGpu* pGpu = new FakeGpu();
+	ring.SetProvider(pGpu);
+
+	pGpu->Complete(Measure(&ring), 1000, FALSE);	// Disjoint: the GPU clock changed meanwhile.
+	pGpu->Complete(Measure(&ring), 2000);
+	ring.Resolve();
+
+	GpuTimeStatistics statistics;
+	ring.GetStatistics(&statistics);
+	CHECK_EQUAL(1u, statistics.Count);
+	CHECK_EQUAL(1u, statistics.Lost);
+	CHECK_EQUAL(2000, statistics.Total);
+}
+
+TEST(EndOfASlotNotBegunIsRejected)
+{
+	GpuTimerQueryRing ring;
+	CHECK_EQUAL(E_UNEXPECTED, ring.End(0));
+
+	UINT slot = 0;
+	CHECK_EQUAL(S_FALSE, ring.Begin(&slot));	// No provider: nothing is measured.
+	CHECK_EQUAL(E_POINTER, ring.Begin(NULL));
+
+	ring.SetProvider(new FakeGpu());
+	CHECK_EQUAL(E_UNEXPECTED, ring.End(0));
+	slot = Measure(&ring);
+	CHECK_EQUAL(E_UNEXPECTED, ring.End(slot));	// Already ended.
+	CHECK_EQUAL(E_UNEXPECTED, ring.End(GPU_TIMER_QUERY_SLOTS));
+}
+
+TEST(ResetLosesTheMeasurementsInFlight)
+{
+	GpuTimerQueryRing ring;
+	FakeGpu* pGpu = new FakeGpu();
+	ring.SetProvider(pGpu);
+
+	Measure(&ring);
+	Measure(&ring);
+	ring.Reset();
+
+	GpuTimeStatistics statistics;
+	ring.GetStatistics(&statistics);
+	CHECK_EQUAL(2u, statistics.Lost);
+
+	// The slots start over.
+	CHECK_EQUAL(0u, Measure(&ring));
+
+	ring.ResetStatistics();
+	ring.GetStatistics(&statistics);
+	CHECK_EQUAL(0u, statistics.Lost);
+}
+
+TEST(TheRingOwnsTheProvider)
+{
+	BOOL bFirstDeleted = FALSE;
+	BOOL bSecondDeleted = FALSE;
+	BOOL bLastDeleted = FALSE;
+	{
+		GpuTimerQueryRing ring;
+		ring.SetProvider(new FakeGpu(&bFirstDeleted));
+		CHECK(ring.HasProvider());
+
+		ring.SetProvider(new FakeGpu(&bSecondDeleted));
+		CHECK(bFirstDeleted);
+		ring.SetProvider(NULL);
+		CHECK(bSecondDeleted);
+		CHECK(!ring.HasProvider());
+
+		ring.SetProvider(new FakeGpu(&bLastDeleted));
+	}
+	CHECK(bLastDeleted);
+}
+
+TEST_MAIN()
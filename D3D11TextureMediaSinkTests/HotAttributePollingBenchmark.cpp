@@ -0,0 +1,194 @@
+// Polling the statistics of the sink, through the hot attribute table and through the generic attribute store.
+//
+// The consumer reads a few statistics every frame with GetUINT32/GetUINT64. Without the hot table those reads go to the
+// attribute store of the sink, which takes its lock and searches its items; the store here is the same, with ITEM_COUNT items,
+// the polled ones among the last. With the table, TextureMediaSink::GetUINT32/GetUINT64 find them with HotAttributeTable::Get.
+// Each is run with nobody writing, then with a thread updating the polled values as fast as it can (the scheduler and the
+// presenter update them once per frame, so this is the worst case).
+//
+// Prints nanoseconds per poll. The iteration count can be given as the first argument. The run fails only if a poll reads
+// a value that was never written.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdlib.h>
+#include <thread>
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	const UINT ITEM_COUNT = 32;
+	const UINT POLLED_COUNT = 8;	// Half of them UINT32, half UINT64.
+	long s_Iterations = 1000000;
+
+	GUID Key(UINT32 n)
+	{
+		GUID key = { n, 0x4d2a, 0x11f0, { 0x8b, 0x3c, 0x00, 0x15, 0x5d, 0x01, 0x42, 0x7e } };
+		return key;
+	}
+	BOOL Is64(UINT n)
+	{
+		return (n & 1) != 0;
+	}
+	UINT64 Value(UINT n, UINT64 i)
+	{
+		return Is64(n) ? (i << 32) | i : (UINT32)i;
+	}
+
+	// The attribute store of the sink: one lock for every call.
+	class LockedAttributeStore
+	{
+	public:
+		LockedAttributeStore()
+		{
+			this->_Attributes = new FakeAttributes<IMFAttributes>();
+		}
+		~LockedAttributeStore()
+		{
+			this->_Attributes->Release();
+		}
+
+		HRESULT GetUINT32(REFGUID key, UINT32* pValue)
+		{
+			AutoLock lock(&this->_csStore);
+			return this->_Attributes->GetUINT32(key, pValue);
+		}
+		HRESULT GetUINT64(REFGUID key, UINT64* pValue)
+		{
+			AutoLock lock(&this->_csStore);
+			return this->_Attributes->GetUINT64(key, pValue);
+		}
+		HRESULT Set(REFGUID key, MF_ATTRIBUTE_TYPE type, UINT64 value)
+		{
+			AutoLock lock(&this->_csStore);
+			return (MF_ATTRIBUTE_UINT32 == type) ? this->_Attributes->SetUINT32(key, (UINT32)value) : this->_Attributes->SetUINT64(key, value);
+		}
+
+	private:
+		FakeAttributes<IMFAttributes>* _Attributes;
+		CriticalSection _csStore;
+	};
+
+	// TextureMediaSink::GetUINT32/GetUINT64, as far as the hot keys go.
+	HRESULT GetUINT32(HotAttributeTable* pTable, REFGUID key, UINT32* pValue)
+	{
+		UINT64 value;
+		if (!pTable->Get(key, MF_ATTRIBUTE_UINT32, &value))
+			return MF_E_ATTRIBUTENOTFOUND;
+		*pValue = (UINT32)value;
+		return S_OK;
+	}
+	HRESULT GetUINT64(HotAttributeTable* pTable, REFGUID key, UINT64* pValue)
+	{
+		if (!pTable->Get(key, MF_ATTRIBUTE_UINT64, pValue))
+			return MF_E_ATTRIBUTENOTFOUND;
+		return S_OK;
+	}
+
+	struct Polling
+	{
+		HotAttributeTable Table;
+		LockedAttributeStore Store;
+		GUID Keys[ITEM_COUNT];
+		std::atomic<bool> Writing;
+
+		Polling()
+		{
+			for (UINT n = 0; n < ITEM_COUNT; n++)
+			{
+				this->Keys[n] = Key(n);
+				MF_ATTRIBUTE_TYPE type = Is64(n) ? MF_ATTRIBUTE_UINT64 : MF_ATTRIBUTE_UINT32;
+				this->Store.Set(this->Keys[n], type, Value(n, 0));
+				this->Table.Register(this->Keys[n], type, Value(n, 0));
+			}
+			this->Writing = false;
+		}
+	};
+
+	void WriteTable(Polling* pPolling)
+	{
+		for (UINT64 i = 1; pPolling->Writing; i++)
+		{
+			for (UINT n = ITEM_COUNT - POLLED_COUNT; n < ITEM_COUNT; n++)
+				pPolling->Table.Set(pPolling->Keys[n], Value(n, i & 0xFFFF));
+		}
+	}
+	void WriteStore(Polling* pPolling)
+	{
+		for (UINT64 i = 1; pPolling->Writing; i++)
+		{
+			for (UINT n = ITEM_COUNT - POLLED_COUNT; n < ITEM_COUNT; n++)
+				pPolling->Store.Set(pPolling->Keys[n], Is64(n) ? MF_ATTRIBUTE_UINT64 : MF_ATTRIBUTE_UINT32, Value(n, i & 0xFFFF));
+		}
+	}
+
+	// Polls the keys in turn, s_Iterations times. Returns FALSE if a value was never written.
+	BOOL Poll(Polling* pPolling, BOOL bHot, BOOL b64, const char* name, const char* workload)
+	{
+		BOOL bValid = TRUE;
+		UINT first = ITEM_COUNT - POLLED_COUNT + (b64 ? 1 : 0);
+
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		for (long i = 0; i < s_Iterations; i++)
+		{
+			UINT n = first + 2 * (i % (POLLED_COUNT / 2));
+			HRESULT hr;
+			UINT64 value;
+			if (b64)
+			{
+				hr = bHot ? GetUINT64(&pPolling->Table, pPolling->Keys[n], &value) : pPolling->Store.GetUINT64(pPolling->Keys[n], &value);
+				if (S_OK != hr || (value >> 32) != (value & 0xFFFFFFFF))
+					bValid = FALSE;
+			}
+			else
+			{
+				UINT32 value32;
+				hr = bHot ? GetUINT32(&pPolling->Table, pPolling->Keys[n], &value32) : pPolling->Store.GetUINT32(pPolling->Keys[n], &value32);
+				if (S_OK != hr || value32 > 0xFFFF)
+					bValid = FALSE;
+			}
+		}
+		double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+
+		printf("  %-18s %-10s %-8s %8.2f ns/poll\n", name, b64 ? "GetUINT64" : "GetUINT32", workload, ns / s_Iterations);
+		return bValid;
+	}
+
+	void Run(BOOL bHot, const char* name)
+	{
+		Polling polling;
+		CHECK(Poll(&polling, bHot, FALSE, name, "idle"));
+		CHECK(Poll(&polling, bHot, TRUE, name, "idle"));
+
+		polling.Writing = true;
+		std::thread writer(bHot ? WriteTable : WriteStore, &polling);
+		CHECK(Poll(&polling, bHot, FALSE, name, "writing"));
+		CHECK(Poll(&polling, bHot, TRUE, name, "writing"));
+		polling.Writing = false;
+		writer.join();
+	}
+}
+
+TEST(PollingTheAttributeStore)
+{
+	Run(FALSE, "attribute store");
+}
+
+TEST(PollingTheHotTable)
+{
+	Run(TRUE, "hot table");
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		s_Iterations = max(1L, atol(argv[1]));
+
+	return TestHarness::RunAll();
+}
@@ -0,0 +1,207 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+#include <atomic>
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	GUID Key(UINT32 n)
+	{
+		GUID key = { n, 0x1234, 0x5678, { 0x9a, 0xbc, 0xde, 0xf0, 0x12, 0x34, 0x56, 0x78 } };
+		return key;
+	}
+
+	const GUID KEY_FLAG = Key(1);	// UINT32
+	const GUID KEY_COUNT = Key(2);	// UINT64
+	const GUID KEY_OTHER = Key(3);	// Not registered.
+
+	const UINT64 LOW = 0x00000000FFFFFFFFULL;
+	const UINT64 HIGH = 0xFFFFFFFF00000000ULL;
+
+	struct Fixture
+	{
+		HotAttributeTable Table;
+
+		Fixture()
+		{
+			CHECK_EQUAL(S_OK, this->Table.Register(KEY_FLAG, MF_ATTRIBUTE_UINT32, 1));
+			CHECK_EQUAL(S_OK, this->Table.Register(KEY_COUNT, MF_ATTRIBUTE_UINT64, 0x100000002ULL));
+		}
+	};
+
+	// The consumer polling a statistic while the scheduler updates it.
+	struct Polling
+	{
+		HotAttributeTable Table;
+		std::atomic<bool> Running;
+		std::atomic<long> Reads;
+		std::atomic<long> Torn;
+	};
+
+	void Poll(Polling* pPolling)
+	{
+		while (pPolling->Running)
+		{
+			UINT64 value = 0;
+			pPolling->Table.Get(KEY_COUNT, MF_ATTRIBUTE_UINT64, &value);
+			if (LOW != value && HIGH != value)
+				pPolling->Torn++;
+			pPolling->Reads++;
+		}
+	}
+}
+
+TEST(RegisteredKeysAreReadWithTheirType)
+{
+	Fixture f;
+	UINT64 value = 0;
+	CHECK(f.Table.Get(KEY_FLAG, MF_ATTRIBUTE_UINT32, &value));
+	CHECK_EQUAL(1u, value);
+	CHECK(f.Table.Get(KEY_COUNT, MF_ATTRIBUTE_UINT64, &value));
+	CHECK_EQUAL(0x100000002ULL, value);
+
+	// The other keys, and the other types, are left to the generic store.
+	CHECK(!f.Table.Get(KEY_FLAG, MF_ATTRIBUTE_UINT64, &value));
+	CHECK(!f.Table.Get(KEY_OTHER, MF_ATTRIBUTE_UINT32, &value));
+	CHECK(!f.Table.Set(KEY_OTHER, 5));
+
+	CHECK(f.Table.Set(KEY_COUNT, 7));
+	CHECK(f.Table.Get(KEY_COUNT, MF_ATTRIBUTE_UINT64, &value));
+	CHECK_EQUAL(7u, value);
+}
+
+TEST(RegisterRejectsDuplicatesAndOtherTypes)
+{
+	Fixture f;
+	CHECK_EQUAL(E_INVALIDARG, f.Table.Register(KEY_FLAG, MF_ATTRIBUTE_UINT32, 0));
+	CHECK_EQUAL(E_INVALIDARG, f.Table.Register(KEY_OTHER, MF_ATTRIBUTE_GUID, 0));
+	CHECK_EQUAL(2u, f.Table.GetCount());
+}
+
+TEST(ItemsReadAsPropVariants)
+{
+	Fixture f;
+	PROPVARIANT value;
+	CHECK(f.Table.GetItem(KEY_FLAG, &value));
+	CHECK_EQUAL((VARTYPE)VT_UI4, value.vt);
+	CHECK_EQUAL(1u, value.ulVal);
+	CHECK(f.Table.GetItem(KEY_COUNT, &value));
+	CHECK_EQUAL((VARTYPE)VT_UI8, value.vt);
+	CHECK_EQUAL(0x100000002ULL, value.uhVal.QuadPart);
+	CHECK(f.Table.GetItem(KEY_COUNT, NULL));	// Only whether it is there.
+	CHECK(!f.Table.GetItem(KEY_OTHER, &value));
+
+	MF_ATTRIBUTE_TYPE type;
+	CHECK(f.Table.GetItemType(KEY_FLAG, &type));
+	CHECK_EQUAL(MF_ATTRIBUTE_UINT32, type);
+	CHECK(f.Table.GetItemType(KEY_COUNT, &type));
+	CHECK_EQUAL(MF_ATTRIBUTE_UINT64, type);
+	CHECK(!f.Table.GetItemType(KEY_OTHER, &type));
+}
+
+TEST(ItemsAreEnumeratedInTheOrderRegistered)
+{
+	Fixture f;
+	f.Table.Set(KEY_FLAG, 0);
+
+	GUID key;
+	PROPVARIANT value;
+	CHECK(f.Table.GetItemByIndex(0, &key, &value));
+	CHECK(KEY_FLAG == key);
+	CHECK_EQUAL(0u, value.ulVal);
+	CHECK(f.Table.GetItemByIndex(1, &key, NULL));
+	CHECK(KEY_COUNT == key);
+	CHECK(!f.Table.GetItemByIndex(2, &key, &value));
+}
+
+TEST(CompareItemNeedsTheSameTypeAndValue)
+{
+	Fixture f;
+	PROPVARIANT value;
+	::PropVariantInit(&value);
+	BOOL bResult = TRUE;
+
+	value.vt = VT_UI4;
+	value.ulVal = 1;
+	CHECK(f.Table.CompareItem(KEY_FLAG, value, &bResult));
+	CHECK(bResult);
+	value.ulVal = 2;
+	CHECK(f.Table.CompareItem(KEY_FLAG, value, &bResult));
+	CHECK(!bResult);
+
+	// The same number as another type is not the same item.
+	value.vt = VT_UI8;
+	value.uhVal.QuadPart = 1;
+	CHECK(f.Table.CompareItem(KEY_FLAG, value, &bResult));
+	CHECK(!bResult);
+	value.uhVal.QuadPart = 0x100000002ULL;
+	CHECK(f.Table.CompareItem(KEY_COUNT, value, &bResult));
+	CHECK(bResult);
+
+	CHECK(!f.Table.CompareItem(KEY_OTHER, value, &bResult));
+}
+
+TEST(CopyAllItemsWritesTheTypedValues)
+{
+	Fixture f;
+	FakeAttributes<IMFAttributes>* pDest = new FakeAttributes<IMFAttributes>();
+	pDest->SetUINT32(KEY_OTHER, 9);
+
+	CHECK_EQUAL(S_OK, f.Table.CopyAllItems(pDest));
+	UINT32 flag = 0;
+	UINT64 count = 0;
+	CHECK_EQUAL(S_OK, pDest->GetUINT32(KEY_FLAG, &flag));
+	CHECK_EQUAL(1u, flag);
+	CHECK_EQUAL(S_OK, pDest->GetUINT64(KEY_COUNT, &count));
+	CHECK_EQUAL(0x100000002ULL, count);
+	CHECK_EQUAL(S_OK, pDest->GetUINT32(KEY_OTHER, &flag));	// The store's own items are the caller's business.
+
+	CHECK_EQUAL(E_POINTER, f.Table.CopyAllItems(NULL));
+	pDest->Release();
+}
+
+TEST(HalfTheSlotsAreUsable)
+{
+	HotAttributeTable table;
+	for (UINT32 i = 0; i < HOT_ATTRIBUTE_SLOTS / 2; i++)
+		CHECK_EQUAL(S_OK, table.Register(Key(100 + i), MF_ATTRIBUTE_UINT64, i));
+	CHECK_EQUAL(E_OUTOFMEMORY, table.Register(Key(99), MF_ATTRIBUTE_UINT64, 0));
+
+	// Every key is found past the others in its chain.
+	for (UINT32 i = 0; i < HOT_ATTRIBUTE_SLOTS / 2; i++)
+	{
+		UINT64 value = ~0ULL;
+		CHECK(table.Get(Key(100 + i), MF_ATTRIBUTE_UINT64, &value));
+		CHECK_EQUAL((UINT64)i, value);
+
+		GUID key;
+		CHECK(table.GetItemByIndex(i, &key, NULL));
+		CHECK(Key(100 + i) == key);
+	}
+	UINT64 value;
+	CHECK(!table.Get(Key(99), MF_ATTRIBUTE_UINT64, &value));
+}
+
+TEST(ReadersNeverSeeHalfAValue)
+{
+	Polling polling;
+	polling.Table.Register(KEY_COUNT, MF_ATTRIBUTE_UINT64, LOW);
+	polling.Running = true;
+	polling.Reads = 0;
+	polling.Torn = 0;
+	std::thread reader(Poll, &polling);
+
+	for (int i = 0; i < 200000; i++)
+		polling.Table.Set(KEY_COUNT, (i & 1) ? LOW : HIGH);
+	polling.Running = false;
+	reader.join();
+
+	printf("  %ld reads while writing, %ld torn\n", (long)polling.Reads, (long)polling.Torn);
+	CHECK_EQUAL(0, (long)polling.Torn);
+}
+
+TEST_MAIN()
@@ -0,0 +1,92 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	struct Item : public IntrusiveListEntry
+	{
+		int Value;
+		Item(int value) : Value(value) {}
+	};
+}
+
+TEST(InsertAndRemoveAtBothEnds)
+{
+	IntrusiveList<Item> list;
+	Item a(1), b(2), c(3);
+
+	CHECK(list.IsEmpty());
+	CHECK_EQUAL(S_OK, list.InsertBack(&b));
+	CHECK_EQUAL(S_OK, list.InsertFront(&a));
+	CHECK_EQUAL(S_OK, list.InsertBack(&c));
+	CHECK_EQUAL(3u, list.GetCount());
+
+	Item* pItem = NULL;
+	CHECK_EQUAL(S_OK, list.GetFront(&pItem));
+	CHECK_EQUAL(&a, pItem);
+	CHECK_EQUAL(S_OK, list.GetBack(&pItem));
+	CHECK_EQUAL(&c, pItem);
+
+	CHECK_EQUAL(S_OK, list.RemoveFront(&pItem));
+	CHECK_EQUAL(&a, pItem);
+	CHECK_EQUAL(S_OK, list.RemoveBack(&pItem));
+	CHECK_EQUAL(&c, pItem);
+	CHECK_EQUAL(S_OK, list.RemoveBack(&pItem));
+	CHECK_EQUAL(&b, pItem);
+	CHECK(list.IsEmpty());
+	CHECK_EQUAL(E_FAIL, list.RemoveFront(&pItem));
+	CHECK_EQUAL(E_FAIL, list.GetBack(&pItem));
+}
+
+TEST(RemoveFromTheMiddleKeepsTheOrder)
+{
+	IntrusiveList<Item> list;
+	Item items[5] = { Item(0), Item(1), Item(2), Item(3), Item(4) };
+	for (int i = 0; i < 5; i++)
+		list.InsertBack(&items[i]);
+
+	CHECK_EQUAL(S_OK, list.Remove(&items[2]));
+	CHECK_EQUAL(4u, list.GetCount());
+
+	int expected[] = { 0, 1, 3, 4 };
+	int n = 0;
+	for (Item* p = list.Front(); p != NULL; p = list.Next(p))
+		CHECK_EQUAL(expected[n++], p->Value);
+	CHECK_EQUAL(4, n);
+}
+
+TEST(AnElementIsInOneListAtATime)
+{
+	IntrusiveList<Item> list1, list2;
+	Item a(1);
+
+	CHECK_EQUAL(S_OK, list1.InsertBack(&a));
+	CHECK_EQUAL(E_INVALIDARG, list2.InsertBack(&a));
+	CHECK_EQUAL(S_OK, list1.Remove(&a));
+	CHECK_EQUAL(E_INVALIDARG, list1.Remove(&a));
+	CHECK_EQUAL(S_OK, list2.InsertBack(&a));
+	CHECK_EQUAL(E_POINTER, list2.InsertBack(NULL));
+}
+
+TEST(ClearUnlinksTheElements)
+{
+	Item a(1), b(2);
+	{
+		IntrusiveList<Item> list;
+		list.InsertBack(&a);
+		list.InsertBack(&b);
+		list.Clear();
+		CHECK(list.IsEmpty());
+		CHECK(NULL == list.Front());
+
+		// Unlinked, so they can go in again.
+		CHECK_EQUAL(S_OK, list.InsertBack(&a));
+	}
+	// The destructor unlinked it too.
+	CHECK(NULL == a.next);
+	CHECK(NULL == b.next);
+}
+
+TEST_MAIN()
@@ -0,0 +1,259 @@
+// Insert/remove throughput of the containers of the sink.
+//
+// Two workloads, each run on every container:
+// - queue: a steady FIFO of QUEUE_DEPTH items, insert at the back and remove at the front (the sample and event queues).
+// - remove-middle: remove one item of STREAM_COUNT by identity and put it back (TextureMemoryBudget::UnregisterStream).
+//   The non-intrusive lists have to search for it; IntrusiveList unlinks it directly.
+//
+// Prints nanoseconds per operation and, where perf_event_open is allowed, cache misses per operation. The iteration count
+// can be given as the first argument. The run fails only if a container returns the items in the wrong order.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+#include <chrono>
+#include <stdlib.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	const DWORD QUEUE_DEPTH = 8;
+	const DWORD STREAM_COUNT = 32;
+	long s_Iterations = 200000;
+
+	// Cache misses of this thread, when the kernel lets us count them.
+	class CacheMissCounter
+	{
+	public:
+		CacheMissCounter()
+		{
+#if defined(__linux__)
+			struct perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			this->_fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+		}
+		~CacheMissCounter()
+		{
+#if defined(__linux__)
+			if (this->_fd >= 0)
+				close(this->_fd);
+#endif
+		}
+
+		void Start()
+		{
+#if defined(__linux__)
+			if (this->_fd >= 0)
+			{
+				ioctl(this->_fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(this->_fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+#endif
+		}
+		// -1 if not available.
+		long long Stop()
+		{
+#if defined(__linux__)
+			if (this->_fd >= 0)
+			{
+				ioctl(this->_fd, PERF_EVENT_IOC_DISABLE, 0);
+				long long count = 0;
+				if (read(this->_fd, &count, sizeof(count)) == sizeof(count))
+					return count;
+			}
+#endif
+			return -1;
+		}
+
+	private:
+		int _fd = -1;
+	};
+
+	struct Timing
+	{
+		std::chrono::steady_clock::time_point Begin;
+		CacheMissCounter Misses;
+
+		void Start()
+		{
+			this->Misses.Start();
+			this->Begin = std::chrono::steady_clock::now();
+		}
+		void Report(const char* container, const char* workload, long operations)
+		{
+			double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->Begin).count();
+			long long misses = this->Misses.Stop();
+
+			if (misses < 0)
+				printf("  %-14s %-14s %8.2f ns/op  cache misses: n/a\n", container, workload, ns / operations);
+			else
+				printf("  %-14s %-14s %8.2f ns/op  cache misses: %.4f/op\n", container, workload, ns / operations, (double)misses / operations);
+		}
+	};
+
+	struct Entry : public IntrusiveListEntry
+	{
+		DWORD Id;
+	};
+
+	// queue: the same for every container with InsertBack/RemoveFront.
+	template <class TList, class T>
+	BOOL RunQueue(const char* name, TList& list, T** items)
+	{
+		BOOL inOrder = TRUE;
+		for (DWORD i = 0; i < QUEUE_DEPTH; i++)
+			list.InsertBack(items[i]);
+
+		Timing timing;
+		timing.Start();
+		for (long n = 0; n < s_Iterations; n++)
+		{
+			T* pItem = NULL;
+			list.RemoveFront(&pItem);
+			if (pItem != items[n % QUEUE_DEPTH])
+				inOrder = FALSE;
+			list.InsertBack(pItem);
+		}
+		timing.Report(name, "queue", s_Iterations * 2);
+
+		return inOrder;
+	}
+
+	// ComPtr containers AddRef what they return.
+	template <class TList>
+	BOOL RunComQueue(const char* name, TList& list, IUnknown** items)
+	{
+		BOOL inOrder = TRUE;
+		for (DWORD i = 0; i < QUEUE_DEPTH; i++)
+			list.InsertBack(items[i]);
+
+		Timing timing;
+		timing.Start();
+		for (long n = 0; n < s_Iterations; n++)
+		{
+			IUnknown* pItem = NULL;
+			list.RemoveFront(&pItem);
+			if (pItem != items[n % QUEUE_DEPTH])
+				inOrder = FALSE;
+			list.InsertBack(pItem);
+			pItem->Release();
+		}
+		timing.Report(name, "queue", s_Iterations * 2);
+
+		list.Clear();
+		return inOrder;
+	}
+}
+
+TEST(Queue)
+{
+	printf("queue of %u items, %ld iterations\n", QUEUE_DEPTH, s_Iterations);
+
+	Entry entries[QUEUE_DEPTH];
+	Entry* pEntries[QUEUE_DEPTH];
+	IUnknown* pUnknowns[QUEUE_DEPTH];
+	for (DWORD i = 0; i < QUEUE_DEPTH; i++)
+	{
+		entries[i].Id = i;
+		pEntries[i] = &entries[i];
+		pUnknowns[i] = new Fakes::FakeUnknown();
+	}
+
+	{
+		PtrList<Entry> list;
+		CHECK(RunQueue("PtrList", list, pEntries));
+	}
+	{
+		PtrRing<Entry> list;
+		CHECK(RunQueue("PtrRing", list, pEntries));
+	}
+	{
+		IntrusiveList<Entry> list;
+		CHECK(RunQueue("IntrusiveList", list, pEntries));
+	}
+	{
+		ComPtrListEx<IUnknown> list;
+		CHECK(RunComQueue("ComPtrListEx", list, pUnknowns));
+	}
+	{
+		ComPtrRing<IUnknown> list;
+		CHECK(RunComQueue("ComPtrRing", list, pUnknowns));
+	}
+
+	for (DWORD i = 0; i < QUEUE_DEPTH; i++)
+		pUnknowns[i]->Release();
+}
+
+TEST(RemoveFromTheMiddle)
+{
+	printf("remove one of %u items by identity, %ld iterations\n", STREAM_COUNT, s_Iterations);
+
+	Entry entries[STREAM_COUNT];
+	for (DWORD i = 0; i < STREAM_COUNT; i++)
+		entries[i].Id = i;
+
+	{
+		// As TextureMemoryBudget did before: rotate the list through RemoveFront/InsertBack, dropping the one that matches.
+		PtrList<Entry> list;
+		for (DWORD i = 0; i < STREAM_COUNT; i++)
+			list.InsertBack(&entries[i]);
+
+		Timing timing;
+		timing.Start();
+		for (long n = 0; n < s_Iterations; n++)
+		{
+			DWORD id = (DWORD)(n * 7) % STREAM_COUNT;
+			DWORD count = list.GetCount();
+			for (DWORD i = 0; i < count; i++)
+			{
+				Entry* pEntry = NULL;
+				list.RemoveFront(&pEntry);
+				if (pEntry->Id != id)
+					list.InsertBack(pEntry);
+			}
+			list.InsertBack(&entries[id]);
+		}
+		timing.Report("PtrList", "remove-middle", s_Iterations * 2);
+		CHECK_EQUAL(STREAM_COUNT, list.GetCount());
+	}
+	{
+		IntrusiveList<Entry> list;
+		for (DWORD i = 0; i < STREAM_COUNT; i++)
+			list.InsertBack(&entries[i]);
+
+		Timing timing;
+		timing.Start();
+		for (long n = 0; n < s_Iterations; n++)
+		{
+			DWORD id = (DWORD)(n * 7) % STREAM_COUNT;
+			list.Remove(&entries[id]);
+			list.InsertBack(&entries[id]);
+		}
+		timing.Report("IntrusiveList", "remove-middle", s_Iterations * 2);
+		CHECK_EQUAL(STREAM_COUNT, list.GetCount());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		s_Iterations = max(1L, atol(argv[1]));
+
+	return TestHarness::RunAll();
+}
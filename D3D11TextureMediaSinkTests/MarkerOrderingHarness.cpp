@@ -0,0 +1,286 @@
+// Markers and the samples placed around them.
+//
+// The pipeline places samples and markers on the stream in a script ("SSMSMM..."). A marker is completed, as
+// StreamSink::CompleteMarkers does it through MarkerSequence, as soon as the samples placed before it are done: in the order
+// the markers were placed, and without waiting for the samples placed after it. The target stands in for the stream sink and
+// records the order, and how many samples were done, when each marker is completed.
+//
+// The last test plays the script with a decoder thread placing and a processing thread taking PROCESS_MILLISECONDS per
+// sample, and prints the time from placing each marker to completing it.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+
+#include <thread>
+#include <vector>
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	const DWORD PROCESS_MILLISECONDS = 2;
+
+	// The stream sink, as far as the markers go.
+	class FakeMarkerTarget : public MarkerTarget
+	{
+	public:
+		MarkerSequence* Markers = NULL;
+		std::vector<UINT32> Completed;		// The contexts, in the order completed.
+		std::vector<UINT64> DoneAt;			// The samples done when each was completed.
+		std::vector<UINT64> Positions;
+		std::vector<MFTIME> CompletedAt;
+		HRESULT NextResult = S_OK;			// Returned once, then S_OK.
+
+		HRESULT CompleteMarker(IMarker* pMarker)
+		{
+			HRESULT hr = this->NextResult;
+			this->NextResult = S_OK;
+			if (S_OK != hr)
+				return hr;
+
+			PROPVARIANT var;
+			::PropVariantInit(&var);
+			pMarker->GetContext(&var);
+			UINT64 position = 0;
+			pMarker->GetPosition(&position);
+
+			this->Completed.push_back(var.ulVal);
+			this->DoneAt.push_back(this->Markers->GetSamplesDone());
+			this->Positions.push_back(position);
+			this->CompletedAt.push_back(::MFGetSystemTime());
+			::PropVariantClear(&var);
+			return S_OK;
+		}
+	};
+
+	HRESULT PlaceMarker(MarkerSequence* pMarkers, MFSTREAMSINK_MARKER_TYPE type, UINT32 context)
+	{
+		PROPVARIANT var;
+		::PropVariantInit(&var);
+		var.vt = VT_UI4;
+		var.ulVal = context;
+		return pMarkers->PlaceMarker(type, NULL, &var);
+	}
+
+	// Places the script: 'S' a sample, 'M' a marker numbered in order. Returns the number of markers.
+	UINT32 Place(MarkerSequence* pMarkers, const char* script)
+	{
+		UINT32 markers = 0;
+		for (const char* p = script; *p; p++)
+		{
+			if ('S' == *p)
+				pMarkers->SamplePlaced();
+			else
+				CHECK_EQUAL(S_OK, PlaceMarker(pMarkers, MFSTREAMSINK_MARKER_DEFAULT, markers++));
+		}
+		return markers;
+	}
+
+	// The script played by two threads.
+	struct Playback
+	{
+		const char* Script;
+		CriticalSection Lock;			// _csStreamSink and _csProcessing, as far as the counts go.
+		MarkerSequence Markers;
+		FakeMarkerTarget Target;
+		std::vector<MFTIME> PlacedAt;
+		volatile LONG SamplesPlaced;
+		LONG SampleCount;
+	};
+
+	// StreamSink::ProcessSample and PlaceMarker, with the OpPlaceMarker that follows a marker.
+	void Decode(Playback* pPlayback)
+	{
+		UINT32 markers = 0;
+		for (const char* p = pPlayback->Script; *p; p++)
+		{
+			AutoLock lock(&pPlayback->Lock);
+			if ('S' == *p)
+			{
+				pPlayback->Markers.SamplePlaced();
+				InterlockedIncrement(&pPlayback->SamplesPlaced);
+			}
+			else
+			{
+				pPlayback->PlacedAt.push_back(::MFGetSystemTime());
+				CHECK_EQUAL(S_OK, PlaceMarker(&pPlayback->Markers, MFSTREAMSINK_MARKER_DEFAULT, markers++));
+				CHECK_EQUAL(S_OK, pPlayback->Markers.Complete(&pPlayback->Target));
+			}
+		}
+	}
+
+	// StreamSink::ProcessSamplesFromQueue.
+	void Process(Playback* pPlayback)
+	{
+		for (LONG done = 0; done < pPlayback->SampleCount; done++)
+		{
+			while (pPlayback->SamplesPlaced <= done)
+				::Sleep(0);
+			::Sleep(PROCESS_MILLISECONDS);
+
+			AutoLock lock(&pPlayback->Lock);
+			pPlayback->Markers.SampleDone();
+			CHECK_EQUAL(S_OK, pPlayback->Markers.Complete(&pPlayback->Target));
+		}
+	}
+
+	void CheckCompletedInOrderWhenDue(FakeMarkerTarget* pTarget, UINT32 markers)
+	{
+		CHECK_EQUAL((size_t)markers, pTarget->Completed.size());
+		for (size_t i = 0; i < pTarget->Completed.size(); i++)
+		{
+			CHECK_EQUAL((UINT32)i, pTarget->Completed[i]);
+			CHECK_EQUAL(pTarget->Positions[i], pTarget->DoneAt[i]);	// Not before its samples, and not after.
+		}
+	}
+}
+
+TEST(ScriptedMarkersCompleteInOrderWhenTheirSamplesAreDone)
+{
+	MarkerSequence markers;
+	FakeMarkerTarget target;
+	target.Markers = &markers;
+
+	const char* script = "SSMSMMSSSMSM";
+	UINT32 count = Place(&markers, script);
+	CHECK_EQUAL(7u, markers.GetSamplesPlaced());
+
+	// Done one sample at a time, completing after each as the processing does.
+	CHECK_EQUAL(S_OK, markers.Complete(&target));
+	CHECK_EQUAL(0u, target.Completed.size());
+	for (UINT64 i = 0; i < markers.GetSamplesPlaced(); i++)
+	{
+		markers.SampleDone();
+		CHECK_EQUAL(S_OK, markers.Complete(&target));
+	}
+
+	CheckCompletedInOrderWhenDue(&target, count);
+	CHECK_EQUAL(0u, markers.GetMarkerCount());
+}
+
+TEST(MarkerWithNoPendingSampleCompletesAtOnce)
+{
+	MarkerSequence markers;
+	FakeMarkerTarget target;
+	target.Markers = &markers;
+
+	// At the start of the stream, and after the samples are all done.
+	CHECK_EQUAL(S_OK, PlaceMarker(&markers, MFSTREAMSINK_MARKER_TICK, 0));
+	CHECK_EQUAL(S_OK, markers.Complete(&target));
+	CHECK_EQUAL(1u, target.Completed.size());
+
+	markers.SamplePlaced();
+	markers.SampleDone();
+	CHECK_EQUAL(S_OK, PlaceMarker(&markers, MFSTREAMSINK_MARKER_TICK, 1));
+	CHECK_EQUAL(S_OK, markers.Complete(&target));
+	CheckCompletedInOrderWhenDue(&target, 2);
+}
+
+TEST(MarkerDoesNotWaitForTheSamplesAfterIt)
+{
+	MarkerSequence markers;
+	FakeMarkerTarget target;
+	target.Markers = &markers;
+
+	Place(&markers, "SMSSSSSSSSSS");
+	CHECK_EQUAL(S_OK, markers.Complete(&target));
+	CHECK_EQUAL(0u, target.Completed.size());	// Its sample is stalled in the processing.
+
+	markers.SampleDone();
+	CHECK_EQUAL(S_OK, markers.Complete(&target));
+	CHECK_EQUAL(1u, target.Completed.size());
+	CHECK_EQUAL(10u, markers.GetSamplesPlaced() - markers.GetSamplesDone());
+}
+
+TEST(EndOfSegmentStillDrainingHoldsTheMarkersAfterIt)
+{
+	MarkerSequence markers;
+	FakeMarkerTarget target;
+	target.Markers = &markers;
+
+	Place(&markers, "SMM");
+	markers.SampleDone();
+
+	// The first waits for its frames to be presented: neither leaves, and the call is not an error.
+	target.NextResult = S_FALSE;
+	CHECK_EQUAL(S_OK, markers.Complete(&target));
+	CHECK_EQUAL(0u, target.Completed.size());
+	CHECK_EQUAL(2u, markers.GetMarkerCount());
+
+	// The next frame retired: both, in order.
+	CHECK_EQUAL(S_OK, markers.Complete(&target));
+	CheckCompletedInOrderWhenDue(&target, 2);
+}
+
+TEST(FailedMarkerStaysAtTheHead)
+{
+	MarkerSequence markers;
+	FakeMarkerTarget target;
+	target.Markers = &markers;
+
+	Place(&markers, "MM");
+	target.NextResult = E_OUTOFMEMORY;
+	CHECK_EQUAL(E_OUTOFMEMORY, markers.Complete(&target));
+	CHECK_EQUAL(2u, markers.GetMarkerCount());
+
+	CHECK_EQUAL(S_OK, markers.Complete(&target));
+	CheckCompletedInOrderWhenDue(&target, 2);
+	CHECK_EQUAL(E_POINTER, markers.Complete(NULL));
+}
+
+TEST(ClearDropsTheMarkersAndThePendingSamples)
+{
+	MarkerSequence markers;
+	FakeMarkerTarget target;
+	target.Markers = &markers;
+
+	// A detach: the markers of the previous source are not completed, and its samples are not awaited any more.
+	Place(&markers, "SSMSM");
+	markers.Clear();
+	CHECK_EQUAL(0u, markers.GetMarkerCount());
+	CHECK_EQUAL(markers.GetSamplesPlaced(), markers.GetSamplesDone());
+
+	CHECK_EQUAL(S_OK, PlaceMarker(&markers, MFSTREAMSINK_MARKER_ENDOFSEGMENT, 0));
+	CHECK_EQUAL(S_OK, markers.Complete(&target));
+	CheckCompletedInOrderWhenDue(&target, 1);
+}
+
+TEST(MarkersCompleteAsTheProcessingGoes)
+{
+	Playback playback;
+	playback.Script = "SSSMSSSSSSSSSSMSMMSSSSSSSSSSSSSSSSSSSSMSSSSSSSSSSSSM";
+	playback.Target.Markers = &playback.Markers;
+	playback.SamplesPlaced = 0;
+	playback.SampleCount = 0;
+	UINT32 count = 0;
+	for (const char* p = playback.Script; *p; p++)
+	{
+		if ('S' == *p)
+			playback.SampleCount++;
+		else
+			count++;
+	}
+
+	// The decoder places the whole script long before the processing is through.
+	std::thread processing(Process, &playback);
+	std::thread decoder(Decode, &playback);
+	decoder.join();
+	processing.join();
+
+	CheckCompletedInOrderWhenDue(&playback.Target, count);
+	CHECK_EQUAL(0u, playback.Markers.GetMarkerCount());
+
+	MFTIME total = 0;
+	MFTIME longest = 0;
+	for (size_t i = 0; i < playback.Target.CompletedAt.size(); i++)
+	{
+		MFTIME latency = playback.Target.CompletedAt[i] - playback.PlacedAt[i];
+		total += latency;
+		if (latency > longest)
+			longest = latency;
+	}
+	printf("  %u markers among %ld samples of %lu ms: %.1f ms from placing to completing on average, %.1f ms at most\n",
+		count, (long)playback.SampleCount, (unsigned long)PROCESS_MILLISECONDS, total / 10000.0 / count, longest / 10000.0);
+}
+
+TEST_MAIN()
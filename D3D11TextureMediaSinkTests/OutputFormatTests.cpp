@@ -0,0 +1,76 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+
+using namespace D3D11TextureMediaSink;
+
+TEST(SupportedOutputFormats)
+{
+	CHECK(IsSupportedOutputFormat(DXGI_FORMAT_B8G8R8A8_UNORM));
+	CHECK(IsSupportedOutputFormat(DXGI_FORMAT_R10G10B10A2_UNORM));
+	CHECK(IsSupportedOutputFormat(DXGI_FORMAT_NV12));
+	CHECK(IsSupportedOutputFormat(DXGI_FORMAT_P010));
+	CHECK(!IsSupportedOutputFormat(DXGI_FORMAT_UNKNOWN));
+	CHECK(!IsSupportedOutputFormat(DXGI_FORMAT_R8G8B8A8_UNORM));
+	CHECK(!IsSupportedOutputFormat(DXGI_FORMAT_YUY2));
+
+	CHECK(IsPlanarFormat(DXGI_FORMAT_NV12));
+	CHECK(IsPlanarFormat(DXGI_FORMAT_P010));
+	CHECK(!IsPlanarFormat(DXGI_FORMAT_B8G8R8A8_UNORM));
+}
+
+TEST(PlanarSizesAreRoundedUpToEven)
+{
+	CHECK_EQUAL(1920u, AlignOutputSize(DXGI_FORMAT_NV12, 1920));
+	CHECK_EQUAL(1082u, AlignOutputSize(DXGI_FORMAT_NV12, 1081));
+	CHECK_EQUAL(2u, AlignOutputSize(DXGI_FORMAT_P010, 1));
+	CHECK_EQUAL(1081u, AlignOutputSize(DXGI_FORMAT_B8G8R8A8_UNORM, 1081));
+}
+
+TEST(PackedFormatsHaveOnePlane)
+{
+	OutputPlane planes[OUTPUT_PLANE_MAX];
+	CHECK_EQUAL(1u, GetOutputPlanes(DXGI_FORMAT_B8G8R8A8_UNORM, 640, 480, planes));
+	CHECK_EQUAL(640u, planes[0].Width);
+	CHECK_EQUAL(480u, planes[0].Height);
+	CHECK_EQUAL(4u, planes[0].BytesPerElement);
+	CHECK_EQUAL(DXGI_FORMAT_B8G8R8A8_UNORM, planes[0].ViewFormat);
+
+	CHECK_EQUAL(1u, GetOutputPlanes(DXGI_FORMAT_R10G10B10A2_UNORM, 640, 480, planes));
+	CHECK_EQUAL(DXGI_FORMAT_R10G10B10A2_UNORM, planes[0].ViewFormat);
+}
+
+TEST(PlanarFormatsHaveALumaAndAnInterleavedChromaPlane)
+{
+	OutputPlane planes[OUTPUT_PLANE_MAX];
+	CHECK_EQUAL(2u, GetOutputPlanes(DXGI_FORMAT_NV12, 1920, 1080, planes));
+	CHECK_EQUAL(1920u, planes[0].Width);
+	CHECK_EQUAL(1080u, planes[0].Height);
+	CHECK_EQUAL(1u, planes[0].BytesPerElement);
+	CHECK_EQUAL(DXGI_FORMAT_R8_UNORM, planes[0].ViewFormat);
+	CHECK_EQUAL(960u, planes[1].Width);
+	CHECK_EQUAL(540u, planes[1].Height);
+	CHECK_EQUAL(2u, planes[1].BytesPerElement);
+	CHECK_EQUAL(DXGI_FORMAT_R8G8_UNORM, planes[1].ViewFormat);
+
+	CHECK_EQUAL(2u, GetOutputPlanes(DXGI_FORMAT_P010, 1920, 1080, planes));
+	CHECK_EQUAL(2u, planes[0].BytesPerElement);
+	CHECK_EQUAL(DXGI_FORMAT_R16_UNORM, planes[0].ViewFormat);
+	CHECK_EQUAL(4u, planes[1].BytesPerElement);
+	CHECK_EQUAL(DXGI_FORMAT_R16G16_UNORM, planes[1].ViewFormat);
+}
+
+TEST(UnsupportedFormatHasNoPlanes)
+{
+	OutputPlane planes[OUTPUT_PLANE_MAX];
+	CHECK_EQUAL(0u, GetOutputPlanes(DXGI_FORMAT_YUY2, 640, 480, planes));
+}
+
+TEST(NV12IsSmallerThanBGRA)
+{
+	// The point of the planar output: 12 bits per pixel instead of 32.
+	UINT64 bgra = GetOutputFrameBytes(DXGI_FORMAT_B8G8R8A8_UNORM, 3840, 2160);
+	UINT64 nv12 = GetOutputFrameBytes(DXGI_FORMAT_NV12, 3840, 2160);
+	CHECK_EQUAL(bgra * 3, nv12 * 8);
+}
+
+TEST_MAIN()
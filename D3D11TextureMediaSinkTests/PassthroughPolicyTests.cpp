@@ -0,0 +1,107 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	// A 1080p BGRA progressive frame from a decoder that can be presented as is.
+	PassthroughQuery MakeQuery()
+	{
+		PassthroughQuery query;
+		query.Enabled = TRUE;
+		query.InputFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
+		query.InputWidth = 1920;
+		query.InputHeight = 1080;
+		query.InputArraySize = 1;
+		query.InputViewIndex = 0;
+		query.InputBindFlags = D3D11_BIND_SHADER_RESOURCE;
+		query.InterlaceMode = MFVideoInterlace_Progressive;
+		query.OutputFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
+		query.OutputWidth = 1920;
+		query.OutputHeight = 1080;
+		return query;
+	}
+}
+
+TEST(MatchingFrameIsPassedThrough)
+{
+	CHECK_EQUAL(Passthrough_Yes, DecidePassthrough(MakeQuery()));
+
+	// BGRX reads as BGRA with opaque alpha.
+	PassthroughQuery query = MakeQuery();
+	query.InputFormat = DXGI_FORMAT_B8G8R8X8_UNORM;
+	CHECK_EQUAL(Passthrough_Yes, DecidePassthrough(query));
+
+	// Any format is passed through to the same output format.
+	query = MakeQuery();
+	query.InputFormat = query.OutputFormat = DXGI_FORMAT_NV12;
+	CHECK_EQUAL(Passthrough_Yes, DecidePassthrough(query));
+}
+
+TEST(DisabledUnlessAsked)
+{
+	PassthroughQuery query = MakeQuery();
+	query.Enabled = FALSE;
+	CHECK_EQUAL(Passthrough_Disabled, DecidePassthrough(query));
+}
+
+TEST(EachMismatchIsReported)
+{
+	PassthroughQuery query = MakeQuery();
+	query.InputFormat = DXGI_FORMAT_NV12;
+	CHECK_EQUAL(Passthrough_FormatMismatch, DecidePassthrough(query));
+
+	// BGRA to BGRX is not the same: the consumer would read garbage alpha.
+	query = MakeQuery();
+	query.OutputFormat = DXGI_FORMAT_B8G8R8X8_UNORM;
+	CHECK_EQUAL(Passthrough_FormatMismatch, DecidePassthrough(query));
+
+	query = MakeQuery();
+	query.OutputWidth = 1280;
+	CHECK_EQUAL(Passthrough_SizeMismatch, DecidePassthrough(query));
+	query = MakeQuery();
+	query.InputHeight = 1088;	// A decoder's padded height.
+	CHECK_EQUAL(Passthrough_SizeMismatch, DecidePassthrough(query));
+
+	query = MakeQuery();
+	query.InterlaceMode = MFVideoInterlace_FieldInterleavedUpperFirst;
+	CHECK_EQUAL(Passthrough_Interlaced, DecidePassthrough(query));
+	query.InterlaceMode = MFVideoInterlace_MixedInterlaceOrProgressive;
+	CHECK_EQUAL(Passthrough_Interlaced, DecidePassthrough(query));
+}
+
+TEST(TextureArraySlicesAndUnbindableTexturesAreNotShared)
+{
+	PassthroughQuery query = MakeQuery();
+	query.InputArraySize = 16;	// Decoders usually output slices of one texture array.
+	query.InputViewIndex = 3;
+	CHECK_EQUAL(Passthrough_NotShareable, DecidePassthrough(query));
+
+	query = MakeQuery();
+	query.InputViewIndex = 1;
+	CHECK_EQUAL(Passthrough_NotShareable, DecidePassthrough(query));
+
+	query = MakeQuery();
+	query.InputBindFlags = 0x200;	// D3D11_BIND_DECODER only.
+	CHECK_EQUAL(Passthrough_NotShareable, DecidePassthrough(query));
+}
+
+TEST(FirstFailingCheckWins)
+{
+	// Format is checked before size, size before interlacing, interlacing before sharing.
+	PassthroughQuery query = MakeQuery();
+	query.InputFormat = DXGI_FORMAT_NV12;
+	query.OutputWidth = 1280;
+	query.InterlaceMode = MFVideoInterlace_FieldInterleavedUpperFirst;
+	query.InputArraySize = 4;
+	CHECK_EQUAL(Passthrough_FormatMismatch, DecidePassthrough(query));
+	query.InputFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
+	CHECK_EQUAL(Passthrough_SizeMismatch, DecidePassthrough(query));
+	query.OutputWidth = 1920;
+	CHECK_EQUAL(Passthrough_Interlaced, DecidePassthrough(query));
+	query.InterlaceMode = MFVideoInterlace_Progressive;
+	CHECK_EQUAL(Passthrough_NotShareable, DecidePassthrough(query));
+}
+
+TEST_MAIN()
@@ -0,0 +1,143 @@
+#include "PortableWindows.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Base of everything a HANDLE points to, so that CloseHandle can delete it.
+	struct PortableHandle
+	{
+		virtual ~PortableHandle() {}
+	};
+
+	struct PortableEvent : public PortableHandle
+	{
+		std::mutex Mutex;
+		std::condition_variable Signaled;
+		BOOL ManualReset;
+		BOOL State;
+	};
+}
+
+struct PortableThreadpoolWork
+{
+	PTP_WORK_CALLBACK Callback;
+	void* Context;
+	std::mutex Mutex;
+	std::vector<std::thread> Threads;
+};
+
+HANDLE CreateEvent(const void* pAttributes, BOOL bManualReset, BOOL bInitialState, LPCWSTR pName)
+{
+	PortableEvent* pEvent = new PortableEvent();
+	pEvent->ManualReset = bManualReset;
+	pEvent->State = bInitialState;
+	return static_cast<PortableHandle*>(pEvent);
+}
+BOOL SetEvent(HANDLE hEvent)
+{
+	PortableEvent* pEvent = static_cast<PortableEvent*>(static_cast<PortableHandle*>(hEvent));
+	// Notified under the lock: a waiter may close the event as soon as it returns.
+	std::lock_guard<std::mutex> lock(pEvent->Mutex);
+	pEvent->State = TRUE;
+	pEvent->Signaled.notify_all();
+	return TRUE;
+}
+BOOL ResetEvent(HANDLE hEvent)
+{
+	PortableEvent* pEvent = static_cast<PortableEvent*>(static_cast<PortableHandle*>(hEvent));
+	std::lock_guard<std::mutex> lock(pEvent->Mutex);
+	pEvent->State = FALSE;
+	return TRUE;
+}
+DWORD WaitForSingleObject(HANDLE hHandle, DWORD dwMilliseconds)
+{
+	PortableEvent* pEvent = static_cast<PortableEvent*>(static_cast<PortableHandle*>(hHandle));
+	std::unique_lock<std::mutex> lock(pEvent->Mutex);
+
+	if (INFINITE == dwMilliseconds)
+	{
+		while (!pEvent->State)
+			pEvent->Signaled.wait(lock);
+	}
+	else
+	{
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(dwMilliseconds);
+		while (!pEvent->State)
+		{
+			if (std::cv_status::timeout == pEvent->Signaled.wait_until(lock, deadline) && !pEvent->State)
+				return WAIT_TIMEOUT;
+		}
+	}
+
+	if (!pEvent->ManualReset)
+		pEvent->State = FALSE;
+
+	return WAIT_OBJECT_0;
+}
+BOOL CloseHandle(HANDLE hHandle)
+{
+	delete static_cast<PortableHandle*>(hHandle);
+	return TRUE;
+}
+void Sleep(DWORD dwMilliseconds)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(dwMilliseconds));
+}
+
+static void RunThreadpoolWork(PTP_WORK pwk)
+{
+	pwk->Callback(NULL, pwk->Context, pwk);
+}
+PTP_WORK CreateThreadpoolWork(PTP_WORK_CALLBACK pfnwk, void* pv, PTP_CALLBACK_ENVIRON pcbe)
+{
+	PTP_WORK pwk = new PortableThreadpoolWork();
+	pwk->Callback = pfnwk;
+	pwk->Context = pv;
+	return pwk;
+}
+void SubmitThreadpoolWork(PTP_WORK pwk)
+{
+	std::lock_guard<std::mutex> lock(pwk->Mutex);
+	pwk->Threads.push_back(std::thread(RunThreadpoolWork, pwk));
+}
+void WaitForThreadpoolWorkCallbacks(PTP_WORK pwk, BOOL fCancelPendingCallbacks)
+{
+	std::vector<std::thread> threads;
+	{
+		std::lock_guard<std::mutex> lock(pwk->Mutex);
+		threads.swap(pwk->Threads);
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+void CloseThreadpoolWork(PTP_WORK pwk)
+{
+	WaitForThreadpoolWorkCallbacks(pwk, TRUE);
+	delete pwk;
+}
+
+GUID PortableNewGuid()
+{
+	static volatile LONG counter = 0;
+	GUID guid = { (uint32_t)InterlockedIncrement(&counter), 0x7e57, 0x7e57, { 0x7e, 0x57, 0x7e, 0x57, 0x7e, 0x57, 0x7e, 0x57 } };
+	return guid;
+}
+
+HRESULT MFFrameRateToAverageTimePerFrame(UINT32 unNumerator, UINT32 unDenominator, UINT64* punAverageTimePerFrame)
+{
+	if (NULL == punAverageTimePerFrame)
+		return E_POINTER;
+	if (0 == unNumerator)
+		return E_INVALIDARG;
+
+	*punAverageTimePerFrame = (10000000ULL * unDenominator + unNumerator / 2) / unNumerator;
+	return S_OK;
+}
+MFTIME MFGetSystemTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / 100;
+}
@@ -0,0 +1,447 @@
+#pragma once
+
+// Just enough of the Windows, Media Foundation and DXGI declarations to build the parts of the sink that do not use D3D
+// on other platforms. The types have the sizes they have on Windows; the interfaces only have the methods those parts
+// call, so a fake that implements them sees every call. The values of the constants are those of the SDK.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <assert.h>
+#include <wchar.h>
+#include <mutex>
+#include <type_traits>
+
+// Basic types
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef int INT;
+typedef unsigned int UINT;
+typedef int32_t INT32;
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef long long INT64;
+typedef unsigned long long UINT64;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+typedef uintptr_t ULONG_PTR;
+typedef size_t SIZE_T;
+typedef void* PVOID;
+typedef void* LPVOID;
+typedef void* HANDLE;
+typedef wchar_t WCHAR;
+typedef wchar_t TCHAR;
+typedef const wchar_t* LPCWSTR;
+typedef const wchar_t* LPCTSTR;
+typedef DWORD* LPDWORD;
+typedef int32_t HRESULT;
+typedef LONGLONG MFTIME;
+typedef unsigned short VARTYPE;
+
+#define TRUE	1
+#define FALSE	0
+
+#define MAXLONGLONG	(0x7fffffffffffffffLL)
+#define INFINITE	0xFFFFFFFF
+
+#define TEXT(s)	L##s
+#define _T(s)	L##s
+
+#define CALLBACK
+#define WINAPI
+#define __cdecl
+#define STDMETHODCALLTYPE
+#define STDMETHODIMP			HRESULT
+#define STDMETHODIMP_(type)		type
+#define STDAPI					extern "C" HRESULT
+#define MIDL_INTERFACE(x)		struct
+
+// Source annotations
+
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _Out_opt_
+#define _Inout_
+#define _Outptr_
+#define _Out_writes_(x)
+#define _In_reads_(x)
+#define _Acquires_lock_(x)
+#define _Releases_lock_(x)
+#define _Result_nullonfailure_
+#define __RPC__in
+#define __RPC__in_opt
+#define __RPC__out
+#define __RPC__deref_out
+
+// HRESULT
+
+#define SUCCEEDED(hr)	(((HRESULT)(hr)) >= 0)
+#define FAILED(hr)		(((HRESULT)(hr)) < 0)
+
+#define S_OK							((HRESULT)0x00000000)
+#define S_FALSE							((HRESULT)0x00000001)
+#define E_NOTIMPL						((HRESULT)0x80004001)
+#define E_NOINTERFACE					((HRESULT)0x80004002)
+#define E_POINTER						((HRESULT)0x80004003)
+#define E_ABORT							((HRESULT)0x80004004)
+#define E_FAIL							((HRESULT)0x80004005)
+#define E_UNEXPECTED					((HRESULT)0x8000FFFF)
+#define E_OUTOFMEMORY					((HRESULT)0x8007000E)
+#define E_INVALIDARG					((HRESULT)0x80070057)
+#define MF_E_INVALIDREQUEST				((HRESULT)0xC00D36B2)
+#define MF_E_INVALIDMEDIATYPE			((HRESULT)0xC00D36B4)
+#define MF_E_NOT_INITIALIZED			((HRESULT)0xC00D36B6)
+#define MF_E_NO_SAMPLE_TIMESTAMP		((HRESULT)0xC00D36C4)
+#define MF_E_NOT_FOUND					((HRESULT)0xC00D36D5)
+#define MF_E_ATTRIBUTENOTFOUND			((HRESULT)0xC00D36E6)
+#define MF_E_SHUTDOWN					((HRESULT)0xC00D3E85)
+#define MF_E_UNSUPPORTED_RATE			((HRESULT)0xC00D3E91)
+#define MF_E_REVERSE_UNSUPPORTED		((HRESULT)0xC00D3E92)
+#define MF_E_THINNING_UNSUPPORTED		((HRESULT)0xC00D3E93)
+#define MF_E_UNSUPPORTED_D3D_TYPE		((HRESULT)0xC00D6D76)
+
+#define HRESULT_FROM_WIN32(x)	((HRESULT)(x) <= 0 ? (HRESULT)(x) : (HRESULT)(((x) & 0x0000FFFF) | (7 << 16) | 0x80000000))
+#define ERROR_NOT_ENOUGH_MEMORY	8L
+inline DWORD GetLastError() { return ERROR_NOT_ENOUGH_MEMORY; }	// The only way the calls here can fail.
+
+// Waits
+
+#define WAIT_OBJECT_0		0x00000000
+#define WAIT_ABANDONED		0x00000080
+#define WAIT_TIMEOUT		0x00000102
+
+// GUID
+
+struct GUID
+{
+	uint32_t Data1;
+	uint16_t Data2;
+	uint16_t Data3;
+	uint8_t Data4[8];
+};
+typedef GUID IID;
+typedef GUID CLSID;
+typedef const GUID& REFGUID;
+typedef const GUID& REFIID;
+
+inline bool operator==(const GUID& guid1, const GUID& guid2) { return 0 == memcmp(&guid1, &guid2, sizeof(GUID)); }
+inline bool operator!=(const GUID& guid1, const GUID& guid2) { return !(guid1 == guid2); }
+inline BOOL IsEqualGUID(REFGUID guid1, REFGUID guid2) { return guid1 == guid2; }
+
+#define DEFINE_GUID(name, l, w1, w2, b1, b2, b3, b4, b5, b6, b7, b8) \
+	static const GUID name = { l, w1, w2, { b1, b2, b3, b4, b5, b6, b7, b8 } }
+
+DEFINE_GUID(GUID_NULL, 0x00000000, 0x0000, 0x0000, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00);
+DEFINE_GUID(IID_IUnknown, 0x00000000, 0x0000, 0x0000, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46);
+
+// __uuidof: MIDL_INTERFACE drops the uuid, so each interface gets an IID of its own, made up on first use.
+GUID PortableNewGuid();
+template <class T> inline const GUID& PortableUuidOf() { static const GUID iid = PortableNewGuid(); return iid; }
+template <> inline const GUID& PortableUuidOf<struct IUnknown>() { return IID_IUnknown; }
+#define __uuidof(T)	PortableUuidOf<T>()
+
+// Memory
+
+#define ZeroMemory(p, cb)			memset((p), 0, (cb))
+#define CopyMemory(d, s, cb)		memcpy((d), (s), (cb))
+#define _countof(a)					(sizeof(a) / sizeof((a)[0]))
+
+template <class T1, class T2> inline typename std::common_type<T1, T2>::type min(T1 a, T2 b) { return (b < a) ? b : a; }
+template <class T1, class T2> inline typename std::common_type<T1, T2>::type max(T1 a, T2 b) { return (a < b) ? b : a; }
+
+inline INT64 _abs64(INT64 value) { return (value < 0) ? -value : value; }
+
+struct RECT
+{
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+};
+
+// Interlocked operations
+
+inline LONG InterlockedIncrement(volatile LONG* p) { return __atomic_add_fetch(p, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedDecrement(volatile LONG* p) { return __atomic_sub_fetch(p, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedExchange(volatile LONG* p, LONG value) { return __atomic_exchange_n(p, value, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedExchangeAdd(volatile LONG* p, LONG value) { return __atomic_fetch_add(p, value, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedCompareExchange(volatile LONG* p, LONG exchange, LONG comparand)
+{
+	__atomic_compare_exchange_n(p, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+}
+inline LONGLONG InterlockedExchange64(volatile LONGLONG* p, LONGLONG value) { return __atomic_exchange_n(p, value, __ATOMIC_SEQ_CST); }
+inline LONGLONG InterlockedCompareExchange64(volatile LONGLONG* p, LONGLONG exchange, LONGLONG comparand)
+{
+	__atomic_compare_exchange_n(p, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+}
+// LONG is 32 bits on Windows; some members are declared long.
+inline long InterlockedIncrement(volatile long* p) { return __atomic_add_fetch(p, 1, __ATOMIC_SEQ_CST); }
+inline long InterlockedDecrement(volatile long* p) { return __atomic_sub_fetch(p, 1, __ATOMIC_SEQ_CST); }
+inline void MemoryBarrier() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+inline void YieldProcessor() {}
+
+// Critical sections (recursive, as on Windows)
+
+struct CRITICAL_SECTION
+{
+	std::recursive_mutex* Mutex;
+};
+inline void InitializeCriticalSection(CRITICAL_SECTION* pcs) { pcs->Mutex = new std::recursive_mutex(); }
+inline void DeleteCriticalSection(CRITICAL_SECTION* pcs) { delete pcs->Mutex; pcs->Mutex = NULL; }
+inline void EnterCriticalSection(CRITICAL_SECTION* pcs) { pcs->Mutex->lock(); }
+inline void LeaveCriticalSection(CRITICAL_SECTION* pcs) { pcs->Mutex->unlock(); }
+
+// Events and handles (PortableWindows.cpp)
+
+HANDLE CreateEvent(const void* pAttributes, BOOL bManualReset, BOOL bInitialState, LPCWSTR pName);
+BOOL SetEvent(HANDLE hEvent);
+BOOL ResetEvent(HANDLE hEvent);
+DWORD WaitForSingleObject(HANDLE hHandle, DWORD dwMilliseconds);
+BOOL CloseHandle(HANDLE hHandle);
+void Sleep(DWORD dwMilliseconds);
+
+// Thread pool work (PortableWindows.cpp). Each submission runs on a thread of its own.
+
+struct PortableThreadpoolWork;
+typedef PortableThreadpoolWork* PTP_WORK;
+typedef void* PTP_CALLBACK_INSTANCE;
+typedef void* PTP_CALLBACK_ENVIRON;
+typedef void (CALLBACK* PTP_WORK_CALLBACK)(PTP_CALLBACK_INSTANCE pInstance, void* pContext, PTP_WORK pWork);
+
+PTP_WORK CreateThreadpoolWork(PTP_WORK_CALLBACK pfnwk, void* pv, PTP_CALLBACK_ENVIRON pcbe);
+void SubmitThreadpoolWork(PTP_WORK pwk);
+void WaitForThreadpoolWorkCallbacks(PTP_WORK pwk, BOOL fCancelPendingCallbacks);
+void CloseThreadpoolWork(PTP_WORK pwk);
+
+// Multimedia class scheduler service
+
+inline HANDLE AvSetMmThreadCharacteristics(LPCTSTR taskName, LPDWORD taskIndex) { *taskIndex = 0; return (HANDLE)1; }
+inline BOOL AvRevertMmThreadCharacteristics(HANDLE avrtHandle) { return TRUE; }
+
+// COM
+
+struct IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) = 0;
+	virtual ULONG STDMETHODCALLTYPE AddRef() = 0;
+	virtual ULONG STDMETHODCALLTYPE Release() = 0;
+};
+
+#define VT_EMPTY	0
+#define VT_UI4		19
+#define VT_UI8		21
+
+union ULARGE_INTEGER
+{
+	ULONGLONG QuadPart;
+};
+
+struct PROPVARIANT
+{
+	VARTYPE vt;
+	union
+	{
+		ULONG ulVal;
+		ULARGE_INTEGER uhVal;
+	};
+};
+typedef const PROPVARIANT& REFPROPVARIANT;
+inline void PropVariantInit(PROPVARIANT* pvar) { memset(pvar, 0, sizeof(PROPVARIANT)); }
+inline HRESULT PropVariantClear(PROPVARIANT* pvar) { memset(pvar, 0, sizeof(PROPVARIANT)); return S_OK; }
+inline HRESULT PropVariantCopy(PROPVARIANT* pvarDest, const PROPVARIANT* pvarSrc) { *pvarDest = *pvarSrc; return S_OK; }
+
+// DXGI / D3D11
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R10G10B10A2_UNORM = 24,
+	DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+	DXGI_FORMAT_R16G16_UNORM = 35,
+	DXGI_FORMAT_R8G8_UNORM = 49,
+	DXGI_FORMAT_R16_UNORM = 56,
+	DXGI_FORMAT_R8_UNORM = 61,
+	DXGI_FORMAT_B8G8R8A8_UNORM = 87,
+	DXGI_FORMAT_B8G8R8X8_UNORM = 88,
+	DXGI_FORMAT_NV12 = 103,
+	DXGI_FORMAT_P010 = 104,
+	DXGI_FORMAT_YUY2 = 107,
+};
+
+#define D3D11_BIND_SHADER_RESOURCE	0x8L
+#define D3D11_BIND_RENDER_TARGET	0x20L
+
+struct IDXGIKeyedMutex : public IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE AcquireSync(UINT64 Key, DWORD dwMilliseconds) = 0;
+	virtual HRESULT STDMETHODCALLTYPE ReleaseSync(UINT64 Key) = 0;
+};
+
+struct D3D11_TEXTURE2D_DESC
+{
+	UINT Width;
+	UINT Height;
+	UINT MipLevels;
+	UINT ArraySize;
+	DXGI_FORMAT Format;
+	UINT BindFlags;
+	UINT CPUAccessFlags;
+	UINT MiscFlags;
+};
+
+struct ID3D11Texture2D : public IUnknown
+{
+	virtual void STDMETHODCALLTYPE GetDesc(D3D11_TEXTURE2D_DESC* pDesc) = 0;
+};
+
+struct ID3D10Multithread : public IUnknown
+{
+	virtual void STDMETHODCALLTYPE Enter() = 0;
+	virtual void STDMETHODCALLTYPE Leave() = 0;
+	virtual BOOL STDMETHODCALLTYPE SetMultithreadProtected(BOOL bMTProtect) = 0;
+	virtual BOOL STDMETHODCALLTYPE GetMultithreadProtected() = 0;
+};
+
+// Only ever used through pointers by the parts built here.
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11Query;
+
+// Media Foundation
+
+struct MFRatio
+{
+	DWORD Numerator;
+	DWORD Denominator;
+};
+
+enum MF_ATTRIBUTE_TYPE
+{
+	MF_ATTRIBUTE_UINT32 = 19,
+	MF_ATTRIBUTE_UINT64 = 21,
+	MF_ATTRIBUTE_DOUBLE = 5,
+	MF_ATTRIBUTE_GUID = 72,
+	MF_ATTRIBUTE_STRING = 31,
+	MF_ATTRIBUTE_BLOB = 0x1011,
+	MF_ATTRIBUTE_IUNKNOWN = 13,
+};
+
+enum MFVideoInterlaceMode
+{
+	MFVideoInterlace_Unknown = 0,
+	MFVideoInterlace_Progressive = 2,
+	MFVideoInterlace_FieldInterleavedUpperFirst = 3,
+	MFVideoInterlace_FieldInterleavedLowerFirst = 4,
+	MFVideoInterlace_FieldSingleUpper = 5,
+	MFVideoInterlace_FieldSingleLower = 6,
+	MFVideoInterlace_MixedInterlaceOrProgressive = 7,
+};
+
+enum MFNominalRange
+{
+	MFNominalRange_Unknown = 0,
+	MFNominalRange_0_255 = 1,
+	MFNominalRange_16_235 = 2,
+};
+
+enum MFSTREAMSINK_MARKER_TYPE
+{
+	MFSTREAMSINK_MARKER_DEFAULT = 0,
+	MFSTREAMSINK_MARKER_ENDOFSEGMENT = 1,
+	MFSTREAMSINK_MARKER_TICK = 2,
+	MFSTREAMSINK_MARKER_EVENT = 3,
+};
+
+DEFINE_GUID(MF_MT_SUBTYPE, 0xf7e34c9a, 0x42e8, 0x4714, 0xb7, 0x4b, 0xcb, 0x29, 0xd7, 0x2c, 0x35, 0xe5);
+DEFINE_GUID(MF_MT_FRAME_SIZE, 0x1652c33d, 0xd6b2, 0x4012, 0xb8, 0x34, 0x72, 0x03, 0x08, 0x49, 0xa3, 0x7d);
+DEFINE_GUID(MF_MT_FRAME_RATE, 0xc459a2e8, 0x3d2c, 0x4e44, 0xb1, 0x32, 0xfe, 0xe5, 0x15, 0x6c, 0x7b, 0xb0);
+DEFINE_GUID(MF_MT_INTERLACE_MODE, 0xe2724bb8, 0xe676, 0x4806, 0xb4, 0xb2, 0xa8, 0xd6, 0xef, 0xb4, 0x4c, 0xcd);
+DEFINE_GUID(MF_MT_YUV_MATRIX, 0x3e23d450, 0x2c75, 0x4d25, 0xa0, 0x0e, 0xb9, 0x16, 0x70, 0xd1, 0x23, 0x27);
+DEFINE_GUID(MF_MT_VIDEO_NOMINAL_RANGE, 0xc21b8ee5, 0xb956, 0x4071, 0x8d, 0xaf, 0x32, 0x5e, 0xdf, 0x5c, 0xab, 0x11);
+DEFINE_GUID(MF_MT_VIDEO_CHROMA_SITING, 0x65df2370, 0xc773, 0x4c33, 0xaa, 0x64, 0x84, 0x3e, 0x06, 0x8e, 0xfb, 0x0c);
+DEFINE_GUID(MF_MT_VIDEO_PRIMARIES, 0xdbfbe4d7, 0x0740, 0x4ee0, 0x81, 0x92, 0x85, 0x0a, 0xb0, 0xe2, 0x19, 0x35);
+DEFINE_GUID(MF_MT_TRANSFER_FUNCTION, 0x5fb0fce9, 0xbe5c, 0x4935, 0xa8, 0x11, 0xec, 0x83, 0x8f, 0x8e, 0xed, 0x93);
+DEFINE_GUID(MFVideoFormat_RGB32, 0x00000016, 0x0000, 0x0010, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71);
+DEFINE_GUID(MFVideoFormat_ARGB32, 0x00000015, 0x0000, 0x0010, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71);
+DEFINE_GUID(MFVideoFormat_NV12, 0x3231564e, 0x0000, 0x0010, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71);
+DEFINE_GUID(MFVideoFormat_YUY2, 0x32595559, 0x0000, 0x0010, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71);
+
+// The attribute store. Only the methods the sink calls on samples and media types.
+struct IMFAttributes : public IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE GetUINT32(REFGUID guidKey, UINT32* punValue) = 0;
+	virtual HRESULT STDMETHODCALLTYPE GetUINT64(REFGUID guidKey, UINT64* punValue) = 0;
+	virtual HRESULT STDMETHODCALLTYPE GetGUID(REFGUID guidKey, GUID* pguidValue) = 0;
+	virtual HRESULT STDMETHODCALLTYPE GetUnknown(REFGUID guidKey, REFIID riid, LPVOID* ppv) = 0;
+	virtual HRESULT STDMETHODCALLTYPE SetUINT32(REFGUID guidKey, UINT32 unValue) = 0;
+	virtual HRESULT STDMETHODCALLTYPE SetUINT64(REFGUID guidKey, UINT64 unValue) = 0;
+	virtual HRESULT STDMETHODCALLTYPE SetGUID(REFGUID guidKey, REFGUID guidValue) = 0;
+	virtual HRESULT STDMETHODCALLTYPE SetUnknown(REFGUID guidKey, IUnknown* pUnknown) = 0;
+	virtual HRESULT STDMETHODCALLTYPE DeleteItem(REFGUID guidKey) = 0;
+};
+
+struct IMFMediaType : public IMFAttributes
+{
+};
+
+struct IMFSample : public IMFAttributes
+{
+	virtual HRESULT STDMETHODCALLTYPE GetSampleFlags(DWORD* pdwSampleFlags) = 0;
+	virtual HRESULT STDMETHODCALLTYPE SetSampleFlags(DWORD dwSampleFlags) = 0;
+	virtual HRESULT STDMETHODCALLTYPE GetSampleTime(LONGLONG* phnsSampleTime) = 0;
+	virtual HRESULT STDMETHODCALLTYPE SetSampleTime(LONGLONG hnsSampleTime) = 0;
+	virtual HRESULT STDMETHODCALLTYPE GetSampleDuration(LONGLONG* phnsSampleDuration) = 0;
+	virtual HRESULT STDMETHODCALLTYPE SetSampleDuration(LONGLONG hnsSampleDuration) = 0;
+};
+
+struct IMFClock : public IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE GetCorrelatedTime(DWORD dwReserved, LONGLONG* pllClockTime, MFTIME* phnsSystemTime) = 0;
+};
+
+struct IMFMediaBuffer;
+
+HRESULT MFFrameRateToAverageTimePerFrame(UINT32 unNumerator, UINT32 unDenominator, UINT64* punAverageTimePerFrame);
+MFTIME MFGetSystemTime();
+
+inline HRESULT MFGetAttributeSize(IMFAttributes* pAttributes, REFGUID guidKey, UINT32* punWidth, UINT32* punHeight)
+{
+	UINT64 value;
+	HRESULT hr = pAttributes->GetUINT64(guidKey, &value);
+	if (SUCCEEDED(hr))
+	{
+		*punWidth = (UINT32)(value >> 32);
+		*punHeight = (UINT32)value;
+	}
+	return hr;
+}
+inline HRESULT MFGetAttributeRatio(IMFAttributes* pAttributes, REFGUID guidKey, UINT32* punNumerator, UINT32* punDenominator)
+{
+	return MFGetAttributeSize(pAttributes, guidKey, punNumerator, punDenominator);
+}
+inline UINT32 MFGetAttributeUINT32(IMFAttributes* pAttributes, REFGUID guidKey, UINT32 unDefault)
+{
+	UINT32 value;
+	return SUCCEEDED(pAttributes->GetUINT32(guidKey, &value)) ? value : unDefault;
+}
+inline HRESULT MFSetAttributeSize(IMFAttributes* pAttributes, REFGUID guidKey, UINT32 unWidth, UINT32 unHeight)
+{
+	return pAttributes->SetUINT64(guidKey, ((UINT64)unWidth << 32) | unHeight);
+}
+inline HRESULT MFSetAttributeRatio(IMFAttributes* pAttributes, REFGUID guidKey, UINT32 unNumerator, UINT32 unDenominator)
+{
+	return MFSetAttributeSize(pAttributes, guidKey, unNumerator, unDenominator);
+}
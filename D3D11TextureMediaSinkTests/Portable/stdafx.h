@@ -0,0 +1,61 @@
+// stdafx.h of the tests: the sink's own stdafx.h, minus Windows and the parts that need D3D11.
+//
+// The sources of the sink under test are copied next to this file by CMakeLists.txt, so that their #include "stdafx.h"
+// finds this one.
+
+#pragma once
+
+#include "PortableWindows.h"
+
+struct IMFStreamSink;
+
+template <class T> inline void SafeRelease(T*& pT)
+{
+	if (pT != nullptr)
+	{
+		pT->Release();
+		pT = nullptr;
+	}
+}
+
+#define _OutputDebugString( str, ... ) // Empty implementation
+
+
+#include "D3D11TextureMediaSink.h"
+#include "CriticalSection.h"
+#include "AutoLock.h"
+#include "DeviceContextLock.h"
+#include "ComPtrListEx.h"
+#include "ComPtrRing.h"
+#include "IntrusiveList.h"
+#include "PtrList.h"
+#include "PtrRing.h"
+#include "ThreadSafeComPtrQueue.h"
+#include "ThreadSafePtrQueue.h"
+#include "IMarker.h"
+#include "Marker.h"
+#include "MarkerSequence.h"
+#include "OutputFormat.h"
+#include "Fnv1a.h"
+#include "CapabilityCache.h"
+#include "HotAttributeTable.h"
+#include "TextureMemoryBudget.h"
+#include "ReferenceFrameHistory.h"
+#include "GpuFence.h"
+#include "SampleFenceList.h"
+#include "SharedFrameRing.h"
+#include "VideoProcessorStateCache.h"
+#include "SampleAllocator.h"
+#include "SamplePoolCache.h"
+#include "FrameDescription.h"
+#include "FrameCache.h"
+#include "ThumbnailAtlas.h"
+#include "FrameRateConverter.h"
+#include "RateCalculator.h"
+#include "Scheduler.h"
+#include "PassthroughPolicy.h"
+#include "GpuTimerQueryRing.h"
+#include "WarmUpWork.h"
+#include "FirstFrameTimer.h"
+#include "TrickPlayPolicy.h"
+#include "SegmentTimeline.h"
@@ -0,0 +1,125 @@
+// Supported playback rates from the measured cost of a frame.
+//
+// The scheduler plays a timeline on a simulated clock that runs at the playback rate, with a presenter of a given speed; the
+// stream sink's processing time is simulated too. The rates the sink would report to the media session (IMFRateSupport) are
+// printed for each case, and checked against what the presenter can keep up with.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	const MFRatio FPS = { 100, 1 };
+	const LONGLONG FRAME = 100000;	// 100ns units, at 100 fps.
+	const int FRAMES = 50;
+
+	struct RateReport
+	{
+		LONGLONG ProcessingTime;
+		LONGLONG PresentLatency;
+		float Fastest;
+		float FastestThin;
+	};
+
+	// Plays FRAMES frames at the rate, with a presenter that takes presentMilliseconds per frame and a processing time of
+	// hnsProcessing per frame, and returns what the rate calculator makes of it.
+	RateReport Play(float rate, DWORD presentMilliseconds, LONGLONG hnsProcessing)
+	{
+		Scheduler scheduler;
+		FakeSchedulerCallback callback;
+		FakeClock* pClock = new FakeClock();
+		callback.PresentDelayMilliseconds = presentMilliseconds;
+		scheduler.SetCallback(&callback);
+		scheduler.SetFrameRate(FPS);
+		scheduler.SetClockRate(rate);
+		scheduler.GetRateCalculator()->SetFrameRate(FPS);
+
+		// The clock starts a frame before the timeline, in the direction of playback.
+		pClock->SetTime((0.0f < rate) ? -FRAME : FRAMES * FRAME);
+		pClock->SetRealTime(TRUE, rate);
+		scheduler.Start(pClock);
+
+		std::vector<FakeSample*> samples;
+		for (int n = 0; n < FRAMES; n++)
+		{
+			LONGLONG hnsTime = (0.0f < rate) ? n * FRAME : (FRAMES - 1 - n) * FRAME;
+			FakeSample* pSample = new FakeSample(hnsTime, FRAME);
+			samples.push_back(pSample);
+			scheduler.GetRateCalculator()->AddProcessingTime(hnsProcessing);	// As StreamSink does around Presenter::ProcessFrame.
+			scheduler.ScheduleSample(pSample, FALSE);
+		}
+		callback.WaitForRetired(FRAMES, 10000);
+		scheduler.Stop();
+
+		RateCalculator* pRates = scheduler.GetRateCalculator();
+		RateReport report = { pRates->GetProcessingTime(), pRates->GetPresentLatency(), pRates->GetFastestRate(FALSE), pRates->GetFastestRate(TRUE) };
+		printf("  %5.1fx, present %2u ms, process %5.1f ms: latency %6.1f ms, fastest %6.1fx (thinned by the source: %s)\n",
+			rate, presentMilliseconds, hnsProcessing / 10000.0, report.PresentLatency / 10000.0, report.Fastest,
+			(FLT_MAX == report.FastestThin) ? "any" : "limited");
+
+		for (size_t i = 0; i < samples.size(); i++)
+			samples[i]->Release();
+		pClock->Release();
+
+		return report;
+	}
+}
+
+TEST(FastPresenterSupportsEveryRate)
+{
+	// 1 ms of processing for a 10 ms frame: the threshold of thinning is reachable, so the sink thins beyond it.
+	RateReport forward = Play(1.0f, 0, 10000);
+	CHECK_EQUAL(RATE_SUPPORT_MAX, forward.Fastest);
+	CHECK_EQUAL(FLT_MAX, forward.FastestThin);
+
+	RateReport reverse = Play(-2.0f, 0, 10000);
+	CHECK_EQUAL(RATE_SUPPORT_MAX, reverse.Fastest);
+}
+
+TEST(SlowPresenterLimitsTheRate)
+{
+	// 25 ms to present a 10 ms frame: the queue falls behind, and the latency rises with it.
+	RateReport report = Play(1.0f, 25, 10000);
+	CHECK(report.PresentLatency > FRAME);
+	CHECK(report.Fastest < TRICKPLAY_THINNING_RATE);
+	CHECK(report.Fastest >= 1.0f);	// Normal playback is always supported; it drops the late frames.
+	CHECK_EQUAL(FLT_MAX, report.FastestThin);
+}
+
+TEST(SlowProcessingLimitsTheRate)
+{
+	// 7 ms of processing for a 10 ms frame: at 2x, it would have 5 ms.
+	RateReport report = Play(1.0f, 0, 70000);
+	CHECK(report.Fastest < TRICKPLAY_THINNING_RATE);
+
+	RateCalculator rates;
+	rates.SetFrameRate(FPS);
+	for (int i = 0; i < 64; i++)
+		rates.AddProcessingTime(70000);
+
+	float nearest = 0.0f;
+	CHECK_EQUAL(S_OK, rates.IsRateSupported(FALSE, 1.25f, &nearest));
+	CHECK_EQUAL(1.25f, nearest);
+	CHECK_EQUAL(MF_E_UNSUPPORTED_RATE, rates.IsRateSupported(FALSE, -4.0f, &nearest));
+	CHECK(-1.5f < nearest && nearest < -1.4f);	// -(10 / 7)
+	CHECK_EQUAL(S_OK, rates.IsRateSupported(TRUE, -4.0f, &nearest));
+}
+
+TEST(NothingMeasuredSupportsEveryRate)
+{
+	RateCalculator rates;
+	CHECK_EQUAL(RATE_SUPPORT_MAX, rates.GetFastestRate(FALSE));
+	CHECK_EQUAL(0.0f, rates.GetSlowestRate());
+
+	for (int i = 0; i < 64; i++)
+		rates.AddProcessingTime(500000);	// Longer than a frame at the default 29.97 fps.
+	CHECK_EQUAL(1.0f, rates.GetFastestRate(FALSE));
+	rates.Reset();
+	CHECK_EQUAL(RATE_SUPPORT_MAX, rates.GetFastestRate(FALSE));
+}
+
+TEST_MAIN()
@@ -0,0 +1,187 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+#include <vector>
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	// The frames of one segment, pushed into the history in order.
+	struct Segment
+	{
+		std::vector<Fakes::FakeSample*> Samples;
+		Fakes::FakeTexture* Texture;
+
+		Segment(int count, UINT width = 720, UINT height = 480)
+		{
+			this->Texture = new Fakes::FakeTexture(width, height, DXGI_FORMAT_NV12);
+			for (int i = 0; i < count; i++)
+				this->Samples.push_back(new Fakes::FakeSample(i * 400000LL, 400000LL));
+		}
+		~Segment()
+		{
+			for (size_t i = 0; i < this->Samples.size(); i++)
+				SafeRelease(this->Samples[i]);
+			SafeRelease(this->Texture);
+		}
+
+		HRESULT Push(ReferenceFrameHistory* pHistory, int index)
+		{
+			return pHistory->Push(this->Samples[index], this->Texture, (UINT)index, MFVideoInterlace_FieldInterleavedUpperFirst);
+		}
+		int IndexOf(const ReferenceFrameHistory::Frame* pFrame)
+		{
+			for (size_t i = 0; i < this->Samples.size(); i++)
+			{
+				if (pFrame->Sample == this->Samples[i])
+					return (int)i;
+			}
+			return -1;
+		}
+	};
+
+	// What Presenter::DrainHistory does: the oldest pending frame, with the frames after it as its future references.
+	const ReferenceFrameHistory::Frame* TakeDrainTarget(ReferenceFrameHistory* pHistory, UINT futureFrames, DWORD* pLag)
+	{
+		if (0 == pHistory->GetPendingCount())
+			return NULL;
+		*pLag = min(pHistory->GetPendingCount() - 1, futureFrames);
+		return pHistory->TakeTarget(*pLag);
+	}
+}
+
+TEST(OutputLagsBehindTheInputByTheFutureFrames)
+{
+	ReferenceFrameHistory history;
+	Segment segment(5);
+	const UINT futureFrames = 2;
+
+	std::vector<int> outputs;
+	for (int i = 0; i < 5; i++)
+	{
+		CHECK_EQUAL(S_OK, segment.Push(&history, i));
+		const ReferenceFrameHistory::Frame* pTarget = history.TakeTarget(futureFrames);
+		if (NULL != pTarget)
+			outputs.push_back(segment.IndexOf(pTarget));
+	}
+
+	CHECK_EQUAL(3u, outputs.size());
+	for (size_t i = 0; i < outputs.size(); i++)
+		CHECK_EQUAL((int)i, outputs[i]);
+
+	// The last two frames are still held back.
+	CHECK_EQUAL(2u, history.GetPendingCount());
+}
+
+TEST(DrainOutputsTheFramesHeldBackWithFewerFutureReferences)
+{
+	ReferenceFrameHistory history;
+	Segment segment(5);
+	const UINT futureFrames = 2;
+
+	for (int i = 0; i < 5; i++)
+	{
+		CHECK_EQUAL(S_OK, segment.Push(&history, i));
+		history.TakeTarget(futureFrames);
+	}
+
+	// Frame 3 has frame 4 as its only future reference, and frame 4 has none.
+	DWORD lag = 0;
+	const ReferenceFrameHistory::Frame* pTarget = TakeDrainTarget(&history, futureFrames, &lag);
+	CHECK(NULL != pTarget);
+	CHECK_EQUAL(3, segment.IndexOf(pTarget));
+	CHECK_EQUAL(1u, lag);
+	CHECK_EQUAL(4, segment.IndexOf(history.GetFrame(lag - 1)));
+	CHECK_EQUAL(2, segment.IndexOf(history.GetFrame(lag + 1)));	// Its past references are still there.
+
+	pTarget = TakeDrainTarget(&history, futureFrames, &lag);
+	CHECK(NULL != pTarget);
+	CHECK_EQUAL(4, segment.IndexOf(pTarget));
+	CHECK_EQUAL(0u, lag);
+
+	CHECK(NULL == TakeDrainTarget(&history, futureFrames, &lag));
+	CHECK_EQUAL(0u, history.GetPendingCount());
+}
+
+TEST(DrainOfASegmentShorterThanTheLagOutputsEveryFrame)
+{
+	ReferenceFrameHistory history;
+	Segment segment(2);
+	const UINT futureFrames = 2;
+
+	for (int i = 0; i < 2; i++)
+	{
+		CHECK_EQUAL(S_OK, segment.Push(&history, i));
+		CHECK(NULL == history.TakeTarget(futureFrames));
+	}
+
+	std::vector<int> outputs;
+	DWORD lag = 0;
+	const ReferenceFrameHistory::Frame* pTarget;
+	while (NULL != (pTarget = TakeDrainTarget(&history, futureFrames, &lag)))
+		outputs.push_back(segment.IndexOf(pTarget));
+
+	CHECK_EQUAL(2u, outputs.size());
+	CHECK_EQUAL(0, outputs[0]);
+	CHECK_EQUAL(1, outputs[1]);
+}
+
+TEST(NextSegmentStartsAfterTheDrain)
+{
+	ReferenceFrameHistory history;
+	Segment first(3);
+	Segment second(3);
+	const UINT futureFrames = 1;
+
+	for (int i = 0; i < 3; i++)
+	{
+		first.Push(&history, i);
+		history.TakeTarget(futureFrames);
+	}
+	DWORD lag = 0;
+	while (NULL != TakeDrainTarget(&history, futureFrames, &lag))
+		;
+	history.Clear();	// As Presenter::DrainHistory does when nothing is left.
+
+	// The first frame of the next segment waits for its future reference again, and has no past references of the previous segment.
+	second.Push(&history, 0);
+	CHECK(NULL == history.TakeTarget(futureFrames));
+	second.Push(&history, 1);
+	const ReferenceFrameHistory::Frame* pTarget = history.TakeTarget(futureFrames);
+	CHECK(NULL != pTarget);
+	CHECK_EQUAL(0, second.IndexOf(pTarget));
+	CHECK(NULL == history.GetFrame(futureFrames + 1));
+}
+
+TEST(SizeChangeDropsThePendingFrames)
+{
+	ReferenceFrameHistory history;
+	Segment small(2, 720, 480);
+	Segment large(1, 1920, 1080);
+
+	small.Push(&history, 0);
+	small.Push(&history, 1);
+	CHECK_EQUAL(2u, history.GetPendingCount());
+
+	large.Push(&history, 0);
+	CHECK_EQUAL(1u, history.GetCount());
+	CHECK_EQUAL(1u, history.GetPendingCount());
+}
+
+TEST(ClearReleasesTheFrames)
+{
+	ReferenceFrameHistory history;
+	Segment segment(3);
+
+	for (int i = 0; i < 3; i++)
+		segment.Push(&history, i);
+	CHECK_EQUAL(4, segment.Texture->GetRefCount());
+
+	history.Clear();
+	CHECK_EQUAL(1, segment.Texture->GetRefCount());
+	CHECK_EQUAL(0u, history.GetPendingCount());
+}
+
+TEST_MAIN()
@@ -0,0 +1,185 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	const UINT COUNT = 4;
+
+	// A fence the test completes by hand.
+	class FakeFence : public GpuFence
+	{
+	public:
+		BOOL Completed = TRUE;
+		int Signals = 0;
+		HRESULT SignalResult = S_OK;
+		BOOL* pDeleted;
+
+		FakeFence(BOOL* pDeleted = NULL) : pDeleted(pDeleted) {}
+		~FakeFence()
+		{
+			if (NULL != this->pDeleted)
+				*this->pDeleted = TRUE;
+		}
+
+		HRESULT Signal()
+		{
+			this->Signals++;
+			if (SUCCEEDED(this->SignalResult))
+				this->Completed = FALSE;
+			return this->SignalResult;
+		}
+		BOOL IsCompleted()
+		{
+			return this->Completed;
+		}
+	};
+
+	// All the samples ready, in a list with a fence on each.
+	struct Fixture
+	{
+		SampleFenceList List;
+		FakeFence* Fences[COUNT];
+		BOOL Ready[COUNT];
+
+		Fixture()
+		{
+			for (UINT i = 0; i < COUNT; i++)
+			{
+				this->Fences[i] = new FakeFence();
+				this->List.Attach(i, this->Fences[i]);
+				this->Ready[i] = TRUE;
+			}
+		}
+
+		// The consumer is done with the sample, and it comes back to the allocator.
+		void Return(UINT index)
+		{
+			CHECK_EQUAL(S_OK, this->List.Signal(index));
+			this->List.Released(index);
+		}
+	};
+}
+
+TEST(PrefersTheOldestCompletedSample)
+{
+	Fixture f;
+	f.Return(2);
+	f.Return(0);
+	f.Return(1);
+	f.Return(3);
+
+	// The GPU has passed the fences of 1 and 3 only: 1 came back before 3.
+	f.Fences[1]->Completed = TRUE;
+	f.Fences[3]->Completed = TRUE;
+	f.List.Poll();
+	CHECK_EQUAL(1, f.List.Select(f.Ready, COUNT));
+
+	f.Ready[1] = FALSE;
+	CHECK_EQUAL(3, f.List.Select(f.Ready, COUNT));
+}
+
+TEST(NoneCompletedTakesTheOldestInsteadOfWaiting)
+{
+	Fixture f;
+	f.Ready[0] = FALSE;
+	f.Return(3);
+	f.Return(1);
+	f.Return(2);
+	f.List.Poll();
+
+	// The GPU is still reading all of them: writing one makes the device wait, not the allocator.
+	CHECK(!f.List.IsCompleted(3));
+	CHECK_EQUAL(3, f.List.Select(f.Ready, COUNT));
+}
+
+TEST(CompletionIsSeenOnlyAtPoll)
+{
+	Fixture f;
+	f.Ready[0] = FALSE;
+	f.Ready[3] = FALSE;
+	f.Return(1);
+	f.Return(2);
+
+	// 2 completes, but the list has not looked yet: 1 is the oldest.
+	f.Fences[2]->Completed = TRUE;
+	CHECK(!f.List.IsCompleted(2));
+	CHECK_EQUAL(1, f.List.Select(f.Ready, COUNT));
+
+	f.List.Poll();
+	CHECK(f.List.IsCompleted(2));
+	CHECK_EQUAL(2, f.List.Select(f.Ready, COUNT));
+}
+
+TEST(NothingReadySelectsNothing)
+{
+	Fixture f;
+	BOOL none[COUNT] = {};
+	CHECK_EQUAL(-1, f.List.Select(none, COUNT));
+	CHECK_EQUAL(-1, f.List.Select(f.Ready, 0));
+}
+
+TEST(SampleWithoutAFenceIsAlwaysCompleted)
+{
+	SampleFenceList list;
+	list.Attach(0, NULL);
+	list.Attach(1, new FakeFence());
+
+	CHECK_EQUAL(S_FALSE, list.Signal(0));
+	CHECK_EQUAL(S_OK, list.Signal(1));
+	list.Released(1);
+	list.Released(0);
+	list.Poll();
+
+	CHECK(list.IsCompleted(0));
+	CHECK(!list.IsCompleted(1));
+	BOOL ready[2] = { TRUE, TRUE };
+	CHECK_EQUAL(0, list.Select(ready, 2));
+}
+
+TEST(FailedSignalLeavesTheSampleCompleted)
+{
+	Fixture f;
+	f.Fences[0]->SignalResult = E_FAIL;
+	CHECK_EQUAL(E_FAIL, f.List.Signal(0));
+	CHECK(f.List.IsCompleted(0));
+	CHECK_EQUAL(E_INVALIDARG, f.List.Signal(SAMPLE_FENCE_MAX));
+}
+
+TEST(TheListOwnsTheFences)
+{
+	BOOL bReplaced = FALSE;
+	BOOL bCleared = FALSE;
+	BOOL bLast = FALSE;
+	BOOL bOutOfRange = FALSE;
+	{
+		SampleFenceList list;
+		list.Attach(0, new FakeFence(&bReplaced));
+		list.Attach(0, new FakeFence(&bCleared));
+		CHECK(bReplaced);
+		list.Clear();
+		CHECK(bCleared);
+
+		list.Attach(SAMPLE_FENCE_MAX, new FakeFence(&bOutOfRange));
+		CHECK(bOutOfRange);
+
+		list.Attach(1, new FakeFence(&bLast));
+	}
+	CHECK(bLast);
+}
+
+TEST(AttachStartsTheSampleOver)
+{
+	Fixture f;
+	f.Return(0);
+	f.Return(1);
+	f.List.Poll();
+
+	// A new fence (the allocator was initialized again): completed, and as old as a sample never returned.
+	f.List.Attach(1, new FakeFence());
+	CHECK(f.List.IsCompleted(1));
+	CHECK_EQUAL(1, f.List.Select(f.Ready, 2));
+}
+
+TEST_MAIN()
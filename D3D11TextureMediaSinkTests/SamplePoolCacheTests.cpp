@@ -0,0 +1,194 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+
+#include <vector>
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	const UINT64 POOL_BYTES = 100;
+
+	// A pool of samples, as far as the cache goes.
+	struct FakePool : public SamplePoolCacheItem
+	{
+		UINT Outstanding;
+	};
+
+	// SampleAllocatorPool, without the allocators.
+	class FakePoolSet : public SamplePoolCacheTarget
+	{
+	public:
+		SamplePoolCache Cache;
+		BOOL OverMemoryBudget = FALSE;
+		UINT Created = 0;
+		std::vector<FakePool*> Destroyed;
+
+		~FakePoolSet()
+		{
+			SamplePoolCacheItem* pItem;
+			while (NULL != (pItem = this->Cache.TakeFront()))
+				delete static_cast<FakePool*>(pItem);
+			for (size_t i = 0; i < this->Destroyed.size(); i++)
+				delete this->Destroyed[i];
+		}
+
+		// SampleAllocatorPool::Activate: gets or creates the pool of the size, makes it current, then trims.
+		FakePool* Activate(UINT32 width, UINT32 height, BOOL bShared = FALSE)
+		{
+			FakePool* pPool = static_cast<FakePool*>(this->Cache.Find(width, height, DXGI_FORMAT_B8G8R8A8_UNORM, bShared));
+			if (NULL == pPool)
+			{
+				pPool = new FakePool();
+				pPool->Width = width;
+				pPool->Height = height;
+				pPool->Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+				pPool->Shared = bShared;
+				pPool->Bytes = POOL_BYTES;
+				pPool->Outstanding = 0;
+				CHECK_EQUAL(S_OK, this->Cache.Insert(pPool));
+				this->Created++;
+			}
+			this->Cache.SetCurrent(pPool);
+			this->Trim();
+			return pPool;
+		}
+		// SampleAllocatorPool::Trim.
+		void Trim()
+		{
+			SamplePoolCacheItem* pVictim;
+			while (NULL != (pVictim = this->Cache.TakeVictim(this->OverMemoryBudget, this)))
+				this->Destroyed.push_back(static_cast<FakePool*>(pVictim));
+		}
+		BOOL IsCached(FakePool* pPool)
+		{
+			for (SamplePoolCacheItem* pItem = this->Cache.Front(); pItem != NULL; pItem = this->Cache.Next(pItem))
+			{
+				if (pItem == pPool)
+					return TRUE;
+			}
+			return FALSE;
+		}
+
+		// SamplePoolCacheTarget
+		UINT GetOutstandingCount(SamplePoolCacheItem* pItem)
+		{
+			return static_cast<FakePool*>(pItem)->Outstanding;
+		}
+	};
+}
+
+TEST(SwitchingBackToACachedSizeCreatesNothing)
+{
+	FakePoolSet pools;
+	pools.Cache.SetBudget(2 * POOL_BYTES);
+
+	FakePool* pHd = pools.Activate(1920, 1080);
+	FakePool* pSd = pools.Activate(640, 360);
+	CHECK_EQUAL(2u, pools.Created);
+
+	// Back and forth between the two sizes, as an adaptive stream does.
+	for (int i = 0; i < 10; i++)
+	{
+		CHECK(pHd == pools.Activate(1920, 1080));
+		CHECK(pSd == pools.Activate(640, 360));
+	}
+	CHECK_EQUAL(2u, pools.Created);
+	CHECK_EQUAL(0u, pools.Destroyed.size());
+	CHECK(pSd == pools.Cache.GetCurrent());
+	CHECK_EQUAL(POOL_BYTES, pools.Cache.GetCachedBytes());
+
+	// The shared and the unshared pools of a size are not the same.
+	pools.Activate(640, 360, TRUE);
+	CHECK_EQUAL(3u, pools.Created);
+}
+
+TEST(LeastRecentlyUsedPoolIsDestroyedFirst)
+{
+	FakePoolSet pools;
+	pools.Cache.SetBudget(2 * POOL_BYTES);
+
+	FakePool* pA = pools.Activate(320, 180);
+	FakePool* pB = pools.Activate(640, 360);
+	FakePool* pC = pools.Activate(1280, 720);
+	CHECK_EQUAL(0u, pools.Destroyed.size());
+
+	// A third size that is not current exceeds the budget: A, the least recently used, goes.
+	FakePool* pD = pools.Activate(1920, 1080);
+	CHECK_EQUAL(1u, pools.Destroyed.size());
+	CHECK(pA == pools.Destroyed[0]);
+
+	// Using B again makes C the least recently used.
+	CHECK(pB == pools.Activate(640, 360));
+	pools.Activate(3840, 2160);
+	CHECK_EQUAL(2u, pools.Destroyed.size());
+	CHECK(pC == pools.Destroyed[1]);
+	CHECK(pools.IsCached(pB));
+	CHECK(pools.IsCached(pD));
+	CHECK_EQUAL(3u, pools.Cache.GetCount());
+	CHECK_EQUAL(2 * POOL_BYTES, pools.Cache.GetCachedBytes());
+}
+
+TEST(PoolWithSamplesOutstandingSurvivesUntilTheyComeBack)
+{
+	FakePoolSet pools;
+	pools.Cache.SetBudget(0);	// Nothing cached.
+
+	FakePool* pOld = pools.Activate(1920, 1080);
+	pOld->Outstanding = 2;		// Frames of the previous size still on display.
+	FakePool* pNew = pools.Activate(1280, 720);
+	CHECK(pools.IsCached(pOld));
+	CHECK_EQUAL(0u, pools.Destroyed.size());
+
+	// The next older pool without samples out goes first, whatever the order of use.
+	FakePool* pOlder = pools.Activate(640, 360);
+	CHECK(pools.IsCached(pOld));
+	CHECK(!pools.IsCached(pNew));
+	CHECK(pNew == pools.Destroyed[0]);
+	CHECK(pOlder == pools.Cache.GetCurrent());
+
+	pOld->Outstanding = 0;
+	pools.Trim();
+	CHECK(!pools.IsCached(pOld));
+	CHECK_EQUAL(1u, pools.Cache.GetCount());
+}
+
+TEST(OverTheMemoryBudgetNothingIsCached)
+{
+	FakePoolSet pools;
+	pools.Cache.SetBudget(10 * POOL_BYTES);
+
+	pools.Activate(320, 180);
+	pools.Activate(640, 360);
+	FakePool* pCurrent = pools.Activate(1280, 720);
+	CHECK_EQUAL(3u, pools.Cache.GetCount());
+
+	pools.OverMemoryBudget = TRUE;
+	pools.Trim();
+	CHECK_EQUAL(1u, pools.Cache.GetCount());
+	CHECK(pCurrent == pools.Cache.Front());
+	CHECK_EQUAL(0u, pools.Cache.GetCachedBytes());
+
+	// Switching back creates the pool again.
+	pools.Activate(640, 360);
+	CHECK_EQUAL(4u, pools.Created);
+}
+
+TEST(TakeFrontEmptiesTheCache)
+{
+	SamplePoolCache cache;
+	FakePool pools[2] = {};
+	CHECK_EQUAL(S_OK, cache.Insert(&pools[0]));
+	CHECK_EQUAL(S_OK, cache.Insert(&pools[1]));
+	cache.SetCurrent(&pools[1]);
+	CHECK_EQUAL(E_POINTER, cache.Insert(NULL));
+
+	CHECK(&pools[0] == cache.TakeFront());
+	CHECK(&pools[1] == cache.GetCurrent());
+	CHECK(&pools[1] == cache.TakeFront());
+	CHECK(NULL == cache.GetCurrent());
+	CHECK(NULL == cache.TakeFront());
+	CHECK(NULL == cache.TakeVictim(TRUE, NULL));
+}
+
+TEST_MAIN()
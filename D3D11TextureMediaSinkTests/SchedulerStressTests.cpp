@@ -0,0 +1,160 @@
+// Scheduler under concurrent use: samples scheduled while the scheduler is flushed, drained, started and stopped from other
+// threads. Meant to be run under ThreadSanitizer (TMS_TESTS_TSAN) as well; without it, it still checks that every sample
+// ends up presented or discarded exactly once, and that nothing deadlocks.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+#include <atomic>
+#include <random>
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	const int RUN_MILLISECONDS = 1000;
+	const LONGLONG ONE_MSEC = 10000;
+
+	struct Context
+	{
+		Scheduler TheScheduler;
+		FakeSchedulerCallback Callback;
+		FakeClock* Clock;
+		std::atomic<bool> Running;
+		std::mutex SamplesMutex;
+		std::vector<FakeSample*> Samples;
+	};
+
+	void Produce(Context* pContext, unsigned seed)
+	{
+		std::mt19937 random(seed);
+		while (pContext->Running)
+		{
+			// Mostly in the near future, some late, a few to be presented now.
+			LONGLONG hnsTime = pContext->Clock->GetTime() + (LONGLONG)(random() % 25) * ONE_MSEC - 5 * ONE_MSEC;
+			FakeSample* pSample = new FakeSample(hnsTime, ONE_MSEC);
+			{
+				std::lock_guard<std::mutex> lock(pContext->SamplesMutex);
+				pContext->Samples.push_back(pSample);
+			}
+			pContext->TheScheduler.ScheduleSample(pSample, 0 == random() % 10);
+			if (0 == random() % 4)
+				std::this_thread::yield();
+		}
+	}
+	void FlushRepeatedly(Context* pContext)
+	{
+		while (pContext->Running)
+		{
+			pContext->TheScheduler.Flush();
+			std::this_thread::sleep_for(std::chrono::milliseconds(3));
+		}
+	}
+	void DrainRepeatedly(Context* pContext, unsigned seed)
+	{
+		std::mt19937 random(seed);
+		while (pContext->Running)
+		{
+			pContext->TheScheduler.BeginDrain();
+			for (int i = 0; i < 5 && !pContext->TheScheduler.IsDrained(); i++)
+				::WaitForSingleObject(pContext->TheScheduler.GetFrameDoneEvent(), 1);
+			pContext->TheScheduler.EndDrain(0 == random() % 2);
+		}
+	}
+	void PresentNow(Scheduler* pScheduler, FakeSample* pSample)
+	{
+		pScheduler->ScheduleSample(pSample, TRUE);
+	}
+	void StartAndStopRepeatedly(Context* pContext)
+	{
+		while (pContext->Running)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(7));
+			pContext->TheScheduler.Stop();
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			pContext->TheScheduler.Start(pContext->Clock);
+		}
+	}
+}
+
+TEST(EverySampleIsPresentedOrDiscardedOnce)
+{
+	Context context;
+	context.Clock = new FakeClock();
+	context.Clock->SetRealTime(TRUE);
+	context.Callback.PresentDelayMilliseconds = 0;
+	context.TheScheduler.SetCallback(&context.Callback);
+	MFRatio fps = { 1000, 1 };
+	context.TheScheduler.SetFrameRate(fps);
+	context.TheScheduler.Start(context.Clock);
+	context.Running = true;
+
+	std::vector<std::thread> threads;
+	threads.push_back(std::thread(Produce, &context, 1u));
+	threads.push_back(std::thread(Produce, &context, 2u));
+	threads.push_back(std::thread(FlushRepeatedly, &context));
+	threads.push_back(std::thread(DrainRepeatedly, &context, 3u));
+	threads.push_back(std::thread(StartAndStopRepeatedly, &context));
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(RUN_MILLISECONDS));
+	context.Running = false;
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	// Whatever is still queued is discarded by Stop.
+	context.TheScheduler.Stop();
+
+	int wrong = 0;
+	for (size_t i = 0; i < context.Samples.size(); i++)
+	{
+		FakeSample* pSample = context.Samples[i];
+		if (1 != pSample->PresentCount + pSample->DiscardCount)
+			wrong++;
+		pSample->Release();
+	}
+	printf("  %d samples, %d presented or discarded other than once\n", (int)context.Samples.size(), wrong);
+	CHECK(0 < context.Samples.size());
+	CHECK_EQUAL(0, wrong);
+	CHECK(context.TheScheduler.IsDrained());
+
+	context.Clock->Release();
+}
+
+TEST(PresentingDoesNotBlockTheOtherCallers)
+{
+	// The thread presents slowly; Flush and Stop from other threads must not wait for each frame.
+	Scheduler scheduler;
+	FakeSchedulerCallback callback;
+	FakeClock* pClock = new FakeClock();
+	callback.PresentDelayMilliseconds = 50;
+	scheduler.SetCallback(&callback);
+	MFRatio fps = { 1000, 1 };
+	scheduler.SetFrameRate(fps);
+	scheduler.Start(pClock);
+
+	// A sample presented now, from another thread, takes 50 ms in the callback.
+	FakeSample* pNow = new FakeSample(0, ONE_MSEC);
+	std::thread presenter(PresentNow, &scheduler, pNow);
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	FakeSample* pQueued = new FakeSample(10000 * ONE_MSEC, ONE_MSEC);
+	scheduler.ScheduleSample(pQueued, FALSE);
+	scheduler.Flush();
+	long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+	printf("  ScheduleSample + Flush while a frame is presented: %lld ms\n", elapsed);
+	CHECK(elapsed < 25);
+
+	presenter.join();
+	scheduler.Stop();
+	CHECK_EQUAL(1, pNow->PresentCount);
+	CHECK_EQUAL(1, pQueued->DiscardCount);
+
+	pNow->Release();
+	pQueued->Release();
+	pClock->Release();
+}
+
+TEST_MAIN()
@@ -0,0 +1,125 @@
+// Time the caller of a seek is blocked.
+//
+// A seek flushes the scheduler (TextureMediaSink::OnClockStart -> StreamSink::Flush -> Scheduler::Flush) while the scheduler
+// thread is presenting frames that each take a while. The samples come from a fixed pool, as from SampleAllocator, so the
+// samples flushed must come back for playback to go on after the seek. Prints the time spent in Flush per seek.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	const int SEEK_COUNT = 50;
+	const int POOL_SIZE = SAMPLE_MAX;
+	const DWORD PRESENT_MILLISECONDS = 8;	// Time a frame takes to present.
+	const LONGLONG FRAME_DURATION = 166667;	// 60 fps
+
+	struct Playback
+	{
+		Scheduler TheScheduler;
+		FakeSchedulerCallback Callback;
+		FakeClock* Clock;
+		FakeSample* Pool[POOL_SIZE];
+		LONG Scheduled[POOL_SIZE];		// Times each sample of the pool was scheduled.
+		std::atomic<bool> Running;
+		std::atomic<long> ScheduledCount;
+		std::atomic<LONGLONG> NextTime;
+	};
+
+	// The decoder side: schedules the samples of the pool as they come back, with consecutive times.
+	void Decode(Playback* pPlayback)
+	{
+		while (pPlayback->Running)
+		{
+			BOOL bScheduled = FALSE;
+			for (int i = 0; i < POOL_SIZE; i++)
+			{
+				FakeSample* pSample = pPlayback->Pool[i];
+				LONG retired = ::InterlockedCompareExchange(&pSample->PresentCount, 0, 0) + ::InterlockedCompareExchange(&pSample->DiscardCount, 0, 0);
+				if (retired != pPlayback->Scheduled[i])
+					continue;	// Still in the scheduler.
+
+				pSample->SetSampleTime(pPlayback->NextTime.fetch_add(FRAME_DURATION));
+				pPlayback->Scheduled[i]++;
+				pPlayback->ScheduledCount++;
+				pPlayback->TheScheduler.ScheduleSample(pSample, FALSE);
+				bScheduled = TRUE;
+			}
+			if (!bScheduled)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+TEST(SeekDoesNotBlockTheCaller)
+{
+	Playback playback;
+	playback.Clock = new FakeClock();
+	playback.Clock->SetRealTime(TRUE);
+	playback.Callback.PresentDelayMilliseconds = PRESENT_MILLISECONDS;
+	playback.TheScheduler.SetCallback(&playback.Callback);
+	MFRatio fps = { 60, 1 };
+	playback.TheScheduler.SetFrameRate(fps);
+	for (int i = 0; i < POOL_SIZE; i++)
+	{
+		playback.Pool[i] = new FakeSample(0, FRAME_DURATION);
+		playback.Scheduled[i] = 0;
+	}
+	playback.ScheduledCount = 0;
+	playback.NextTime = 0;
+	playback.Running = true;
+	playback.TheScheduler.Start(playback.Clock);
+
+	std::thread decoder(Decode, &playback);
+
+	std::vector<long long> blocked;
+	for (int seek = 0; seek < SEEK_COUNT; seek++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		// Seek: the clock jumps, the queued samples are flushed, the decoder goes on from the new position.
+		LONGLONG hnsPosition = (LONGLONG)(seek % 7) * 10000000;
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		playback.TheScheduler.Flush();
+		blocked.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count());
+		playback.Clock->SetTime(hnsPosition);
+		playback.NextTime = hnsPosition;
+	}
+
+	// Playback goes on after the last seek: the flushed samples came back to the pool.
+	long scheduledAfterSeeks = playback.ScheduledCount;
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	CHECK(playback.ScheduledCount > scheduledAfterSeeks + POOL_SIZE);
+
+	playback.Running = false;
+	decoder.join();
+	playback.TheScheduler.Stop();
+
+	std::sort(blocked.begin(), blocked.end());
+	long long total = 0;
+	for (size_t i = 0; i < blocked.size(); i++)
+		total += blocked[i];
+	printf("  %d seeks while presenting takes %u ms: caller blocked mean %lld us, median %lld us, max %lld us\n",
+		SEEK_COUNT, PRESENT_MILLISECONDS, total / (long long)blocked.size(), blocked[blocked.size() / 2], blocked.back());
+	printf("  %zu frames presented, %zu discarded\n", playback.Callback.GetPresented().size(), playback.Callback.GetDiscarded().size());
+
+	// The caller never waits for the frame being presented.
+	CHECK(blocked.back() < PRESENT_MILLISECONDS * 1000 / 2);
+	CHECK(0 < playback.Callback.GetDiscarded().size());
+
+	for (int i = 0; i < POOL_SIZE; i++)
+	{
+		CHECK_EQUAL(playback.Scheduled[i], playback.Pool[i]->PresentCount + playback.Pool[i]->DiscardCount);
+		playback.Pool[i]->Release();
+	}
+	playback.Clock->Release();
+}
+
+TEST_MAIN()
@@ -0,0 +1,193 @@
+// The drain of a segment, with the samples of the next one arriving behind it.
+//
+// The stream sink completes an end-of-segment marker once the scheduler has presented (or, at the deadline, dropped) the
+// samples queued before the marker: Scheduler::BeginDrain, IsDrained, EndDrain. Meanwhile the samples of the next segment keep
+// being scheduled, and their timestamps may start over. The clock here stands still unless the test moves it, so what is
+// presented, blended and dropped depends only on the script.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+#include <algorithm>
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	const MFRatio FPS = { 25, 1 };
+	const LONGLONG FRAME = 400000;	// 100ns units, at 25 fps.
+
+	struct Playback
+	{
+		Scheduler TheScheduler;
+		FakeSchedulerCallback Callback;
+		FakeClock* Clock;
+		std::vector<FakeSample*> Samples;
+
+		Playback(LONGLONG hnsStart)
+		{
+			this->Clock = new FakeClock();
+			this->Clock->SetTime(hnsStart);
+			this->TheScheduler.SetCallback(&this->Callback);
+			this->TheScheduler.SetFrameRate(FPS);
+		}
+		~Playback()
+		{
+			this->TheScheduler.Stop();
+			for (size_t i = 0; i < this->Samples.size(); i++)
+				this->Samples[i]->Release();
+			this->Clock->Release();
+		}
+
+		// Schedules the frames first to first + count - 1 of a segment.
+		std::vector<FakeSample*> Schedule(int first, int count)
+		{
+			std::vector<FakeSample*> segment;
+			for (int n = first; n < first + count; n++)
+			{
+				FakeSample* pSample = new FakeSample(n * FRAME, FRAME);
+				this->Samples.push_back(pSample);
+				segment.push_back(pSample);
+				CHECK_EQUAL(S_OK, this->TheScheduler.ScheduleSample(pSample, FALSE));
+			}
+			return segment;
+		}
+	};
+
+	BOOL Contains(const std::vector<FakeSample*>& samples, FakeSample* pSample)
+	{
+		return std::find(samples.begin(), samples.end(), pSample) != samples.end();
+	}
+
+	// Waits until at least count frames have been blended. FALSE on timeout.
+	BOOL WaitForBlends(FakeSchedulerCallback* pCallback, size_t count)
+	{
+		for (int i = 0; i < 5000 && pCallback->GetBlends().size() < count; i++)
+			::Sleep(1);
+		return pCallback->GetBlends().size() >= count;
+	}
+}
+
+TEST(DrainIsDoneWhenItsSamplesArePresented)
+{
+	Playback playback(-FRAME);
+	playback.TheScheduler.Start(playback.Clock);
+
+	std::vector<FakeSample*> segment = playback.Schedule(0, 5);
+	playback.TheScheduler.BeginDrain();
+	std::vector<FakeSample*> next = playback.Schedule(10, 5);
+	CHECK(!playback.TheScheduler.IsDrained());
+
+	// The clock reaches the end of the segment; the next one is not due yet.
+	playback.Clock->SetTime(5 * FRAME);
+	playback.Schedule(15, 1);	// Wakes the scheduler thread.
+	CHECK(playback.Callback.WaitForRetired(segment.size()));
+	CHECK(playback.TheScheduler.IsDrained());
+
+	std::vector<FakeSample*> presented = playback.Callback.GetPresented();
+	CHECK_EQUAL(segment.size(), presented.size());
+	for (size_t i = 0; i < presented.size(); i++)
+		CHECK(segment[i] == presented[i]);
+	playback.TheScheduler.EndDrain(FALSE);
+}
+
+TEST(NextSegmentStaysBehindTheDrainWhenItsTimestampsStartOver)
+{
+	Playback playback(-FRAME);
+	playback.TheScheduler.Start(playback.Clock);
+
+	std::vector<FakeSample*> segment = playback.Schedule(0, 5);
+	playback.TheScheduler.BeginDrain();
+	std::vector<FakeSample*> next = playback.Schedule(0, 5);	// Not rebased.
+
+	// Everything is due: the segment goes first, then the next one, each in its own order.
+	playback.Clock->SetTime(10 * FRAME);
+	next.push_back(playback.Schedule(5, 1)[0]);
+	CHECK(playback.Callback.WaitForRetired(segment.size() + next.size()));
+	CHECK(playback.TheScheduler.IsDrained());
+	playback.TheScheduler.EndDrain(FALSE);
+
+	std::vector<FakeSample*> presented = playback.Callback.GetPresented();
+	CHECK_EQUAL(segment.size() + next.size(), presented.size());
+	for (size_t i = 0; i < segment.size(); i++)
+		CHECK(segment[i] == presented[i]);
+	for (size_t i = 0; i < next.size(); i++)
+		CHECK(next[i] == presented[segment.size() + i]);
+}
+
+TEST(DroppedDrainIsNeverBlended)
+{
+	Playback playback(0);
+	FrameRateConverter* pFrc = playback.TheScheduler.GetFrameRateConverter();
+	MFRatio output = { 60, 1 };
+	CHECK_EQUAL(S_OK, pFrc->SetTargetRate(output));
+	CHECK_EQUAL(S_OK, pFrc->SetMode(TMS_FRC_MODE_BLEND));
+	playback.TheScheduler.Start(playback.Clock);
+
+	// The end of the segment is still far ahead of the clock when the next segment starts over at 0, in the lookahead.
+	std::vector<FakeSample*> segment = playback.Schedule(10, 3);
+	playback.TheScheduler.BeginDrain();
+	std::vector<FakeSample*> next = playback.Schedule(0, 2);
+	CHECK(!playback.TheScheduler.IsDrained());
+
+	// The deadline: the rest of the segment is dropped, and the next segment is blended on the following ticks, up to its
+	// last frame.
+	playback.TheScheduler.EndDrain(TRUE);
+	CHECK(playback.Callback.WaitForRetired(segment.size()));
+	for (int tick = 1; tick <= 3; tick++)
+	{
+		size_t blends = playback.Callback.GetBlends().size();
+		playback.Clock->SetTime(tick * FRAME / 2);
+		CHECK(WaitForBlends(&playback.Callback, blends + 1));
+	}
+
+	// The frames of the next segment that were blended and passed are returned too.
+	std::vector<FakeSample*> discarded = playback.Callback.GetDiscarded();
+	for (size_t i = 0; i < segment.size(); i++)
+		CHECK(Contains(discarded, segment[i]));
+	for (size_t i = 0; i < discarded.size(); i++)
+		CHECK(Contains(segment, discarded[i]) || Contains(next, discarded[i]));
+	CHECK_EQUAL(0u, playback.Callback.GetPresented().size());
+
+	std::vector<FakeSchedulerCallback::Blend> blends = playback.Callback.GetBlends();
+	for (size_t i = 0; i < blends.size(); i++)
+	{
+		CHECK(Contains(next, blends[i].First));
+		CHECK(NULL == blends[i].Second || Contains(next, blends[i].Second));
+	}
+	printf("  %zu dropped at the deadline, %zu frames blended from the next segment only\n", segment.size(), blends.size());
+}
+
+TEST(RemoveTakesTheItemFromAnywhereInTheQueue)
+{
+	ThreadSafeComPtrQueue<IUnknown> queue;
+	FakeUnknown* items[4];
+	for (int i = 0; i < 4; i++)
+	{
+		items[i] = new FakeUnknown();
+		CHECK_EQUAL(S_OK, queue.Queue(items[i]));
+	}
+
+	CHECK_EQUAL(S_OK, queue.Remove(items[2]));
+	CHECK_EQUAL(S_FALSE, queue.Remove(items[2]));
+	CHECK_EQUAL(1, items[2]->GetRefCount());
+
+	int order[] = { 0, 1, 3 };
+	for (int i = 0; i < 3; i++)
+	{
+		IUnknown* pItem = NULL;
+		CHECK_EQUAL(S_OK, queue.Dequeue(&pItem));
+		CHECK(items[order[i]] == pItem);
+		SafeRelease(pItem);
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		CHECK_EQUAL(1, items[i]->GetRefCount());
+		items[i]->Release();
+	}
+}
+
+TEST_MAIN()
@@ -0,0 +1,228 @@
+// The gap between the items of a playlist played on one stream.
+//
+// A synthetic stream of two items goes through the steps of the stream sink: the samples and the end-of-segment marker are
+// placed (MarkerSequence), each sample is rebased by SegmentTimeline when it is processed, and the scheduler presents it on a
+// real-time clock. Opening the next item takes OPEN_MILLISECONDS, while the last frames of the first one are still queued;
+// its own timestamps start LEAD after the end of the first one. The gap is measured as PresentFrame measures
+// TMS_SEGMENT_GAP: how long the last frame of the first item stayed on display beyond its duration.
+//
+// Prints the gap with and without TMS_GAPLESS.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	const MFRatio FPS = { 25, 1 };
+	const LONGLONG FRAME = 400000;				// 100ns units, at 25 fps.
+	const int ITEM_FRAMES = 10;
+	const DWORD OPEN_MILLISECONDS = 150;		// Opening and decoding the start of the next item.
+	const LONGLONG LEAD = 3000000;				// The next item's own timestamps start 300 ms after the end of the first one.
+	const LONGLONG NOISE = 20 * 10000;			// Scheduling noise.
+
+	// Measures the gap as StreamSink::PresentFrame does.
+	class GapCallback : public FakeSchedulerCallback
+	{
+	public:
+		HRESULT PresentFrame(IMFSample* pSample)
+		{
+			{
+				AutoLock lock(&this->_csGap);
+				MFTIME hnsNow = ::MFGetSystemTime();
+				FakeSample* pFake = static_cast<FakeSample*>(pSample);
+				if (pFake->Descriptor.SegmentStart && NULL != this->_Previous)
+				{
+					pFake->Descriptor.SegmentStart = FALSE;
+					this->_Gap = SegmentTimeline::GetGap(this->_PreviousPresented, this->_PreviousDuration, 1.0f, hnsNow);
+					this->_HasGap = TRUE;
+				}
+				this->_Previous = pFake;
+				this->_PreviousPresented = hnsNow;
+				pSample->GetSampleDuration(&this->_PreviousDuration);
+			}
+
+			return FakeSchedulerCallback::PresentFrame(pSample);
+		}
+
+		BOOL GetGap(LONGLONG* pGap)
+		{
+			AutoLock lock(&this->_csGap);
+			*pGap = this->_Gap;
+			return this->_HasGap;
+		}
+
+	private:
+		CriticalSection _csGap;
+		FakeSample* _Previous = NULL;
+		MFTIME _PreviousPresented = 0;
+		LONGLONG _PreviousDuration = 0;
+		LONGLONG _Gap = 0;
+		BOOL _HasGap = FALSE;
+	};
+
+	// The stream sink, as far as the timeline goes.
+	struct Stream
+	{
+		Scheduler TheScheduler;
+		GapCallback Callback;
+		FakeClock* Clock;
+		MarkerSequence Markers;
+		SegmentTimeline Segments;
+		std::vector<FakeSample*> Samples;
+
+		Stream(BOOL bGapless)
+		{
+			this->Clock = new FakeClock();
+			this->Clock->SetRealTime(TRUE);
+			this->TheScheduler.SetCallback(&this->Callback);
+			this->TheScheduler.SetFrameRate(FPS);
+			this->Segments.SetGapless(bGapless);
+		}
+		~Stream()
+		{
+			this->TheScheduler.Stop();
+			for (size_t i = 0; i < this->Samples.size(); i++)
+				this->Samples[i]->Release();
+			this->Clock->Release();
+		}
+
+		// StreamSink::ProcessSample, then ProcessSamplesFromQueue with the pre-processing queue empty.
+		void Process(LONGLONG hnsTime)
+		{
+			FakeSample* pSample = new FakeSample(hnsTime, FRAME);
+			this->Samples.push_back(pSample);
+			this->Markers.SamplePlaced();
+
+			LONGLONG hnsOffset = this->Segments.GetSampleOffset(hnsTime, this->Markers.GetSamplesDone());
+			pSample->SetSampleTime(hnsTime + hnsOffset);
+			pSample->Descriptor.SegmentStart = this->Segments.FrameScheduled(hnsTime + hnsOffset, FRAME);
+			CHECK_EQUAL(S_OK, this->TheScheduler.ScheduleSample(pSample, FALSE));
+			this->Markers.SampleDone();
+		}
+		// StreamSink::PlaceMarker.
+		void EndOfSegment()
+		{
+			CHECK_EQUAL(S_OK, this->Markers.PlaceMarker(MFSTREAMSINK_MARKER_ENDOFSEGMENT, NULL, NULL));
+			this->Segments.EndOfSegment(this->Markers.GetSamplesPlaced());
+		}
+	};
+
+	// Plays the two items and returns the gap between them.
+	LONGLONG Play(BOOL bGapless)
+	{
+		Stream stream(bGapless);
+		stream.TheScheduler.Start(stream.Clock);
+
+		for (int n = 0; n < ITEM_FRAMES; n++)
+			stream.Process(n * FRAME);
+		stream.EndOfSegment();
+
+		// The next item is opened while the first one plays.
+		::Sleep(OPEN_MILLISECONDS);
+		LONGLONG hnsStart = ITEM_FRAMES * FRAME + LEAD;
+		for (int n = 0; n < ITEM_FRAMES; n++)
+			stream.Process(hnsStart + n * FRAME);
+
+		CHECK(stream.Callback.WaitForRetired(2 * ITEM_FRAMES));
+		LONGLONG gap = 0;
+		CHECK(stream.Callback.GetGap(&gap));
+		return gap;
+	}
+}
+
+TEST(GaplessItemsFollowEachOther)
+{
+	LONGLONG gapless = Play(TRUE);
+	LONGLONG plain = Play(FALSE);
+
+	printf("  gap between the items: %.1f ms gapless, %.1f ms on their own timestamps (which start %.1f ms later)\n",
+		gapless / 10000.0, plain / 10000.0, LEAD / 10000.0);
+	CHECK(gapless < NOISE);
+	CHECK(plain > LEAD - NOISE);
+}
+
+TEST(SegmentsAreRebasedOntoTheEndOfThePreviousOne)
+{
+	SegmentTimeline timeline;
+	timeline.SetGapless(TRUE);
+
+	// The first segment keeps its own times.
+	for (int n = 0; n < 5; n++)
+	{
+		CHECK_EQUAL(0, timeline.GetSampleOffset(n * FRAME, n));
+		CHECK(!timeline.FrameScheduled(n * FRAME, FRAME));
+	}
+	timeline.EndOfSegment(5);
+
+	// The next one starts over at 0, and follows the first one.
+	CHECK_EQUAL(5 * FRAME, timeline.GetSampleOffset(0, 5));
+	CHECK(timeline.FrameScheduled(5 * FRAME, FRAME));
+	CHECK_EQUAL(5 * FRAME, timeline.GetSampleOffset(FRAME, 6));
+	CHECK(!timeline.FrameScheduled(6 * FRAME, FRAME));
+	timeline.EndOfSegment(7);
+
+	// A segment that starts far ahead is brought back.
+	CHECK_EQUAL(7 * FRAME - 100 * FRAME, timeline.GetSampleOffset(100 * FRAME, 7));
+	CHECK(timeline.FrameScheduled(7 * FRAME, FRAME));
+	CHECK_EQUAL(7 * FRAME - 100 * FRAME, timeline.GetOffset());
+}
+
+TEST(NextSegmentWaitsForTheSamplesBeforeTheMarker)
+{
+	SegmentTimeline timeline;
+	timeline.SetGapless(TRUE);
+	timeline.FrameScheduled(0, FRAME);
+	timeline.EndOfSegment(3);
+
+	// Two of the three samples before the marker are done: the one in front is still of the first segment.
+	CHECK_EQUAL(0, timeline.GetSampleOffset(FRAME, 2));
+	CHECK(!timeline.FrameScheduled(FRAME, FRAME));
+	CHECK_EQUAL(2 * FRAME, timeline.GetSampleOffset(0, 3));
+	CHECK(timeline.FrameScheduled(2 * FRAME, FRAME));
+}
+
+TEST(WithoutGaplessTheSegmentStartIsOnlyMarked)
+{
+	SegmentTimeline timeline;
+	timeline.FrameScheduled(0, FRAME);
+	timeline.EndOfSegment(1);
+	CHECK_EQUAL(0, timeline.GetSampleOffset(50 * FRAME, 1));
+	CHECK(timeline.FrameScheduled(50 * FRAME, FRAME));	// Still measured.
+}
+
+TEST(StartAndDetachEndTheRebasing)
+{
+	SegmentTimeline timeline;
+	timeline.SetGapless(TRUE);
+	timeline.FrameScheduled(0, FRAME);
+	timeline.EndOfSegment(1);
+	CHECK_EQUAL(FRAME, timeline.GetSampleOffset(0, 1));
+
+	// A start at a new position: the clock is on the source's timestamps again, and nothing was scheduled since.
+	timeline.Restart();
+	CHECK_EQUAL(0, timeline.GetOffset());
+	timeline.EndOfSegment(2);
+	CHECK_EQUAL(0, timeline.GetSampleOffset(10 * FRAME, 2));
+
+	// A detach forgets a marker of the previous source.
+	timeline.FrameScheduled(10 * FRAME, FRAME);
+	timeline.EndOfSegment(3);
+	timeline.Clear();
+	CHECK_EQUAL(0, timeline.GetSampleOffset(0, 3));
+	CHECK(!timeline.FrameScheduled(0, FRAME));
+}
+
+TEST(GapIsWhatTheFrameStayedBeyondItsDuration)
+{
+	CHECK_EQUAL(0, SegmentTimeline::GetGap(1000, FRAME, 1.0f, 1000 + FRAME));
+	CHECK_EQUAL(0, SegmentTimeline::GetGap(1000, FRAME, 1.0f, 1000 + FRAME / 2));	// Early: no gap.
+	CHECK_EQUAL(250, SegmentTimeline::GetGap(1000, FRAME, 1.0f, 1250 + FRAME));
+	CHECK_EQUAL(FRAME / 2, SegmentTimeline::GetGap(0, FRAME, 2.0f, FRAME));			// At 2x, a frame is shown half as long.
+	CHECK_EQUAL(0, SegmentTimeline::GetGap(0, FRAME, 0.0f, 10 * FRAME));
+}
+
+TEST_MAIN()
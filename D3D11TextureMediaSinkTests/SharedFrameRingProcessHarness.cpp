@@ -0,0 +1,222 @@
+// The shared frame ring between two processes.
+//
+// The sink writes the slots through SharedFrameRing in this process; the compositor reads them in a child process. The slots
+// and their keyed mutexes live in shared memory, the mutex being a word that holds the key it was released with, or HELD.
+// Each frame is a block of words that all hold its sequence number, so a frame read while it was being written shows up as
+// mixed words. First the child holds a slot while the parent writes, to see the parent skip it without waiting; then the
+// parent writes frames as fast as it can while the child reads what it gets.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	const UINT SLOTS = 3;
+	const UINT FRAME_WORDS = 256;
+	const UINT FRAMES = 20000;
+	const UINT32 HELD = 2;		// Neither of the keys.
+
+	struct SharedSlot
+	{
+		std::atomic<UINT32> State;	// The key it was released with, or HELD.
+		UINT64 Frame[FRAME_WORDS];
+	};
+
+	struct SharedState
+	{
+		SharedSlot Slots[SLOTS];
+		std::atomic<UINT32> Holding;	// The child holds the first frame.
+		std::atomic<UINT32> LetGo;		// The parent has written around it.
+		std::atomic<UINT32> Done;		// The parent has written the last frame.
+		std::atomic<UINT64> FramesRead;
+		std::atomic<UINT64> NewestRead;
+		std::atomic<UINT64> Errors;
+	};
+
+	// The keyed mutex of a slot, in shared memory.
+	class SharedMemoryKeyedMutex : public SharedSlotMutex
+	{
+	public:
+		SharedMemoryKeyedMutex(SharedSlot* pSlot) : pSlot(pSlot) {}
+
+		HRESULT TryAcquire(UINT64 key)
+		{
+			UINT32 expected = (UINT32)key;
+			return this->pSlot->State.compare_exchange_strong(expected, HELD) ? S_OK : S_FALSE;
+		}
+		HRESULT Release(UINT64 key)
+		{
+			this->pSlot->State.store((UINT32)key);
+			return S_OK;
+		}
+
+	private:
+		SharedSlot* pSlot;
+	};
+
+	BOOL WaitFor(std::atomic<UINT32>* pFlag)
+	{
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (0 == pFlag->load())
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+				return FALSE;
+			std::this_thread::yield();
+		}
+		return TRUE;
+	}
+
+	void WriteFrame(SharedSlot* pSlot, UINT64 sequence)
+	{
+		for (UINT i = 0; i < FRAME_WORDS; i++)
+			pSlot->Frame[i] = sequence;
+	}
+
+	// Reads the frame of the slot if it has one that is not read yet. Returns its sequence number, or 0.
+	UINT64 ReadFrame(SharedState* pState, UINT slot, UINT64* pLastRead)
+	{
+		SharedSlot* pSlot = &pState->Slots[slot];
+		UINT32 expected = SHARED_KEY_CONSUMER;
+		if (!pSlot->State.compare_exchange_strong(expected, HELD))
+			return 0;
+
+		UINT64 sequence = pSlot->Frame[0];
+		for (UINT i = 1; i < FRAME_WORDS; i++)
+		{
+			if (pSlot->Frame[i] != sequence)
+			{
+				pState->Errors++;	// Written while it was read.
+				break;
+			}
+		}
+		if (sequence <= pLastRead[slot])
+			pState->Errors++;		// Read twice.
+		pLastRead[slot] = sequence;
+
+		pState->FramesRead++;
+		if (sequence > pState->NewestRead.load())
+			pState->NewestRead.store(sequence);
+		return sequence;
+	}
+	void GiveBack(SharedState* pState, UINT slot)
+	{
+		pState->Slots[slot].State.store(SHARED_KEY_PRODUCER);
+	}
+
+	// The compositor.
+	int Consume(SharedState* pState)
+	{
+		UINT64 lastRead[SLOTS] = {};
+
+		// Holds the first frame until the parent has written around it.
+		while (0 == ReadFrame(pState, 0, lastRead))
+			std::this_thread::yield();
+		pState->Holding.store(1);
+		if (!WaitFor(&pState->LetGo))
+			return 1;
+		GiveBack(pState, 0);
+
+		// Reads whatever is there, holding each frame for a little while, until the parent is done and nothing is left.
+		for (;;)
+		{
+			BOOL bDone = (0 != pState->Done.load());
+			BOOL bRead = FALSE;
+			for (UINT slot = 0; slot < SLOTS; slot++)
+			{
+				if (0 != ReadFrame(pState, slot, lastRead))
+				{
+					bRead = TRUE;
+					for (int spin = 0; spin < 1000; spin++)
+						std::atomic_signal_fence(std::memory_order_seq_cst);
+					GiveBack(pState, slot);
+				}
+			}
+			if (bDone && !bRead)
+				break;
+		}
+
+		return (0 == pState->Errors.load()) ? 0 : 1;
+	}
+}
+
+TEST(TheSinkNeverWaitsForTheOtherProcess)
+{
+	void* pMemory = mmap(NULL, sizeof(SharedState), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	CHECK(MAP_FAILED != pMemory);
+	if (MAP_FAILED == pMemory)
+		return;
+
+	SharedState* pState = new (pMemory) SharedState();
+	for (UINT slot = 0; slot < SLOTS; slot++)
+		pState->Slots[slot].State.store(SHARED_KEY_PRODUCER);
+
+	pid_t child = fork();
+	CHECK(child >= 0);
+	if (0 == child)
+		_exit(Consume(pState));
+
+	SharedFrameRing ring;
+	for (UINT slot = 0; slot < SLOTS; slot++)
+		ring.Attach(slot, new SharedMemoryKeyedMutex(&pState->Slots[slot]));
+
+	UINT64 written = 0;
+	UINT64 sequence = 0;
+
+	// The first frame, which the child holds.
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	WriteFrame(&pState->Slots[0], ++written);
+	CHECK_EQUAL(S_OK, ring.EndWrite(0, &sequence));
+	CHECK(WaitFor(&pState->Holding));
+
+	// The slot being read is skipped, and the next one written.
+	CHECK_EQUAL(S_FALSE, ring.BeginWrite(0));
+	CHECK_EQUAL(1u, ring.GetBusyCount());
+	CHECK_EQUAL(S_OK, ring.BeginWrite(1));
+	WriteFrame(&pState->Slots[1], ++written);
+	CHECK_EQUAL(S_OK, ring.EndWrite(1, &sequence));
+	CHECK_EQUAL(written, sequence);
+	pState->LetGo.store(1);
+
+	// As fast as it goes. The child holds one slot at most, so one of the others is always free.
+	UINT slot = 0;
+	for (UINT n = 0; n < FRAMES; n++)
+	{
+		UINT tries = 0;
+		while (S_OK != ring.BeginWrite(slot) && tries++ < SLOTS)
+			slot = (slot + 1) % SLOTS;
+		CHECK(ring.IsWriting(slot));
+
+		WriteFrame(&pState->Slots[slot], ++written);
+		CHECK_EQUAL(S_OK, ring.EndWrite(slot, &sequence));
+		CHECK_EQUAL(written, sequence);
+		slot = (slot + 1) % SLOTS;
+	}
+	pState->Done.store(1);
+
+	int status = 0;
+	CHECK_EQUAL(child, waitpid(child, &status, 0));
+	CHECK(WIFEXITED(status));
+	CHECK_EQUAL(0, WEXITSTATUS(status));
+	CHECK_EQUAL(0u, pState->Errors.load());
+	CHECK_EQUAL(written, pState->NewestRead.load());	// The last frame was read.
+	CHECK(pState->FramesRead.load() > 1);
+
+	printf("  %u frames written, %llu read, %llu slots skipped while read\n", (UINT)written,
+		(unsigned long long)pState->FramesRead.load(), (unsigned long long)ring.GetBusyCount());
+
+	ring.Clear();
+	pState->~SharedState();
+	munmap(pMemory, sizeof(SharedState));
+}
+
+TEST_MAIN()
@@ -0,0 +1,243 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	// A keyed mutex as DXGI keeps it: whoever holds it releases it with a key, and only that key acquires it next.
+	class FakeKeyedMutex : public SharedSlotMutex
+	{
+	public:
+		BOOL Held = FALSE;
+		UINT64 Key = SHARED_KEY_PRODUCER;	// The key it was last released with.
+		int Releases = 0;
+		BOOL* pDeleted;
+		BOOL* pHeldWhenDeleted;
+
+		FakeKeyedMutex(BOOL* pDeleted = NULL, BOOL* pHeldWhenDeleted = NULL) : pDeleted(pDeleted), pHeldWhenDeleted(pHeldWhenDeleted) {}
+		~FakeKeyedMutex()
+		{
+			if (NULL != this->pDeleted)
+				*this->pDeleted = TRUE;
+			if (NULL != this->pHeldWhenDeleted)
+				*this->pHeldWhenDeleted = this->Held;
+		}
+
+		HRESULT TryAcquire(UINT64 key)
+		{
+			if (this->Held || key != this->Key)
+				return S_FALSE;
+			this->Held = TRUE;
+			return S_OK;
+		}
+		HRESULT Release(UINT64 key)
+		{
+			if (!this->Held)
+				return E_UNEXPECTED;
+			this->Held = FALSE;
+			this->Key = key;
+			this->Releases++;
+			return S_OK;
+		}
+
+		// The consumer in the other process.
+		BOOL ConsumerAcquire()
+		{
+			return S_OK == this->TryAcquire(SHARED_KEY_CONSUMER);
+		}
+		void ConsumerRelease()
+		{
+			this->Release(SHARED_KEY_PRODUCER);
+		}
+	};
+
+	// IDXGIKeyedMutex that answers AcquireSync with a given result.
+	class FakeDxgiKeyedMutex : public IDXGIKeyedMutex
+	{
+	public:
+		HRESULT AcquireResult = S_OK;
+		UINT64 LastKey = 0;
+		DWORD LastTimeout = INFINITE;
+		LONG RefCount = 1;
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppv) { return E_NOINTERFACE; }
+		ULONG STDMETHODCALLTYPE AddRef() { return ++this->RefCount; }
+		ULONG STDMETHODCALLTYPE Release() { return --this->RefCount; }
+		HRESULT STDMETHODCALLTYPE AcquireSync(UINT64 Key, DWORD dwMilliseconds)
+		{
+			this->LastKey = Key;
+			this->LastTimeout = dwMilliseconds;
+			return this->AcquireResult;
+		}
+		HRESULT STDMETHODCALLTYPE ReleaseSync(UINT64 Key)
+		{
+			this->LastKey = Key;
+			return S_OK;
+		}
+	};
+}
+
+TEST(FramesGoAroundTheRing)
+{
+	SharedFrameRing ring;
+	FakeKeyedMutex* pMutex = new FakeKeyedMutex();
+	ring.Attach(0, pMutex);
+
+	UINT64 sequence = 0;
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	CHECK(ring.IsWriting(0));
+	CHECK(!pMutex->ConsumerAcquire());	// Not handed over yet.
+	CHECK_EQUAL(S_OK, ring.EndWrite(0, &sequence));
+	CHECK_EQUAL(1u, sequence);
+	CHECK(!ring.IsWriting(0));
+
+	CHECK(pMutex->ConsumerAcquire());
+	pMutex->ConsumerRelease();
+
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	CHECK_EQUAL(S_OK, ring.EndWrite(0, &sequence));
+	CHECK_EQUAL(2u, sequence);
+	CHECK_EQUAL(0u, ring.GetBusyCount());
+}
+
+TEST(AFrameNeverReadIsTakenBack)
+{
+	SharedFrameRing ring;
+	FakeKeyedMutex* pMutex = new FakeKeyedMutex();
+	ring.Attach(0, pMutex);
+
+	UINT64 sequence = 0;
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	CHECK_EQUAL(S_OK, ring.EndWrite(0, &sequence));
+
+	// The consumer skipped it: the producer acquires it with the consumer's key and overwrites it.
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	CHECK_EQUAL(S_OK, ring.EndWrite(0, &sequence));
+	CHECK_EQUAL(2u, sequence);
+}
+
+TEST(ASlotTheConsumerIsReadingIsSkipped)
+{
+	SharedFrameRing ring;
+	FakeKeyedMutex* pMutex0 = new FakeKeyedMutex();
+	FakeKeyedMutex* pMutex1 = new FakeKeyedMutex();
+	ring.Attach(0, pMutex0);
+	ring.Attach(1, pMutex1);
+
+	UINT64 sequence = 0;
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	CHECK_EQUAL(S_OK, ring.EndWrite(0, &sequence));
+	CHECK(pMutex0->ConsumerAcquire());
+
+	// The producer does not wait for the consumer; it writes the other slot.
+	CHECK_EQUAL(S_FALSE, ring.BeginWrite(0));
+	CHECK(!ring.IsWriting(0));
+	CHECK_EQUAL(1u, ring.GetBusyCount());
+	CHECK_EQUAL(S_OK, ring.BeginWrite(1));
+	CHECK_EQUAL(S_OK, ring.EndWrite(1, &sequence));
+	CHECK_EQUAL(2u, sequence);
+
+	pMutex0->ConsumerRelease();
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+}
+
+TEST(AbortKeepsTheFrameReadable)
+{
+	SharedFrameRing ring;
+	FakeKeyedMutex* pMutex = new FakeKeyedMutex();
+	ring.Attach(0, pMutex);
+
+	UINT64 sequence = 0;
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	CHECK_EQUAL(S_OK, ring.EndWrite(0, &sequence));
+
+	// Taken back with the consumer's key, then not written after all: it goes back the same way.
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	ring.AbortWrite(0);
+	CHECK(!ring.IsWriting(0));
+	CHECK(pMutex->ConsumerAcquire());
+	pMutex->ConsumerRelease();
+
+	// A slot the consumer had given back stays the producer's.
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	ring.AbortWrite(0);
+	CHECK(!pMutex->ConsumerAcquire());
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+}
+
+TEST(BeginWriteTwiceIsOneWrite)
+{
+	SharedFrameRing ring;
+	FakeKeyedMutex* pMutex = new FakeKeyedMutex();
+	ring.Attach(0, pMutex);
+
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	UINT64 sequence = 0;
+	CHECK_EQUAL(S_OK, ring.EndWrite(0, &sequence));
+	CHECK_EQUAL(E_UNEXPECTED, ring.EndWrite(0, &sequence));
+	CHECK_EQUAL(1, pMutex->Releases);
+}
+
+TEST(InvalidSlotsAreRejected)
+{
+	SharedFrameRing ring;
+	UINT64 sequence = 0;
+	CHECK_EQUAL(E_INVALIDARG, ring.BeginWrite(SHARED_RING_MAX));
+	CHECK_EQUAL(E_UNEXPECTED, ring.BeginWrite(0));	// Nothing attached.
+	CHECK_EQUAL(E_UNEXPECTED, ring.EndWrite(0, &sequence));
+	CHECK_EQUAL(E_POINTER, ring.EndWrite(0, NULL));
+	CHECK(!ring.IsWriting(SHARED_RING_MAX));
+	ring.AbortWrite(SHARED_RING_MAX);
+}
+
+TEST(ClearGivesBackTheSlotsBeingWritten)
+{
+	BOOL bDeleted = FALSE;
+	BOOL bHeld = TRUE;
+	BOOL bReplaced = FALSE;
+	BOOL bOutOfRange = FALSE;
+	SharedFrameRing ring;
+
+	ring.Attach(0, new FakeKeyedMutex(&bReplaced));
+	FakeKeyedMutex* pMutex = new FakeKeyedMutex(&bDeleted, &bHeld);
+	ring.Attach(0, pMutex);
+	CHECK(bReplaced);
+	ring.Attach(SHARED_RING_MAX, new FakeKeyedMutex(&bOutOfRange));
+	CHECK(bOutOfRange);
+
+	// The consumer must not be left waiting on a slot that will never be written.
+	CHECK_EQUAL(S_OK, ring.BeginWrite(0));
+	CHECK(pMutex->Held);
+	ring.Clear();
+	CHECK(bDeleted);
+	CHECK(!bHeld);
+	CHECK_EQUAL(E_UNEXPECTED, ring.BeginWrite(0));
+}
+
+TEST(DxgiKeyedMutexNeverWaits)
+{
+	FakeDxgiKeyedMutex keyedMutex;
+	{
+		DxgiKeyedMutex mutex(&keyedMutex);
+		CHECK_EQUAL(2, keyedMutex.RefCount);
+
+		CHECK_EQUAL(S_OK, mutex.TryAcquire(SHARED_KEY_CONSUMER));
+		CHECK_EQUAL((UINT64)SHARED_KEY_CONSUMER, keyedMutex.LastKey);
+		CHECK_EQUAL(0u, keyedMutex.LastTimeout);
+
+		keyedMutex.AcquireResult = WAIT_TIMEOUT;
+		CHECK_EQUAL(S_FALSE, mutex.TryAcquire(SHARED_KEY_PRODUCER));
+		keyedMutex.AcquireResult = WAIT_ABANDONED;	// The consumer went away while holding it.
+		CHECK_EQUAL(S_OK, mutex.TryAcquire(SHARED_KEY_PRODUCER));
+		keyedMutex.AcquireResult = E_FAIL;
+		CHECK_EQUAL(E_FAIL, mutex.TryAcquire(SHARED_KEY_PRODUCER));
+
+		CHECK_EQUAL(S_OK, mutex.Release(SHARED_KEY_PRODUCER));
+		CHECK_EQUAL((UINT64)SHARED_KEY_PRODUCER, keyedMutex.LastKey);
+	}
+	CHECK_EQUAL(1, keyedMutex.RefCount);
+}
+
+TEST_MAIN()
@@ -0,0 +1,185 @@
+// Time from one source to the first frame of the next.
+//
+// A channel switch either tears the sink down and builds a new one, or, with TMS_KEEP_ALIVE, detaches it and attaches it
+// to the next topology. Both are played here the way the sink does them: the scheduler is stopped and started with the clock
+// of the next session, and the first frame waits for the objects of its pool entry (the video processor and the textures)
+// through WarmUpWork, which take SETUP_MILLISECONDS to create on a new sink and are already there on a kept one. The switch
+// time is measured by FirstFrameTimer, as StreamSink measures TMS_SWITCH_LATENCY, from the detach to the first frame presented.
+//
+// Prints the switch time of both ways.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	const int SWITCH_COUNT = 10;
+	const DWORD SETUP_MILLISECONDS = 50;	// The video processor and the textures of a new sink.
+	const LONGLONG FRAME_DURATION = 400000;	// 25 fps
+
+	struct Objects
+	{
+		volatile LONG Created;
+	};
+
+	// The presenter, as far as the first frame of a source needs it.
+	class FakeSetup : public WarmUpTarget
+	{
+	public:
+		volatile LONG Creations = 0;
+
+		HRESULT WarmUp(void* pItem)
+		{
+			Objects* pObjects = (Objects*)pItem;
+			if (pObjects->Created)
+				return S_OK;
+
+			::Sleep(SETUP_MILLISECONDS);
+			InterlockedIncrement(&this->Creations);
+			pObjects->Created = TRUE;
+			return S_OK;
+		}
+	};
+
+	// Measures the first frame presented after each switch, as StreamSink::PresentFrame does.
+	class SwitchCallback : public FakeSchedulerCallback
+	{
+	public:
+		HRESULT PresentFrame(IMFSample* pSample)
+		{
+			HRESULT hr = FakeSchedulerCallback::PresentFrame(pSample);
+
+			AutoLock lock(&this->_csTimer);
+			UINT64 latency;
+			if (this->_Timer.FramePresented(::MFGetSystemTime(), &latency))
+				this->_Latency = latency;
+			return hr;
+		}
+
+		void StartSwitch()
+		{
+			AutoLock lock(&this->_csTimer);
+			this->_Timer.Start(::MFGetSystemTime());
+			this->_Latency = 0;
+		}
+		// 0 while the first frame is awaited.
+		UINT64 GetLatency()
+		{
+			AutoLock lock(&this->_csTimer);
+			return this->_Latency;
+		}
+
+	private:
+		CriticalSection _csTimer;
+		FirstFrameTimer _Timer;
+		UINT64 _Latency = 0;
+	};
+
+	// The next source: a new session clock, and its first frame through the pool entry.
+	UINT64 Attach(Scheduler* pScheduler, SwitchCallback* pCallback, WarmUpWork* pWork, FakeSetup* pSetup, Objects* pObjects, FakeSample* pFirst)
+	{
+		FakeClock* pClock = new FakeClock();
+		pClock->SetRealTime(TRUE);
+		pScheduler->Start(pClock);
+		pClock->Release();
+
+		size_t presented = pCallback->GetPresented().size();
+		CHECK_EQUAL(S_OK, pWork->Ensure(pSetup, pObjects));
+		CHECK_EQUAL(S_OK, pScheduler->ScheduleSample(pFirst, FALSE));
+		CHECK(pCallback->WaitForRetired(presented + 1));
+
+		UINT64 latency = pCallback->GetLatency();
+		CHECK(0 < latency);
+		return latency;
+	}
+
+	double Milliseconds(UINT64 total)
+	{
+		return total / 10000.0 / SWITCH_COUNT;
+	}
+}
+
+TEST(KeptAliveSwitchSkipsTheSetup)
+{
+	FakeSample* pFirst = new FakeSample(0, FRAME_DURATION);
+	MFRatio fps = { 25, 1 };
+
+	// Torn down and built again: a new scheduler, a new presenter with nothing created.
+	UINT64 rebuilt = 0;
+	FakeSetup rebuiltSetup;
+	for (int i = 0; i < SWITCH_COUNT; i++)
+	{
+		SwitchCallback callback;
+		callback.StartSwitch();
+		{
+			Scheduler scheduler;
+			WarmUpWork work;
+			Objects objects = {};
+			scheduler.SetCallback(&callback);
+			scheduler.SetFrameRate(fps);
+			rebuilt += Attach(&scheduler, &callback, &work, &rebuiltSetup, &objects, pFirst);
+			scheduler.Stop();
+			work.Close();
+		}
+	}
+
+	// Kept alive: the same scheduler and pool entry, stopped at the detach and started again.
+	UINT64 kept = 0;
+	FakeSetup keptSetup;
+	{
+		SwitchCallback callback;
+		Scheduler scheduler;
+		WarmUpWork work;
+		Objects objects = {};
+		scheduler.SetCallback(&callback);
+		scheduler.SetFrameRate(fps);
+		CHECK_EQUAL(S_OK, work.Start(&keptSetup, &objects));	// The first source warmed it up.
+		work.Wait();
+
+		for (int i = 0; i < SWITCH_COUNT; i++)
+		{
+			scheduler.Stop();
+			callback.StartSwitch();
+			kept += Attach(&scheduler, &callback, &work, &keptSetup, &objects, pFirst);
+		}
+		scheduler.Stop();
+		work.Close();
+	}
+
+	printf("  %d switches: torn down and built again %.1f ms, kept alive %.1f ms to the first frame\n",
+		SWITCH_COUNT, Milliseconds(rebuilt), Milliseconds(kept));
+
+	CHECK_EQUAL(SWITCH_COUNT, rebuiltSetup.Creations);
+	CHECK_EQUAL(1, keptSetup.Creations);
+	CHECK(Milliseconds(rebuilt) >= SETUP_MILLISECONDS - 5);
+	CHECK(Milliseconds(kept) < SETUP_MILLISECONDS / 2);
+
+	pFirst->Release();
+}
+
+TEST(OnlyTheFirstFrameAfterTheSwitchIsMeasured)
+{
+	FirstFrameTimer timer;
+	UINT64 latency = 1;
+	CHECK(!timer.IsWaiting());
+	CHECK(!timer.FramePresented(100, &latency));
+	CHECK_EQUAL(0u, latency);
+
+	timer.Start(1000);
+	CHECK(timer.IsWaiting());
+	CHECK(timer.FramePresented(1500, &latency));
+	CHECK_EQUAL(500u, latency);
+	CHECK(!timer.FramePresented(2000, &latency));
+
+	// Switched again before the first frame: measured from the last switch.
+	timer.Start(3000);
+	timer.Start(4000);
+	CHECK(timer.FramePresented(4250, &latency));
+	CHECK_EQUAL(250u, latency);
+}
+
+TEST_MAIN()
@@ -0,0 +1,71 @@
+#pragma once
+
+// A minimal test harness: each test is a function registered with TEST, each executable runs all of its tests and fails if
+// any CHECK failed.
+
+#include <stdio.h>
+#include <vector>
+
+namespace TestHarness
+{
+	typedef void (*TestFunction)();
+
+	struct TestCase
+	{
+		const char* Name;
+		TestFunction Function;
+	};
+
+	inline std::vector<TestCase>& GetTests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	inline int& GetFailureCount()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	struct Registrar
+	{
+		Registrar(const char* name, TestFunction function)
+		{
+			TestCase test = { name, function };
+			GetTests().push_back(test);
+		}
+	};
+
+	inline void Fail(const char* file, int line, const char* expression)
+	{
+		fprintf(stderr, "%s(%d): CHECK failed: %s\n", file, line, expression);
+		GetFailureCount()++;
+	}
+
+	inline int RunAll()
+	{
+		for (size_t i = 0; i < GetTests().size(); i++)
+		{
+			int failuresBefore = GetFailureCount();
+			GetTests()[i].Function();
+			printf("%s %s\n", (GetFailureCount() == failuresBefore) ? "[  OK  ]" : "[FAILED]", GetTests()[i].Name);
+		}
+		printf("%d test(s), %d failure(s)\n", (int)GetTests().size(), GetFailureCount());
+		return (0 == GetFailureCount()) ? 0 : 1;
+	}
+}
+
+#define TEST(name) \
+	static void name(); \
+	static TestHarness::Registrar name##_registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) TestHarness::Fail(__FILE__, __LINE__, #expression); } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+	do { if (!((expected) == (actual))) TestHarness::Fail(__FILE__, __LINE__, #expected " == " #actual); } while (0)
+
+#define TEST_MAIN() \
+	int main() { return TestHarness::RunAll(); }
@@ -0,0 +1,126 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	const UINT64 MB = 1024 * 1024;
+}
+
+TEST(ReservationsAreAccountedPerStreamAndInTotal)
+{
+	TextureMemoryBudget budget(100 * MB);
+	DWORD stream1 = 0, stream2 = 0;
+	CHECK_EQUAL(S_OK, budget.RegisterStream(&stream1));
+	CHECK_EQUAL(S_OK, budget.RegisterStream(&stream2));
+	CHECK(stream1 != stream2);
+
+	CHECK_EQUAL(S_OK, budget.Reserve(stream1, 30 * MB));
+	CHECK_EQUAL(S_OK, budget.Reserve(stream2, 20 * MB));
+	budget.Release(stream1, 10 * MB);
+	CHECK_EQUAL(40 * MB, budget.GetTotalBytes());
+
+	UINT64 current = 0, peak = 0;
+	CHECK_EQUAL(S_OK, budget.GetStreamBytes(stream1, &current, &peak));
+	CHECK_EQUAL(20 * MB, current);
+	CHECK_EQUAL(30 * MB, peak);
+
+	// Never release more than the stream holds.
+	budget.Release(stream2, 50 * MB);
+	CHECK_EQUAL(S_OK, budget.GetStreamBytes(stream2, &current, NULL));
+	CHECK_EQUAL(0u, current);
+	CHECK_EQUAL(20 * MB, budget.GetTotalBytes());
+}
+
+TEST(UnregisteringAStreamGivesBackWhatItHolds)
+{
+	TextureMemoryBudget budget(100 * MB);
+	DWORD streams[4];
+	for (int i = 0; i < 4; i++)
+	{
+		budget.RegisterStream(&streams[i]);
+		budget.Reserve(streams[i], (i + 1) * MB);
+	}
+	CHECK_EQUAL(10 * MB, budget.GetTotalBytes());
+
+	budget.UnregisterStream(streams[1]);
+	CHECK_EQUAL(8 * MB, budget.GetTotalBytes());
+	CHECK_EQUAL(MF_E_NOT_FOUND, budget.GetStreamBytes(streams[1], NULL, NULL));
+	CHECK_EQUAL(MF_E_NOT_FOUND, budget.Reserve(streams[1], MB));
+
+	// The others are untouched.
+	UINT64 current = 0;
+	CHECK_EQUAL(S_OK, budget.GetStreamBytes(streams[3], &current, NULL));
+	CHECK_EQUAL(4 * MB, current);
+
+	// Unknown ids are ignored.
+	budget.UnregisterStream(12345);
+	CHECK_EQUAL(8 * MB, budget.GetTotalBytes());
+}
+
+TEST(ReservationOverTheBudgetIsGrantedWithSFalse)
+{
+	TextureMemoryBudget budget(10 * MB);
+	DWORD stream = 0;
+	budget.RegisterStream(&stream);
+
+	CHECK_EQUAL(S_OK, budget.Reserve(stream, 10 * MB));
+	CHECK(!budget.IsOverBudget());
+	CHECK_EQUAL(S_FALSE, budget.Reserve(stream, 1));
+	CHECK(budget.IsOverBudget());
+	CHECK_EQUAL(10 * MB + 1, budget.GetTotalBytes());
+
+	// A larger budget brings it back under.
+	budget.SetBudget(20 * MB);
+	CHECK(!budget.IsOverBudget());
+}
+
+TEST(RefuseNewStreamsPolicy)
+{
+	TextureMemoryBudget budget(10 * MB);
+	CHECK_EQUAL(E_INVALIDARG, budget.SetPolicy(99));
+	CHECK_EQUAL(S_OK, budget.SetPolicy(TMS_MEMORY_POLICY_REFUSE_NEW_STREAMS));
+
+	DWORD stream = 0, refused = 0;
+	budget.RegisterStream(&stream);
+	budget.Reserve(stream, 11 * MB);
+	CHECK_EQUAL(E_OUTOFMEMORY, budget.RegisterStream(&refused));
+
+	// Once back under the budget, new streams are accepted again.
+	budget.Release(stream, 2 * MB);
+	CHECK_EQUAL(S_OK, budget.RegisterStream(&refused));
+
+	// Other policies never refuse.
+	budget.SetPolicy(TMS_MEMORY_POLICY_SHRINK_POOLS);
+	budget.Reserve(stream, 100 * MB);
+	CHECK_EQUAL(S_OK, budget.RegisterStream(&refused));
+}
+
+TEST(OutputDivisorUnderLowerOutputSizePolicy)
+{
+	TextureMemoryBudget budget(100 * MB);
+	DWORD stream = 0;
+	budget.RegisterStream(&stream);
+	budget.Reserve(stream, 90 * MB);
+
+	// Only under TMS_MEMORY_POLICY_LOWER_OUTPUT_SIZE.
+	CHECK_EQUAL(1u, budget.GetOutputDivisor(40 * MB));
+
+	budget.SetPolicy(TMS_MEMORY_POLICY_LOWER_OUTPUT_SIZE);
+	CHECK_EQUAL(1u, budget.GetOutputDivisor(10 * MB));		// Fits.
+	CHECK_EQUAL(2u, budget.GetOutputDivisor(40 * MB));		// 10 MB at half the size.
+	CHECK_EQUAL(4u, budget.GetOutputDivisor(100 * MB));	// 6.25 MB at a quarter.
+	CHECK_EQUAL((UINT32)TEXTURE_MEMORY_OUTPUT_DIVISOR_MAX, budget.GetOutputDivisor(10000 * MB));	// Never smaller than 1/8.
+}
+
+TEST(OutputFrameBytes)
+{
+	CHECK_EQUAL(1920ull * 1080 * 4, GetOutputFrameBytes(DXGI_FORMAT_B8G8R8A8_UNORM, 1920, 1080));
+	CHECK_EQUAL(1920ull * 1080 * 4, GetOutputFrameBytes(DXGI_FORMAT_R10G10B10A2_UNORM, 1920, 1080));
+	CHECK_EQUAL(1920ull * 1080 * 3 / 2, GetOutputFrameBytes(DXGI_FORMAT_NV12, 1920, 1080));
+	CHECK_EQUAL(1920ull * 1080 * 3, GetOutputFrameBytes(DXGI_FORMAT_P010, 1920, 1080));
+	CHECK_EQUAL(64ull * 4, GetOutputFrameBytes(DXGI_FORMAT_R8G8B8A8_UNORM, 8, 8));	// Unknown: 32 bits per pixel.
+}
+
+TEST_MAIN()
@@ -0,0 +1,204 @@
+#include "stdafx.h"
+#include "TestHarness.h"
+
+#include <vector>
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	const LONGLONG FRAME = 400000;	// 100ns units, at 25 fps.
+
+	// Matches the frame against the requests as Presenter::ProcessThumbnail does, until it serves no more. Returns the count served.
+	UINT Serve(ThumbnailAtlas* pAtlas, LONGLONG hnsSampleTime, LONGLONG hnsDuration, std::vector<TMS_THUMBNAIL>* pServed)
+	{
+		UINT count = 0;
+		TMS_THUMBNAIL thumbnail;
+		while (pAtlas->Match(hnsSampleTime, hnsDuration, &thumbnail))
+		{
+			pServed->push_back(thumbnail);
+			count++;
+		}
+		return count;
+	}
+}
+
+TEST(LayoutFitsTheCellsInTheAtlas)
+{
+	ThumbnailAtlas atlas;
+	UINT32 width, height;
+
+	CHECK(!atlas.IsEnabled());
+	atlas.GetAtlasSize(&width, &height);
+	CHECK_EQUAL(0u, width);
+	CHECK_EQUAL(0u, height);
+
+	CHECK_EQUAL(S_OK, atlas.SetLayout(160, 90, 16384));
+	CHECK(atlas.IsEnabled());
+	atlas.GetAtlasSize(&width, &height);
+	CHECK_EQUAL(160u * THUMBNAIL_ATLAS_COLUMNS, width);
+	CHECK_EQUAL(90u * THUMBNAIL_ATLAS_ROWS, height);
+
+	// A small texture limit takes fewer cells.
+	CHECK_EQUAL(S_OK, atlas.SetLayout(160, 90, 500));
+	atlas.GetAtlasSize(&width, &height);
+	CHECK_EQUAL(480u, width);
+	CHECK_EQUAL(450u, height);
+
+	CHECK_EQUAL(E_INVALIDARG, atlas.SetLayout(160, 0, 16384));
+	CHECK_EQUAL(E_INVALIDARG, atlas.SetLayout(1000, 90, 500));
+	CHECK_EQUAL(S_OK, atlas.SetLayout(0, 0, 16384));
+	CHECK(!atlas.IsEnabled());
+}
+
+TEST(RequestsAreServedInAscendingOrder)
+{
+	ThumbnailAtlas atlas;
+	CHECK_EQUAL(S_OK, atlas.SetLayout(160, 90, 16384));
+	LONGLONG times[] = { 5 * FRAME, FRAME, 3 * FRAME };
+	CHECK_EQUAL(S_OK, atlas.SetRequests(times, 3));
+	CHECK_EQUAL(3u, atlas.GetPendingCount());
+
+	std::vector<TMS_THUMBNAIL> served;
+	for (int n = 0; n < 8; n++)
+		Serve(&atlas, n * FRAME, FRAME, &served);
+
+	CHECK_EQUAL(3u, served.size());
+	for (size_t i = 0; i < served.size(); i++)
+	{
+		CHECK_EQUAL((LONGLONG)(2 * i + 1) * FRAME, served[i].RequestTime);
+		CHECK_EQUAL(served[i].RequestTime, served[i].SampleTime);
+		CHECK_EQUAL((UINT32)(160 * i), served[i].X);
+		CHECK_EQUAL(0u, served[i].Y);
+	}
+	CHECK_EQUAL(0u, atlas.GetPendingCount());
+	CHECK_EQUAL(0u, atlas.GetMissedCount());
+
+	CHECK_EQUAL(E_POINTER, atlas.SetRequests(NULL, 1));
+	CHECK_EQUAL(E_INVALIDARG, atlas.SetRequests(times, TMS_THUMBNAIL_REQUEST_MAX + 1));
+}
+
+TEST(FrameServesEveryRequestItCovers)
+{
+	ThumbnailAtlas atlas;
+	CHECK_EQUAL(S_OK, atlas.SetLayout(160, 90, 16384));
+
+	// Requests closer together than a frame.
+	LONGLONG times[] = { FRAME, FRAME + FRAME / 4, FRAME + FRAME / 2, 2 * FRAME };
+	CHECK_EQUAL(S_OK, atlas.SetRequests(times, 4));
+
+	std::vector<TMS_THUMBNAIL> served;
+	CHECK_EQUAL(0u, Serve(&atlas, 0, FRAME, &served));
+	CHECK_EQUAL(3u, Serve(&atlas, FRAME, FRAME, &served));
+	CHECK_EQUAL(1u, Serve(&atlas, 2 * FRAME, FRAME, &served));
+
+	for (size_t i = 0; i < served.size(); i++)
+		CHECK_EQUAL(times[i], served[i].RequestTime);
+	CHECK_EQUAL(FRAME, served[2].SampleTime);
+	CHECK_EQUAL(2 * FRAME, served[3].SampleTime);
+	CHECK(atlas.IsBatchReady());
+}
+
+TEST(RequestsPassedByTheFrameAreMissed)
+{
+	ThumbnailAtlas atlas;
+	CHECK_EQUAL(S_OK, atlas.SetLayout(160, 90, 16384));
+	LONGLONG times[] = { 0, FRAME, 2 * FRAME + FRAME / 2, 10 * FRAME, 20 * FRAME };
+	CHECK_EQUAL(S_OK, atlas.SetRequests(times, 5));
+
+	// A sparse decode after a seek: the first frame starts past three requests, and serves none of them.
+	std::vector<TMS_THUMBNAIL> served;
+	CHECK_EQUAL(0u, Serve(&atlas, 3 * FRAME, FRAME, &served));
+	CHECK_EQUAL(3u, atlas.GetMissedCount());
+	CHECK_EQUAL(2u, atlas.GetPendingCount());
+
+	CHECK_EQUAL(1u, Serve(&atlas, 10 * FRAME, FRAME, &served));
+	CHECK_EQUAL(10 * FRAME, served[0].RequestTime);
+	CHECK(!atlas.IsBatchReady());
+
+	// The last request is passed too: the batch is ready with what it has.
+	CHECK_EQUAL(0u, Serve(&atlas, 21 * FRAME, FRAME, &served));
+	CHECK_EQUAL(4u, atlas.GetMissedCount());
+	CHECK_EQUAL(0u, atlas.GetPendingCount());
+	CHECK(atlas.IsBatchReady());
+
+	// New requests start the count over.
+	CHECK_EQUAL(S_OK, atlas.SetRequests(times, 1));
+	CHECK_EQUAL(0u, atlas.GetMissedCount());
+}
+
+TEST(FrameWithoutDurationServesOnlyItsOwnTime)
+{
+	ThumbnailAtlas atlas;
+	CHECK_EQUAL(S_OK, atlas.SetLayout(160, 90, 16384));
+	LONGLONG times[] = { FRAME, FRAME + 1 };
+	CHECK_EQUAL(S_OK, atlas.SetRequests(times, 2));
+
+	std::vector<TMS_THUMBNAIL> served;
+	CHECK_EQUAL(1u, Serve(&atlas, FRAME, 0, &served));
+	CHECK_EQUAL(0u, Serve(&atlas, 2 * FRAME, 0, &served));
+	CHECK_EQUAL(1u, atlas.GetMissedCount());
+}
+
+TEST(FullCellsWaitForTheBatchToBeTaken)
+{
+	ThumbnailAtlas atlas;
+	CHECK_EQUAL(S_OK, atlas.SetLayout(100, 100, 200));	// 2 x 2 cells.
+	LONGLONG times[6];
+	for (int i = 0; i < 6; i++)
+		times[i] = i * FRAME;
+	CHECK_EQUAL(S_OK, atlas.SetRequests(times, 6));
+
+	std::vector<TMS_THUMBNAIL> served;
+	for (int n = 0; n < 4; n++)
+		CHECK_EQUAL(1u, Serve(&atlas, n * FRAME, FRAME, &served));
+	CHECK(atlas.IsBatchReady());
+	CHECK_EQUAL(100u, served[3].X);
+	CHECK_EQUAL(100u, served[3].Y);
+
+	// No free cell: the next frame waits, and is not counted as passing its request.
+	CHECK_EQUAL(0u, Serve(&atlas, 4 * FRAME, FRAME, &served));
+	CHECK_EQUAL(0u, atlas.GetMissedCount());
+
+	TMS_THUMBNAIL batch[THUMBNAIL_ATLAS_CELLS];
+	CHECK_EQUAL(4u, atlas.TakeBatch(batch));
+	CHECK_EQUAL(3 * FRAME, batch[3].RequestTime);
+	CHECK(!atlas.IsBatchReady());
+
+	CHECK_EQUAL(1u, Serve(&atlas, 4 * FRAME, FRAME, &served));
+	CHECK_EQUAL(0u, served[4].X);	// The cells start over.
+	CHECK_EQUAL(1u, Serve(&atlas, 5 * FRAME, FRAME, &served));
+	CHECK(atlas.IsBatchReady());
+	CHECK_EQUAL(2u, atlas.TakeBatch(batch));
+}
+
+TEST(FrameIsLetterboxedInItsCell)
+{
+	TMS_THUMBNAIL cell = {};
+	cell.X = 160;
+	cell.Y = 90;
+	cell.Width = 160;
+	cell.Height = 90;
+	RECT rect;
+
+	// 4:3 in 16:9: bars on the sides.
+	ThumbnailAtlas::FitFrame(640, 480, cell, &rect);
+	CHECK_EQUAL(180, rect.left);
+	CHECK_EQUAL(90, rect.top);
+	CHECK_EQUAL(300, rect.right);
+	CHECK_EQUAL(180, rect.bottom);
+
+	// 2.39:1: bars above and below.
+	ThumbnailAtlas::FitFrame(1920, 804, cell, &rect);
+	CHECK_EQUAL(160, rect.left);
+	CHECK_EQUAL(320, rect.right);
+	CHECK_EQUAL(67, rect.bottom - rect.top);
+	CHECK_EQUAL(101, rect.top);
+
+	// Unknown size: the whole cell.
+	ThumbnailAtlas::FitFrame(0, 0, cell, &rect);
+	CHECK_EQUAL(160, rect.left);
+	CHECK_EQUAL(180, rect.bottom);
+}
+
+TEST_MAIN()
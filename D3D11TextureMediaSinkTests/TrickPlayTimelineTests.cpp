@@ -0,0 +1,196 @@
+// Synthetic timelines at playback rates from -8x to 16x: which frames the stream sink processes, which ones it finds late,
+// and the order in which the scheduler presents them.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+#include <algorithm>
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	const float RATES[] = { -8.0f, -4.0f, -2.0f, -1.0f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f };
+	const MFRatio FPS = { 30, 1 };
+	const LONGLONG FRAME = 333333;	// 100ns units, at 30 fps.
+	const int FRAMES = 96;
+
+	// Media time of the n-th frame in the direction of playback.
+	LONGLONG TimeOf(float rate, int n)
+	{
+		return (0.0f < rate) ? n * FRAME : (FRAMES - 1 - n) * FRAME;
+	}
+
+	// Orders an integer sequence; the queued item is an IUnknown whose place in the test's array is its value.
+	class ValueOrder : public QueueOrder<IUnknown>
+	{
+	public:
+		ValueOrder(const std::vector<FakeUnknown*>* pItems, int value) : _Items(pItems), _Value(value) {}
+		BOOL IsBefore(IUnknown* pQueued)
+		{
+			int queued = (int)(std::find(this->_Items->begin(), this->_Items->end(), pQueued) - this->_Items->begin());
+			return this->_Value < queued;
+		}
+
+	private:
+		const std::vector<FakeUnknown*>* _Items;
+		int _Value;
+	};
+}
+
+TEST(ThinningProcessesOneFrameForEveryRateFrames)
+{
+	for (size_t r = 0; r < _countof(RATES); r++)
+	{
+		float rate = RATES[r];
+		TrickPlayPolicy policy;
+		CHECK_EQUAL(S_OK, policy.SetFrameRate(FPS));
+		policy.SetRate(rate);
+
+		std::vector<LONGLONG> processed;
+		for (int n = 0; n < FRAMES; n++)
+		{
+			if (policy.ShouldProcess(TimeOf(rate, n)))
+				processed.push_back(TimeOf(rate, n));
+		}
+
+		int absRate = (int)::fabsf(rate);
+		int expected = (::fabsf(rate) > TRICKPLAY_THINNING_RATE) ? (FRAMES + absRate - 1) / absRate : FRAMES;
+		printf("  %5.1fx: %d of %d frames processed\n", rate, (int)processed.size(), FRAMES);
+		CHECK_EQUAL(expected, (int)processed.size());
+		CHECK_EQUAL((UINT64)(FRAMES - expected), policy.GetThinnedCount());
+		CHECK_EQUAL(::fabsf(rate) > TRICKPLAY_THINNING_RATE, !!policy.IsThinning());
+		CHECK_EQUAL(rate < 0.0f, !!policy.IsReverse());
+
+		// The frames processed are evenly spaced, in the direction of playback.
+		for (size_t i = 1; i < processed.size(); i++)
+		{
+			LONGLONG step = (0.0f < rate) ? processed[i] - processed[i - 1] : processed[i - 1] - processed[i];
+			CHECK_EQUAL((expected == FRAMES) ? FRAME : absRate * FRAME, step);
+		}
+	}
+}
+
+TEST(LatenessFollowsTheDirectionOfPlayback)
+{
+	for (size_t r = 0; r < _countof(RATES); r++)
+	{
+		float rate = RATES[r];
+		TrickPlayPolicy policy;
+		policy.SetRate(rate);
+
+		// The clock is at the 10th frame of the timeline; the frames before it in playback are late, the ones after it are not.
+		LONGLONG clockTime = TimeOf(rate, 10);
+		CHECK(policy.IsLate(TimeOf(rate, 9), clockTime));
+		CHECK(!policy.IsLate(TimeOf(rate, 10), clockTime));
+		CHECK(!policy.IsLate(TimeOf(rate, 11), clockTime));
+		CHECK(policy.IsBefore(TimeOf(rate, 3), TimeOf(rate, 4)));
+		CHECK(!policy.IsBefore(TimeOf(rate, 4), TimeOf(rate, 3)));
+	}
+}
+
+TEST(SchedulerPresentsInPlaybackOrderWhateverTheArrivalOrder)
+{
+	for (size_t r = 0; r < _countof(RATES); r++)
+	{
+		float rate = RATES[r];
+		Scheduler scheduler;
+		FakeSchedulerCallback callback;
+		FakeClock* pClock = new FakeClock();
+		scheduler.SetCallback(&callback);
+		scheduler.SetFrameRate(FPS);
+		scheduler.SetClockRate(rate);
+
+		// The clock stands a frame before the timeline, so nothing is due while the samples arrive.
+		pClock->SetTime((0.0f < rate) ? -FRAME : FRAMES * FRAME);
+		scheduler.Start(pClock);
+
+		// The decoder outputs each group of 8 frames in media time order, whatever the direction; the groups come in playback order.
+		std::vector<FakeSample*> samples;
+		for (int group = 0; group < FRAMES / 8; group++)
+		{
+			for (int i = 0; i < 8; i++)
+			{
+				int n = (0.0f < rate) ? group * 8 + i : group * 8 + 7 - i;
+				FakeSample* pSample = new FakeSample(TimeOf(rate, n), FRAME);
+				samples.push_back(pSample);
+				CHECK_EQUAL(S_OK, scheduler.ScheduleSample(pSample, FALSE));
+			}
+		}
+
+		// Then the clock runs past the whole timeline, and the queue is presented at once.
+		pClock->SetTime((0.0f < rate) ? (FRAMES + 1) * FRAME : -2 * FRAME);
+		FakeSample* pLast = new FakeSample(TimeOf(rate, FRAMES), FRAME);
+		samples.push_back(pLast);
+		CHECK_EQUAL(S_OK, scheduler.ScheduleSample(pLast, FALSE));
+		CHECK(callback.WaitForRetired(samples.size()));
+		scheduler.Stop();
+
+		std::vector<FakeSample*> presented = callback.GetPresented();
+		CHECK_EQUAL(samples.size(), presented.size());
+		int outOfOrder = 0;
+		for (size_t i = 1; i < presented.size(); i++)
+		{
+			LONGLONG previous = 0, current = 0;
+			presented[i - 1]->GetSampleTime(&previous);
+			presented[i]->GetSampleTime(&current);
+			if ((0.0f < rate) ? (current <= previous) : (current >= previous))
+				outOfOrder++;
+		}
+		printf("  %5.1fx: %d presented, %d out of order\n", rate, (int)presented.size(), outOfOrder);
+		CHECK_EQUAL(0, outOfOrder);
+
+		for (size_t i = 0; i < samples.size(); i++)
+			samples[i]->Release();
+		pClock->Release();
+	}
+}
+
+TEST(InsertOrderedStopsAtTheFirstItemItDoesNotGoBefore)
+{
+	ThreadSafeComPtrQueue<IUnknown> queue;
+	std::vector<FakeUnknown*> items;
+	for (int i = 0; i < 6; i++)
+		items.push_back(new FakeUnknown());
+
+	// Each one walks from the back past the larger ones.
+	int arrivals[] = { 1, 3, 5, 4, 0, 2 };
+	for (int i = 0; i < 6; i++)
+	{
+		ValueOrder order(&items, arrivals[i]);
+		CHECK_EQUAL(S_OK, queue.InsertOrdered(items[arrivals[i]], &order));
+	}
+
+	CHECK_EQUAL(6u, queue.GetCount());
+	for (int i = 0; i < 6; i++)
+	{
+		IUnknown* pItem = NULL;
+		CHECK_EQUAL(S_OK, queue.Dequeue(&pItem));
+		CHECK(items[i] == pItem);
+		SafeRelease(pItem);
+	}
+
+	// The walk stops at the first item it does not go before, even if there are larger ones in front of it.
+	int stops[] = { 5, 1, 3 };
+	CHECK_EQUAL(S_OK, queue.Queue(items[5]));
+	CHECK_EQUAL(S_OK, queue.Queue(items[1]));
+	ValueOrder order(&items, 3);
+	CHECK_EQUAL(S_OK, queue.InsertOrdered(items[3], &order));
+	for (int i = 0; i < 3; i++)
+	{
+		IUnknown* pItem = NULL;
+		CHECK_EQUAL(S_OK, queue.Dequeue(&pItem));
+		CHECK(items[stops[i]] == pItem);
+		SafeRelease(pItem);
+	}
+
+	for (int i = 0; i < 6; i++)
+	{
+		CHECK_EQUAL(1, items[i]->GetRefCount());
+		items[i]->Release();
+	}
+}
+
+TEST_MAIN()
@@ -0,0 +1,144 @@
+// The first frame and the objects the warm-up creates for it.
+//
+// A target stands in for the presenter: creating the object of an item (the video processor of a pool entry) takes
+// CREATE_MILLISECONDS. The media type is set, the warm-up starts, and the first frame comes some time later and asks for the
+// object the way ProcessFrameUsingD3D11 does. The time it waits is printed, next to what it waits without the warm-up.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+
+using namespace D3D11TextureMediaSink;
+
+namespace
+{
+	const DWORD CREATE_MILLISECONDS = 100;
+	const LONGLONG NO_WAIT = 20 * 10000;	// 100ns units; scheduling noise, not a creation.
+
+	struct Item
+	{
+		volatile LONG Created;
+	};
+
+	class FakeTarget : public WarmUpTarget
+	{
+	public:
+		volatile LONG Creations = 0;
+		volatile LONG Failures = 0;	// The next creations that fail.
+
+		HRESULT WarmUp(void* pItem)
+		{
+			Item* pObject = (Item*)pItem;
+			if (pObject->Created)
+				return S_OK;
+
+			::Sleep(CREATE_MILLISECONDS);
+			InterlockedIncrement(&this->Creations);
+			if (0 < this->Failures)
+			{
+				InterlockedDecrement(&this->Failures);
+				return E_OUTOFMEMORY;
+			}
+
+			pObject->Created = TRUE;
+			return S_OK;
+		}
+	};
+}
+
+TEST(WarmedUpFirstFrameDoesNotWait)
+{
+	WarmUpWork work;
+	FakeTarget target;
+	Item item = {};
+
+	CHECK_EQUAL(S_OK, work.Start(&target, &item));
+	::Sleep(2 * CREATE_MILLISECONDS);	// The media type comes before the first sample.
+
+	LONGLONG hnsWait = 0;
+	CHECK_EQUAL(S_OK, work.Ensure(&target, &item, &hnsWait));
+	printf("  warmed up: the first frame waited %.1f ms\n", hnsWait / 10000.0);
+	CHECK(hnsWait < NO_WAIT);
+	CHECK_EQUAL(1, target.Creations);
+}
+
+TEST(ColdFirstFramePaysTheCreation)
+{
+	WarmUpWork work;
+	FakeTarget target;
+	Item item = {};
+
+	LONGLONG hnsWait = 0;
+	CHECK_EQUAL(S_OK, work.Ensure(&target, &item, &hnsWait));
+	printf("  cold: the first frame waited %.1f ms\n", hnsWait / 10000.0);
+	CHECK(hnsWait >= (CREATE_MILLISECONDS - 5) * 10000);
+	CHECK_EQUAL(1, target.Creations);
+}
+
+TEST(EarlyFirstFrameWaitsForTheWarmUpInsteadOfCreatingAgain)
+{
+	WarmUpWork work;
+	FakeTarget target;
+	Item item = {};
+
+	CHECK_EQUAL(S_OK, work.Start(&target, &item));
+	::Sleep(CREATE_MILLISECONDS / 4);	// The warm-up has started creating it.
+
+	LONGLONG hnsWait = 0;
+	CHECK_EQUAL(S_OK, work.Ensure(&target, &item, &hnsWait));
+	printf("  early: the first frame waited %.1f ms for what was left\n", hnsWait / 10000.0);
+	CHECK(item.Created);
+	CHECK_EQUAL(1, target.Creations);
+}
+
+TEST(FailedWarmUpIsLeftToTheFirstFrame)
+{
+	WarmUpWork work;
+	FakeTarget target;
+	Item item = {};
+	target.Failures = 1;
+
+	CHECK_EQUAL(S_OK, work.Start(&target, &item));
+	work.Wait();
+	CHECK(!item.Created);
+
+	// The first frame tries again, and reports what it gets.
+	CHECK_EQUAL(S_OK, work.Ensure(&target, &item));
+	CHECK_EQUAL(2, target.Creations);
+
+	Item other = {};
+	target.Failures = 1;
+	CHECK_EQUAL(E_OUTOFMEMORY, work.Ensure(&target, &other));
+}
+
+TEST(StartWaitsForTheWorkInProgress)
+{
+	WarmUpWork work;
+	FakeTarget target;
+	Item first = {};
+	Item second = {};
+
+	// A new media type while the previous one warms up: both are created, one after the other.
+	CHECK_EQUAL(S_OK, work.Start(&target, &first));
+	CHECK_EQUAL(S_OK, work.Start(&target, &second));
+	CHECK(first.Created);
+	work.Wait();
+	CHECK(second.Created);
+
+	// Already warm: nothing to do.
+	CHECK_EQUAL(S_OK, work.Start(&target, &second));
+	work.Close();
+	CHECK_EQUAL(2, target.Creations);
+}
+
+TEST(InvalidCallsAreRejected)
+{
+	WarmUpWork work;
+	Item item = {};
+	CHECK_EQUAL(E_POINTER, work.Start(NULL, &item));
+	CHECK_EQUAL(E_POINTER, work.Ensure(NULL, &item));
+	work.Wait();	// Nothing started.
+	work.Close();
+	work.Close();
+}
+
+TEST_MAIN()
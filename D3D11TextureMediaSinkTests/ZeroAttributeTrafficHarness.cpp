@@ -0,0 +1,167 @@
+// Calls on the attribute store of the pooled samples per frame.
+//
+// The frames go around a pool of samples as they do in the sink: the allocator hands one out (UPDATING), the processing
+// copies the times to it and describes it with FrameDescription, the scheduler queues it and presents it at its time, and it
+// is handed out again once presented. The state, the epoch, the order and the description all live in the FrameDescriptor
+// of the sample, so once every sample of the pool has been described, a frame makes no call on any attribute store.
+//
+// Prints the calls of the first lap of the pool and of the steady state. The run fails on any call in the steady state.
+
+#include "stdafx.h"
+#include "TestHarness.h"
+#include "Fakes.h"
+
+using namespace D3D11TextureMediaSink;
+using namespace Fakes;
+
+namespace
+{
+	const int POOL_SIZE = 4;
+	const int FRAME_COUNT = 200;
+	const LONGLONG FRAME_DURATION = 40000;	// 250 fps, to keep the run short.
+
+	struct Playback
+	{
+		Scheduler TheScheduler;
+		FakeSchedulerCallback Callback;
+		FakeClock* Clock;
+		FakeSample* Pool[POOL_SIZE];
+		LONG Scheduled[POOL_SIZE];
+		int NextFrame;
+
+		Playback()
+		{
+			this->Clock = new FakeClock();
+			this->Clock->SetRealTime(TRUE);
+			this->TheScheduler.SetCallback(&this->Callback);
+			MFRatio fps = { 250, 1 };
+			this->TheScheduler.SetFrameRate(fps);
+			for (int i = 0; i < POOL_SIZE; i++)
+			{
+				this->Pool[i] = new FakeSample();
+				this->Pool[i]->Descriptor.State = SAMPLE_STATE_READY;
+				this->Scheduled[i] = 0;
+			}
+			this->NextFrame = 0;
+			this->TheScheduler.Start(this->Clock);
+		}
+		~Playback()
+		{
+			this->TheScheduler.Stop();
+			for (int i = 0; i < POOL_SIZE; i++)
+				this->Pool[i]->Release();
+			this->Clock->Release();
+		}
+
+		LONG GetAttributeCalls()
+		{
+			LONG calls = 0;
+			for (int i = 0; i < POOL_SIZE; i++)
+				calls += this->Pool[i]->AttributeCalls;
+			return calls;
+		}
+	};
+
+	TMS_FRAME_DESCRIPTOR Color(UINT32 yuvMatrix)
+	{
+		TMS_FRAME_DESCRIPTOR color = {};
+		color.YuvMatrix = yuvMatrix;
+		color.NominalRange = MFNominalRange_16_235;
+		color.ChromaSiting = 6;		// MFVideoChromaSubsampling_MPEG2
+		color.Primaries = 2;		// MFVideoPrimaries_BT709
+		color.TransferFunction = 5;	// MFVideoTransFunc_709
+		return color;
+	}
+
+	// Plays count frames of the given colour. Each waits for the sample it reuses to come back, as SampleAllocator::GetSample does.
+	void Play(Playback* pPlayback, int count, const TMS_FRAME_DESCRIPTOR& color)
+	{
+		for (int frame = 0; frame < count; frame++)
+		{
+			int index = pPlayback->NextFrame % POOL_SIZE;
+			FakeSample* pSample = pPlayback->Pool[index];
+			while (pSample->PresentCount + pSample->DiscardCount != pPlayback->Scheduled[index])
+				::Sleep(1);
+
+			// SampleAllocator::GetSample, then the processing.
+			pSample->Descriptor.State = SAMPLE_STATE_UPDATING;
+			pSample->SetSampleTime(pPlayback->NextFrame * FRAME_DURATION);
+			pSample->SetSampleDuration(FRAME_DURATION);
+			FrameDescription::SetColor(pSample, &pSample->Descriptor, color);
+			FrameDescription::SetTimes(pSample, &pSample->Descriptor, pPlayback->NextFrame, 0);
+
+			pPlayback->Scheduled[index]++;
+			pPlayback->NextFrame++;
+			CHECK_EQUAL(S_OK, pPlayback->TheScheduler.ScheduleSample(pSample, FALSE));
+		}
+		CHECK(pPlayback->Callback.WaitForRetired(pPlayback->NextFrame));
+	}
+}
+
+TEST(SteadyStateMakesNoAttributeCalls)
+{
+	Playback playback;
+
+	Play(&playback, POOL_SIZE, Color(1));
+	LONG firstLap = playback.GetAttributeCalls();
+
+	Play(&playback, FRAME_COUNT, Color(1));
+	LONG steady = playback.GetAttributeCalls() - firstLap;
+
+	printf("  first lap of %d samples: %ld attribute calls; next %d frames: %ld attribute calls (%zu presented)\n",
+		POOL_SIZE, (long)firstLap, FRAME_COUNT, (long)steady, playback.Callback.GetPresented().size());
+
+	CHECK_EQUAL(POOL_SIZE * 5, firstLap);	// The five colour attributes, once per sample.
+	CHECK_EQUAL(0, steady);
+}
+
+TEST(ColorChangeIsWrittenOncePerSample)
+{
+	Playback playback;
+	Play(&playback, POOL_SIZE, Color(1));
+	LONG before = playback.GetAttributeCalls();
+
+	// The media type changes the matrix: one attribute, once on each sample, then nothing again.
+	Play(&playback, FRAME_COUNT / 2, Color(2));
+	CHECK_EQUAL(POOL_SIZE, playback.GetAttributeCalls() - before);
+
+	FakeSample* pSample = playback.Pool[0];
+	UINT32 matrix = 0;
+	CHECK_EQUAL(S_OK, pSample->GetUINT32(MF_MT_YUV_MATRIX, &matrix));
+	CHECK_EQUAL(2u, matrix);
+	CHECK_EQUAL(2u, pSample->Descriptor.Frame.YuvMatrix);
+}
+
+TEST(UnknownColorIsRemovedFromTheSample)
+{
+	FakeSample* pSample = new FakeSample(400000, FRAME_DURATION);
+	FrameDescriptor* pDescriptor = &pSample->Descriptor;
+	FrameDescription::SetColor(pSample, pDescriptor, Color(1));
+
+	// An RGB output has no matrix and no chroma siting.
+	TMS_FRAME_DESCRIPTOR rgb = Color(0);
+	rgb.ChromaSiting = 0;
+	rgb.NominalRange = MFNominalRange_0_255;
+	LONG before = pSample->AttributeCalls;
+	FrameDescription::SetColor(pSample, pDescriptor, rgb);
+	CHECK_EQUAL(3, pSample->AttributeCalls - before);
+
+	UINT32 value;
+	CHECK_EQUAL(MF_E_ATTRIBUTENOTFOUND, pSample->GetUINT32(MF_MT_YUV_MATRIX, &value));
+	CHECK_EQUAL(MF_E_ATTRIBUTENOTFOUND, pSample->GetUINT32(MF_MT_VIDEO_CHROMA_SITING, &value));
+	CHECK_EQUAL(S_OK, pSample->GetUINT32(MF_MT_VIDEO_NOMINAL_RANGE, &value));
+	CHECK_EQUAL((UINT32)MFNominalRange_0_255, value);
+
+	// The times and the flags come from the sample itself.
+	pSample->SetSampleFlags(1);
+	FrameDescription::SetTimes(pSample, pDescriptor, 7, 1234);
+	CHECK_EQUAL(400000, pDescriptor->Frame.SampleTime);
+	CHECK_EQUAL(FRAME_DURATION, pDescriptor->Frame.SampleDuration);
+	CHECK_EQUAL(1u, pDescriptor->Frame.SampleFlags);
+	CHECK_EQUAL(7u, pDescriptor->Frame.SourceIndex);
+	CHECK_EQUAL(1234, pDescriptor->Frame.ProcessTime);
+
+	pSample->Release();
+}
+
+TEST_MAIN()